@@ -0,0 +1,268 @@
+#include "alloc_profile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+
+// Sampling allocation profiler. ton_malloc counts allocated bytes down and
+// calls alloc_profile_sample roughly every `rate` bytes; each sample charges
+// `rate` bytes to the C callsite, the Ton line being executed and the Ton
+// call stack. The profiler's own bookkeeping uses plain malloc so it neither
+// shows up in nor recurses into the heap it measures.
+
+#define PROFILE_TABLE_SIZE 1024
+#define PROFILE_KEY_MAX 4096
+
+typedef struct ProfileEntry {
+    char* key;                    // "file.c:line" site or collapsed stack
+    const char* c_file;           // C callsite (site table only)
+    int c_line;
+    int ton_line;                 // Ton line at the time of the sample
+    size_t samples;               // Number of samples charged here
+    size_t bytes;                 // Estimated bytes allocated here
+    struct ProfileEntry* next;    // Next entry in the same bucket
+} ProfileEntry;
+
+typedef struct ProfileFrame {
+    const char* function_name;    // Ton function entered
+    int call_line;                // Caller's line at the call
+} ProfileFrame;
+
+int alloc_profile_line = 0;
+long long alloc_profile_countdown = LLONG_MAX;
+
+static int profiling = 0;
+static size_t sample_rate = ALLOC_PROFILE_DEFAULT_RATE;
+static char* output_path = NULL;
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+static size_t total_samples = 0;
+static size_t total_bytes = 0;
+
+static ProfileEntry* sites[PROFILE_TABLE_SIZE];
+static ProfileEntry* stacks[PROFILE_TABLE_SIZE];
+
+static ProfileFrame frames[ALLOC_PROFILE_MAX_DEPTH];
+static int frame_depth = 0;
+
+static long long next_interval(void) {
+    // Uniform in [1, 2 * rate] so periodic allocation patterns cannot alias
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (long long)(rng_state % (2 * (uint64_t)sample_rate)) + 1;
+}
+
+static unsigned int hash_key(const char* key) {
+    unsigned int hash = 2166136261u;
+    while (*key) {
+        hash ^= (unsigned char)*key++;
+        hash *= 16777619u;
+    }
+    return hash & (PROFILE_TABLE_SIZE - 1);
+}
+
+// strdup is POSIX, not C11; copy with plain malloc like the rest of the bookkeeping
+static char* copy_string(const char* s) {
+    size_t len = strlen(s) + 1;
+    char* copy = (char*)malloc(len);
+    if (copy) memcpy(copy, s, len);
+    return copy;
+}
+
+static ProfileEntry* table_find_or_add(ProfileEntry** table, const char* key) {
+    unsigned int bucket = hash_key(key);
+    for (ProfileEntry* e = table[bucket]; e; e = e->next) {
+        if (strcmp(e->key, key) == 0) return e;
+    }
+    ProfileEntry* e = (ProfileEntry*)calloc(1, sizeof(ProfileEntry));
+    if (!e) return NULL;
+    e->key = copy_string(key);
+    if (!e->key) {
+        free(e);
+        return NULL;
+    }
+    e->next = table[bucket];
+    table[bucket] = e;
+    return e;
+}
+
+static const char* base_name(const char* path) {
+    const char* name = path;
+    for (const char* p = path; *p; p++) {
+        if (*p == '/' || *p == '\\') name = p + 1;
+    }
+    return name;
+}
+
+/**
+ * Enable sampling
+ * @param rate Mean number of allocated bytes between samples
+ * @param path File receiving collapsed stacks at exit
+ */
+void alloc_profile_start(size_t rate, const char* path) {
+    sample_rate = rate > 0 ? rate : ALLOC_PROFILE_DEFAULT_RATE;
+    free(output_path);
+    output_path = copy_string(path);
+    if (!output_path) return;
+    profiling = 1;
+    alloc_profile_countdown = next_interval();
+}
+
+int alloc_profile_enabled(void) {
+    return profiling;
+}
+
+/**
+ * Record one sample for an allocation that exhausted the countdown
+ * @param size Size of the allocation
+ * @param file C source file of the callsite
+ * @param line C source line of the callsite
+ */
+void alloc_profile_sample(size_t size, const char* file, int line) {
+    if (!profiling) {
+        alloc_profile_countdown = LLONG_MAX;
+        return;
+    }
+    alloc_profile_countdown = next_interval();
+
+    // A sample stands for `rate` bytes; larger blocks are charged in full
+    size_t weight = size > sample_rate ? size : sample_rate;
+    const char* c_file = base_name(file);
+    total_samples++;
+    total_bytes += weight;
+
+    char key[PROFILE_KEY_MAX];
+    snprintf(key, sizeof(key), "%s:%d@%d", c_file, line, alloc_profile_line);
+    ProfileEntry* site = table_find_or_add(sites, key);
+    if (site) {
+        site->c_file = c_file;
+        site->c_line = line;
+        site->ton_line = alloc_profile_line;
+        site->samples++;
+        site->bytes += weight;
+    }
+
+    // Collapsed stack: <toplevel>:line;fn:line;...;file.c:line
+    int depth = frame_depth < ALLOC_PROFILE_MAX_DEPTH ? frame_depth : ALLOC_PROFILE_MAX_DEPTH;
+    size_t used = 0;
+    int outer_line = depth > 0 ? frames[0].call_line : alloc_profile_line;
+    used += snprintf(key + used, sizeof(key) - used, "<toplevel>:%d", outer_line);
+    for (int i = 0; i < depth && used < sizeof(key); i++) {
+        int frame_line = i + 1 < depth ? frames[i + 1].call_line : alloc_profile_line;
+        used += snprintf(key + used, sizeof(key) - used, ";%s:%d", frames[i].function_name, frame_line);
+    }
+    if (used < sizeof(key)) {
+        snprintf(key + used, sizeof(key) - used, ";%s:%d", c_file, line);
+    }
+    ProfileEntry* stack = table_find_or_add(stacks, key);
+    if (stack) {
+        stack->samples++;
+        stack->bytes += weight;
+    }
+}
+
+void alloc_profile_enter(const char* function_name) {
+    if (!profiling) return;
+    if (frame_depth < ALLOC_PROFILE_MAX_DEPTH) {
+        frames[frame_depth].function_name = function_name ? function_name : "<anonymous>";
+        frames[frame_depth].call_line = alloc_profile_line;
+    }
+    frame_depth++;
+}
+
+void alloc_profile_leave(void) {
+    if (!profiling || frame_depth == 0) return;
+    frame_depth--;
+    if (frame_depth < ALLOC_PROFILE_MAX_DEPTH) {
+        // Resume attributing to the caller's line
+        alloc_profile_line = frames[frame_depth].call_line;
+    }
+}
+
+static int compare_by_bytes(const void* a, const void* b) {
+    const ProfileEntry* ea = *(const ProfileEntry* const*)a;
+    const ProfileEntry* eb = *(const ProfileEntry* const*)b;
+    if (ea->bytes != eb->bytes) return ea->bytes < eb->bytes ? 1 : -1;
+    return strcmp(ea->key, eb->key);
+}
+
+static void print_top_sites(void) {
+    size_t count = 0;
+    for (int i = 0; i < PROFILE_TABLE_SIZE; i++) {
+        for (ProfileEntry* e = sites[i]; e; e = e->next) count++;
+    }
+
+    fprintf(stderr, "--- Allocation Profile (1 sample per ~%llu bytes, %llu samples) ---\n",
+            (unsigned long long)sample_rate, (unsigned long long)total_samples);
+    if (count == 0) {
+        fprintf(stderr, "No allocations sampled\n");
+        return;
+    }
+
+    ProfileEntry** sorted = (ProfileEntry**)malloc(sizeof(ProfileEntry*) * count);
+    if (!sorted) return;
+    size_t n = 0;
+    for (int i = 0; i < PROFILE_TABLE_SIZE; i++) {
+        for (ProfileEntry* e = sites[i]; e; e = e->next) sorted[n++] = e;
+    }
+    qsort(sorted, count, sizeof(ProfileEntry*), compare_by_bytes);
+
+    fprintf(stderr, "%14s %7s %8s  %-28s %s\n", "bytes", "share", "samples", "C callsite", "Ton line");
+    for (size_t i = 0; i < count && i < ALLOC_PROFILE_TOP_N; i++) {
+        char site[64];
+        snprintf(site, sizeof(site), "%s:%d", sorted[i]->c_file, sorted[i]->c_line);
+        fprintf(stderr, "%14llu %6.1f%% %8llu  %-28s %d\n",
+                (unsigned long long)sorted[i]->bytes, 100.0 * (double)sorted[i]->bytes / (double)total_bytes,
+                (unsigned long long)sorted[i]->samples, site, sorted[i]->ton_line);
+    }
+    free(sorted);
+}
+
+static int write_collapsed_stacks(void) {
+    FILE* out = fopen(output_path, "w");
+    if (!out) return 0;
+    for (int i = 0; i < PROFILE_TABLE_SIZE; i++) {
+        for (ProfileEntry* e = stacks[i]; e; e = e->next) {
+            fprintf(out, "%s %llu\n", e->key, (unsigned long long)e->bytes);
+        }
+    }
+    fclose(out);
+    return 1;
+}
+
+static void free_table(ProfileEntry** table) {
+    for (int i = 0; i < PROFILE_TABLE_SIZE; i++) {
+        ProfileEntry* e = table[i];
+        while (e) {
+            ProfileEntry* next = e->next;
+            free(e->key);
+            free(e);
+            e = next;
+        }
+        table[i] = NULL;
+    }
+}
+
+/**
+ * Stop sampling, print the top callsites to stderr and write the collapsed
+ * stacks (flamegraph.pl / pprof compatible) to the output file
+ */
+void alloc_profile_finish(void) {
+    if (!profiling) return;
+    profiling = 0;
+    alloc_profile_countdown = LLONG_MAX;
+
+    print_top_sites();
+    if (write_collapsed_stacks()) {
+        fprintf(stderr, "Collapsed allocation stacks written to %s\n", output_path);
+    } else {
+        fprintf(stderr, "Could not write allocation profile to %s\n", output_path);
+    }
+
+    free_table(sites);
+    free_table(stacks);
+    free(output_path);
+    output_path = NULL;
+    frame_depth = 0;
+}
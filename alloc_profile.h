@@ -0,0 +1,29 @@
+#ifndef TON_ALLOC_PROFILE_H
+#define TON_ALLOC_PROFILE_H
+
+#include <stddef.h>
+
+#define ALLOC_PROFILE_DEFAULT_RATE (512 * 1024)   // Mean bytes allocated between samples
+#define ALLOC_PROFILE_TOP_N 20                    // Rows in the summary table
+#define ALLOC_PROFILE_MAX_DEPTH 128               // Ton frames recorded per sample
+
+// Line of the Ton statement currently executing (maintained by the interpreter)
+extern int alloc_profile_line;
+
+// Bytes left until the next sample. Stays out of reach while profiling is
+// off, so the allocation fast path is a single subtract-and-compare.
+extern long long alloc_profile_countdown;
+
+// Profiler control
+void alloc_profile_start(size_t rate, const char* output_path);
+int  alloc_profile_enabled(void);
+void alloc_profile_finish(void);
+
+// Called by ton_malloc when the countdown runs out
+void alloc_profile_sample(size_t size, const char* file, int line);
+
+// Ton call stack tracking
+void alloc_profile_enter(const char* function_name);
+void alloc_profile_leave(void);
+
+#endif // TON_ALLOC_PROFILE_H
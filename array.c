@@ -1,64 +1,107 @@
 #include "array.h"
+#include "gc.h"
+#include "memory.h"
 #include <stdlib.h>
 #include <string.h>
 
 TonArray* create_static_array(size_t length) {
-    TonArray* a = (TonArray*)malloc(sizeof(TonArray));
+    TonArray* a = (TonArray*)gc_alloc(GC_KIND_ARRAY, sizeof(TonArray));
     if (!a) return NULL;
     a->kind = ARRAY_STATIC;
     a->length = length;
     a->capacity = length;
-    a->elements = (Value*)calloc(length, sizeof(Value));
+    a->elements.boxed = (Value*)ton_calloc(length > 0 ? length : 1, sizeof(Value));
+    a->element_kind = ELEMENTS_BOXED;
     a->element_type_name = NULL;
+    a->locked = 0;
     return a;
 }
 
 TonArray* create_dynamic_array(size_t initial_capacity) {
-    TonArray* a = (TonArray*)malloc(sizeof(TonArray));
+    TonArray* a = (TonArray*)gc_alloc(GC_KIND_ARRAY, sizeof(TonArray));
     if (!a) return NULL;
     a->kind = ARRAY_DYNAMIC;
     a->length = 0;
     a->capacity = initial_capacity > 0 ? initial_capacity : 4;
-    a->elements = (Value*)calloc(a->capacity, sizeof(Value));
+    a->elements.boxed = (Value*)ton_calloc(a->capacity, sizeof(Value));
+    a->element_kind = ELEMENTS_BOXED;
     a->element_type_name = NULL;
+    a->locked = 0;
     return a;
 }
 
 void destroy_array(TonArray* arr) {
     if (!arr) return;
-    if (arr->elements) {
-        // Note: currently Value has no value_free here; we assume plain values
-        free(arr->elements);
+    if (arr->elements.raw) {
+        if (arr->element_kind == ELEMENTS_BOXED) {
+            for (size_t i = 0; i < arr->length; i++) {
+                value_release(&arr->elements.boxed[i]);
+            }
+        }
+        ton_free(arr->elements.raw);
     }
-    free(arr);
+    ton_free((void*)arr->element_type_name);
+    gc_free(arr);
 }
 
 int array_push(TonArray* arr, Value v) {
-    if (!arr || arr->kind != ARRAY_DYNAMIC) return 0;
+    if (!arr || arr->kind != ARRAY_DYNAMIC || arr->locked) return 0;
+    if (!elements_accept(&arr->element_kind, &arr->elements, arr->length, arr->capacity, &v)) return 0;
     if (arr->length >= arr->capacity) {
         size_t new_cap = arr->capacity * 2;
-        Value* t = (Value*)realloc(arr->elements, new_cap * sizeof(Value));
+        void* t = ton_realloc(arr->elements.raw, new_cap * element_size(arr->element_kind));
         if (!t) return 0;
-        arr->elements = t; arr->capacity = new_cap;
+        arr->elements.raw = t; arr->capacity = new_cap;
+    }
+    if (arr->element_kind == ELEMENTS_BOXED) {
+        arr->elements.boxed[arr->length++] = value_copy(&v);
+        gc_write_barrier(arr, &v);
+    } else {
+        elements_store(arr->element_kind, arr->elements, arr->length++, &v);
     }
-    arr->elements[arr->length++] = v;
     return 1;
 }
 
 Value array_pop(TonArray* arr) {
     Value out; out.type = VALUE_INT; out.data.int_val = 0;
-    if (!arr || arr->kind != ARRAY_DYNAMIC || arr->length == 0) return out;
-    return arr->elements[--arr->length];
+    if (!arr || arr->kind != ARRAY_DYNAMIC || arr->length == 0 || arr->locked) return out;
+    return elements_load(arr->element_kind, arr->elements, --arr->length);
 }
 
 Value array_get(const TonArray* arr, size_t index) {
     Value out; out.type = VALUE_INT; out.data.int_val = 0;
     if (!arr || index >= arr->length) return out;
-    return arr->elements[index];
+    return elements_load(arr->element_kind, arr->elements, index);
 }
 
 int array_set(TonArray* arr, size_t index, Value v) {
-    if (!arr || index >= arr->length) return 0;
-    arr->elements[index] = v;
+    if (!arr || arr->locked || index >= arr->length) return 0;
+    if (!elements_accept(&arr->element_kind, &arr->elements, arr->length, arr->capacity, &v)) return 0;
+    if (arr->element_kind != ELEMENTS_BOXED) {
+        elements_store(arr->element_kind, arr->elements, index, &v);
+        return 1;
+    }
+    value_release(&arr->elements.boxed[index]);
+    arr->elements.boxed[index] = value_copy(&v);
+    gc_write_barrier(arr, &v);
     return 1;
-}
\ No newline at end of file
+}
+
+// Declare the element type ("int", "float", "bool", "char"/"byte"); an
+// empty array switches to the matching unboxed storage right away
+int array_set_element_type(TonArray* arr, const char* type_name) {
+    if (!arr || !type_name || arr->locked) return 0;
+    char* name = ton_strdup(type_name);
+    if (!name) return 0;
+    ton_free((void*)arr->element_type_name);
+    arr->element_type_name = name;
+
+    ElementKind kind = element_kind_for_type_name(type_name);
+    if (arr->length == 0 && kind != arr->element_kind) {
+        void* t = ton_realloc(arr->elements.raw, element_size(kind) * (arr->capacity > 0 ? arr->capacity : 1));
+        if (!t) return 0;
+        arr->elements.raw = t;
+        arr->element_kind = kind;
+    }
+    return 1;
+}
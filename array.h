@@ -3,6 +3,7 @@
 
 #include <stddef.h>
 #include "interpreter.h"
+#include "elements.h"
 
 typedef enum { ARRAY_STATIC, ARRAY_DYNAMIC } ArrayKind;
 
@@ -10,8 +11,10 @@ typedef struct TonArray {
     ArrayKind kind;
     size_t length;
     size_t capacity;
-    Value* elements;
+    ElementData elements;          // Laid out according to `element_kind`
+    ElementKind element_kind;      // Unboxed while homogeneous or declared primitive
     const char* element_type_name;
+    int locked;                    // Set while a native sort calls back into Ton; mutators refuse
 } TonArray;
 
 TonArray* create_static_array(size_t length);
@@ -22,5 +25,6 @@ int       array_push(TonArray* arr, Value v);
 Value     array_pop(TonArray* arr);
 Value     array_get(const TonArray* arr, size_t index);
 int       array_set(TonArray* arr, size_t index, Value v);
+int       array_set_element_type(TonArray* arr, const char* type_name);
 
 #endif // TON_ARRAY_H
\ No newline at end of file
@@ -0,0 +1,572 @@
+#include "art.h"
+#include "gc.h"
+#include "memory.h"
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ART_USE_SSE2 1
+#else
+#define ART_USE_SSE2 0
+#endif
+
+// Shrink thresholds sit below the grow points so a node hovering around a
+// boundary does not convert back and forth
+#define ART_NODE16_SHRINK 3
+#define ART_NODE48_SHRINK 12
+#define ART_NODE256_SHRINK 37
+
+static inline int lowest_bit(uint32_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(mask);
+#else
+    int i = 0;
+    while (!(mask & 1)) { mask >>= 1; i++; }
+    return i;
+#endif
+}
+
+// ---------------------------------------------------------------------------
+// Nodes and leaves
+
+static unsigned char* node_prefix(ArtNode* node) {
+    return node->prefix_len > ART_PREFIX_INLINE ? node->prefix.heap : node->prefix.bytes;
+}
+
+// Replace a node's prefix; `bytes` may point into the current one. Leaves
+// the node unchanged and returns 0 if out of memory.
+static int set_prefix(ArtNode* node, const unsigned char* bytes, uint32_t len) {
+    unsigned char inline_bytes[ART_PREFIX_INLINE];
+    unsigned char* heap = NULL;
+    if (len > ART_PREFIX_INLINE) {
+        heap = (unsigned char*)ton_malloc(len);
+        if (!heap) return 0;
+        memcpy(heap, bytes, len);
+    } else {
+        memcpy(inline_bytes, bytes, len);
+    }
+    if (node->prefix_len > ART_PREFIX_INLINE) ton_free(node->prefix.heap);
+    if (heap) {
+        node->prefix.heap = heap;
+    } else {
+        memcpy(node->prefix.bytes, inline_bytes, len);
+    }
+    node->prefix_len = len;
+    return 1;
+}
+
+static ArtNode* alloc_node(uint8_t type) {
+    size_t size;
+    switch (type) {
+        case ART_NODE4:  size = sizeof(ArtNode4); break;
+        case ART_NODE16: size = sizeof(ArtNode16); break;
+        case ART_NODE48: size = sizeof(ArtNode48); break;
+        default:         size = sizeof(ArtNode256); break;
+    }
+    ArtNode* node = (ArtNode*)ton_calloc(1, size);
+    if (node) node->type = type;
+    return node;
+}
+
+// Move the child count and prefix of `from` into a node of another size
+static void move_header(ArtNode* to, ArtNode* from) {
+    to->child_count = from->child_count;
+    to->prefix_len = from->prefix_len;
+    to->prefix = from->prefix;
+    from->prefix_len = 0;
+}
+
+static void free_node_shell(ArtNode* node) {
+    if (node->prefix_len > ART_PREFIX_INLINE) ton_free(node->prefix.heap);
+    ton_free(node);
+}
+
+static ArtLeaf* make_leaf(const unsigned char* key, uint32_t key_len, const Value* value) {
+    ArtLeaf* leaf = (ArtLeaf*)ton_malloc(sizeof(ArtLeaf) + key_len);
+    if (!leaf) return NULL;
+    leaf->value = value_copy(value);
+    leaf->key_len = key_len;
+    memcpy(leaf->key, key, key_len);
+    return leaf;
+}
+
+static void free_leaf(ArtLeaf* leaf) {
+    value_release(&leaf->value);
+    ton_free(leaf);
+}
+
+static int leaf_matches(const ArtLeaf* leaf, const unsigned char* key, uint32_t key_len) {
+    return leaf->key_len == key_len && memcmp(leaf->key, key, key_len) == 0;
+}
+
+static void free_tree(ArtNode* node) {
+    if (!node) return;
+    if (ART_IS_LEAF(node)) {
+        free_leaf(ART_LEAF(node));
+        return;
+    }
+    switch (node->type) {
+        case ART_NODE4:
+            for (int i = 0; i < node->child_count; i++) free_tree(((ArtNode4*)node)->children[i]);
+            break;
+        case ART_NODE16:
+            for (int i = 0; i < node->child_count; i++) free_tree(((ArtNode16*)node)->children[i]);
+            break;
+        case ART_NODE48:
+            for (int i = 0; i < 48; i++) free_tree(((ArtNode48*)node)->children[i]);
+            break;
+        default:
+            for (int i = 0; i < 256; i++) free_tree(((ArtNode256*)node)->children[i]);
+            break;
+    }
+    free_node_shell(node);
+}
+
+// Slot holding the child for `byte`, or NULL
+static ArtNode** find_child(ArtNode* node, unsigned char byte) {
+    switch (node->type) {
+        case ART_NODE4: {
+            ArtNode4* n = (ArtNode4*)node;
+            for (int i = 0; i < node->child_count; i++) {
+                if (n->keys[i] == byte) return &n->children[i];
+            }
+            return NULL;
+        }
+        case ART_NODE16: {
+            ArtNode16* n = (ArtNode16*)node;
+#if ART_USE_SSE2
+            __m128i match = _mm_cmpeq_epi8(_mm_set1_epi8((char)byte), _mm_loadu_si128((const __m128i*)n->keys));
+            uint32_t mask = (uint32_t)_mm_movemask_epi8(match) & ((1u << node->child_count) - 1);
+            return mask ? &n->children[lowest_bit(mask)] : NULL;
+#else
+            for (int i = 0; i < node->child_count; i++) {
+                if (n->keys[i] == byte) return &n->children[i];
+            }
+            return NULL;
+#endif
+        }
+        case ART_NODE48: {
+            ArtNode48* n = (ArtNode48*)node;
+            return n->child_index[byte] ? &n->children[n->child_index[byte] - 1] : NULL;
+        }
+        default: {
+            ArtNode256* n = (ArtNode256*)node;
+            return n->children[byte] ? &n->children[byte] : NULL;
+        }
+    }
+}
+
+// Bytes of the node's prefix that match key[depth..]
+static uint32_t prefix_match(ArtNode* node, const unsigned char* key, uint32_t key_len, uint32_t depth) {
+    const unsigned char* prefix = node_prefix(node);
+    uint32_t limit = node->prefix_len < key_len - depth ? node->prefix_len : key_len - depth;
+    uint32_t i = 0;
+    while (i < limit && prefix[i] == key[depth + i]) i++;
+    return i;
+}
+
+// ---------------------------------------------------------------------------
+// Adding children (growing nodes as they fill)
+
+static void add_sorted(unsigned char* keys, ArtNode** children, int count, unsigned char byte, ArtNode* child) {
+    int i = 0;
+    while (i < count && keys[i] < byte) i++;
+    memmove(&keys[i + 1], &keys[i], (size_t)(count - i));
+    memmove(&children[i + 1], &children[i], sizeof(ArtNode*) * (size_t)(count - i));
+    keys[i] = byte;
+    children[i] = child;
+}
+
+// Add a child for `byte`, which must not have one yet. The node may be
+// replaced by a larger one, which is stored through `ref`. Returns 0 if out of memory.
+static int add_child(ArtNode* node, ArtNode** ref, unsigned char byte, ArtNode* child) {
+    switch (node->type) {
+        case ART_NODE4: {
+            ArtNode4* n = (ArtNode4*)node;
+            if (node->child_count < 4) {
+                add_sorted(n->keys, n->children, node->child_count, byte, child);
+                node->child_count++;
+                return 1;
+            }
+            ArtNode16* grown = (ArtNode16*)alloc_node(ART_NODE16);
+            if (!grown) return 0;
+            move_header(&grown->node, node);
+            memcpy(grown->keys, n->keys, 4);
+            memcpy(grown->children, n->children, sizeof(ArtNode*) * 4);
+            free_node_shell(node);
+            *ref = &grown->node;
+            return add_child(&grown->node, ref, byte, child);
+        }
+        case ART_NODE16: {
+            ArtNode16* n = (ArtNode16*)node;
+            if (node->child_count < 16) {
+                add_sorted(n->keys, n->children, node->child_count, byte, child);
+                node->child_count++;
+                return 1;
+            }
+            ArtNode48* grown = (ArtNode48*)alloc_node(ART_NODE48);
+            if (!grown) return 0;
+            move_header(&grown->node, node);
+            for (int i = 0; i < 16; i++) {
+                grown->children[i] = n->children[i];
+                grown->child_index[n->keys[i]] = (unsigned char)(i + 1);
+            }
+            free_node_shell(node);
+            *ref = &grown->node;
+            return add_child(&grown->node, ref, byte, child);
+        }
+        case ART_NODE48: {
+            ArtNode48* n = (ArtNode48*)node;
+            if (node->child_count < 48) {
+                int slot = 0;
+                while (n->children[slot]) slot++;    // Removals leave holes
+                n->children[slot] = child;
+                n->child_index[byte] = (unsigned char)(slot + 1);
+                node->child_count++;
+                return 1;
+            }
+            ArtNode256* grown = (ArtNode256*)alloc_node(ART_NODE256);
+            if (!grown) return 0;
+            move_header(&grown->node, node);
+            for (int b = 0; b < 256; b++) {
+                if (n->child_index[b]) grown->children[b] = n->children[n->child_index[b] - 1];
+            }
+            free_node_shell(node);
+            *ref = &grown->node;
+            return add_child(&grown->node, ref, byte, child);
+        }
+        default:
+            ((ArtNode256*)node)->children[byte] = child;
+            node->child_count++;
+            return 1;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Removing children (shrinking nodes as they empty)
+
+static void remove_sorted(unsigned char* keys, ArtNode** children, int count, int i) {
+    memmove(&keys[i], &keys[i + 1], (size_t)(count - i - 1));
+    memmove(&children[i], &children[i + 1], sizeof(ArtNode*) * (size_t)(count - i - 1));
+}
+
+// A Node4 left with one child is replaced by that child, with the node's
+// prefix and branch byte folded into the child's prefix. If that needs memory
+// that is not available the node simply stays, which is still valid.
+static void collapse_node4(ArtNode4* n, ArtNode** ref) {
+    ArtNode* child = n->children[0];
+    if (!ART_IS_LEAF(child)) {
+        uint32_t len = n->node.prefix_len + 1 + child->prefix_len;
+        unsigned char* joined = (unsigned char*)ton_malloc(len);
+        if (!joined) return;
+        memcpy(joined, node_prefix(&n->node), n->node.prefix_len);
+        joined[n->node.prefix_len] = n->keys[0];
+        memcpy(joined + n->node.prefix_len + 1, node_prefix(child), child->prefix_len);
+        int ok = set_prefix(child, joined, len);
+        ton_free(joined);
+        if (!ok) return;
+    }
+    *ref = child;
+    free_node_shell(&n->node);
+}
+
+// Remove the child in `slot` (the one for `byte`); the node may be replaced
+// by a smaller one through `ref`
+static void remove_child(ArtNode* node, ArtNode** ref, unsigned char byte, ArtNode** slot) {
+    switch (node->type) {
+        case ART_NODE4: {
+            ArtNode4* n = (ArtNode4*)node;
+            remove_sorted(n->keys, n->children, node->child_count, (int)(slot - n->children));
+            node->child_count--;
+            if (node->child_count == 1) collapse_node4(n, ref);
+            return;
+        }
+        case ART_NODE16: {
+            ArtNode16* n = (ArtNode16*)node;
+            remove_sorted(n->keys, n->children, node->child_count, (int)(slot - n->children));
+            node->child_count--;
+            if (node->child_count != ART_NODE16_SHRINK) return;
+            ArtNode4* shrunk = (ArtNode4*)alloc_node(ART_NODE4);
+            if (!shrunk) return;
+            move_header(&shrunk->node, node);
+            memcpy(shrunk->keys, n->keys, ART_NODE16_SHRINK);
+            memcpy(shrunk->children, n->children, sizeof(ArtNode*) * ART_NODE16_SHRINK);
+            free_node_shell(node);
+            *ref = &shrunk->node;
+            return;
+        }
+        case ART_NODE48: {
+            ArtNode48* n = (ArtNode48*)node;
+            *slot = NULL;
+            n->child_index[byte] = 0;
+            node->child_count--;
+            if (node->child_count != ART_NODE48_SHRINK) return;
+            ArtNode16* shrunk = (ArtNode16*)alloc_node(ART_NODE16);
+            if (!shrunk) return;
+            move_header(&shrunk->node, node);
+            int count = 0;
+            for (int b = 0; b < 256; b++) {
+                if (!n->child_index[b]) continue;
+                shrunk->keys[count] = (unsigned char)b;
+                shrunk->children[count++] = n->children[n->child_index[b] - 1];
+            }
+            free_node_shell(node);
+            *ref = &shrunk->node;
+            return;
+        }
+        default: {
+            ArtNode256* n = (ArtNode256*)node;
+            *slot = NULL;
+            node->child_count--;
+            if (node->child_count != ART_NODE256_SHRINK) return;
+            ArtNode48* shrunk = (ArtNode48*)alloc_node(ART_NODE48);
+            if (!shrunk) return;
+            move_header(&shrunk->node, node);
+            int count = 0;
+            for (int b = 0; b < 256; b++) {
+                if (!n->children[b]) continue;
+                shrunk->children[count] = n->children[b];
+                shrunk->child_index[b] = (unsigned char)(++count);
+            }
+            free_node_shell(node);
+            *ref = &shrunk->node;
+            return;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Tree operations
+
+TonART* tonart_create(void) {
+    return gc_alloc(GC_KIND_ART, sizeof(TonART));
+}
+
+void tonart_destroy(TonART* art) {
+    if (!art) return;
+    free_tree(art->root);
+    gc_free(art);
+}
+
+static int insert_at(ArtNode** ref, const unsigned char* key, uint32_t key_len, uint32_t depth, const Value* value) {
+    ArtNode* node = *ref;
+    if (!node) {
+        ArtLeaf* leaf = make_leaf(key, key_len, value);
+        if (!leaf) return -1;
+        *ref = ART_TAG_LEAF(leaf);
+        return 1;
+    }
+
+    if (ART_IS_LEAF(node)) {
+        ArtLeaf* existing = ART_LEAF(node);
+        if (leaf_matches(existing, key, key_len)) {
+            value_release(&existing->value);
+            existing->value = value_copy(value);
+            return 0;
+        }
+        // Two keys share this slot: branch where they first differ. Keys
+        // end in NUL, so neither runs out before that byte.
+        const unsigned char* other = (const unsigned char*)existing->key;
+        uint32_t common = 0;
+        while (other[depth + common] == key[depth + common]) common++;
+        ArtNode4* branch = (ArtNode4*)alloc_node(ART_NODE4);
+        ArtLeaf* leaf = make_leaf(key, key_len, value);
+        if (!branch || !leaf || !set_prefix(&branch->node, key + depth, common)) {
+            ton_free(branch);
+            if (leaf) free_leaf(leaf);
+            return -1;
+        }
+        add_child(&branch->node, NULL, other[depth + common], node);
+        add_child(&branch->node, NULL, key[depth + common], ART_TAG_LEAF(leaf));
+        *ref = &branch->node;
+        return 1;
+    }
+
+    if (node->prefix_len) {
+        uint32_t matched = prefix_match(node, key, key_len, depth);
+        if (matched < node->prefix_len) {
+            // The key leaves the prefix early: split it at the first difference
+            unsigned char* prefix = node_prefix(node);
+            unsigned char old_byte = prefix[matched];
+            ArtNode4* branch = (ArtNode4*)alloc_node(ART_NODE4);
+            ArtLeaf* leaf = make_leaf(key, key_len, value);
+            if (!branch || !leaf || !set_prefix(&branch->node, prefix, matched) ||
+                !set_prefix(node, prefix + matched + 1, node->prefix_len - matched - 1)) {
+                if (branch) free_node_shell(&branch->node);
+                if (leaf) free_leaf(leaf);
+                return -1;
+            }
+            add_child(&branch->node, NULL, old_byte, node);
+            add_child(&branch->node, NULL, key[depth + matched], ART_TAG_LEAF(leaf));
+            *ref = &branch->node;
+            return 1;
+        }
+        depth += node->prefix_len;
+    }
+
+    ArtNode** child = find_child(node, key[depth]);
+    if (child) return insert_at(child, key, key_len, depth + 1, value);
+
+    ArtLeaf* leaf = make_leaf(key, key_len, value);
+    if (!leaf) return -1;
+    if (!add_child(node, ref, key[depth], ART_TAG_LEAF(leaf))) {
+        free_leaf(leaf);
+        return -1;
+    }
+    return 1;
+}
+
+int tonart_insert(TonART* art, const char* key, Value value) {
+    int inserted = insert_at(&art->root, (const unsigned char*)key, (uint32_t)strlen(key) + 1, 0, &value);
+    if (inserted < 0) return -1;
+    gc_write_barrier(art, &value);
+    if (inserted) {
+        art->size++;
+        art->version++;
+    }
+    return inserted;
+}
+
+static const ArtLeaf* find_leaf(const TonART* art, const unsigned char* key, uint32_t key_len) {
+    ArtNode* node = art->root;
+    uint32_t depth = 0;
+    while (node) {
+        if (ART_IS_LEAF(node)) {
+            const ArtLeaf* leaf = ART_LEAF(node);
+            return leaf_matches(leaf, key, key_len) ? leaf : NULL;
+        }
+        if (node->prefix_len) {
+            if (prefix_match(node, key, key_len, depth) != node->prefix_len) return NULL;
+            depth += node->prefix_len;
+        }
+        if (depth >= key_len) return NULL;
+        ArtNode** child = find_child(node, key[depth]);
+        node = child ? *child : NULL;
+        depth++;
+    }
+    return NULL;
+}
+
+int tonart_get(const TonART* art, const char* key, Value* out) {
+    const ArtLeaf* leaf = find_leaf(art, (const unsigned char*)key, (uint32_t)strlen(key) + 1);
+    if (!leaf) return 0;
+    *out = leaf->value;
+    return 1;
+}
+
+static int remove_at(ArtNode** ref, const unsigned char* key, uint32_t key_len, uint32_t depth) {
+    ArtNode* node = *ref;
+    if (!node) return 0;
+    if (ART_IS_LEAF(node)) {
+        if (!leaf_matches(ART_LEAF(node), key, key_len)) return 0;
+        free_leaf(ART_LEAF(node));
+        *ref = NULL;
+        return 1;
+    }
+    if (node->prefix_len) {
+        if (prefix_match(node, key, key_len, depth) != node->prefix_len) return 0;
+        depth += node->prefix_len;
+    }
+    if (depth >= key_len) return 0;
+    ArtNode** child = find_child(node, key[depth]);
+    if (!child) return 0;
+    if (!ART_IS_LEAF(*child)) return remove_at(child, key, key_len, depth + 1);
+    if (!leaf_matches(ART_LEAF(*child), key, key_len)) return 0;
+    free_leaf(ART_LEAF(*child));
+    remove_child(node, ref, key[depth], child);
+    return 1;
+}
+
+int tonart_remove(TonART* art, const char* key) {
+    if (!remove_at(&art->root, (const unsigned char*)key, (uint32_t)strlen(key) + 1, 0)) return 0;
+    art->size--;
+    art->version++;
+    return 1;
+}
+
+int tonart_size(const TonART* art) {
+    return art ? art->size : 0;
+}
+
+const ArtLeaf* tonart_longest_prefix(const TonART* art, const char* query) {
+    const unsigned char* q = (const unsigned char*)query;
+    uint32_t q_len = (uint32_t)strlen(query);
+    const ArtLeaf* best = NULL;
+    ArtNode* node = art->root;
+    uint32_t depth = 0;
+    while (node) {
+        if (ART_IS_LEAF(node)) {
+            const ArtLeaf* leaf = ART_LEAF(node);
+            if (leaf->key_len - 1 <= q_len && memcmp(leaf->key, q, leaf->key_len - 1) == 0) best = leaf;
+            break;
+        }
+        if (node->prefix_len) {
+            if (depth + node->prefix_len > q_len || memcmp(node_prefix(node), q + depth, node->prefix_len) != 0) break;
+            depth += node->prefix_len;
+        }
+        // A key equal to the first `depth` bytes of the query hangs off the NUL branch
+        ArtNode** end = find_child(node, 0);
+        if (end) best = ART_LEAF(*end);
+        if (depth >= q_len) break;
+        ArtNode** child = find_child(node, q[depth]);
+        node = child ? *child : NULL;
+        depth++;
+    }
+    return best;
+}
+
+static int visit_all(ArtNode* node, ArtVisitFn visit, void* ctx) {
+    if (ART_IS_LEAF(node)) return visit(ctx, ART_LEAF(node));
+    switch (node->type) {
+        case ART_NODE4:
+            for (int i = 0; i < node->child_count; i++) {
+                if (visit_all(((ArtNode4*)node)->children[i], visit, ctx)) return 1;
+            }
+            return 0;
+        case ART_NODE16:
+            for (int i = 0; i < node->child_count; i++) {
+                if (visit_all(((ArtNode16*)node)->children[i], visit, ctx)) return 1;
+            }
+            return 0;
+        case ART_NODE48: {
+            ArtNode48* n = (ArtNode48*)node;
+            for (int b = 0; b < 256; b++) {
+                if (n->child_index[b] && visit_all(n->children[n->child_index[b] - 1], visit, ctx)) return 1;
+            }
+            return 0;
+        }
+        default: {
+            ArtNode256* n = (ArtNode256*)node;
+            for (int b = 0; b < 256; b++) {
+                if (n->children[b] && visit_all(n->children[b], visit, ctx)) return 1;
+            }
+            return 0;
+        }
+    }
+}
+
+int tonart_iter_prefix(const TonART* art, const char* prefix, ArtVisitFn visit, void* ctx) {
+    const unsigned char* p = (const unsigned char*)prefix;
+    uint32_t p_len = (uint32_t)strlen(prefix);
+    ArtNode* node = art->root;
+    uint32_t depth = 0;
+    while (node) {
+        if (ART_IS_LEAF(node)) {
+            const ArtLeaf* leaf = ART_LEAF(node);
+            if (leaf->key_len - 1 >= p_len && memcmp(leaf->key, p, p_len) == 0) return visit(ctx, leaf);
+            return 0;
+        }
+        if (depth == p_len) return visit_all(node, visit, ctx);
+        if (node->prefix_len) {
+            uint32_t matched = prefix_match(node, p, p_len, depth);
+            // Either the search prefix ends inside this node's prefix, or it must cover all of it
+            if (matched == p_len - depth) return visit_all(node, visit, ctx);
+            if (matched < node->prefix_len) return 0;
+            depth += node->prefix_len;
+        }
+        ArtNode** child = find_child(node, p[depth]);
+        node = child ? *child : NULL;
+        depth++;
+    }
+    return 0;
+}
@@ -0,0 +1,87 @@
+#ifndef TON_ART_H
+#define TON_ART_H
+
+#include "value.h"
+#include <stdint.h>
+
+// TonART - Adaptive radix tree keyed by strings. Each inner node branches on
+// one key byte and comes in four sizes (4, 16, 48 and 256 children), grown
+// and shrunk as children come and go. Runs of bytes with a single child are
+// collapsed into the node's prefix, so a lookup walks at most one node per
+// distinct branching byte and costs O(key length) however many keys there
+// are. Keys are stored with their terminating NUL, which keeps a key that is
+// a prefix of another ("ab", "abc") in its own leaf under the NUL branch.
+
+#define ART_NODE4 1
+#define ART_NODE16 2
+#define ART_NODE48 3
+#define ART_NODE256 4
+
+#define ART_PREFIX_INLINE 12           // Longer prefixes live in a separate buffer
+
+// Leaves are tagged by setting the low bit of the child pointer
+#define ART_IS_LEAF(node) (((uintptr_t)(node)) & 1)
+#define ART_LEAF(node) ((ArtLeaf*)((uintptr_t)(node) & ~(uintptr_t)1))
+#define ART_TAG_LEAF(leaf) ((ArtNode*)((uintptr_t)(leaf) | 1))
+
+typedef struct {
+    uint8_t type;
+    uint16_t child_count;
+    uint32_t prefix_len;          // Bytes every key below this node shares at this depth
+    union {
+        unsigned char bytes[ART_PREFIX_INLINE];
+        unsigned char* heap;      // When prefix_len > ART_PREFIX_INLINE
+    } prefix;
+} ArtNode;
+
+typedef struct {
+    ArtNode node;
+    unsigned char keys[4];        // Sorted
+    ArtNode* children[4];
+} ArtNode4;
+
+typedef struct {
+    ArtNode node;
+    unsigned char keys[16];       // Sorted
+    ArtNode* children[16];
+} ArtNode16;
+
+typedef struct {
+    ArtNode node;
+    unsigned char child_index[256]; // Slot + 1 in `children`, 0 if no child
+    ArtNode* children[48];
+} ArtNode48;
+
+typedef struct {
+    ArtNode node;
+    ArtNode* children[256];
+} ArtNode256;
+
+typedef struct {
+    Value value;
+    uint32_t key_len;             // Including the terminating NUL
+    char key[];
+} ArtLeaf;
+
+typedef struct {
+    ArtNode* root;                // Inner node or tagged leaf; NULL when empty
+    int size;
+    unsigned version;             // Bumped by every insert of a new key and every removal
+} TonART;
+
+// Called for each leaf in key order; return nonzero to stop the walk
+typedef int (*ArtVisitFn)(void* ctx, const ArtLeaf* leaf);
+
+TonART* tonart_create(void);
+void tonart_destroy(TonART* art);
+// Returns 1 if the key is new, 0 if its value was replaced, -1 if out of memory
+int tonart_insert(TonART* art, const char* key, Value value);
+int tonart_get(const TonART* art, const char* key, Value* out);
+int tonart_remove(TonART* art, const char* key);
+int tonart_size(const TonART* art);
+// Leaf of the longest key that is a prefix of `query`, or NULL
+const ArtLeaf* tonart_longest_prefix(const TonART* art, const char* query);
+// Visit every key starting with `prefix`, in key order; returns 1 if stopped early
+int tonart_iter_prefix(const TonART* art, const char* prefix, ArtVisitFn visit, void* ctx);
+
+#endif // TON_ART_H
@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include "token.h"
+#include "memory.h"
 #include <string.h> // Dodaj to
 #include <stdbool.h> // Dodaj to
 
@@ -9,12 +10,12 @@
 void free_type_node(TypeNode* type_node) {
     if (!type_node) return;
     if (type_node->type_name) {
-        free(type_node->type_name);
+        ton_free(type_node->type_name);
     }
     if (type_node->base_type) {
         free_type_node(type_node->base_type);
     }
-    free(type_node);
+    ton_free(type_node);
 }
 
 void free_ast_node(ASTNode* node) {
@@ -26,14 +27,14 @@ void free_ast_node(ASTNode* node) {
             for (int i = 0; i < program->num_statements; i++) {
                 free_ast_node(program->statements[i]);
             }
-            free(program->statements);
+            ton_free(program->statements);
             // free(program); // Removed: ASTNode is freed at the end of the function
             break;
         }
         case NODE_VAR_DECLARATION:
         {
             VariableDeclarationNode* var_decl = (VariableDeclarationNode*)node;
-            free(var_decl->identifier); // Free the duplicated string
+            ton_free(var_decl->identifier); // Free the duplicated string
             if (var_decl->initializer) {
                 free_ast_node(var_decl->initializer);
             }
@@ -45,7 +46,7 @@ void free_ast_node(ASTNode* node) {
             for (int i = 0; i < fn_decl->num_parameters; i++) {
                 free_ast_node((ASTNode*)fn_decl->parameters[i]);
             }
-            free(fn_decl->parameters);
+            ton_free(fn_decl->parameters);
             // No need to free fn_decl->return_type as it's an enum now
             free_ast_node((ASTNode*)fn_decl->body);
             // free(fn_decl); // This line is incorrect, fn_decl is part of the ASTNode
@@ -54,18 +55,18 @@ void free_ast_node(ASTNode* node) {
         case NODE_STRUCT_DECLARATION: {
             struct StructDeclarationNode* struct_decl = (struct StructDeclarationNode*)node;
             if (struct_decl->name) {
-                free(struct_decl->name);
+                ton_free(struct_decl->name);
             }
             if (struct_decl->fields) {
                 for (int i = 0; i < struct_decl->num_fields; i++) {
                     if (struct_decl->fields[i].name) {
-                        free((void*)struct_decl->fields[i].name);
+                        ton_free((void*)struct_decl->fields[i].name);
                     }
                     if (struct_decl->fields[i].type_name) {
-                        free((void*)struct_decl->fields[i].type_name);
+                        ton_free((void*)struct_decl->fields[i].type_name);
                     }
                 }
-                free(struct_decl->fields);
+                ton_free(struct_decl->fields);
             }
             // Free methods
             if (struct_decl->methods) {
@@ -74,10 +75,10 @@ void free_ast_node(ASTNode* node) {
                         free_ast_node((ASTNode*)struct_decl->methods[i].function);
                     }
                     if (struct_decl->methods[i].name) {
-                        free((void*)struct_decl->methods[i].name);
+                        ton_free((void*)struct_decl->methods[i].name);
                     }
                 }
-                free(struct_decl->methods);
+                ton_free(struct_decl->methods);
             }
             break;
         }
@@ -86,7 +87,7 @@ void free_ast_node(ASTNode* node) {
             for (int i = 0; i < block->num_statements; i++) {
                 free_ast_node(block->statements[i]);
             }
-            free(block->statements);
+            ton_free(block->statements);
             // free(block); // Removed: ASTNode is freed at the end of the function
             break;
         }
@@ -101,7 +102,7 @@ void free_ast_node(ASTNode* node) {
             LoopStatementNode* loop_stmt = (LoopStatementNode*)node;
             if (loop_stmt->iterator) {
                 free_token(loop_stmt->iterator);
-                free(loop_stmt->iterator);
+                ton_free(loop_stmt->iterator);
             }
             free_ast_node(loop_stmt->start_expr);
             free_ast_node(loop_stmt->end_expr);
@@ -117,12 +118,20 @@ void free_ast_node(ASTNode* node) {
             if (for_stmt->body) free_ast_node((ASTNode*)for_stmt->body);
             break;
         }
+        case NODE_FOR_IN_STATEMENT: {
+            ForInStatementNode* for_in = (ForInStatementNode*)node;
+            ton_free(for_in->first_name);
+            ton_free(for_in->second_name);
+            free_ast_node(for_in->iterable);
+            free_ast_node((ASTNode*)for_in->body);
+            break;
+        }
         case NODE_ARRAY_LITERAL_EXPRESSION: {
             ArrayLiteralExpressionNode* array_lit = (ArrayLiteralExpressionNode*)node;
             for (int i = 0; i < array_lit->num_elements; i++) {
                 if (array_lit->elements[i]) free_ast_node(array_lit->elements[i]);
             }
-            if (array_lit->elements) free(array_lit->elements);
+            if (array_lit->elements) ton_free(array_lit->elements);
             break;
         }
         case NODE_ARRAY_ACCESS_EXPRESSION: {
@@ -192,7 +201,7 @@ void free_ast_node(ASTNode* node) {
         }
         case NODE_IDENTIFIER_EXPRESSION: {
             IdentifierExpressionNode* id_expr = (IdentifierExpressionNode*)node;
-            free(id_expr->identifier); // Free the duplicated string
+            ton_free(id_expr->identifier); // Free the duplicated string
             break;
         }
         case NODE_FN_CALL_EXPRESSION: {
@@ -201,7 +210,7 @@ void free_ast_node(ASTNode* node) {
             for (int i = 0; i < fn_call->num_arguments; i++) {
                 free_ast_node(fn_call->arguments[i]);
             }
-            free(fn_call->arguments);
+            ton_free(fn_call->arguments);
             break;
         }
         case NODE_PARAMETER: {
@@ -217,7 +226,7 @@ void free_ast_node(ASTNode* node) {
             for (int i = 0; i < switch_stmt->num_cases; i++) {
                 free_ast_node((ASTNode*)switch_stmt->cases[i]);
             }
-            free(switch_stmt->cases);
+            ton_free(switch_stmt->cases);
             break;
         }
         case NODE_CASE_STATEMENT: {
@@ -226,7 +235,7 @@ void free_ast_node(ASTNode* node) {
             for (int i = 0; i < case_stmt->num_statements; i++) {
                 free_ast_node(case_stmt->statements[i]);
             }
-            free(case_stmt->statements);
+            ton_free(case_stmt->statements);
             break;
         }
         case NODE_BREAK_STATEMENT: {
@@ -247,11 +256,11 @@ void free_ast_node(ASTNode* node) {
         }
         case NODE_NEW_EXPRESSION: {
             NewExpressionNode* new_expr = (NewExpressionNode*)node;
-            free(new_expr->class_name);
+            ton_free(new_expr->class_name);
             for (int i = 0; i < new_expr->num_arguments; i++) {
                 free_ast_node(new_expr->arguments[i]);
             }
-            free(new_expr->arguments);
+            ton_free(new_expr->arguments);
             break;
         }
         case NODE_IMPORT_STATEMENT: {
@@ -282,7 +291,7 @@ void free_ast_node(ASTNode* node) {
             for (int i = 0; i < try_stmt->num_catch_blocks; i++) {
                 free_ast_node((ASTNode*)try_stmt->catch_blocks[i]);
             }
-            free(try_stmt->catch_blocks);
+            ton_free(try_stmt->catch_blocks);
             if (try_stmt->finally_block) {
                 free_ast_node((ASTNode*)try_stmt->finally_block);
             }
@@ -291,10 +300,10 @@ void free_ast_node(ASTNode* node) {
         case NODE_CATCH_STATEMENT: {
             CatchStatementNode* catch_stmt = (CatchStatementNode*)node;
             if (catch_stmt->exception_type) {
-                free(catch_stmt->exception_type);
+                ton_free(catch_stmt->exception_type);
             }
             if (catch_stmt->exception_var) {
-                free(catch_stmt->exception_var);
+                ton_free(catch_stmt->exception_var);
             }
             if (catch_stmt->catch_block) {
                 free_ast_node((ASTNode*)catch_stmt->catch_block);
@@ -322,7 +331,7 @@ void free_ast_node(ASTNode* node) {
         // Add more cases for other node types as they are implemented
     }
 
-    free(node);
+    ton_free(node);
 }
 
 #include "error.h"
@@ -351,6 +360,9 @@ IdentifierExpressionNode* create_identifier_expression_node(const char* identifi
     node->base.type = NODE_IDENTIFIER_EXPRESSION;
     node->base.line = line;
     node->base.column = column;
+    node->is_this = 0;
+    node->this_type = NULL;
+    node->this_slot = -1;
     node->identifier = strdup(identifier);
     if (!node->identifier) {
         perror("Failed to duplicate identifier string");
@@ -462,6 +474,7 @@ ASTNode* create_new_expression_node(const char* class_name, ASTNode** arguments,
         perror("Failed to duplicate class name string");
         exit(EXIT_FAILURE);
     }
+    node->cached_type = NULL;
     
     // Copy arguments array
     if (num_arguments > 0) {
@@ -14,6 +14,7 @@ typedef struct BlockStatementNode BlockStatementNode;
 typedef struct IfStatementNode IfStatementNode;
 typedef struct LoopStatementNode LoopStatementNode;
 typedef struct ForStatementNode ForStatementNode;
+typedef struct ForInStatementNode ForInStatementNode;
 typedef struct WhileStatementNode WhileStatementNode;
 typedef struct SwitchStatementNode SwitchStatementNode;
 typedef struct CaseStatementNode CaseStatementNode;
@@ -47,6 +48,7 @@ typedef struct MacroCallExpressionNode MacroCallExpressionNode;
 typedef struct ArrayLiteralExpressionNode ArrayLiteralExpressionNode;
 typedef struct ArrayAccessExpressionNode ArrayAccessExpressionNode;
 typedef struct MemberAccessExpressionNode MemberAccessExpressionNode;
+typedef struct MethodCallExpressionNode MethodCallExpressionNode;
 typedef struct NewExpressionNode NewExpressionNode;
 typedef struct ParameterNode ParameterNode;
 typedef struct TypeNode TypeNode;
@@ -61,6 +63,7 @@ typedef enum {
     NODE_IF_STATEMENT,
     NODE_LOOP_STATEMENT,
     NODE_FOR_STATEMENT,
+    NODE_FOR_IN_STATEMENT,      // for k, v in collection { ... }
     NODE_WHILE_STATEMENT,
     NODE_SWITCH_STATEMENT,
     NODE_CASE_STATEMENT,
@@ -209,6 +212,18 @@ struct ForStatementNode {
     ASTNode* condition; // Loop condition (can be NULL)
     ASTNode* update; // Update expression (can be NULL)
     BlockStatementNode* body; // Loop body
+    int bounds_analyzed; // Set once the body has been scanned for hoistable bounds checks
+};
+
+// For-In Statement Node: for item in collection { ... } / for k, v in map { ... }
+struct ForInStatementNode {
+    ASTNodeType type;
+    int line;
+    int column;
+    char* first_name;   // Map key, or list/array/set element; list/array index when second_name is set
+    char* second_name;  // Map value or list/array element; NULL in the single-variable form
+    ASTNode* iterable;
+    BlockStatementNode* body;
 };
 
 // While Statement Node: while (condition) { ... }
@@ -307,6 +322,7 @@ struct ClassDeclarationNode {
     char* parent_name;          // for inheritance (extends)
     char** field_names;
     VariableType* field_types;
+    char** field_type_names;    // class name of struct-typed fields, NULL for others
     int* field_access;          // access modifiers for fields
     int num_fields;
     FunctionDeclarationNode** methods;
@@ -379,6 +395,10 @@ struct LiteralExpressionNode {
 struct IdentifierExpressionNode {
     ASTNode base; // Embed base ASTNode
     char* identifier; // The identifier string
+    int is_this; // The `this` keyword, read from the method frame
+    // Inline cache for identifiers that resolve to a field of `this`
+    const TonStructType* this_type; // Last instance type seen, NULL if none
+    int this_slot; // Slot of the field in that type
 };
 
 // Function Call Expression Node: myFunction(arg1, arg2)
@@ -410,6 +430,7 @@ struct ArrayAccessExpressionNode {
     ASTNode base; // Embed base ASTNode
     ASTNode* array; // Array expression
     ASTNode* index; // Index expression
+    int bounds_hoisted; // 1 when the enclosing counted loop already guarantees 0 <= index < len(array)
 };
 
 // Member Access Expression Node: obj.field, this.x
@@ -417,15 +438,31 @@ struct MemberAccessExpressionNode {
     ASTNode base; // Embed base ASTNode
     ASTNode* object; // Object expression (e.g., 'this', 'obj')
     char* member; // Member name (e.g., 'x', 'field')
+    // Inline cache: the slot of `member` in the last instance type seen here
+    const TonStructType* cached_type; // NULL until the first access
+    int cached_slot;
 };
 
+// Polymorphic inline cache entries kept per method call site
+#define METHOD_CACHE_SIZE 4
+
+typedef struct {
+    const TonStructType* type;
+    StructMethod* method;
+} MethodCacheEntry;
+
 // Method Call Expression Node: obj.method(args...)
 struct MethodCallExpressionNode {
     ASTNode base; // Embed base ASTNode
     ASTNode* object; // Object expression
     char* method_name; // Name of the method
     ASTNode** arguments; // Array of argument expressions
-    int num_arguments; // Number of arguments\n};
+    int num_arguments; // Number of arguments
+    // Methods resolved at this site for the instance types seen so far. Once
+    // more than METHOD_CACHE_SIZE types show up the site is megamorphic and
+    // every call looks the method up in the vtable.
+    MethodCacheEntry cache[METHOD_CACHE_SIZE];
+    int cache_count;
 };
 
 // New Expression Node: new ClassName(args...)
@@ -434,6 +471,7 @@ struct NewExpressionNode {
     char* class_name; // Name of the class to instantiate
     ASTNode** arguments; // Array of argument expressions
     int num_arguments; // Number of arguments
+    TonStructType* cached_type; // Class resolved by the first evaluation; NULL until then
 };
 
 // Type Node: Represents a type (e.g., int, float, bool)
@@ -1,6 +1,13 @@
 #include "builtin.h"
 #include "builtin_tonlib.h"
 #include "builtin_crypto.h"
+#include "builtin_memory.h"
+#include "builtin_sort.h"
+#include "builtin_queue.h"
+#include "builtin_persistent.h"
+#include "builtin_sketch.h"
+#include "builtin_cache.h"
+#include "builtin_soa.h"
 #include "io.h"
 #include "bitops.h"
 #include "array.h"
@@ -32,6 +39,27 @@ void install_builtins(Environment* env) {
     // Install Crypto built-in functions
     install_crypto_builtins(env);
 
+    // Install garbage collector and memory built-in functions
+    install_memory_builtins(env);
+
+    // Install sorting and searching built-in functions
+    install_sort_builtins(env);
+
+    // Install deque and priority queue built-in functions
+    install_queue_builtins(env);
+
+    // Install persistent vector and map built-in functions
+    install_persistent_builtins(env);
+
+    // Install Bloom filter, HyperLogLog and bitmap built-in functions
+    install_sketch_builtins(env);
+
+    // Install bounded LRU / W-TinyLFU cache built-in functions
+    install_cache_builtins(env);
+
+    // Install struct-of-arrays built-in functions
+    install_soa_builtins(env);
+
     // Install TonLib Low-level built-in functions
     // register_tonlib_low_functions(env); // Commented out due to missing assembly functions
 
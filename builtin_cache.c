@@ -0,0 +1,184 @@
+#include "builtin_cache.h"
+#include "builtin.h"
+#include "cache.h"
+#include "collections.h"
+#include "memory.h"
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+static TonCache* cache_arg(Value* args, int arg_count, int expected) {
+    if (arg_count != expected || args[0].type != VALUE_TONCACHE) return NULL;
+    return (TonCache*)args[0].data.toncache_val;
+}
+
+static Value count_value(uint64_t count) {
+    return create_value_int(count > INT_MAX ? INT_MAX : (int)count);
+}
+
+static Value unhashable_error(const char* name) {
+    char message[64];
+    snprintf(message, sizeof(message), "%s: key is not hashable", name);
+    return create_value_error(message);
+}
+
+// cache_create(capacity [, policy [, max_bytes]]) -> empty cache; policy is "lru" (default) or "tinylfu"
+Value cache_builtin_create(Value* args, int arg_count) {
+    if (arg_count < 1 || arg_count > 3 || args[0].type != VALUE_INT ||
+        (arg_count >= 2 && args[1].type != VALUE_STRING) ||
+        (arg_count == 3 && (args[2].type != VALUE_INT || args[2].data.int_val < 0))) {
+        return create_value_error("cache_create expects a capacity, an optional policy and an optional byte budget");
+    }
+    int policy = CACHE_LRU;
+    if (arg_count >= 2) {
+        if (strcmp(args[1].data.string_val, "tinylfu") == 0) {
+            policy = CACHE_TINYLFU;
+        } else if (strcmp(args[1].data.string_val, "lru") != 0) {
+            return create_value_error("cache_create: policy must be \"lru\" or \"tinylfu\"");
+        }
+    }
+    if (args[0].data.int_val < 1) {
+        return create_value_error("cache_create: capacity must be at least 1");
+    }
+    size_t max_bytes = arg_count == 3 ? (size_t)args[2].data.int_val : 0;
+    TonCache* cache = toncache_create(args[0].data.int_val, policy, max_bytes);
+    if (!cache) {
+        return create_value_error("Failed to create cache");
+    }
+    return create_value_toncache(cache);
+}
+
+// cache_get(cache, key) -> cached value, or null on a miss
+Value cache_builtin_get(Value* args, int arg_count) {
+    TonCache* cache = cache_arg(args, arg_count, 2);
+    if (!cache) {
+        return create_value_error("cache_get expects a cache and a key");
+    }
+    Value item;
+    if (!toncache_get(cache, &args[1], &item)) {
+        return create_value_null();
+    }
+    return value_copy(&item);
+}
+
+// cache_has(cache, key) -> bool, without counting a hit or refreshing the entry
+Value cache_builtin_has(Value* args, int arg_count) {
+    TonCache* cache = cache_arg(args, arg_count, 2);
+    if (!cache) {
+        return create_value_error("cache_has expects a cache and a key");
+    }
+    Value item;
+    return create_value_bool(toncache_peek(cache, &args[1], &item));
+}
+
+// cache_put(cache, key, value) -> true if the value is cached, false if it alone exceeds the byte budget
+Value cache_builtin_put(Value* args, int arg_count) {
+    TonCache* cache = cache_arg(args, arg_count, 3);
+    if (!cache) {
+        return create_value_error("cache_put expects a cache, a key and a value");
+    }
+    if (!tonmap_key_hashable(&args[1])) {
+        return unhashable_error("cache_put");
+    }
+    int stored = toncache_put(cache, &args[1], args[2]);
+    if (stored < 0) {
+        return create_value_error("cache_put: out of memory");
+    }
+    return create_value_bool(stored);
+}
+
+// cache_remove(cache, key) -> true if the key was cached
+Value cache_builtin_remove(Value* args, int arg_count) {
+    TonCache* cache = cache_arg(args, arg_count, 2);
+    if (!cache) {
+        return create_value_error("cache_remove expects a cache and a key");
+    }
+    return create_value_bool(toncache_remove(cache, &args[1]));
+}
+
+// cache_size(cache) -> number of cached entries
+Value cache_builtin_size(Value* args, int arg_count) {
+    TonCache* cache = cache_arg(args, arg_count, 1);
+    if (!cache) {
+        return create_value_error("cache_size expects a cache");
+    }
+    return create_value_int(toncache_size(cache));
+}
+
+// cache_bytes(cache) -> estimated bytes of the cached entries
+Value cache_builtin_bytes(Value* args, int arg_count) {
+    TonCache* cache = cache_arg(args, arg_count, 1);
+    if (!cache) {
+        return create_value_error("cache_bytes expects a cache");
+    }
+    return count_value(cache->bytes);
+}
+
+// cache_clear(cache) -> true; drops every entry but keeps the counters
+Value cache_builtin_clear(Value* args, int arg_count) {
+    TonCache* cache = cache_arg(args, arg_count, 1);
+    if (!cache) {
+        return create_value_error("cache_clear expects a cache");
+    }
+    toncache_clear(cache);
+    return create_value_bool(1);
+}
+
+// cache_stats(cache) -> map of hits, misses, evictions, size, bytes and hit_rate
+Value cache_builtin_stats(Value* args, int arg_count) {
+    TonCache* cache = cache_arg(args, arg_count, 1);
+    if (!cache) {
+        return create_value_error("cache_stats expects a cache");
+    }
+    TonMap* map = tonmap_create();
+    if (!map) {
+        return create_value_error("cache_stats: allocation failed");
+    }
+    uint64_t lookups = cache->hits + cache->misses;
+    tonmap_set(map, "hits", count_value(cache->hits));
+    tonmap_set(map, "misses", count_value(cache->misses));
+    tonmap_set(map, "evictions", count_value(cache->evictions));
+    tonmap_set(map, "size", create_value_int(cache->size));
+    tonmap_set(map, "bytes", count_value(cache->bytes));
+    tonmap_set(map, "hit_rate", create_value_float(lookups ? (double)cache->hits / (double)lookups : 0.0));
+    return create_value_tonmap(map);
+}
+
+void install_cache_builtins(Environment* env) {
+    env_add_function(env, "cache_create", make_builtin_fn("cache_create"));
+    env_add_function(env, "cache_get", make_builtin_fn("cache_get"));
+    env_add_function(env, "cache_has", make_builtin_fn("cache_has"));
+    env_add_function(env, "cache_put", make_builtin_fn("cache_put"));
+    env_add_function(env, "cache_remove", make_builtin_fn("cache_remove"));
+    env_add_function(env, "cache_size", make_builtin_fn("cache_size"));
+    env_add_function(env, "cache_bytes", make_builtin_fn("cache_bytes"));
+    env_add_function(env, "cache_clear", make_builtin_fn("cache_clear"));
+    env_add_function(env, "cache_stats", make_builtin_fn("cache_stats"));
+}
+
+int is_cache_function(const char* function_name) {
+    return strncmp(function_name, "cache_", 6) == 0;
+}
+
+Value call_cache_function(const char* function_name, Value* args, int arg_count) {
+    if (strcmp(function_name, "cache_create") == 0) {
+        return cache_builtin_create(args, arg_count);
+    } else if (strcmp(function_name, "cache_get") == 0) {
+        return cache_builtin_get(args, arg_count);
+    } else if (strcmp(function_name, "cache_has") == 0) {
+        return cache_builtin_has(args, arg_count);
+    } else if (strcmp(function_name, "cache_put") == 0) {
+        return cache_builtin_put(args, arg_count);
+    } else if (strcmp(function_name, "cache_remove") == 0) {
+        return cache_builtin_remove(args, arg_count);
+    } else if (strcmp(function_name, "cache_size") == 0) {
+        return cache_builtin_size(args, arg_count);
+    } else if (strcmp(function_name, "cache_bytes") == 0) {
+        return cache_builtin_bytes(args, arg_count);
+    } else if (strcmp(function_name, "cache_clear") == 0) {
+        return cache_builtin_clear(args, arg_count);
+    } else if (strcmp(function_name, "cache_stats") == 0) {
+        return cache_builtin_stats(args, arg_count);
+    }
+    return create_value_error("Unknown cache function");
+}
@@ -0,0 +1,27 @@
+#ifndef TON_BUILTIN_CACHE_H
+#define TON_BUILTIN_CACHE_H
+
+#include "interpreter.h"
+#include "environment.h"
+
+// Cache module initialization
+void install_cache_builtins(Environment* env);
+
+// True for the names handled by call_cache_function
+int is_cache_function(const char* function_name);
+
+// Cache function dispatcher
+Value call_cache_function(const char* function_name, Value* args, int arg_count);
+
+// Bounded LRU / W-TinyLFU caches
+Value cache_builtin_create(Value* args, int arg_count);
+Value cache_builtin_get(Value* args, int arg_count);
+Value cache_builtin_has(Value* args, int arg_count);
+Value cache_builtin_put(Value* args, int arg_count);
+Value cache_builtin_remove(Value* args, int arg_count);
+Value cache_builtin_size(Value* args, int arg_count);
+Value cache_builtin_bytes(Value* args, int arg_count);
+Value cache_builtin_clear(Value* args, int arg_count);
+Value cache_builtin_stats(Value* args, int arg_count);
+
+#endif // TON_BUILTIN_CACHE_H
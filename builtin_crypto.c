@@ -18,7 +18,10 @@
 #include "builtin.h"
 #include "sha256.h"
 #include "md5.h"
+#include "digest.h"
 #include "memory.h"
+#include "collections.h"
+#include "array.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -125,6 +128,200 @@ Value crypto_sha256_hash(Value* args, int arg_count) {
     return result;
 }
 
+// `hex` needs room for len * 2 + 1 chars
+static void digest_to_hex(const BYTE* hash, size_t len, char* hex) {
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < len; i++) {
+        hex[i * 2] = digits[hash[i] >> 4];
+        hex[i * 2 + 1] = digits[hash[i] & 15];
+    }
+    hex[len * 2] = '\0';
+}
+
+// sha256_many(list) -> list of hex digests, one per string, hashed as a batch
+Value crypto_sha256_many(Value* args, int arg_count) {
+    if (arg_count != 1 || args[0].type != VALUE_TONLIST) {
+        return create_value_error("sha256_many requires a list of strings");
+    }
+    TonList* input = (TonList*)args[0].data.tonlist_val;
+    int count = tonlist_size(input);
+    for (int i = 0; i < count; i++) {
+        if (tonlist_get(input, i).type != VALUE_STRING) {
+            return create_value_error("sha256_many requires a list of strings");
+        }
+    }
+
+    const BYTE** data = (const BYTE**)ton_malloc((count > 0 ? count : 1) * sizeof(BYTE*));
+    size_t* lens = (size_t*)ton_malloc((count > 0 ? count : 1) * sizeof(size_t));
+    BYTE (*hashes)[SHA256_BLOCK_SIZE] = ton_malloc((count > 0 ? count : 1) * SHA256_BLOCK_SIZE);
+    TonList* output = tonlist_create();
+    if (!data || !lens || !hashes || !output) {
+        ton_free(data);
+        ton_free(lens);
+        ton_free(hashes);
+        return create_value_error("Memory allocation failed");
+    }
+    for (int i = 0; i < count; i++) {
+        const char* s = tonlist_get(input, i).data.string_val;
+        data[i] = (const BYTE*)s;
+        lens[i] = strlen(s);
+    }
+    int ok = sha256_many(data, lens, (size_t)count, hashes);
+    ton_free(data);
+    ton_free(lens);
+    if (!ok) {
+        ton_free(hashes);
+        return create_value_error("Memory allocation failed");
+    }
+
+    char hex[SHA256_BLOCK_SIZE * 2 + 1];
+    for (int i = 0; i < count; i++) {
+        digest_to_hex(hashes[i], SHA256_BLOCK_SIZE, hex);
+        Value digest = create_value_string(hex);
+        tonlist_push(output, digest);
+        value_release(&digest);
+    }
+    ton_free(hashes);
+    return create_value_tonlist(output);
+}
+
+// sha256_backend([name]) -> implementation in use; with a name, switches to it first
+Value crypto_sha256_backend(Value* args, int arg_count) {
+    if (arg_count > 1 || (arg_count == 1 && args[0].type != VALUE_STRING)) {
+        return create_value_error("sha256_backend takes an optional backend name");
+    }
+    if (arg_count == 1 && !sha256_set_backend(args[0].data.string_val)) {
+        return create_value_error("sha256_backend: unknown backend or not supported by this CPU");
+    }
+    return create_value_string(sha256_backend());
+}
+
+static int digest_algorithm_arg(Value* args, int arg_count, int index) {
+    if (arg_count <= index) return DIGEST_SHA256;
+    if (args[index].type != VALUE_STRING) return -1;
+    return tondigest_algorithm(args[index].data.string_val);
+}
+
+// A byte element: a char, or an int from 0 to 255
+static int byte_of(const Value* v, BYTE* out) {
+    if (v->type == VALUE_CHAR) {
+        *out = (BYTE)v->data.char_val;
+        return 1;
+    }
+    if (v->type == VALUE_INT && v->data.int_val >= 0 && v->data.int_val <= 255) {
+        *out = (BYTE)v->data.int_val;
+        return 1;
+    }
+    return 0;
+}
+
+// Feed a list or array of bytes to the digest. Char storage is hashed in
+// place; other storage is checked first, then converted a chunk at a time.
+static int digest_update_elements(TonDigest* digest, ElementKind kind, ElementData data, size_t length) {
+    if (kind == ELEMENTS_CHAR) {
+        tondigest_update(digest, data.bytes, length);
+        return 1;
+    }
+    if (kind != ELEMENTS_INT32 && kind != ELEMENTS_BOXED) return length == 0;
+    BYTE chunk[4096];
+    for (size_t i = 0; i < length; i++) {
+        Value v = elements_load(kind, data, i);
+        if (!byte_of(&v, &chunk[0])) return 0;
+    }
+    for (size_t start = 0; start < length; start += sizeof(chunk)) {
+        size_t n = length - start < sizeof(chunk) ? length - start : sizeof(chunk);
+        for (size_t i = 0; i < n; i++) {
+            Value v = elements_load(kind, data, start + i);
+            byte_of(&v, &chunk[i]);
+        }
+        tondigest_update(digest, chunk, n);
+    }
+    return 1;
+}
+
+// hash_new([algorithm]) -> incremental digest; "sha256" (the default) or "md5"
+Value crypto_hash_new(Value* args, int arg_count) {
+    int algorithm = arg_count > 1 ? -1 : digest_algorithm_arg(args, arg_count, 0);
+    if (algorithm < 0) {
+        return create_value_error("hash_new takes an optional algorithm: \"sha256\" or \"md5\"");
+    }
+    TonDigest* digest = tondigest_create(algorithm);
+    if (!digest) {
+        return create_value_error("Memory allocation failed");
+    }
+    return create_value_tondigest(digest);
+}
+
+// hash_update(h, data) -> true; data is a string or a list or array of bytes
+Value crypto_hash_update(Value* args, int arg_count) {
+    if (arg_count != 2 || args[0].type != VALUE_TONDIGEST) {
+        return create_value_error("hash_update expects a digest and data");
+    }
+    TonDigest* digest = (TonDigest*)args[0].data.tondigest_val;
+    if (digest->finished) {
+        return create_value_error("hash_update: digest is already finished");
+    }
+    int ok;
+    switch (args[1].type) {
+        case VALUE_STRING:
+            tondigest_update(digest, (const BYTE*)args[1].data.string_val, strlen(args[1].data.string_val));
+            ok = 1;
+            break;
+        case VALUE_TONLIST: {
+            TonList* list = (TonList*)args[1].data.tonlist_val;
+            ok = digest_update_elements(digest, list->kind, list->data, (size_t)list->size);
+            break;
+        }
+        case VALUE_ARRAY: {
+            TonArray* arr = (TonArray*)args[1].data.array_val;
+            ok = digest_update_elements(digest, arr->element_kind, arr->elements, arr->length);
+            break;
+        }
+        default:
+            ok = 0;
+            break;
+    }
+    if (!ok) {
+        return create_value_error("hash_update: data must be a string or a list of bytes (chars or ints 0-255)");
+    }
+    return create_value_bool(1);
+}
+
+// hash_final(h) -> hex digest of everything fed to h; h cannot be updated afterwards
+Value crypto_hash_final(Value* args, int arg_count) {
+    if (arg_count != 1 || args[0].type != VALUE_TONDIGEST) {
+        return create_value_error("hash_final expects a digest");
+    }
+    TonDigest* digest = (TonDigest*)args[0].data.tondigest_val;
+    if (digest->finished) {
+        return create_value_error("hash_final: digest is already finished");
+    }
+    BYTE hash[DIGEST_MAX_SIZE];
+    char hex[DIGEST_MAX_SIZE * 2 + 1];
+    tondigest_final(digest, hash);
+    digest_to_hex(hash, tondigest_size(digest->algorithm), hex);
+    return create_value_string(hex);
+}
+
+// hash_file(path[, algorithm]) -> hex digest of the file, read in 1 MiB chunks
+Value crypto_hash_file(Value* args, int arg_count) {
+    int algorithm = arg_count > 2 ? -1 : digest_algorithm_arg(args, arg_count, 1);
+    if (arg_count < 1 || args[0].type != VALUE_STRING || algorithm < 0) {
+        return create_value_error("hash_file expects a path and an optional algorithm: \"sha256\" or \"md5\"");
+    }
+    BYTE hash[DIGEST_MAX_SIZE];
+    int read = tondigest_file(algorithm, args[0].data.string_val, hash);
+    if (read < 0) {
+        return create_value_error("Memory allocation failed");
+    }
+    if (read == 0) {
+        return create_value_error("hash_file: cannot read file");
+    }
+    char hex[DIGEST_MAX_SIZE * 2 + 1];
+    digest_to_hex(hash, tondigest_size(algorithm), hex);
+    return create_value_string(hex);
+}
+
 Value crypto_md5_hash(Value* args, int arg_count) {
     if (arg_count != 1 || args[0].type != VALUE_STRING) {
         return create_value_error("md5_hash requires exactly one string argument");
@@ -388,6 +585,18 @@ Value call_crypto_function(const char* function_name, Value* args, int arg_count
         return crypto_sha256_hash(args, arg_count);
     } else if (strcmp(function_name, "md5_hash") == 0) {
         return crypto_md5_hash(args, arg_count);
+    } else if (strcmp(function_name, "sha256_many") == 0) {
+        return crypto_sha256_many(args, arg_count);
+    } else if (strcmp(function_name, "sha256_backend") == 0) {
+        return crypto_sha256_backend(args, arg_count);
+    } else if (strcmp(function_name, "hash_new") == 0) {
+        return crypto_hash_new(args, arg_count);
+    } else if (strcmp(function_name, "hash_update") == 0) {
+        return crypto_hash_update(args, arg_count);
+    } else if (strcmp(function_name, "hash_final") == 0) {
+        return crypto_hash_final(args, arg_count);
+    } else if (strcmp(function_name, "hash_file") == 0) {
+        return crypto_hash_file(args, arg_count);
     } else if (strcmp(function_name, "base64_encode_text") == 0) {
         return crypto_base64_encode_text(args, arg_count);
     } else if (strcmp(function_name, "base64_decode_text") == 0) {
@@ -421,6 +630,14 @@ void install_crypto_builtins(Environment* env) {
     // Hash functions
     env_add_function(env, "sha256_hash", make_crypto_builtin_fn("sha256_hash"));
     env_add_function(env, "md5_hash", make_crypto_builtin_fn("md5_hash"));
+    env_add_function(env, "sha256_many", make_crypto_builtin_fn("sha256_many"));
+    env_add_function(env, "sha256_backend", make_crypto_builtin_fn("sha256_backend"));
+    
+    // Incremental digests
+    env_add_function(env, "hash_new", make_crypto_builtin_fn("hash_new"));
+    env_add_function(env, "hash_update", make_crypto_builtin_fn("hash_update"));
+    env_add_function(env, "hash_final", make_crypto_builtin_fn("hash_final"));
+    env_add_function(env, "hash_file", make_crypto_builtin_fn("hash_file"));
     
     // Encoding functions
     env_add_function(env, "base64_encode_text", make_crypto_builtin_fn("base64_encode_text"));
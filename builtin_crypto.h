@@ -13,6 +13,14 @@ Value call_crypto_function(const char* function_name, Value* args, int arg_count
 // Hash functions
 Value crypto_sha256_hash(Value* args, int arg_count);
 Value crypto_md5_hash(Value* args, int arg_count);
+Value crypto_sha256_many(Value* args, int arg_count);
+Value crypto_sha256_backend(Value* args, int arg_count);
+
+// Incremental digests
+Value crypto_hash_new(Value* args, int arg_count);
+Value crypto_hash_update(Value* args, int arg_count);
+Value crypto_hash_final(Value* args, int arg_count);
+Value crypto_hash_file(Value* args, int arg_count);
 
 // Encoding functions
 Value crypto_base64_encode_text(Value* args, int arg_count);
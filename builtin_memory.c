@@ -0,0 +1,203 @@
+#include "builtin_memory.h"
+#include "builtin.h"
+#include "gc.h"
+#include "memory.h"
+#include "collections.h"
+#include <limits.h>
+#include <string.h>
+
+// A size or counter as a Ton int, clamped to INT_MAX so a heap past 2 GiB
+// still compares as large instead of wrapping negative
+static Value size_value(size_t n) {
+    return create_value_int(n > (size_t)INT_MAX ? INT_MAX : (int)n);
+}
+
+// gc_collect() -> bytes reclaimed by a full collection
+Value memory_gc_collect(Value* args, int arg_count) {
+    (void)args;
+    (void)arg_count;
+    return size_value(gc_collect());
+}
+
+// gc_set_threshold(bytes) -> previous threshold
+Value memory_gc_set_threshold(Value* args, int arg_count) {
+    if (arg_count != 1 || args[0].type != VALUE_INT || args[0].data.int_val <= 0) {
+        return create_value_error("gc_set_threshold expects a positive byte count");
+    }
+    size_t previous = gc_get_threshold();
+    gc_set_threshold((size_t)args[0].data.int_val);
+    return size_value(previous);
+}
+
+// gc_threshold() -> current threshold in bytes
+Value memory_gc_threshold(Value* args, int arg_count) {
+    (void)args;
+    (void)arg_count;
+    return size_value(gc_get_threshold());
+}
+
+// gc_live_objects() -> number of objects currently owned by the collector
+Value memory_gc_live_objects(Value* args, int arg_count) {
+    (void)args;
+    (void)arg_count;
+    GcStats stats;
+    gc_get_stats(&stats);
+    return size_value(stats.live_objects);
+}
+
+// gc_minor() -> bytes reclaimed by a young-generation collection
+Value memory_gc_minor(Value* args, int arg_count) {
+    (void)args;
+    (void)arg_count;
+    return size_value(gc_collect_minor());
+}
+
+// gc_set_step_budget(objects) -> previous budget (0 = non-incremental marking)
+Value memory_gc_set_step_budget(Value* args, int arg_count) {
+    if (arg_count != 1 || args[0].type != VALUE_INT || args[0].data.int_val < 0) {
+        return create_value_error("gc_set_step_budget expects a non-negative object count");
+    }
+    size_t previous = gc_get_step_budget();
+    gc_set_step_budget((size_t)args[0].data.int_val);
+    return size_value(previous);
+}
+
+// gc_set_nursery(bytes) -> previous nursery size
+Value memory_gc_set_nursery(Value* args, int arg_count) {
+    if (arg_count != 1 || args[0].type != VALUE_INT || args[0].data.int_val <= 0) {
+        return create_value_error("gc_set_nursery expects a positive byte count");
+    }
+    size_t previous = gc_get_nursery_size();
+    gc_set_nursery_size((size_t)args[0].data.int_val);
+    return size_value(previous);
+}
+
+static void stats_put(TonMap* map, const char* key, size_t value) {
+    tonmap_set(map, key, size_value(value));
+}
+
+// gc_stats() -> map of collector counters and the pause histogram
+Value memory_gc_stats(Value* args, int arg_count) {
+    (void)args;
+    (void)arg_count;
+    static const char* pause_keys[GC_PAUSE_BUCKETS] = {
+        "pauses_10us", "pauses_100us", "pauses_1ms", "pauses_10ms", "pauses_100ms", "pauses_slow"
+    };
+    GcStats stats;
+    gc_get_stats(&stats);
+
+    TonMap* map = tonmap_create();
+    if (!map) return create_value_error("gc_stats: allocation failed");
+    stats_put(map, "collections", stats.collections);
+    stats_put(map, "minor_collections", stats.minor_collections);
+    stats_put(map, "major_collections", stats.major_collections);
+    stats_put(map, "incremental_steps", stats.incremental_steps);
+    stats_put(map, "live_objects", stats.live_objects);
+    stats_put(map, "live_bytes", stats.live_bytes);
+    stats_put(map, "young_objects", stats.young_objects);
+    stats_put(map, "young_bytes", stats.young_bytes);
+    stats_put(map, "promoted_objects", stats.promoted_objects);
+    stats_put(map, "promoted_bytes", stats.promoted_bytes);
+    stats_put(map, "freed_objects", stats.freed_objects);
+    stats_put(map, "freed_bytes", stats.freed_bytes);
+    stats_put(map, "total_pause_us", stats.total_pause_us);
+    stats_put(map, "max_pause_us", stats.max_pause_us);
+    for (int i = 0; i < GC_PAUSE_BUCKETS; i++) {
+        stats_put(map, pause_keys[i], stats.pause_histogram[i]);
+    }
+    stats_put(map, "scratch_peak", ton_scratch_peak());
+    return create_value_tonmap(map);
+}
+
+// mem_usage() -> bytes currently allocated
+Value memory_mem_usage(Value* args, int arg_count) {
+    (void)args;
+    (void)arg_count;
+    return size_value(ton_mem_usage());
+}
+
+// mem_limit() -> hard heap limit in bytes (0 = unlimited)
+Value memory_mem_limit(Value* args, int arg_count) {
+    (void)args;
+    (void)arg_count;
+    return size_value(ton_mem_hard_limit());
+}
+
+// mem_set_limit(bytes) -> previous hard limit. A limit set on the command line
+// can only be tightened, so a script cannot lift the quota it was given.
+Value memory_mem_set_limit(Value* args, int arg_count) {
+    if (arg_count != 1 || args[0].type != VALUE_INT || args[0].data.int_val <= 0) {
+        return create_value_error("mem_set_limit expects a positive byte count");
+    }
+    size_t previous = ton_mem_hard_limit();
+    size_t hard = (size_t)args[0].data.int_val;
+    if (previous && hard > previous) {
+        return create_value_error("mem_set_limit cannot raise the heap limit");
+    }
+    size_t soft = ton_mem_soft_limit();
+    if (!soft || soft > hard) soft = hard / 4 * 3;
+    ton_mem_set_limits(soft, hard);
+    return size_value(previous);
+}
+
+// mem_set_soft_limit(bytes) -> previous soft limit
+Value memory_mem_set_soft_limit(Value* args, int arg_count) {
+    if (arg_count != 1 || args[0].type != VALUE_INT || args[0].data.int_val <= 0) {
+        return create_value_error("mem_set_soft_limit expects a positive byte count");
+    }
+    size_t previous = ton_mem_soft_limit();
+    size_t soft = (size_t)args[0].data.int_val;
+    size_t hard = ton_mem_hard_limit();
+    if (hard && soft > hard) {
+        return create_value_error("mem_set_soft_limit: soft limit is above the hard limit");
+    }
+    ton_mem_set_limits(soft, hard);
+    return size_value(previous);
+}
+
+void install_memory_builtins(Environment* env) {
+    // Garbage collector
+    env_add_function(env, "gc_collect", make_builtin_fn("gc_collect"));
+    env_add_function(env, "gc_set_threshold", make_builtin_fn("gc_set_threshold"));
+    env_add_function(env, "gc_threshold", make_builtin_fn("gc_threshold"));
+    env_add_function(env, "gc_live_objects", make_builtin_fn("gc_live_objects"));
+    env_add_function(env, "gc_minor", make_builtin_fn("gc_minor"));
+    env_add_function(env, "gc_set_step_budget", make_builtin_fn("gc_set_step_budget"));
+    env_add_function(env, "gc_set_nursery", make_builtin_fn("gc_set_nursery"));
+    env_add_function(env, "gc_stats", make_builtin_fn("gc_stats"));
+
+    // Heap limits
+    env_add_function(env, "mem_usage", make_builtin_fn("mem_usage"));
+    env_add_function(env, "mem_limit", make_builtin_fn("mem_limit"));
+    env_add_function(env, "mem_set_limit", make_builtin_fn("mem_set_limit"));
+    env_add_function(env, "mem_set_soft_limit", make_builtin_fn("mem_set_soft_limit"));
+}
+
+Value call_memory_function(const char* function_name, Value* args, int arg_count) {
+    if (strcmp(function_name, "gc_collect") == 0) {
+        return memory_gc_collect(args, arg_count);
+    } else if (strcmp(function_name, "gc_set_threshold") == 0) {
+        return memory_gc_set_threshold(args, arg_count);
+    } else if (strcmp(function_name, "gc_threshold") == 0) {
+        return memory_gc_threshold(args, arg_count);
+    } else if (strcmp(function_name, "gc_live_objects") == 0) {
+        return memory_gc_live_objects(args, arg_count);
+    } else if (strcmp(function_name, "gc_minor") == 0) {
+        return memory_gc_minor(args, arg_count);
+    } else if (strcmp(function_name, "gc_set_step_budget") == 0) {
+        return memory_gc_set_step_budget(args, arg_count);
+    } else if (strcmp(function_name, "gc_set_nursery") == 0) {
+        return memory_gc_set_nursery(args, arg_count);
+    } else if (strcmp(function_name, "gc_stats") == 0) {
+        return memory_gc_stats(args, arg_count);
+    } else if (strcmp(function_name, "mem_usage") == 0) {
+        return memory_mem_usage(args, arg_count);
+    } else if (strcmp(function_name, "mem_limit") == 0) {
+        return memory_mem_limit(args, arg_count);
+    } else if (strcmp(function_name, "mem_set_limit") == 0) {
+        return memory_mem_set_limit(args, arg_count);
+    } else if (strcmp(function_name, "mem_set_soft_limit") == 0) {
+        return memory_mem_set_soft_limit(args, arg_count);
+    }
+    return create_value_null();
+}
@@ -0,0 +1,29 @@
+#ifndef TON_BUILTIN_MEMORY_H
+#define TON_BUILTIN_MEMORY_H
+
+#include "interpreter.h"
+#include "environment.h"
+
+// Memory module initialization
+void install_memory_builtins(Environment* env);
+
+// Memory function dispatcher
+Value call_memory_function(const char* function_name, Value* args, int arg_count);
+
+// Garbage collector control
+Value memory_gc_collect(Value* args, int arg_count);
+Value memory_gc_set_threshold(Value* args, int arg_count);
+Value memory_gc_threshold(Value* args, int arg_count);
+Value memory_gc_live_objects(Value* args, int arg_count);
+Value memory_gc_minor(Value* args, int arg_count);
+Value memory_gc_set_step_budget(Value* args, int arg_count);
+Value memory_gc_set_nursery(Value* args, int arg_count);
+Value memory_gc_stats(Value* args, int arg_count);
+
+// Heap limits
+Value memory_mem_usage(Value* args, int arg_count);
+Value memory_mem_limit(Value* args, int arg_count);
+Value memory_mem_set_limit(Value* args, int arg_count);
+Value memory_mem_set_soft_limit(Value* args, int arg_count);
+
+#endif // TON_BUILTIN_MEMORY_H
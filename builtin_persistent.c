@@ -0,0 +1,348 @@
+#include "builtin_persistent.h"
+#include "builtin.h"
+#include "persistent.h"
+#include "array.h"
+#include <stdio.h>
+#include <string.h>
+
+// Persistent collection argument, or NULL if args[0] is something else or the
+// argument count is wrong
+static TonPVec* pvec_arg(Value* args, int arg_count, int expected) {
+    if (arg_count != expected || args[0].type != VALUE_TONPVEC) return NULL;
+    return (TonPVec*)args[0].data.tonpvec_val;
+}
+
+static TonPMap* pmap_arg(Value* args, int arg_count, int expected) {
+    if (arg_count != expected || args[0].type != VALUE_TONPMAP) return NULL;
+    return (TonPMap*)args[0].data.tonpmap_val;
+}
+
+static Value retired_error(const char* name) {
+    char message[96];
+    snprintf(message, sizeof(message), "%s: transient was already made persistent", name);
+    return create_value_error(message);
+}
+
+static Value pvec_result(TonPVec* vec) {
+    if (!vec) {
+        return create_value_error("Failed to update persistent vector");
+    }
+    return create_value_tonpvec(vec);
+}
+
+static Value pmap_result(TonPMap* map) {
+    if (!map) {
+        return create_value_error("Failed to update persistent map");
+    }
+    return create_value_tonpmap(map);
+}
+
+// pvec_create() -> empty persistent vector
+Value persistent_pvec_create(Value* args, int arg_count) {
+    (void)args;
+    if (arg_count != 0) {
+        return create_value_error("pvec_create expects no arguments");
+    }
+    TonPVec* vec = tonpvec_create();
+    if (!vec) {
+        return create_value_error("Failed to create persistent vector");
+    }
+    return create_value_tonpvec(vec);
+}
+
+// pvec_from(list | array) -> persistent vector of the same elements
+Value persistent_pvec_from(Value* args, int arg_count) {
+    if (arg_count != 1 || (args[0].type != VALUE_TONLIST && args[0].type != VALUE_ARRAY)) {
+        return create_value_error("pvec_from expects a list or an array");
+    }
+    int count = args[0].type == VALUE_TONLIST ? tonlist_size((TonList*)args[0].data.tonlist_val)
+                                              : (int)((TonArray*)args[0].data.array_val)->length;
+    // Built through a transient, so each leaf is allocated once
+    TonPVec* vec = tonpvec_transient(tonpvec_create());
+    for (int i = 0; vec && i < count; i++) {
+        Value item = args[0].type == VALUE_TONLIST ? tonlist_get((TonList*)args[0].data.tonlist_val, i)
+                                                   : array_get((TonArray*)args[0].data.array_val, (size_t)i);
+        vec = tonpvec_push(vec, item);
+    }
+    return pvec_result(tonpvec_persistent(vec));
+}
+
+// pvec_push(vec, value) -> vector with value appended
+Value persistent_pvec_push(Value* args, int arg_count) {
+    TonPVec* vec = pvec_arg(args, arg_count, 2);
+    if (!vec) {
+        return create_value_error("pvec_push expects a persistent vector and a value");
+    }
+    if (vec->retired) return retired_error("pvec_push");
+    return pvec_result(tonpvec_push(vec, args[1]));
+}
+
+// pvec_pop(vec) -> vector without its last element
+Value persistent_pvec_pop(Value* args, int arg_count) {
+    TonPVec* vec = pvec_arg(args, arg_count, 1);
+    if (!vec) {
+        return create_value_error("pvec_pop expects a persistent vector");
+    }
+    if (vec->retired) return retired_error("pvec_pop");
+    if (vec->count == 0) {
+        return create_value_error("pvec_pop: vector is empty");
+    }
+    return pvec_result(tonpvec_pop(vec));
+}
+
+// pvec_set(vec, index, value) -> vector with element `index` replaced
+Value persistent_pvec_set(Value* args, int arg_count) {
+    TonPVec* vec = pvec_arg(args, arg_count, 3);
+    if (!vec || args[1].type != VALUE_INT) {
+        return create_value_error("pvec_set expects a persistent vector, an int index and a value");
+    }
+    if (vec->retired) return retired_error("pvec_set");
+    if (args[1].data.int_val < 0 || args[1].data.int_val >= vec->count) {
+        char message[96];
+        snprintf(message, sizeof(message), "pvec_set: index %d out of range for length %d", args[1].data.int_val, vec->count);
+        return create_value_error(message);
+    }
+    return pvec_result(tonpvec_set(vec, args[1].data.int_val, args[2]));
+}
+
+// pvec_get(vec, index) -> element, or null if out of range
+Value persistent_pvec_get(Value* args, int arg_count) {
+    TonPVec* vec = pvec_arg(args, arg_count, 2);
+    if (!vec || args[1].type != VALUE_INT) {
+        return create_value_error("pvec_get expects a persistent vector and an int index");
+    }
+    Value item = tonpvec_get(vec, args[1].data.int_val);
+    return value_copy(&item);
+}
+
+// pvec_size(vec) -> int
+Value persistent_pvec_size(Value* args, int arg_count) {
+    TonPVec* vec = pvec_arg(args, arg_count, 1);
+    if (!vec) {
+        return create_value_error("pvec_size expects a persistent vector");
+    }
+    return create_value_int(tonpvec_size(vec));
+}
+
+// pvec_to_list(vec) -> new list of the elements
+Value persistent_pvec_to_list(Value* args, int arg_count) {
+    TonPVec* vec = pvec_arg(args, arg_count, 1);
+    if (!vec) {
+        return create_value_error("pvec_to_list expects a persistent vector");
+    }
+    TonList* list = tonlist_create();
+    if (!list) {
+        return create_value_error("Failed to create list");
+    }
+    for (int i = 0; i < vec->count; i++) {
+        if (!tonlist_push(list, tonpvec_get(vec, i))) {
+            return create_value_error("Failed to create list");
+        }
+    }
+    return create_value_tonlist(list);
+}
+
+// pvec_transient(vec) -> transient copy that pvec_push/pop/set update in place
+Value persistent_pvec_transient(Value* args, int arg_count) {
+    TonPVec* vec = pvec_arg(args, arg_count, 1);
+    if (!vec) {
+        return create_value_error("pvec_transient expects a persistent vector");
+    }
+    if (vec->retired) return retired_error("pvec_transient");
+    return pvec_result(tonpvec_transient(vec));
+}
+
+// pvec_persistent(vec) -> persistent version of a transient; the transient is retired
+Value persistent_pvec_persistent(Value* args, int arg_count) {
+    TonPVec* vec = pvec_arg(args, arg_count, 1);
+    if (!vec) {
+        return create_value_error("pvec_persistent expects a persistent vector");
+    }
+    if (vec->retired) return retired_error("pvec_persistent");
+    return pvec_result(tonpvec_persistent(vec));
+}
+
+// pmap_create() -> empty persistent map
+Value persistent_pmap_create(Value* args, int arg_count) {
+    (void)args;
+    if (arg_count != 0) {
+        return create_value_error("pmap_create expects no arguments");
+    }
+    TonPMap* map = tonpmap_create();
+    if (!map) {
+        return create_value_error("Failed to create persistent map");
+    }
+    return create_value_tonpmap(map);
+}
+
+// pmap_set(map, key, value) -> map with key bound to value
+Value persistent_pmap_set(Value* args, int arg_count) {
+    TonPMap* map = pmap_arg(args, arg_count, 3);
+    if (!map) {
+        return create_value_error("pmap_set expects a persistent map, a key and a value");
+    }
+    if (map->retired) return retired_error("pmap_set");
+    if (!tonmap_key_hashable(&args[1])) {
+        return create_value_error("pmap_set: key is not hashable");
+    }
+    return pmap_result(tonpmap_set(map, &args[1], args[2]));
+}
+
+// pmap_remove(map, key) -> map without key
+Value persistent_pmap_remove(Value* args, int arg_count) {
+    TonPMap* map = pmap_arg(args, arg_count, 2);
+    if (!map) {
+        return create_value_error("pmap_remove expects a persistent map and a key");
+    }
+    if (map->retired) return retired_error("pmap_remove");
+    if (!tonmap_key_hashable(&args[1])) {
+        return create_value_tonpmap(map); // Such a key can never be present
+    }
+    return pmap_result(tonpmap_remove(map, &args[1]));
+}
+
+// pmap_get(map, key) -> value, or null if absent
+Value persistent_pmap_get(Value* args, int arg_count) {
+    TonPMap* map = pmap_arg(args, arg_count, 2);
+    if (!map) {
+        return create_value_error("pmap_get expects a persistent map and a key");
+    }
+    Value item;
+    if (!tonpmap_get(map, &args[1], &item)) {
+        return create_value_null();
+    }
+    return value_copy(&item);
+}
+
+// pmap_has(map, key) -> bool
+Value persistent_pmap_has(Value* args, int arg_count) {
+    TonPMap* map = pmap_arg(args, arg_count, 2);
+    if (!map) {
+        return create_value_error("pmap_has expects a persistent map and a key");
+    }
+    Value item;
+    return create_value_bool(tonpmap_get(map, &args[1], &item));
+}
+
+// pmap_size(map) -> int
+Value persistent_pmap_size(Value* args, int arg_count) {
+    TonPMap* map = pmap_arg(args, arg_count, 1);
+    if (!map) {
+        return create_value_error("pmap_size expects a persistent map");
+    }
+    return create_value_int(tonpmap_size(map));
+}
+
+// pmap_items(map) -> list of [key, value] pairs, in no particular order
+Value persistent_pmap_items(Value* args, int arg_count) {
+    TonPMap* map = pmap_arg(args, arg_count, 1);
+    if (!map) {
+        return create_value_error("pmap_items expects a persistent map");
+    }
+    TonList* list = tonlist_create();
+    if (!list) {
+        return create_value_error("Failed to create list");
+    }
+    TonPMapIter iter;
+    tonpmap_iter_init(&iter, map);
+    for (const TonMapEntry* entry = tonpmap_iter_next(&iter); entry; entry = tonpmap_iter_next(&iter)) {
+        TonList* pair = tonlist_create();
+        if (!pair) {
+            return create_value_error("Failed to create list");
+        }
+        tonlist_push(pair, entry->key);
+        tonlist_push(pair, entry->value);
+        tonlist_push(list, create_value_tonlist(pair));
+    }
+    return create_value_tonlist(list);
+}
+
+// pmap_transient(map) -> transient copy that pmap_set/remove update in place
+Value persistent_pmap_transient(Value* args, int arg_count) {
+    TonPMap* map = pmap_arg(args, arg_count, 1);
+    if (!map) {
+        return create_value_error("pmap_transient expects a persistent map");
+    }
+    if (map->retired) return retired_error("pmap_transient");
+    return pmap_result(tonpmap_transient(map));
+}
+
+// pmap_persistent(map) -> persistent version of a transient; the transient is retired
+Value persistent_pmap_persistent(Value* args, int arg_count) {
+    TonPMap* map = pmap_arg(args, arg_count, 1);
+    if (!map) {
+        return create_value_error("pmap_persistent expects a persistent map");
+    }
+    if (map->retired) return retired_error("pmap_persistent");
+    return pmap_result(tonpmap_persistent(map));
+}
+
+void install_persistent_builtins(Environment* env) {
+    env_add_function(env, "pvec_create", make_builtin_fn("pvec_create"));
+    env_add_function(env, "pvec_from", make_builtin_fn("pvec_from"));
+    env_add_function(env, "pvec_push", make_builtin_fn("pvec_push"));
+    env_add_function(env, "pvec_pop", make_builtin_fn("pvec_pop"));
+    env_add_function(env, "pvec_set", make_builtin_fn("pvec_set"));
+    env_add_function(env, "pvec_get", make_builtin_fn("pvec_get"));
+    env_add_function(env, "pvec_size", make_builtin_fn("pvec_size"));
+    env_add_function(env, "pvec_to_list", make_builtin_fn("pvec_to_list"));
+    env_add_function(env, "pvec_transient", make_builtin_fn("pvec_transient"));
+    env_add_function(env, "pvec_persistent", make_builtin_fn("pvec_persistent"));
+    env_add_function(env, "pmap_create", make_builtin_fn("pmap_create"));
+    env_add_function(env, "pmap_set", make_builtin_fn("pmap_set"));
+    env_add_function(env, "pmap_remove", make_builtin_fn("pmap_remove"));
+    env_add_function(env, "pmap_get", make_builtin_fn("pmap_get"));
+    env_add_function(env, "pmap_has", make_builtin_fn("pmap_has"));
+    env_add_function(env, "pmap_size", make_builtin_fn("pmap_size"));
+    env_add_function(env, "pmap_items", make_builtin_fn("pmap_items"));
+    env_add_function(env, "pmap_transient", make_builtin_fn("pmap_transient"));
+    env_add_function(env, "pmap_persistent", make_builtin_fn("pmap_persistent"));
+}
+
+int is_persistent_function(const char* function_name) {
+    return strncmp(function_name, "pvec_", 5) == 0 ||
+           strncmp(function_name, "pmap_", 5) == 0;
+}
+
+Value call_persistent_function(const char* function_name, Value* args, int arg_count) {
+    if (strcmp(function_name, "pvec_create") == 0) {
+        return persistent_pvec_create(args, arg_count);
+    } else if (strcmp(function_name, "pvec_from") == 0) {
+        return persistent_pvec_from(args, arg_count);
+    } else if (strcmp(function_name, "pvec_push") == 0) {
+        return persistent_pvec_push(args, arg_count);
+    } else if (strcmp(function_name, "pvec_pop") == 0) {
+        return persistent_pvec_pop(args, arg_count);
+    } else if (strcmp(function_name, "pvec_set") == 0) {
+        return persistent_pvec_set(args, arg_count);
+    } else if (strcmp(function_name, "pvec_get") == 0) {
+        return persistent_pvec_get(args, arg_count);
+    } else if (strcmp(function_name, "pvec_size") == 0) {
+        return persistent_pvec_size(args, arg_count);
+    } else if (strcmp(function_name, "pvec_to_list") == 0) {
+        return persistent_pvec_to_list(args, arg_count);
+    } else if (strcmp(function_name, "pvec_transient") == 0) {
+        return persistent_pvec_transient(args, arg_count);
+    } else if (strcmp(function_name, "pvec_persistent") == 0) {
+        return persistent_pvec_persistent(args, arg_count);
+    } else if (strcmp(function_name, "pmap_create") == 0) {
+        return persistent_pmap_create(args, arg_count);
+    } else if (strcmp(function_name, "pmap_set") == 0) {
+        return persistent_pmap_set(args, arg_count);
+    } else if (strcmp(function_name, "pmap_remove") == 0) {
+        return persistent_pmap_remove(args, arg_count);
+    } else if (strcmp(function_name, "pmap_get") == 0) {
+        return persistent_pmap_get(args, arg_count);
+    } else if (strcmp(function_name, "pmap_has") == 0) {
+        return persistent_pmap_has(args, arg_count);
+    } else if (strcmp(function_name, "pmap_size") == 0) {
+        return persistent_pmap_size(args, arg_count);
+    } else if (strcmp(function_name, "pmap_items") == 0) {
+        return persistent_pmap_items(args, arg_count);
+    } else if (strcmp(function_name, "pmap_transient") == 0) {
+        return persistent_pmap_transient(args, arg_count);
+    } else if (strcmp(function_name, "pmap_persistent") == 0) {
+        return persistent_pmap_persistent(args, arg_count);
+    }
+    return create_value_error("Unknown persistent collection function");
+}
@@ -0,0 +1,39 @@
+#ifndef TON_BUILTIN_PERSISTENT_H
+#define TON_BUILTIN_PERSISTENT_H
+
+#include "interpreter.h"
+#include "environment.h"
+
+// Persistent collection module initialization
+void install_persistent_builtins(Environment* env);
+
+// True for the names handled by call_persistent_function
+int is_persistent_function(const char* function_name);
+
+// Persistent collection function dispatcher
+Value call_persistent_function(const char* function_name, Value* args, int arg_count);
+
+// Persistent vectors
+Value persistent_pvec_create(Value* args, int arg_count);
+Value persistent_pvec_from(Value* args, int arg_count);
+Value persistent_pvec_push(Value* args, int arg_count);
+Value persistent_pvec_pop(Value* args, int arg_count);
+Value persistent_pvec_set(Value* args, int arg_count);
+Value persistent_pvec_get(Value* args, int arg_count);
+Value persistent_pvec_size(Value* args, int arg_count);
+Value persistent_pvec_to_list(Value* args, int arg_count);
+Value persistent_pvec_transient(Value* args, int arg_count);
+Value persistent_pvec_persistent(Value* args, int arg_count);
+
+// Persistent hash maps
+Value persistent_pmap_create(Value* args, int arg_count);
+Value persistent_pmap_set(Value* args, int arg_count);
+Value persistent_pmap_remove(Value* args, int arg_count);
+Value persistent_pmap_get(Value* args, int arg_count);
+Value persistent_pmap_has(Value* args, int arg_count);
+Value persistent_pmap_size(Value* args, int arg_count);
+Value persistent_pmap_items(Value* args, int arg_count);
+Value persistent_pmap_transient(Value* args, int arg_count);
+Value persistent_pmap_persistent(Value* args, int arg_count);
+
+#endif // TON_BUILTIN_PERSISTENT_H
@@ -0,0 +1,245 @@
+#include "builtin_queue.h"
+#include "builtin.h"
+#include "builtin_sort.h"
+#include "collections.h"
+#include <string.h>
+
+static TonDeque* deque_arg(Value* args, int arg_count, int expected) {
+    if (arg_count != expected || args[0].type != VALUE_TONDEQUE) return NULL;
+    return (TonDeque*)args[0].data.tondeque_val;
+}
+
+static TonPQ* pq_arg(Value* args, int arg_count, int expected) {
+    if (arg_count != expected || args[0].type != VALUE_TONPQ) return NULL;
+    return (TonPQ*)args[0].data.tonpq_val;
+}
+
+// deque_create() -> empty deque
+Value queue_deque_create(Value* args, int arg_count) {
+    (void)args;
+    if (arg_count != 0) {
+        return create_value_error("deque_create expects no arguments");
+    }
+    TonDeque* deque = tondeque_create();
+    if (!deque) {
+        return create_value_error("Failed to create deque");
+    }
+    return create_value_tondeque(deque);
+}
+
+// deque_push_back(deque, value) -> bool
+Value queue_deque_push_back(Value* args, int arg_count) {
+    TonDeque* deque = deque_arg(args, arg_count, 2);
+    if (!deque) {
+        return create_value_error("deque_push_back expects a deque and a value");
+    }
+    return create_value_bool(tondeque_push_back(deque, args[1]));
+}
+
+// deque_push_front(deque, value) -> bool
+Value queue_deque_push_front(Value* args, int arg_count) {
+    TonDeque* deque = deque_arg(args, arg_count, 2);
+    if (!deque) {
+        return create_value_error("deque_push_front expects a deque and a value");
+    }
+    return create_value_bool(tondeque_push_front(deque, args[1]));
+}
+
+// deque_pop_back(deque) -> last element, or null if empty
+Value queue_deque_pop_back(Value* args, int arg_count) {
+    TonDeque* deque = deque_arg(args, arg_count, 1);
+    if (!deque) {
+        return create_value_error("deque_pop_back expects a deque");
+    }
+    return tondeque_pop_back(deque);
+}
+
+// deque_pop_front(deque) -> first element, or null if empty
+Value queue_deque_pop_front(Value* args, int arg_count) {
+    TonDeque* deque = deque_arg(args, arg_count, 1);
+    if (!deque) {
+        return create_value_error("deque_pop_front expects a deque");
+    }
+    return tondeque_pop_front(deque);
+}
+
+// deque_front(deque) -> first element without removing it, or null
+Value queue_deque_front(Value* args, int arg_count) {
+    TonDeque* deque = deque_arg(args, arg_count, 1);
+    if (!deque) {
+        return create_value_error("deque_front expects a deque");
+    }
+    Value item = tondeque_get(deque, 0);
+    return value_copy(&item);
+}
+
+// deque_back(deque) -> last element without removing it, or null
+Value queue_deque_back(Value* args, int arg_count) {
+    TonDeque* deque = deque_arg(args, arg_count, 1);
+    if (!deque) {
+        return create_value_error("deque_back expects a deque");
+    }
+    Value item = tondeque_get(deque, tondeque_size(deque) - 1);
+    return value_copy(&item);
+}
+
+// deque_get(deque, index) -> element `index` places from the front, or null
+Value queue_deque_get(Value* args, int arg_count) {
+    TonDeque* deque = deque_arg(args, arg_count, 2);
+    if (!deque || args[1].type != VALUE_INT) {
+        return create_value_error("deque_get expects a deque and an int index");
+    }
+    Value item = tondeque_get(deque, args[1].data.int_val);
+    return value_copy(&item);
+}
+
+// deque_size(deque) -> int
+Value queue_deque_size(Value* args, int arg_count) {
+    TonDeque* deque = deque_arg(args, arg_count, 1);
+    if (!deque) {
+        return create_value_error("deque_size expects a deque");
+    }
+    return create_value_int(tondeque_size(deque));
+}
+
+// pq_create([less]) -> empty priority queue; less(a, b) is true (or a negative int) when a comes out first
+Value queue_pq_create(Value* args, int arg_count) {
+    Value less = create_value_null();
+    if (arg_count > 1) {
+        return create_value_error("pq_create expects an optional comparator");
+    }
+    if (arg_count == 1) {
+        if (args[0].type != VALUE_FN || !args[0].data.function_value ||
+            args[0].data.function_value->type != USER_DEFINED) {
+            return create_value_error("pq_create: comparator must be a user-defined function");
+        }
+        less = args[0];
+    }
+    TonPQ* pq = tonpq_create(less);
+    if (!pq) {
+        return create_value_error("Failed to create priority queue");
+    }
+    return create_value_tonpq(pq);
+}
+
+// Bind the queue's comparator for one push or pop
+static int pq_open(TonPQ* pq, SortCallbacks* cb, const char* name, Environment* env) {
+    sort_callbacks_init(cb, name);
+    if (pq->locked) {
+        sort_callbacks_fail(cb, "priority queue is in use by its comparator");
+        return 0;
+    }
+    if (pq->less.type == VALUE_NULL) return 1;
+    return sort_callbacks_open(cb, &pq->less, 2, env);
+}
+
+// pq_push(pq, value) -> bool
+Value queue_pq_push(Value* args, int arg_count, Environment* env) {
+    TonPQ* pq = pq_arg(args, arg_count, 2);
+    if (!pq) {
+        return create_value_error("pq_push expects a priority queue and a value");
+    }
+    SortCallbacks cb;
+    if (!pq_open(pq, &cb, "pq_push", env)) {
+        return create_value_error(cb.error);
+    }
+    int pushed = tonpq_push(pq, args[1], sort_callbacks_less(&cb), &cb);
+    sort_callbacks_close(&cb);
+    if (cb.failed) {
+        return create_value_error(cb.error);
+    }
+    return create_value_bool(pushed);
+}
+
+// pq_pop(pq) -> least element, or null if empty
+Value queue_pq_pop(Value* args, int arg_count, Environment* env) {
+    TonPQ* pq = pq_arg(args, arg_count, 1);
+    if (!pq) {
+        return create_value_error("pq_pop expects a priority queue");
+    }
+    SortCallbacks cb;
+    if (!pq_open(pq, &cb, "pq_pop", env)) {
+        return create_value_error(cb.error);
+    }
+    Value item = tonpq_pop(pq, sort_callbacks_less(&cb), &cb);
+    sort_callbacks_close(&cb);
+    if (cb.failed) {
+        value_release(&item);
+        return create_value_error(cb.error);
+    }
+    return item;
+}
+
+// pq_peek(pq) -> least element without removing it, or null
+Value queue_pq_peek(Value* args, int arg_count) {
+    TonPQ* pq = pq_arg(args, arg_count, 1);
+    if (!pq) {
+        return create_value_error("pq_peek expects a priority queue");
+    }
+    Value item = tonpq_peek(pq);
+    return value_copy(&item);
+}
+
+// pq_size(pq) -> int
+Value queue_pq_size(Value* args, int arg_count) {
+    TonPQ* pq = pq_arg(args, arg_count, 1);
+    if (!pq) {
+        return create_value_error("pq_size expects a priority queue");
+    }
+    return create_value_int(tonpq_size(pq));
+}
+
+void install_queue_builtins(Environment* env) {
+    env_add_function(env, "deque_create", make_builtin_fn("deque_create"));
+    env_add_function(env, "deque_push_back", make_builtin_fn("deque_push_back"));
+    env_add_function(env, "deque_push_front", make_builtin_fn("deque_push_front"));
+    env_add_function(env, "deque_pop_back", make_builtin_fn("deque_pop_back"));
+    env_add_function(env, "deque_pop_front", make_builtin_fn("deque_pop_front"));
+    env_add_function(env, "deque_front", make_builtin_fn("deque_front"));
+    env_add_function(env, "deque_back", make_builtin_fn("deque_back"));
+    env_add_function(env, "deque_get", make_builtin_fn("deque_get"));
+    env_add_function(env, "deque_size", make_builtin_fn("deque_size"));
+    env_add_function(env, "pq_create", make_builtin_fn("pq_create"));
+    env_add_function(env, "pq_push", make_builtin_fn("pq_push"));
+    env_add_function(env, "pq_pop", make_builtin_fn("pq_pop"));
+    env_add_function(env, "pq_peek", make_builtin_fn("pq_peek"));
+    env_add_function(env, "pq_size", make_builtin_fn("pq_size"));
+}
+
+int is_queue_function(const char* function_name) {
+    return strncmp(function_name, "deque_", 6) == 0 ||
+           strncmp(function_name, "pq_", 3) == 0;
+}
+
+Value call_queue_function(const char* function_name, Value* args, int arg_count, Environment* env) {
+    if (strcmp(function_name, "deque_create") == 0) {
+        return queue_deque_create(args, arg_count);
+    } else if (strcmp(function_name, "deque_push_back") == 0) {
+        return queue_deque_push_back(args, arg_count);
+    } else if (strcmp(function_name, "deque_push_front") == 0) {
+        return queue_deque_push_front(args, arg_count);
+    } else if (strcmp(function_name, "deque_pop_back") == 0) {
+        return queue_deque_pop_back(args, arg_count);
+    } else if (strcmp(function_name, "deque_pop_front") == 0) {
+        return queue_deque_pop_front(args, arg_count);
+    } else if (strcmp(function_name, "deque_front") == 0) {
+        return queue_deque_front(args, arg_count);
+    } else if (strcmp(function_name, "deque_back") == 0) {
+        return queue_deque_back(args, arg_count);
+    } else if (strcmp(function_name, "deque_get") == 0) {
+        return queue_deque_get(args, arg_count);
+    } else if (strcmp(function_name, "deque_size") == 0) {
+        return queue_deque_size(args, arg_count);
+    } else if (strcmp(function_name, "pq_create") == 0) {
+        return queue_pq_create(args, arg_count);
+    } else if (strcmp(function_name, "pq_push") == 0) {
+        return queue_pq_push(args, arg_count, env);
+    } else if (strcmp(function_name, "pq_pop") == 0) {
+        return queue_pq_pop(args, arg_count, env);
+    } else if (strcmp(function_name, "pq_peek") == 0) {
+        return queue_pq_peek(args, arg_count);
+    } else if (strcmp(function_name, "pq_size") == 0) {
+        return queue_pq_size(args, arg_count);
+    }
+    return create_value_error("Unknown queue function");
+}
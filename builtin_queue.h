@@ -0,0 +1,34 @@
+#ifndef TON_BUILTIN_QUEUE_H
+#define TON_BUILTIN_QUEUE_H
+
+#include "interpreter.h"
+#include "environment.h"
+
+// Queue module initialization
+void install_queue_builtins(Environment* env);
+
+// True for the names handled by call_queue_function
+int is_queue_function(const char* function_name);
+
+// Queue function dispatcher; priority queue comparators run in frames created from `env`
+Value call_queue_function(const char* function_name, Value* args, int arg_count, Environment* env);
+
+// Double-ended queues
+Value queue_deque_create(Value* args, int arg_count);
+Value queue_deque_push_back(Value* args, int arg_count);
+Value queue_deque_push_front(Value* args, int arg_count);
+Value queue_deque_pop_back(Value* args, int arg_count);
+Value queue_deque_pop_front(Value* args, int arg_count);
+Value queue_deque_front(Value* args, int arg_count);
+Value queue_deque_back(Value* args, int arg_count);
+Value queue_deque_get(Value* args, int arg_count);
+Value queue_deque_size(Value* args, int arg_count);
+
+// Priority queues
+Value queue_pq_create(Value* args, int arg_count);
+Value queue_pq_push(Value* args, int arg_count, Environment* env);
+Value queue_pq_pop(Value* args, int arg_count, Environment* env);
+Value queue_pq_peek(Value* args, int arg_count);
+Value queue_pq_size(Value* args, int arg_count);
+
+#endif // TON_BUILTIN_QUEUE_H
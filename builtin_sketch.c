@@ -0,0 +1,532 @@
+#include "builtin_sketch.h"
+#include "builtin.h"
+#include "builtin_tonlib.h"
+#include "sketch.h"
+#include "collections.h"
+#include "array.h"
+#include "memory.h"
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+#define HLL_DEFAULT_PRECISION 14       // 16 KiB of registers, about 0.8% standard error
+#define BLOOM_DEFAULT_FPR 0.01
+
+static TonBloom* bloom_arg(Value* args, int arg_count, int expected) {
+    if (arg_count != expected || args[0].type != VALUE_TONBLOOM) return NULL;
+    return (TonBloom*)args[0].data.tonbloom_val;
+}
+
+static TonHLL* hll_arg(Value* args, int arg_count, int expected) {
+    if (arg_count != expected || args[0].type != VALUE_TONHLL) return NULL;
+    return (TonHLL*)args[0].data.tonhll_val;
+}
+
+static TonBitmap* bitmap_arg(Value* args, int arg_count, int expected) {
+    if (arg_count != expected || args[0].type != VALUE_TONBITMAP) return NULL;
+    return (TonBitmap*)args[0].data.tonbitmap_val;
+}
+
+// Length and element i of a list or array argument
+static int sequence_length(const Value* value) {
+    if (value->type == VALUE_TONLIST) return tonlist_size((TonList*)value->data.tonlist_val);
+    if (value->type == VALUE_ARRAY) return (int)((TonArray*)value->data.array_val)->length;
+    return -1;
+}
+
+static Value sequence_get(const Value* value, int index) {
+    if (value->type == VALUE_TONLIST) return tonlist_get((TonList*)value->data.tonlist_val, index);
+    return array_get((TonArray*)value->data.array_val, (size_t)index);
+}
+
+static Value count_value(uint64_t count) {
+    return create_value_int(count > INT_MAX ? INT_MAX : (int)count);
+}
+
+static Value unhashable_error(const char* name) {
+    char message[64];
+    snprintf(message, sizeof(message), "%s: key is not hashable", name);
+    return create_value_error(message);
+}
+
+// Serialized bytes as base64 text; takes ownership of `data`
+static Value serialized_value(unsigned char* data, size_t len) {
+    if (len == 0) {
+        return create_value_error("Failed to serialize");
+    }
+    char* text = base64_encode(data, len);
+    ton_free(data);
+    if (!text) {
+        return create_value_error("Failed to serialize");
+    }
+    Value result = create_value_string(text);
+    ton_free(text);
+    return result;
+}
+
+static unsigned char* serialized_bytes(Value* args, int arg_count, size_t* len) {
+    if (arg_count != 1 || args[0].type != VALUE_STRING || !args[0].data.string_val) return NULL;
+    return base64_decode(args[0].data.string_val, len);
+}
+
+// bloom_create(expected [, fpr]) -> filter sized for `expected` keys at the given false positive rate
+Value sketch_bloom_create(Value* args, int arg_count) {
+    double fpr = BLOOM_DEFAULT_FPR;
+    if (arg_count < 1 || arg_count > 2 || args[0].type != VALUE_INT || args[0].data.int_val < 0 ||
+        (arg_count == 2 && args[1].type != VALUE_FLOAT)) {
+        return create_value_error("bloom_create expects an expected key count and an optional float false positive rate");
+    }
+    if (arg_count == 2) fpr = args[1].data.float_val;
+    if (!(fpr > 0.0 && fpr < 1.0)) {
+        return create_value_error("bloom_create: false positive rate must be between 0 and 1");
+    }
+    TonBloom* bloom = bloom_create((uint64_t)args[0].data.int_val, fpr);
+    if (!bloom) {
+        return create_value_error("Failed to create Bloom filter");
+    }
+    return create_value_tonbloom(bloom);
+}
+
+// bloom_add(filter, key) -> true if the key was certainly not added before
+Value sketch_bloom_add(Value* args, int arg_count) {
+    TonBloom* bloom = bloom_arg(args, arg_count, 2);
+    if (!bloom) {
+        return create_value_error("bloom_add expects a Bloom filter and a key");
+    }
+    uint64_t hash;
+    if (!sketch_hash_key(&args[1], &hash)) return unhashable_error("bloom_add");
+    return create_value_bool(!bloom_add_hash(bloom, hash));
+}
+
+// bloom_add_all(filter, keys) -> number of keys that were certainly new
+Value sketch_bloom_add_all(Value* args, int arg_count) {
+    TonBloom* bloom = bloom_arg(args, arg_count, 2);
+    int count = arg_count == 2 ? sequence_length(&args[1]) : -1;
+    if (!bloom || count < 0) {
+        return create_value_error("bloom_add_all expects a Bloom filter and a list or array of keys");
+    }
+    int added = 0;
+    for (int i = 0; i < count; i++) {
+        Value key = sequence_get(&args[1], i);
+        uint64_t hash;
+        if (!sketch_hash_key(&key, &hash)) return unhashable_error("bloom_add_all");
+        added += !bloom_add_hash(bloom, hash);
+    }
+    return create_value_int(added);
+}
+
+// bloom_has(filter, key) -> false if the key was never added, true if it probably was
+Value sketch_bloom_has(Value* args, int arg_count) {
+    TonBloom* bloom = bloom_arg(args, arg_count, 2);
+    if (!bloom) {
+        return create_value_error("bloom_has expects a Bloom filter and a key");
+    }
+    uint64_t hash;
+    if (!sketch_hash_key(&args[1], &hash)) return create_value_bool(0);
+    return create_value_bool(bloom_has_hash(bloom, hash));
+}
+
+// bloom_count(filter) -> keys added that were new at the time (a lower bound on distinct keys)
+Value sketch_bloom_count(Value* args, int arg_count) {
+    TonBloom* bloom = bloom_arg(args, arg_count, 1);
+    if (!bloom) {
+        return create_value_error("bloom_count expects a Bloom filter");
+    }
+    return count_value(bloom->added);
+}
+
+// bloom_merge(filter, other) -> adds every key of `other`; both must have the same size
+Value sketch_bloom_merge(Value* args, int arg_count) {
+    TonBloom* bloom = bloom_arg(args, arg_count, 2);
+    if (!bloom || args[1].type != VALUE_TONBLOOM) {
+        return create_value_error("bloom_merge expects two Bloom filters");
+    }
+    if (!bloom_merge(bloom, (TonBloom*)args[1].data.tonbloom_val)) {
+        return create_value_error("bloom_merge: filters were created with different sizes");
+    }
+    return create_value_bool(1);
+}
+
+// bloom_serialize(filter) -> base64 string
+Value sketch_bloom_serialize(Value* args, int arg_count) {
+    TonBloom* bloom = bloom_arg(args, arg_count, 1);
+    if (!bloom) {
+        return create_value_error("bloom_serialize expects a Bloom filter");
+    }
+    unsigned char* data = NULL;
+    size_t len = bloom_serialize(bloom, &data);
+    return serialized_value(data, len);
+}
+
+// bloom_deserialize(text) -> filter saved by bloom_serialize
+Value sketch_bloom_deserialize(Value* args, int arg_count) {
+    size_t len = 0;
+    unsigned char* data = serialized_bytes(args, arg_count, &len);
+    TonBloom* bloom = data ? bloom_deserialize(data, len) : NULL;
+    ton_free(data);
+    if (!bloom) {
+        return create_value_error("bloom_deserialize: not a serialized Bloom filter");
+    }
+    return create_value_tonbloom(bloom);
+}
+
+// hll_create([precision]) -> empty distinct counter with 2^precision registers
+Value sketch_hll_create(Value* args, int arg_count) {
+    int precision = HLL_DEFAULT_PRECISION;
+    if (arg_count > 1 || (arg_count == 1 && args[0].type != VALUE_INT)) {
+        return create_value_error("hll_create expects an optional int precision");
+    }
+    if (arg_count == 1) precision = args[0].data.int_val;
+    if (precision < HLL_MIN_PRECISION || precision > HLL_MAX_PRECISION) {
+        char message[80];
+        snprintf(message, sizeof(message), "hll_create: precision must be between %d and %d",
+                 HLL_MIN_PRECISION, HLL_MAX_PRECISION);
+        return create_value_error(message);
+    }
+    TonHLL* hll = hll_create(precision);
+    if (!hll) {
+        return create_value_error("Failed to create HyperLogLog");
+    }
+    return create_value_tonhll(hll);
+}
+
+// hll_add(counter, key) -> bool
+Value sketch_hll_add(Value* args, int arg_count) {
+    TonHLL* hll = hll_arg(args, arg_count, 2);
+    if (!hll) {
+        return create_value_error("hll_add expects a HyperLogLog and a key");
+    }
+    uint64_t hash;
+    if (!sketch_hash_key(&args[1], &hash)) return unhashable_error("hll_add");
+    return create_value_bool(hll_add_hash(hll, hash));
+}
+
+// hll_add_all(counter, keys) -> bool
+Value sketch_hll_add_all(Value* args, int arg_count) {
+    TonHLL* hll = hll_arg(args, arg_count, 2);
+    int count = arg_count == 2 ? sequence_length(&args[1]) : -1;
+    if (!hll || count < 0) {
+        return create_value_error("hll_add_all expects a HyperLogLog and a list or array of keys");
+    }
+    for (int i = 0; i < count; i++) {
+        Value key = sequence_get(&args[1], i);
+        uint64_t hash;
+        if (!sketch_hash_key(&key, &hash)) return unhashable_error("hll_add_all");
+        if (!hll_add_hash(hll, hash)) return create_value_bool(0);
+    }
+    return create_value_bool(1);
+}
+
+// hll_count(counter) -> estimated number of distinct keys added
+Value sketch_hll_count(Value* args, int arg_count) {
+    TonHLL* hll = hll_arg(args, arg_count, 1);
+    if (!hll) {
+        return create_value_error("hll_count expects a HyperLogLog");
+    }
+    double estimate = hll_estimate(hll);
+    return count_value((uint64_t)(estimate + 0.5));
+}
+
+// hll_merge(counter, other) -> adds every key counted by `other`; both must have the same precision
+Value sketch_hll_merge(Value* args, int arg_count) {
+    TonHLL* hll = hll_arg(args, arg_count, 2);
+    if (!hll || args[1].type != VALUE_TONHLL) {
+        return create_value_error("hll_merge expects two HyperLogLogs");
+    }
+    TonHLL* other = (TonHLL*)args[1].data.tonhll_val;
+    if (hll->precision != other->precision) {
+        return create_value_error("hll_merge: counters have different precisions");
+    }
+    return create_value_bool(hll_merge(hll, other));
+}
+
+// hll_serialize(counter) -> base64 string
+Value sketch_hll_serialize(Value* args, int arg_count) {
+    TonHLL* hll = hll_arg(args, arg_count, 1);
+    if (!hll) {
+        return create_value_error("hll_serialize expects a HyperLogLog");
+    }
+    unsigned char* data = NULL;
+    size_t len = hll_serialize(hll, &data);
+    return serialized_value(data, len);
+}
+
+// hll_deserialize(text) -> counter saved by hll_serialize
+Value sketch_hll_deserialize(Value* args, int arg_count) {
+    size_t len = 0;
+    unsigned char* data = serialized_bytes(args, arg_count, &len);
+    TonHLL* hll = data ? hll_deserialize(data, len) : NULL;
+    ton_free(data);
+    if (!hll) {
+        return create_value_error("hll_deserialize: not a serialized HyperLogLog");
+    }
+    return create_value_tonhll(hll);
+}
+
+// bitmap_create() -> empty bitmap
+Value sketch_bitmap_create(Value* args, int arg_count) {
+    (void)args;
+    if (arg_count != 0) {
+        return create_value_error("bitmap_create expects no arguments");
+    }
+    TonBitmap* bitmap = bitmap_create();
+    if (!bitmap) {
+        return create_value_error("Failed to create bitmap");
+    }
+    return create_value_tonbitmap(bitmap);
+}
+
+// bitmap_from(list | array) -> bitmap of the (non-negative int) elements
+Value sketch_bitmap_from(Value* args, int arg_count) {
+    int count = arg_count == 1 ? sequence_length(&args[0]) : -1;
+    if (count < 0) {
+        return create_value_error("bitmap_from expects a list or array of non-negative ints");
+    }
+    TonBitmap* bitmap = bitmap_create();
+    if (!bitmap) {
+        return create_value_error("Failed to create bitmap");
+    }
+    for (int i = 0; i < count; i++) {
+        Value item = sequence_get(&args[0], i);
+        if (item.type != VALUE_INT || item.data.int_val < 0) {
+            return create_value_error("bitmap_from: elements must be non-negative ints");
+        }
+        if (bitmap_add(bitmap, (uint32_t)item.data.int_val) < 0) {
+            return create_value_error("bitmap_from: out of memory");
+        }
+    }
+    return create_value_tonbitmap(bitmap);
+}
+
+// The int argument of a bitmap update or query, or -1
+static int bitmap_value_arg(Value* args) {
+    if (args[1].type != VALUE_INT || args[1].data.int_val < 0) return -1;
+    return args[1].data.int_val;
+}
+
+// bitmap_add(bitmap, n) -> true if n was not present
+Value sketch_bitmap_add(Value* args, int arg_count) {
+    TonBitmap* bitmap = bitmap_arg(args, arg_count, 2);
+    if (!bitmap || bitmap_value_arg(args) < 0) {
+        return create_value_error("bitmap_add expects a bitmap and a non-negative int");
+    }
+    int added = bitmap_add(bitmap, (uint32_t)bitmap_value_arg(args));
+    if (added < 0) {
+        return create_value_error("bitmap_add: out of memory");
+    }
+    return create_value_bool(added);
+}
+
+// bitmap_remove(bitmap, n) -> true if n was present
+Value sketch_bitmap_remove(Value* args, int arg_count) {
+    TonBitmap* bitmap = bitmap_arg(args, arg_count, 2);
+    if (!bitmap || args[1].type != VALUE_INT) {
+        return create_value_error("bitmap_remove expects a bitmap and an int");
+    }
+    if (args[1].data.int_val < 0) return create_value_bool(0);
+    return create_value_bool(bitmap_remove(bitmap, (uint32_t)args[1].data.int_val));
+}
+
+// bitmap_has(bitmap, n) -> bool
+Value sketch_bitmap_has(Value* args, int arg_count) {
+    TonBitmap* bitmap = bitmap_arg(args, arg_count, 2);
+    if (!bitmap || args[1].type != VALUE_INT) {
+        return create_value_error("bitmap_has expects a bitmap and an int");
+    }
+    if (args[1].data.int_val < 0) return create_value_bool(0);
+    return create_value_bool(bitmap_contains(bitmap, (uint32_t)args[1].data.int_val));
+}
+
+// bitmap_count(bitmap) -> int
+Value sketch_bitmap_count(Value* args, int arg_count) {
+    TonBitmap* bitmap = bitmap_arg(args, arg_count, 1);
+    if (!bitmap) {
+        return create_value_error("bitmap_count expects a bitmap");
+    }
+    return count_value(bitmap_cardinality(bitmap));
+}
+
+typedef TonBitmap* (*BitmapSetOp)(const TonBitmap* a, const TonBitmap* b);
+
+static Value bitmap_set_op(Value* args, int arg_count, const char* name, BitmapSetOp op) {
+    TonBitmap* a = bitmap_arg(args, arg_count, 2);
+    if (!a || args[1].type != VALUE_TONBITMAP) {
+        char message[64];
+        snprintf(message, sizeof(message), "%s expects two bitmaps", name);
+        return create_value_error(message);
+    }
+    TonBitmap* result = op(a, (TonBitmap*)args[1].data.tonbitmap_val);
+    if (!result) {
+        return create_value_error("Failed to create bitmap");
+    }
+    return create_value_tonbitmap(result);
+}
+
+// bitmap_or(a, b) -> new bitmap with the values of either
+Value sketch_bitmap_or(Value* args, int arg_count) {
+    return bitmap_set_op(args, arg_count, "bitmap_or", bitmap_or);
+}
+
+// bitmap_and(a, b) -> new bitmap with the values of both
+Value sketch_bitmap_and(Value* args, int arg_count) {
+    return bitmap_set_op(args, arg_count, "bitmap_and", bitmap_and);
+}
+
+// bitmap_andnot(a, b) -> new bitmap with the values of a that are not in b
+Value sketch_bitmap_andnot(Value* args, int arg_count) {
+    return bitmap_set_op(args, arg_count, "bitmap_andnot", bitmap_andnot);
+}
+
+// bitmap_and_count(a, b) -> size of the intersection, without building it
+Value sketch_bitmap_and_count(Value* args, int arg_count) {
+    TonBitmap* a = bitmap_arg(args, arg_count, 2);
+    if (!a || args[1].type != VALUE_TONBITMAP) {
+        return create_value_error("bitmap_and_count expects two bitmaps");
+    }
+    return count_value(bitmap_and_cardinality(a, (TonBitmap*)args[1].data.tonbitmap_val));
+}
+
+// bitmap_to_list(bitmap) -> ascending list of the values
+Value sketch_bitmap_to_list(Value* args, int arg_count) {
+    TonBitmap* bitmap = bitmap_arg(args, arg_count, 1);
+    if (!bitmap) {
+        return create_value_error("bitmap_to_list expects a bitmap");
+    }
+    size_t count = (size_t)bitmap_cardinality(bitmap);
+    uint32_t* values = (uint32_t*)ton_malloc(sizeof(uint32_t) * (count > 0 ? count : 1));
+    TonList* list = tonlist_create();
+    if (!values || !list) {
+        ton_free(values);
+        return create_value_error("Failed to create list");
+    }
+    bitmap_to_array(bitmap, values, count);
+    for (size_t i = 0; i < count; i++) {
+        if (!tonlist_push(list, create_value_int((int)values[i]))) {
+            ton_free(values);
+            return create_value_error("Failed to create list");
+        }
+    }
+    ton_free(values);
+    return create_value_tonlist(list);
+}
+
+// bitmap_serialize(bitmap) -> base64 string
+Value sketch_bitmap_serialize(Value* args, int arg_count) {
+    TonBitmap* bitmap = bitmap_arg(args, arg_count, 1);
+    if (!bitmap) {
+        return create_value_error("bitmap_serialize expects a bitmap");
+    }
+    unsigned char* data = NULL;
+    size_t len = bitmap_serialize(bitmap, &data);
+    return serialized_value(data, len);
+}
+
+// bitmap_deserialize(text) -> bitmap saved by bitmap_serialize
+Value sketch_bitmap_deserialize(Value* args, int arg_count) {
+    size_t len = 0;
+    unsigned char* data = serialized_bytes(args, arg_count, &len);
+    TonBitmap* bitmap = data ? bitmap_deserialize(data, len) : NULL;
+    ton_free(data);
+    if (!bitmap) {
+        return create_value_error("bitmap_deserialize: not a serialized bitmap");
+    }
+    return create_value_tonbitmap(bitmap);
+}
+
+void install_sketch_builtins(Environment* env) {
+    env_add_function(env, "bloom_create", make_builtin_fn("bloom_create"));
+    env_add_function(env, "bloom_add", make_builtin_fn("bloom_add"));
+    env_add_function(env, "bloom_add_all", make_builtin_fn("bloom_add_all"));
+    env_add_function(env, "bloom_has", make_builtin_fn("bloom_has"));
+    env_add_function(env, "bloom_count", make_builtin_fn("bloom_count"));
+    env_add_function(env, "bloom_merge", make_builtin_fn("bloom_merge"));
+    env_add_function(env, "bloom_serialize", make_builtin_fn("bloom_serialize"));
+    env_add_function(env, "bloom_deserialize", make_builtin_fn("bloom_deserialize"));
+    env_add_function(env, "hll_create", make_builtin_fn("hll_create"));
+    env_add_function(env, "hll_add", make_builtin_fn("hll_add"));
+    env_add_function(env, "hll_add_all", make_builtin_fn("hll_add_all"));
+    env_add_function(env, "hll_count", make_builtin_fn("hll_count"));
+    env_add_function(env, "hll_merge", make_builtin_fn("hll_merge"));
+    env_add_function(env, "hll_serialize", make_builtin_fn("hll_serialize"));
+    env_add_function(env, "hll_deserialize", make_builtin_fn("hll_deserialize"));
+    env_add_function(env, "bitmap_create", make_builtin_fn("bitmap_create"));
+    env_add_function(env, "bitmap_from", make_builtin_fn("bitmap_from"));
+    env_add_function(env, "bitmap_add", make_builtin_fn("bitmap_add"));
+    env_add_function(env, "bitmap_remove", make_builtin_fn("bitmap_remove"));
+    env_add_function(env, "bitmap_has", make_builtin_fn("bitmap_has"));
+    env_add_function(env, "bitmap_count", make_builtin_fn("bitmap_count"));
+    env_add_function(env, "bitmap_or", make_builtin_fn("bitmap_or"));
+    env_add_function(env, "bitmap_and", make_builtin_fn("bitmap_and"));
+    env_add_function(env, "bitmap_andnot", make_builtin_fn("bitmap_andnot"));
+    env_add_function(env, "bitmap_and_count", make_builtin_fn("bitmap_and_count"));
+    env_add_function(env, "bitmap_to_list", make_builtin_fn("bitmap_to_list"));
+    env_add_function(env, "bitmap_serialize", make_builtin_fn("bitmap_serialize"));
+    env_add_function(env, "bitmap_deserialize", make_builtin_fn("bitmap_deserialize"));
+}
+
+int is_sketch_function(const char* function_name) {
+    return strncmp(function_name, "bloom_", 6) == 0 ||
+           strncmp(function_name, "hll_", 4) == 0 ||
+           strncmp(function_name, "bitmap_", 7) == 0;
+}
+
+Value call_sketch_function(const char* function_name, Value* args, int arg_count) {
+    if (strcmp(function_name, "bloom_create") == 0) {
+        return sketch_bloom_create(args, arg_count);
+    } else if (strcmp(function_name, "bloom_add") == 0) {
+        return sketch_bloom_add(args, arg_count);
+    } else if (strcmp(function_name, "bloom_add_all") == 0) {
+        return sketch_bloom_add_all(args, arg_count);
+    } else if (strcmp(function_name, "bloom_has") == 0) {
+        return sketch_bloom_has(args, arg_count);
+    } else if (strcmp(function_name, "bloom_count") == 0) {
+        return sketch_bloom_count(args, arg_count);
+    } else if (strcmp(function_name, "bloom_merge") == 0) {
+        return sketch_bloom_merge(args, arg_count);
+    } else if (strcmp(function_name, "bloom_serialize") == 0) {
+        return sketch_bloom_serialize(args, arg_count);
+    } else if (strcmp(function_name, "bloom_deserialize") == 0) {
+        return sketch_bloom_deserialize(args, arg_count);
+    } else if (strcmp(function_name, "hll_create") == 0) {
+        return sketch_hll_create(args, arg_count);
+    } else if (strcmp(function_name, "hll_add") == 0) {
+        return sketch_hll_add(args, arg_count);
+    } else if (strcmp(function_name, "hll_add_all") == 0) {
+        return sketch_hll_add_all(args, arg_count);
+    } else if (strcmp(function_name, "hll_count") == 0) {
+        return sketch_hll_count(args, arg_count);
+    } else if (strcmp(function_name, "hll_merge") == 0) {
+        return sketch_hll_merge(args, arg_count);
+    } else if (strcmp(function_name, "hll_serialize") == 0) {
+        return sketch_hll_serialize(args, arg_count);
+    } else if (strcmp(function_name, "hll_deserialize") == 0) {
+        return sketch_hll_deserialize(args, arg_count);
+    } else if (strcmp(function_name, "bitmap_create") == 0) {
+        return sketch_bitmap_create(args, arg_count);
+    } else if (strcmp(function_name, "bitmap_from") == 0) {
+        return sketch_bitmap_from(args, arg_count);
+    } else if (strcmp(function_name, "bitmap_add") == 0) {
+        return sketch_bitmap_add(args, arg_count);
+    } else if (strcmp(function_name, "bitmap_remove") == 0) {
+        return sketch_bitmap_remove(args, arg_count);
+    } else if (strcmp(function_name, "bitmap_has") == 0) {
+        return sketch_bitmap_has(args, arg_count);
+    } else if (strcmp(function_name, "bitmap_count") == 0) {
+        return sketch_bitmap_count(args, arg_count);
+    } else if (strcmp(function_name, "bitmap_or") == 0) {
+        return sketch_bitmap_or(args, arg_count);
+    } else if (strcmp(function_name, "bitmap_and") == 0) {
+        return sketch_bitmap_and(args, arg_count);
+    } else if (strcmp(function_name, "bitmap_andnot") == 0) {
+        return sketch_bitmap_andnot(args, arg_count);
+    } else if (strcmp(function_name, "bitmap_and_count") == 0) {
+        return sketch_bitmap_and_count(args, arg_count);
+    } else if (strcmp(function_name, "bitmap_to_list") == 0) {
+        return sketch_bitmap_to_list(args, arg_count);
+    } else if (strcmp(function_name, "bitmap_serialize") == 0) {
+        return sketch_bitmap_serialize(args, arg_count);
+    } else if (strcmp(function_name, "bitmap_deserialize") == 0) {
+        return sketch_bitmap_deserialize(args, arg_count);
+    }
+    return create_value_error("Unknown sketch function");
+}
@@ -0,0 +1,50 @@
+#ifndef TON_BUILTIN_SKETCH_H
+#define TON_BUILTIN_SKETCH_H
+
+#include "interpreter.h"
+#include "environment.h"
+
+// Sketch module initialization
+void install_sketch_builtins(Environment* env);
+
+// True for the names handled by call_sketch_function
+int is_sketch_function(const char* function_name);
+
+// Sketch function dispatcher
+Value call_sketch_function(const char* function_name, Value* args, int arg_count);
+
+// Bloom filters
+Value sketch_bloom_create(Value* args, int arg_count);
+Value sketch_bloom_add(Value* args, int arg_count);
+Value sketch_bloom_add_all(Value* args, int arg_count);
+Value sketch_bloom_has(Value* args, int arg_count);
+Value sketch_bloom_count(Value* args, int arg_count);
+Value sketch_bloom_merge(Value* args, int arg_count);
+Value sketch_bloom_serialize(Value* args, int arg_count);
+Value sketch_bloom_deserialize(Value* args, int arg_count);
+
+// HyperLogLog distinct counters
+Value sketch_hll_create(Value* args, int arg_count);
+Value sketch_hll_add(Value* args, int arg_count);
+Value sketch_hll_add_all(Value* args, int arg_count);
+Value sketch_hll_count(Value* args, int arg_count);
+Value sketch_hll_merge(Value* args, int arg_count);
+Value sketch_hll_serialize(Value* args, int arg_count);
+Value sketch_hll_deserialize(Value* args, int arg_count);
+
+// Compressed int bitmaps
+Value sketch_bitmap_create(Value* args, int arg_count);
+Value sketch_bitmap_from(Value* args, int arg_count);
+Value sketch_bitmap_add(Value* args, int arg_count);
+Value sketch_bitmap_remove(Value* args, int arg_count);
+Value sketch_bitmap_has(Value* args, int arg_count);
+Value sketch_bitmap_count(Value* args, int arg_count);
+Value sketch_bitmap_or(Value* args, int arg_count);
+Value sketch_bitmap_and(Value* args, int arg_count);
+Value sketch_bitmap_andnot(Value* args, int arg_count);
+Value sketch_bitmap_and_count(Value* args, int arg_count);
+Value sketch_bitmap_to_list(Value* args, int arg_count);
+Value sketch_bitmap_serialize(Value* args, int arg_count);
+Value sketch_bitmap_deserialize(Value* args, int arg_count);
+
+#endif // TON_BUILTIN_SKETCH_H
@@ -0,0 +1,271 @@
+#include "builtin_soa.h"
+#include "builtin.h"
+#include "soa.h"
+#include "collections.h"
+#include "memory.h"
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+static TonSoA* soa_arg(Value* args, int arg_count, int expected) {
+    if (arg_count != expected || args[0].type != VALUE_TONSOA) return NULL;
+    return (TonSoA*)args[0].data.tonsoa_val;
+}
+
+// Slot of the field named by `name`, or -1 with *error set
+static int column_arg(TonSoA* soa, const Value* name, const char* function_name, Value* error) {
+    char message[128];
+    if (name->type != VALUE_STRING) {
+        snprintf(message, sizeof(message), "%s: field name must be a string", function_name);
+        *error = create_value_error(message);
+        return -1;
+    }
+    int slot = struct_field_slot(soa->type, name->data.string_val);
+    if (slot < 0) {
+        snprintf(message, sizeof(message), "%s: %s has no field '%s'", function_name, soa->type->name, name->data.string_val);
+        *error = create_value_error(message);
+    }
+    return slot;
+}
+
+static int index_arg(const TonSoA* soa, const Value* index) {
+    return index->type == VALUE_INT && index->data.int_val >= 0 && index->data.int_val < soa->length;
+}
+
+static int is_number(const Value* v) {
+    return v->type == VALUE_INT || v->type == VALUE_FLOAT;
+}
+
+static double number_of(const Value* v) {
+    return v->type == VALUE_INT ? (double)v->data.int_val : v->data.float_val;
+}
+
+static Value column_type_error(const char* function_name, const TonSoA* soa, int slot) {
+    char message[128];
+    snprintf(message, sizeof(message), "%s: value does not fit field '%s' (%s)", function_name,
+             soa->type->fields[slot].name, soa->type->fields[slot].type_name);
+    return create_value_error(message);
+}
+
+// soa_create(class_name, n) -> struct-of-arrays of n instances with every field zeroed
+Value soa_builtin_create(Value* args, int arg_count) {
+    if (arg_count != 2 || args[0].type != VALUE_STRING || args[1].type != VALUE_INT || args[1].data.int_val < 0) {
+        return create_value_error("soa_create expects a class name and a non-negative length");
+    }
+    TonStructType* type = find_struct_type(args[0].data.string_val);
+    if (!type) {
+        return create_value_error("soa_create: unknown class");
+    }
+    TonSoA* soa = tonsoa_create(type, args[1].data.int_val);
+    if (!soa) {
+        return create_value_error("Failed to create struct-of-arrays");
+    }
+    return create_value_tonsoa(soa);
+}
+
+// soa_push(arr, instance) -> true; appends the instance's fields as a new element
+Value soa_builtin_push(Value* args, int arg_count) {
+    TonSoA* soa = soa_arg(args, arg_count, 2);
+    if (!soa || args[1].type != VALUE_STRUCT) {
+        return create_value_error("soa_push expects a struct-of-arrays and an instance");
+    }
+    TonStructInstance* si = (TonStructInstance*)args[1].data.struct_val;
+    if (si->type != soa->type) {
+        return create_value_error("soa_push: instance is of another class");
+    }
+    int pushed = tonsoa_push(soa, si);
+    if (pushed == 0) {
+        return create_value_error("soa_push: out of memory");
+    }
+    if (pushed < 0) {
+        return create_value_error("soa_push: a field does not fit its column");
+    }
+    return create_value_bool(1);
+}
+
+// soa_get(arr, i) -> new instance holding a copy of element i
+Value soa_builtin_get(Value* args, int arg_count) {
+    TonSoA* soa = soa_arg(args, arg_count, 2);
+    if (!soa || !index_arg(soa, &args[1])) {
+        return create_value_error("soa_get expects a struct-of-arrays and an index in range");
+    }
+    TonStructInstance* si = tonsoa_get(soa, args[1].data.int_val);
+    if (!si) {
+        return create_value_error("soa_get: out of memory");
+    }
+    return create_value_struct(si);
+}
+
+// soa_set(arr, i, instance) -> true; overwrites element i with the instance's fields
+Value soa_builtin_set(Value* args, int arg_count) {
+    TonSoA* soa = soa_arg(args, arg_count, 3);
+    if (!soa || !index_arg(soa, &args[1]) || args[2].type != VALUE_STRUCT) {
+        return create_value_error("soa_set expects a struct-of-arrays, an index in range and an instance");
+    }
+    TonStructInstance* si = (TonStructInstance*)args[2].data.struct_val;
+    if (si->type != soa->type) {
+        return create_value_error("soa_set: instance is of another class");
+    }
+    if (!tonsoa_set(soa, args[1].data.int_val, si)) {
+        return create_value_error("soa_set: a field does not fit its column");
+    }
+    return create_value_bool(1);
+}
+
+// soa_column(arr, field) -> list of the field's values, in element order
+Value soa_builtin_column(Value* args, int arg_count) {
+    TonSoA* soa = soa_arg(args, arg_count, 2);
+    if (!soa) {
+        return create_value_error("soa_column expects a struct-of-arrays and a field name");
+    }
+    Value error;
+    int slot = column_arg(soa, &args[1], "soa_column", &error);
+    if (slot < 0) return error;
+    TonList* list = tonlist_create();
+    if (!list) {
+        return create_value_error("Failed to create list");
+    }
+    for (int i = 0; i < soa->length; i++) {
+        tonlist_push(list, tonsoa_get_field(soa, i, slot));
+    }
+    return create_value_tonlist(list);
+}
+
+// soa_fill(arr, field, value) -> true; stores the value in the field of every element
+Value soa_builtin_fill(Value* args, int arg_count) {
+    TonSoA* soa = soa_arg(args, arg_count, 3);
+    if (!soa) {
+        return create_value_error("soa_fill expects a struct-of-arrays, a field name and a value");
+    }
+    Value error;
+    int slot = column_arg(soa, &args[1], "soa_fill", &error);
+    if (slot < 0) return error;
+    for (int i = 0; i < soa->length; i++) {
+        if (!tonsoa_set_field(soa, i, slot, args[2])) return column_type_error("soa_fill", soa, slot);
+    }
+    return create_value_bool(1);
+}
+
+// soa_sum(arr, field) -> sum of an int or float field; a bool field counts its true values
+Value soa_builtin_sum(Value* args, int arg_count) {
+    TonSoA* soa = soa_arg(args, arg_count, 2);
+    if (!soa) {
+        return create_value_error("soa_sum expects a struct-of-arrays and a field name");
+    }
+    Value error;
+    int slot = column_arg(soa, &args[1], "soa_sum", &error);
+    if (slot < 0) return error;
+    const TonSoAColumn* column = &soa->columns[slot];
+    switch (column->kind) {
+        case SOA_COLUMN_INT: {
+            long long sum = 0;
+            for (int i = 0; i < soa->length; i++) sum += column->data.ints[i];
+            if (sum < INT_MIN || sum > INT_MAX) {
+                return create_value_error("soa_sum: sum does not fit in an int");
+            }
+            return create_value_int((int)sum);
+        }
+        case SOA_COLUMN_FLOAT: {
+            double sum = 0.0;
+            for (int i = 0; i < soa->length; i++) sum += column->data.floats[i];
+            return create_value_float(sum);
+        }
+        case SOA_COLUMN_BOOL: {
+            int count = 0;
+            for (int i = 0; i < soa->length; i++) count += column->data.bools[i];
+            return create_value_int(count);
+        }
+        default:
+            return column_type_error("soa_sum", soa, slot);
+    }
+}
+
+// soa_scale(arr, field, k) -> true; multiplies an int or float field by k
+Value soa_builtin_scale(Value* args, int arg_count) {
+    TonSoA* soa = soa_arg(args, arg_count, 3);
+    if (!soa || !is_number(&args[2])) {
+        return create_value_error("soa_scale expects a struct-of-arrays, a field name and a number");
+    }
+    Value error;
+    int slot = column_arg(soa, &args[1], "soa_scale", &error);
+    if (slot < 0) return error;
+    TonSoAColumn* column = &soa->columns[slot];
+    if (column->kind == SOA_COLUMN_INT && args[2].type == VALUE_INT) {
+        int k = args[2].data.int_val;
+        for (int i = 0; i < soa->length; i++) column->data.ints[i] *= k;
+    } else if (column->kind == SOA_COLUMN_FLOAT) {
+        double k = number_of(&args[2]);
+        for (int i = 0; i < soa->length; i++) column->data.floats[i] *= k;
+    } else {
+        return column_type_error("soa_scale", soa, slot);
+    }
+    return create_value_bool(1);
+}
+
+// soa_axpy(arr, field, source, k) -> true; adds k * source to field in every
+// element, e.g. soa_axpy(particles, "x", "vx", dt) moves every particle
+Value soa_builtin_axpy(Value* args, int arg_count) {
+    TonSoA* soa = soa_arg(args, arg_count, 4);
+    if (!soa || !is_number(&args[3])) {
+        return create_value_error("soa_axpy expects a struct-of-arrays, two field names and a number");
+    }
+    Value error;
+    int dst_slot = column_arg(soa, &args[1], "soa_axpy", &error);
+    if (dst_slot < 0) return error;
+    int src_slot = column_arg(soa, &args[2], "soa_axpy", &error);
+    if (src_slot < 0) return error;
+    TonSoAColumn* dst = &soa->columns[dst_slot];
+    const TonSoAColumn* src = &soa->columns[src_slot];
+    if (dst->kind == SOA_COLUMN_INT && src->kind == SOA_COLUMN_INT && args[3].type == VALUE_INT) {
+        int k = args[3].data.int_val;
+        for (int i = 0; i < soa->length; i++) dst->data.ints[i] += k * src->data.ints[i];
+    } else if (dst->kind == SOA_COLUMN_FLOAT && src->kind == SOA_COLUMN_FLOAT) {
+        double k = number_of(&args[3]);
+        for (int i = 0; i < soa->length; i++) dst->data.floats[i] += k * src->data.floats[i];
+    } else if (dst->kind == SOA_COLUMN_FLOAT && src->kind == SOA_COLUMN_INT) {
+        double k = number_of(&args[3]);
+        for (int i = 0; i < soa->length; i++) dst->data.floats[i] += k * (double)src->data.ints[i];
+    } else {
+        return create_value_error("soa_axpy: fields must be numeric, and an int field needs an int source and factor");
+    }
+    return create_value_bool(1);
+}
+
+void install_soa_builtins(Environment* env) {
+    env_add_function(env, "soa_create", make_builtin_fn("soa_create"));
+    env_add_function(env, "soa_push", make_builtin_fn("soa_push"));
+    env_add_function(env, "soa_get", make_builtin_fn("soa_get"));
+    env_add_function(env, "soa_set", make_builtin_fn("soa_set"));
+    env_add_function(env, "soa_column", make_builtin_fn("soa_column"));
+    env_add_function(env, "soa_fill", make_builtin_fn("soa_fill"));
+    env_add_function(env, "soa_sum", make_builtin_fn("soa_sum"));
+    env_add_function(env, "soa_scale", make_builtin_fn("soa_scale"));
+    env_add_function(env, "soa_axpy", make_builtin_fn("soa_axpy"));
+}
+
+int is_soa_function(const char* function_name) {
+    return strncmp(function_name, "soa_", 4) == 0;
+}
+
+Value call_soa_function(const char* function_name, Value* args, int arg_count) {
+    if (strcmp(function_name, "soa_create") == 0) {
+        return soa_builtin_create(args, arg_count);
+    } else if (strcmp(function_name, "soa_push") == 0) {
+        return soa_builtin_push(args, arg_count);
+    } else if (strcmp(function_name, "soa_get") == 0) {
+        return soa_builtin_get(args, arg_count);
+    } else if (strcmp(function_name, "soa_set") == 0) {
+        return soa_builtin_set(args, arg_count);
+    } else if (strcmp(function_name, "soa_column") == 0) {
+        return soa_builtin_column(args, arg_count);
+    } else if (strcmp(function_name, "soa_fill") == 0) {
+        return soa_builtin_fill(args, arg_count);
+    } else if (strcmp(function_name, "soa_sum") == 0) {
+        return soa_builtin_sum(args, arg_count);
+    } else if (strcmp(function_name, "soa_scale") == 0) {
+        return soa_builtin_scale(args, arg_count);
+    } else if (strcmp(function_name, "soa_axpy") == 0) {
+        return soa_builtin_axpy(args, arg_count);
+    }
+    return create_value_error("Unknown struct-of-arrays function");
+}
@@ -0,0 +1,27 @@
+#ifndef TON_BUILTIN_SOA_H
+#define TON_BUILTIN_SOA_H
+
+#include "interpreter.h"
+#include "environment.h"
+
+// Struct-of-arrays module initialization
+void install_soa_builtins(Environment* env);
+
+// True for the names handled by call_soa_function
+int is_soa_function(const char* function_name);
+
+// Struct-of-arrays function dispatcher
+Value call_soa_function(const char* function_name, Value* args, int arg_count);
+
+// Columnar arrays of class instances
+Value soa_builtin_create(Value* args, int arg_count);
+Value soa_builtin_push(Value* args, int arg_count);
+Value soa_builtin_get(Value* args, int arg_count);
+Value soa_builtin_set(Value* args, int arg_count);
+Value soa_builtin_column(Value* args, int arg_count);
+Value soa_builtin_fill(Value* args, int arg_count);
+Value soa_builtin_sum(Value* args, int arg_count);
+Value soa_builtin_scale(Value* args, int arg_count);
+Value soa_builtin_axpy(Value* args, int arg_count);
+
+#endif // TON_BUILTIN_SOA_H
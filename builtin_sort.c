@@ -0,0 +1,335 @@
+#include "builtin_sort.h"
+#include "builtin.h"
+#include "array.h"
+#include "collections.h"
+#include "gc.h"
+#include "interpreter_expr.h"
+#include "memory.h"
+#include "sort.h"
+#include <stdio.h>
+#include <string.h>
+
+// Element storage of a list or array, viewed uniformly
+typedef struct {
+    ElementKind* kind;
+    ElementData* data;
+    size_t length;
+    int* locked;
+    void* owner;
+} SortTarget;
+
+static int sort_target(const Value* value, SortTarget* target) {
+    if (value->type == VALUE_TONLIST && value->data.tonlist_val) {
+        TonList* list = (TonList*)value->data.tonlist_val;
+        target->kind = &list->kind;
+        target->data = &list->data;
+        target->length = (size_t)list->size;
+        target->locked = &list->locked;
+        target->owner = list;
+        return 1;
+    }
+    if (value->type == VALUE_ARRAY && value->data.array_val) {
+        TonArray* arr = (TonArray*)value->data.array_val;
+        target->kind = &arr->element_kind;
+        target->data = &arr->elements;
+        target->length = arr->length;
+        target->locked = &arr->locked;
+        target->owner = arr;
+        return 1;
+    }
+    return 0;
+}
+
+void sort_callbacks_init(SortCallbacks* cb, const char* name) {
+    cb->name = name;
+    cb->frame.env = NULL;
+    cb->has_callback = 0;
+    cb->failed = 0;
+    cb->error[0] = '\0';
+}
+
+void sort_callbacks_fail(SortCallbacks* cb, const char* message) {
+    if (cb->failed) return;
+    cb->failed = 1;
+    snprintf(cb->error, sizeof(cb->error), "%s: %s", cb->name, message ? message : "callback failed");
+}
+
+int sort_callbacks_open(SortCallbacks* cb, const Value* callee, int arg_count, Environment* env) {
+    TonError err = call_frame_open(&cb->frame, callee, arg_count, env);
+    if (err.code != TON_OK) {
+        sort_callbacks_fail(cb, arg_count == 2 ? "comparator must be a function of two arguments"
+                                          : "predicate must be a function of one argument");
+        return 0;
+    }
+    cb->has_callback = 1;
+    return 1;
+}
+
+void sort_callbacks_close(SortCallbacks* cb) {
+    if (cb->has_callback) call_frame_close(&cb->frame);
+}
+
+static int natural_less(const Value* a, const Value* b, void* ctx) {
+    SortCallbacks* cb = (SortCallbacks*)ctx;
+    if (cb->failed) return 0;
+    int comparable;
+    int order = sort_compare_natural(a, b, &comparable);
+    if (!comparable) {
+        char message[96];
+        snprintf(message, sizeof(message), "cannot compare %s and %s", value_type_to_string(a->type), value_type_to_string(b->type));
+        sort_callbacks_fail(cb, message);
+        return 0;
+    }
+    return order < 0;
+}
+
+// Comparators return true (or a negative int) when a belongs before b
+static int callback_less(const Value* a, const Value* b, void* ctx) {
+    SortCallbacks* cb = (SortCallbacks*)ctx;
+    if (cb->failed) return 0;
+    Value args[2] = { *a, *b };
+    Value result;
+    TonError err = call_frame_invoke(&cb->frame, args, &result);
+    if (err.code != TON_OK) {
+        sort_callbacks_fail(cb, err.message);
+        return 0;
+    }
+    int less = 0;
+    if (result.type == VALUE_BOOL) less = result.data.bool_val != 0;
+    else if (result.type == VALUE_INT) less = result.data.int_val < 0;
+    else sort_callbacks_fail(cb, "comparator must return a bool or an int");
+    value_release(&result);
+    return less;
+}
+
+SortLessFn sort_callbacks_less(const SortCallbacks* cb) {
+    return cb->has_callback ? callback_less : natural_less;
+}
+
+static int callback_pred(const Value* value, void* ctx) {
+    SortCallbacks* cb = (SortCallbacks*)ctx;
+    if (cb->failed) return 0;
+    Value result;
+    TonError err = call_frame_invoke(&cb->frame, value, &result);
+    if (err.code != TON_OK) {
+        sort_callbacks_fail(cb, err.message);
+        return 0;
+    }
+    int keep = 0;
+    if (result.type == VALUE_BOOL) keep = result.data.bool_val != 0;
+    else if (result.type == VALUE_INT) keep = result.data.int_val != 0;
+    else sort_callbacks_fail(cb, "predicate must return a bool or an int");
+    value_release(&result);
+    return keep;
+}
+
+static void span_for(SortSpan* span, SortTarget* target, SortCallbacks* cb) {
+    sort_span_init(span, *target->kind, *target->data, sort_callbacks_less(cb), cb);
+    span->stop = &cb->failed;
+    span->owner = target->owner;
+}
+
+// Shared by sort, sort_by and stable_sort
+static Value run_sort(const char* name, Value* args, int arg_count, Environment* env, int need_callback, int stable) {
+    SortTarget target;
+    int min_args = need_callback ? 2 : 1;
+    if (arg_count < min_args || arg_count > 2 || !sort_target(&args[0], &target)) {
+        char message[96];
+        snprintf(message, sizeof(message), need_callback ? "%s expects a list or array and a comparator"
+                                                         : "%s expects a list or array and an optional comparator", name);
+        return create_value_error(message);
+    }
+    SortCallbacks cb;
+    sort_callbacks_init(&cb, name);
+    if (*target.locked) {
+        sort_callbacks_fail(&cb, "list is already being sorted");
+        return create_value_error(cb.error);
+    }
+    if (arg_count == 2 && !sort_callbacks_open(&cb, &args[1], 2, env)) {
+        return create_value_error(cb.error);
+    }
+
+    if (!cb.has_callback && *target.kind != ELEMENTS_BOXED) {
+        // Unboxed natural order: radix sort is stable, so it serves both
+        if (!sort_radix(*target.kind, *target.data, target.length)) sort_callbacks_fail(&cb, "out of memory");
+    } else {
+        SortSpan span;
+        span_for(&span, &target, &cb);
+        *target.locked = 1;
+        if (!stable) {
+            sort_unstable(&span, target.length);
+        } else if (target.length > 1 && *target.kind == ELEMENTS_BOXED) {
+            // Scratch for boxed elements is a list, so the collector sees
+            // values while they are parked there during a merge
+            TonList* scratch = tonlist_create();
+            void* grown = scratch ? ton_realloc(scratch->data.raw, sizeof(Value) * target.length) : NULL;
+            if (!grown) {
+                sort_callbacks_fail(&cb, "out of memory");
+            } else {
+                scratch->data.raw = grown;
+                scratch->capacity = (int)target.length;
+                for (size_t i = 0; i < target.length; i++) scratch->data.boxed[i] = create_value_null();
+                scratch->size = (int)target.length;
+                Value scratch_val = create_value_tonlist(scratch);
+                gc_push_root(&scratch_val);
+                span.scratch_owner = scratch;
+                sort_stable(&span, target.length, scratch->data);
+                scratch->size = 0; // Copies only; the elements belong to the target
+                gc_pop_roots(1);
+            }
+        } else if (target.length > 1) {
+            ElementData scratch;
+            scratch.raw = ton_malloc(span.width * target.length);
+            if (!scratch.raw) {
+                sort_callbacks_fail(&cb, "out of memory");
+            } else {
+                sort_stable(&span, target.length, scratch);
+                ton_free(scratch.raw);
+            }
+        }
+        *target.locked = 0;
+    }
+
+    sort_callbacks_close(&cb);
+    if (cb.failed) return create_value_error(cb.error);
+    return args[0];
+}
+
+// sort(list [, less]) -> list, sorted in place (pdqsort; radix sort for unboxed ints and floats)
+Value sort_sort(Value* args, int arg_count, Environment* env) {
+    return run_sort("sort", args, arg_count, env, 0, 0);
+}
+
+// sort_by(list, less) -> list, sorted in place with a comparator
+Value sort_sort_by(Value* args, int arg_count, Environment* env) {
+    return run_sort("sort_by", args, arg_count, env, 1, 0);
+}
+
+// stable_sort(list [, less]) -> list, sorted in place keeping equal elements in order
+Value sort_stable_sort(Value* args, int arg_count, Environment* env) {
+    return run_sort("stable_sort", args, arg_count, env, 0, 1);
+}
+
+// nth_element(list, n [, less]) -> the element a full sort would put at n
+Value sort_nth_element(Value* args, int arg_count, Environment* env) {
+    SortTarget target;
+    if (arg_count < 2 || arg_count > 3 || !sort_target(&args[0], &target) || args[1].type != VALUE_INT) {
+        return create_value_error("nth_element expects a list or array, an index and an optional comparator");
+    }
+    if (args[1].data.int_val < 0 || (size_t)args[1].data.int_val >= target.length) {
+        return create_value_error("nth_element: index out of range");
+    }
+    SortCallbacks cb;
+    sort_callbacks_init(&cb, "nth_element");
+    if (*target.locked) {
+        sort_callbacks_fail(&cb, "list is already being sorted");
+        return create_value_error(cb.error);
+    }
+    if (arg_count == 3 && !sort_callbacks_open(&cb, &args[2], 2, env)) {
+        return create_value_error(cb.error);
+    }
+
+    SortSpan span;
+    span_for(&span, &target, &cb);
+    size_t nth = (size_t)args[1].data.int_val;
+    *target.locked = 1;
+    sort_select(&span, target.length, nth);
+    *target.locked = 0;
+    sort_callbacks_close(&cb);
+    if (cb.failed) return create_value_error(cb.error);
+
+    Value element = elements_load(*target.kind, *target.data, nth);
+    return value_copy(&element);
+}
+
+// partition(list, pred) -> number of elements for which pred holds; they are moved to the front
+Value sort_partition_by(Value* args, int arg_count, Environment* env) {
+    SortTarget target;
+    if (arg_count != 2 || !sort_target(&args[0], &target)) {
+        return create_value_error("partition expects a list or array and a predicate");
+    }
+    SortCallbacks cb;
+    sort_callbacks_init(&cb, "partition");
+    if (*target.locked) {
+        sort_callbacks_fail(&cb, "list is already being sorted");
+        return create_value_error(cb.error);
+    }
+    if (!sort_callbacks_open(&cb, &args[1], 1, env)) {
+        return create_value_error(cb.error);
+    }
+
+    SortSpan span;
+    span_for(&span, &target, &cb);
+    *target.locked = 1;
+    size_t split = sort_partition(&span, target.length, callback_pred, &cb);
+    *target.locked = 0;
+    sort_callbacks_close(&cb);
+    if (cb.failed) return create_value_error(cb.error);
+    return create_value_int((int)split);
+}
+
+// binary_search(sorted, value [, less]) -> index of value, or -(insertion point) - 1 if absent
+Value sort_binary_search(Value* args, int arg_count, Environment* env) {
+    SortTarget target;
+    if (arg_count < 2 || arg_count > 3 || !sort_target(&args[0], &target)) {
+        return create_value_error("binary_search expects a list or array, a value and an optional comparator");
+    }
+    SortCallbacks cb;
+    sort_callbacks_init(&cb, "binary_search");
+    if (*target.locked) {
+        sort_callbacks_fail(&cb, "list is being sorted");
+        return create_value_error(cb.error);
+    }
+    if (arg_count == 3 && !sort_callbacks_open(&cb, &args[2], 2, env)) {
+        return create_value_error(cb.error);
+    }
+
+    SortSpan span;
+    span_for(&span, &target, &cb);
+    *target.locked = 1;
+    size_t position = sort_lower_bound(&span, target.length, &args[1]);
+    int found = 0;
+    if (!cb.failed && position < target.length) {
+        Value element = elements_load(*target.kind, *target.data, position);
+        found = !span.less(&args[1], &element, &cb);
+    }
+    *target.locked = 0;
+    sort_callbacks_close(&cb);
+    if (cb.failed) return create_value_error(cb.error);
+    return create_value_int(found ? (int)position : -(int)position - 1);
+}
+
+void install_sort_builtins(Environment* env) {
+    env_add_function(env, "sort", make_builtin_fn("sort"));
+    env_add_function(env, "sort_by", make_builtin_fn("sort_by"));
+    env_add_function(env, "stable_sort", make_builtin_fn("stable_sort"));
+    env_add_function(env, "nth_element", make_builtin_fn("nth_element"));
+    env_add_function(env, "partition", make_builtin_fn("partition"));
+    env_add_function(env, "binary_search", make_builtin_fn("binary_search"));
+}
+
+int is_sort_function(const char* function_name) {
+    return strcmp(function_name, "sort") == 0 ||
+           strcmp(function_name, "sort_by") == 0 ||
+           strcmp(function_name, "stable_sort") == 0 ||
+           strcmp(function_name, "nth_element") == 0 ||
+           strcmp(function_name, "partition") == 0 ||
+           strcmp(function_name, "binary_search") == 0;
+}
+
+Value call_sort_function(const char* function_name, Value* args, int arg_count, Environment* env) {
+    if (strcmp(function_name, "sort") == 0) {
+        return sort_sort(args, arg_count, env);
+    } else if (strcmp(function_name, "sort_by") == 0) {
+        return sort_sort_by(args, arg_count, env);
+    } else if (strcmp(function_name, "stable_sort") == 0) {
+        return sort_stable_sort(args, arg_count, env);
+    } else if (strcmp(function_name, "nth_element") == 0) {
+        return sort_nth_element(args, arg_count, env);
+    } else if (strcmp(function_name, "partition") == 0) {
+        return sort_partition_by(args, arg_count, env);
+    } else if (strcmp(function_name, "binary_search") == 0) {
+        return sort_binary_search(args, arg_count, env);
+    }
+    return create_value_error("Unknown sort function");
+}
@@ -0,0 +1,47 @@
+#ifndef TON_BUILTIN_SORT_H
+#define TON_BUILTIN_SORT_H
+
+#include "interpreter.h"
+#include "environment.h"
+#include "interpreter_expr.h"
+#include "sort.h"
+
+// Ordering state for builtins that call back into Ton. The callee runs in
+// one CallFrame reused for every comparison; the first failure is recorded
+// in `error` and stops the algorithm.
+typedef struct {
+    const char* name;             // Builtin name, for error messages
+    CallFrame frame;              // Reused for every comparator / predicate call
+    int has_callback;
+    int failed;
+    char error[256];
+} SortCallbacks;
+
+void sort_callbacks_init(SortCallbacks* cb, const char* name);
+void sort_callbacks_fail(SortCallbacks* cb, const char* message);
+// Bind `callee` as the comparator (2 arguments) or predicate (1 argument)
+int  sort_callbacks_open(SortCallbacks* cb, const Value* callee, int arg_count, Environment* env);
+void sort_callbacks_close(SortCallbacks* cb);
+// The bound comparator, or natural order if none was bound; ctx is `cb`
+SortLessFn sort_callbacks_less(const SortCallbacks* cb);
+
+// Sorting module initialization
+void install_sort_builtins(Environment* env);
+
+// True for the names handled by call_sort_function
+int is_sort_function(const char* function_name);
+
+// Sorting function dispatcher; comparators run in frames created from `env`
+Value call_sort_function(const char* function_name, Value* args, int arg_count, Environment* env);
+
+// In-place ordering of lists and arrays
+Value sort_sort(Value* args, int arg_count, Environment* env);
+Value sort_sort_by(Value* args, int arg_count, Environment* env);
+Value sort_stable_sort(Value* args, int arg_count, Environment* env);
+Value sort_nth_element(Value* args, int arg_count, Environment* env);
+Value sort_partition_by(Value* args, int arg_count, Environment* env);
+
+// Searching sorted lists and arrays
+Value sort_binary_search(Value* args, int arg_count, Environment* env);
+
+#endif // TON_BUILTIN_SORT_H
@@ -1,17 +1,24 @@
 #include "builtin_tonlib.h"
 #include "builtin.h"
 #include "collections.h"
+#include "persistent.h"
+#include "sketch.h"
+#include "art.h"
+#include "cache.h"
+#include "soa.h"
 #include "sha256.h"
 #include "md5.h"
 #include "memory.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include <math.h>
 #include <ctype.h>
 #include <time.h>
 #include <stdint.h>
 #include "array.h" // Added to resolve TonArray and tonarray_create errors
+#include "struct.h"
 #include "memory.h" // Added to resolve my_strdup undefined reference
 
 // Math constants
@@ -57,8 +64,12 @@ unsigned char* base64_decode(const char* data, size_t* output_length) {
     if (input_length > 0 && data[input_length - 1] == '=') padding++;
     if (input_length > 1 && data[input_length - 2] == '=') padding++;
 
+    for (size_t i = 0; i < input_length; i++) {
+        if (data[i] == '=' ? i < input_length - padding : !strchr(base64_table, data[i])) return NULL;
+    }
+
     *output_length = (input_length / 4) * 3 - padding;
-    unsigned char* decoded_data = ton_malloc(*output_length);
+    unsigned char* decoded_data = ton_malloc(*output_length > 0 ? *output_length : 1);
     if (decoded_data == NULL) return NULL;
 
     for (size_t i = 0, j = 0; i < input_length;) {
@@ -242,12 +253,533 @@ Value tonlib_array_create(Value* args, int arg_count) {
     }
 
     if (arg_count > 1 && args[1].type == VALUE_STRING) {
-        arr->element_type_name = ton_strdup(args[1].data.string_val);
+        array_set_element_type(arr, args[1].data.string_val);
     }
 
     return create_value_array(arr);
 }
 
+// TonList operations
+Value tonlib_list_push(Value* args, int arg_count) {
+    if (arg_count != 2 || args[0].type != VALUE_TONLIST) {
+        return create_value_bool(0);
+    }
+    return create_value_bool(tonlist_push((TonList*)args[0].data.tonlist_val, args[1]));
+}
+
+Value tonlib_list_pop(Value* args, int arg_count) {
+    if (arg_count != 1 || args[0].type != VALUE_TONLIST) {
+        return create_value_null();
+    }
+    return tonlist_pop((TonList*)args[0].data.tonlist_val);
+}
+
+Value tonlib_list_get(Value* args, int arg_count) {
+    if (arg_count != 2 || args[0].type != VALUE_TONLIST || args[1].type != VALUE_INT) {
+        return create_value_null();
+    }
+    Value item = tonlist_get((TonList*)args[0].data.tonlist_val, args[1].data.int_val);
+    return value_copy(&item);
+}
+
+Value tonlib_list_set(Value* args, int arg_count) {
+    if (arg_count != 3 || args[0].type != VALUE_TONLIST || args[1].type != VALUE_INT) {
+        return create_value_bool(0);
+    }
+    return create_value_bool(tonlist_set((TonList*)args[0].data.tonlist_val, args[1].data.int_val, args[2]));
+}
+
+Value tonlib_list_size(Value* args, int arg_count) {
+    if (arg_count != 1 || args[0].type != VALUE_TONLIST) {
+        return create_value_int(0);
+    }
+    return create_value_int(tonlist_size((TonList*)args[0].data.tonlist_val));
+}
+
+// TonMap operations (keys may be any hashable value)
+Value tonlib_map_set(Value* args, int arg_count) {
+    if (arg_count != 3 || args[0].type != VALUE_TONMAP) {
+        return create_value_bool(0);
+    }
+    if (!tonmap_key_hashable(&args[1])) {
+        return create_value_error("map_set: key is not hashable");
+    }
+    return create_value_bool(tonmap_set_value((TonMap*)args[0].data.tonmap_val, &args[1], args[2]));
+}
+
+Value tonlib_map_get(Value* args, int arg_count) {
+    if (arg_count != 2 || args[0].type != VALUE_TONMAP) {
+        return create_value_null();
+    }
+    Value item = tonmap_get_value((TonMap*)args[0].data.tonmap_val, &args[1]);
+    return value_copy(&item);
+}
+
+Value tonlib_map_has(Value* args, int arg_count) {
+    if (arg_count != 2 || args[0].type != VALUE_TONMAP) {
+        return create_value_bool(0);
+    }
+    return create_value_bool(tonmap_has_value((TonMap*)args[0].data.tonmap_val, &args[1]));
+}
+
+Value tonlib_map_remove(Value* args, int arg_count) {
+    if (arg_count != 2 || args[0].type != VALUE_TONMAP) {
+        return create_value_bool(0);
+    }
+    return create_value_bool(tonmap_remove_value((TonMap*)args[0].data.tonmap_val, &args[1]));
+}
+
+Value tonlib_map_size(Value* args, int arg_count) {
+    if (arg_count != 1 || args[0].type != VALUE_TONMAP) {
+        return create_value_int(0);
+    }
+    return create_value_int(tonmap_size((TonMap*)args[0].data.tonmap_val));
+}
+
+// Keys, values or [key, value] pairs of a map, in insertion order
+static Value map_to_list(Value* args, int arg_count, const char* name, int keys, int values) {
+    if (arg_count != 1 || args[0].type != VALUE_TONMAP) {
+        char message[64];
+        snprintf(message, sizeof(message), "%s: expected a map", name);
+        return create_value_error(message);
+    }
+    TonMap* map = (TonMap*)args[0].data.tonmap_val;
+    TonList* list = tonlist_create();
+    if (!list) {
+        return create_value_error("Failed to create list");
+    }
+    for (int i = tonmap_next(map, 0); i >= 0; i = tonmap_next(map, i + 1)) {
+        const TonMapEntry* entry = &map->entries[i];
+        if (keys && values) {
+            TonList* pair = tonlist_create();
+            if (!pair) {
+                return create_value_error("Failed to create list");
+            }
+            tonlist_push(pair, entry->key);
+            tonlist_push(pair, entry->value);
+            tonlist_push(list, create_value_tonlist(pair));
+        } else {
+            tonlist_push(list, keys ? entry->key : entry->value);
+        }
+    }
+    return create_value_tonlist(list);
+}
+
+Value tonlib_map_keys(Value* args, int arg_count) {
+    return map_to_list(args, arg_count, "map_keys", 1, 0);
+}
+
+Value tonlib_map_values(Value* args, int arg_count) {
+    return map_to_list(args, arg_count, "map_values", 0, 1);
+}
+
+Value tonlib_map_items(Value* args, int arg_count) {
+    return map_to_list(args, arg_count, "map_items", 1, 1);
+}
+
+// TonSet operations
+Value tonlib_set_add(Value* args, int arg_count) {
+    if (arg_count != 2 || args[0].type != VALUE_TONSET) {
+        return create_value_bool(0);
+    }
+    if (!tonmap_key_hashable(&args[1])) {
+        return create_value_error("set_add: value is not hashable");
+    }
+    return create_value_bool(tonset_add_value((TonSet*)args[0].data.tonset_val, &args[1]));
+}
+
+Value tonlib_set_has(Value* args, int arg_count) {
+    if (arg_count != 2 || args[0].type != VALUE_TONSET) {
+        return create_value_bool(0);
+    }
+    return create_value_bool(tonset_has_value((TonSet*)args[0].data.tonset_val, &args[1]));
+}
+
+Value tonlib_set_remove(Value* args, int arg_count) {
+    if (arg_count != 2 || args[0].type != VALUE_TONSET) {
+        return create_value_bool(0);
+    }
+    return create_value_bool(tonset_remove_value((TonSet*)args[0].data.tonset_val, &args[1]));
+}
+
+Value tonlib_set_size(Value* args, int arg_count) {
+    if (arg_count != 1 || args[0].type != VALUE_TONSET) {
+        return create_value_int(0);
+    }
+    return create_value_int(tonset_size((TonSet*)args[0].data.tonset_val));
+}
+
+// TonOMap operations
+static TonOMap* omap_arg(Value* args, int arg_count, int expected) {
+    if (arg_count != expected || args[0].type != VALUE_TONOMAP) return NULL;
+    return (TonOMap*)args[0].data.tonomap_val;
+}
+
+static Value omap_key_error(const char* name) {
+    char message[96];
+    snprintf(message, sizeof(message), "%s: keys must be all ints or all strings", name);
+    return create_value_error(message);
+}
+
+// [key, value] pair at a cursor, as a new list
+static Value omap_pair(TonOMap* map, const TonOMapCursor* cursor) {
+    TonList* pair = tonlist_create();
+    if (!pair) {
+        return create_value_error("Failed to create list");
+    }
+    tonlist_push(pair, tonomap_cursor_key(map, cursor));
+    tonlist_push(pair, tonomap_cursor_value(cursor));
+    return create_value_tonlist(pair);
+}
+
+// Length and element i of a list or array argument
+static int sequence_length(const Value* value) {
+    if (value->type == VALUE_TONLIST) return tonlist_size((TonList*)value->data.tonlist_val);
+    if (value->type == VALUE_ARRAY) return (int)((TonArray*)value->data.array_val)->length;
+    return -1;
+}
+
+static Value sequence_get(const Value* value, int index) {
+    if (value->type == VALUE_TONLIST) return tonlist_get((TonList*)value->data.tonlist_val, index);
+    return array_get((TonArray*)value->data.array_val, (size_t)index);
+}
+
+// omap_create() -> empty ordered map
+Value tonlib_omap_create(Value* args, int arg_count) {
+    (void)args;
+    (void)arg_count;
+    TonOMap* map = tonomap_create();
+    if (!map) {
+        return create_value_error("Failed to create ordered map");
+    }
+    return create_value_tonomap(map);
+}
+
+// omap_from_sorted(keys [, values]) -> ordered map bulk loaded from strictly ascending keys
+Value tonlib_omap_from_sorted(Value* args, int arg_count) {
+    int count = arg_count >= 1 ? sequence_length(&args[0]) : -1;
+    if (count < 0 || arg_count > 2 || (arg_count == 2 && sequence_length(&args[1]) != count)) {
+        return create_value_error("omap_from_sorted expects a list of keys and an optional list of values of the same length");
+    }
+    Value* keys = (Value*)ton_malloc(sizeof(Value) * (count > 0 ? count : 1));
+    Value* values = arg_count == 2 ? (Value*)ton_malloc(sizeof(Value) * (count > 0 ? count : 1)) : NULL;
+    TonOMap* map = tonomap_create();
+    if (!keys || (arg_count == 2 && !values) || !map) {
+        ton_free(keys);
+        ton_free(values);
+        return create_value_error("Failed to create ordered map");
+    }
+    for (int i = 0; i < count; i++) {
+        keys[i] = sequence_get(&args[0], i);
+        if (values) values[i] = sequence_get(&args[1], i);
+    }
+    int loaded = tonomap_load_sorted(map, keys, values, count);
+    ton_free(keys);
+    ton_free(values);
+    if (loaded < 0) {
+        return create_value_error("omap_from_sorted: keys must be strictly ascending ints or strings");
+    }
+    if (loaded == 0) {
+        return create_value_error("omap_from_sorted: out of memory");
+    }
+    return create_value_tonomap(map);
+}
+
+// omap_set(map, key, value) -> bool
+Value tonlib_omap_set(Value* args, int arg_count) {
+    TonOMap* map = omap_arg(args, arg_count, 3);
+    if (!map) {
+        return create_value_error("omap_set expects an ordered map, a key and a value");
+    }
+    if (!tonomap_key_ok(map, &args[1])) {
+        return omap_key_error("omap_set");
+    }
+    return create_value_bool(tonomap_set(map, &args[1], args[2]));
+}
+
+// omap_get(map, key) -> value, or null if absent
+Value tonlib_omap_get(Value* args, int arg_count) {
+    TonOMap* map = omap_arg(args, arg_count, 2);
+    if (!map) {
+        return create_value_error("omap_get expects an ordered map and a key");
+    }
+    Value item;
+    if (!tonomap_get(map, &args[1], &item)) {
+        return create_value_null();
+    }
+    return value_copy(&item);
+}
+
+// omap_has(map, key) -> bool
+Value tonlib_omap_has(Value* args, int arg_count) {
+    TonOMap* map = omap_arg(args, arg_count, 2);
+    if (!map) {
+        return create_value_error("omap_has expects an ordered map and a key");
+    }
+    Value item;
+    return create_value_bool(tonomap_get(map, &args[1], &item));
+}
+
+// omap_remove(map, key) -> true if the key was present
+Value tonlib_omap_remove(Value* args, int arg_count) {
+    TonOMap* map = omap_arg(args, arg_count, 2);
+    if (!map) {
+        return create_value_error("omap_remove expects an ordered map and a key");
+    }
+    return create_value_bool(tonomap_remove(map, &args[1]));
+}
+
+// omap_size(map) -> int
+Value tonlib_omap_size(Value* args, int arg_count) {
+    TonOMap* map = omap_arg(args, arg_count, 1);
+    if (!map) {
+        return create_value_error("omap_size expects an ordered map");
+    }
+    return create_value_int(tonomap_size(map));
+}
+
+// omap_first(map) -> least key, or null if empty
+Value tonlib_omap_first(Value* args, int arg_count) {
+    TonOMap* map = omap_arg(args, arg_count, 1);
+    if (!map) {
+        return create_value_error("omap_first expects an ordered map");
+    }
+    TonOMapCursor cursor = tonomap_begin(map);
+    if (!cursor.leaf) {
+        return create_value_null();
+    }
+    Value key = tonomap_cursor_key(map, &cursor);
+    return value_copy(&key);
+}
+
+// omap_last(map) -> greatest key, or null if empty
+Value tonlib_omap_last(Value* args, int arg_count) {
+    TonOMap* map = omap_arg(args, arg_count, 1);
+    if (!map) {
+        return create_value_error("omap_last expects an ordered map");
+    }
+    TonOMapCursor cursor = tonomap_last(map);
+    if (!cursor.leaf) {
+        return create_value_null();
+    }
+    Value key = tonomap_cursor_key(map, &cursor);
+    return value_copy(&key);
+}
+
+// omap_lower_bound(map, key) -> least key not less than key, or null
+Value tonlib_omap_lower_bound(Value* args, int arg_count) {
+    TonOMap* map = omap_arg(args, arg_count, 2);
+    if (!map) {
+        return create_value_error("omap_lower_bound expects an ordered map and a key");
+    }
+    TonOMapCursor cursor = tonomap_lower_bound(map, &args[1]);
+    if (!cursor.leaf) {
+        return create_value_null();
+    }
+    Value key = tonomap_cursor_key(map, &cursor);
+    return value_copy(&key);
+}
+
+// omap_range(map, lo, hi) -> list of [key, value] pairs with lo <= key < hi, in key order
+Value tonlib_omap_range(Value* args, int arg_count) {
+    TonOMap* map = omap_arg(args, arg_count, 3);
+    if (!map) {
+        return create_value_error("omap_range expects an ordered map and two keys");
+    }
+    if (map->size > 0 && (!tonomap_key_ok(map, &args[1]) || !tonomap_key_ok(map, &args[2]))) {
+        return omap_key_error("omap_range");
+    }
+    TonList* list = tonlist_create();
+    if (!list) {
+        return create_value_error("Failed to create list");
+    }
+    int comparable;
+    if (sort_compare_natural(&args[1], &args[2], &comparable) >= 0) {
+        return create_value_tonlist(list);
+    }
+    TonOMapCursor end = tonomap_lower_bound(map, &args[2]);
+    for (TonOMapCursor cursor = tonomap_lower_bound(map, &args[1]);
+         cursor.leaf && (cursor.leaf != end.leaf || cursor.index < end.index);
+         tonomap_cursor_next(&cursor)) {
+        tonlist_push(list, omap_pair(map, &cursor));
+    }
+    return create_value_tonlist(list);
+}
+
+// omap_pop_min(map) -> [key, value] pair of the least key, removed from the map; null if empty
+Value tonlib_omap_pop_min(Value* args, int arg_count) {
+    TonOMap* map = omap_arg(args, arg_count, 1);
+    if (!map) {
+        return create_value_error("omap_pop_min expects an ordered map");
+    }
+    TonOMapCursor cursor = tonomap_begin(map);
+    if (!cursor.leaf) {
+        return create_value_null();
+    }
+    Value pair = omap_pair(map, &cursor);
+    if (pair.type == VALUE_TONLIST) {
+        Value key = tonlist_get((TonList*)pair.data.tonlist_val, 0);
+        tonomap_remove(map, &key);
+    }
+    return pair;
+}
+
+// TonART operations; keys are strings
+static TonART* art_arg(Value* args, int arg_count, int expected) {
+    if (arg_count != expected || args[0].type != VALUE_TONART) return NULL;
+    if (expected > 1 && args[1].type != VALUE_STRING) return NULL;
+    return (TonART*)args[0].data.tonart_val;
+}
+
+// [key, value] pair of a leaf, as a new list
+static Value art_pair(const ArtLeaf* leaf) {
+    TonList* pair = tonlist_create();
+    if (!pair) {
+        return create_value_error("Failed to create list");
+    }
+    tonlist_push(pair, create_value_string(ton_strdup(leaf->key)));
+    tonlist_push(pair, value_copy(&leaf->value));
+    return create_value_tonlist(pair);
+}
+
+typedef struct {
+    TonList* list;
+    int limit;                    // Pairs still wanted; negative for no limit
+} ArtCollect;
+
+static int art_collect(void* ctx, const ArtLeaf* leaf) {
+    ArtCollect* collect = (ArtCollect*)ctx;
+    if (collect->limit == 0) return 1;
+    tonlist_push(collect->list, art_pair(leaf));
+    if (collect->limit > 0) collect->limit--;
+    return 0;
+}
+
+// art_create() -> empty radix tree
+Value tonlib_art_create(Value* args, int arg_count) {
+    (void)args;
+    (void)arg_count;
+    TonART* art = tonart_create();
+    if (!art) {
+        return create_value_error("Failed to create radix tree");
+    }
+    return create_value_tonart(art);
+}
+
+// art_insert(tree, key, value) -> true if the key was new
+Value tonlib_art_insert(Value* args, int arg_count) {
+    TonART* art = art_arg(args, arg_count, 3);
+    if (!art) {
+        return create_value_error("art_insert expects a radix tree, a string key and a value");
+    }
+    int inserted = tonart_insert(art, args[1].data.string_val, args[2]);
+    if (inserted < 0) {
+        return create_value_error("art_insert: out of memory");
+    }
+    return create_value_bool(inserted);
+}
+
+// art_get(tree, key) -> value, or null if absent
+Value tonlib_art_get(Value* args, int arg_count) {
+    TonART* art = art_arg(args, arg_count, 2);
+    if (!art) {
+        return create_value_error("art_get expects a radix tree and a string key");
+    }
+    Value item;
+    if (!tonart_get(art, args[1].data.string_val, &item)) {
+        return create_value_null();
+    }
+    return value_copy(&item);
+}
+
+// art_has(tree, key) -> bool
+Value tonlib_art_has(Value* args, int arg_count) {
+    TonART* art = art_arg(args, arg_count, 2);
+    if (!art) {
+        return create_value_error("art_has expects a radix tree and a string key");
+    }
+    Value item;
+    return create_value_bool(tonart_get(art, args[1].data.string_val, &item));
+}
+
+// art_remove(tree, key) -> true if the key was present
+Value tonlib_art_remove(Value* args, int arg_count) {
+    TonART* art = art_arg(args, arg_count, 2);
+    if (!art) {
+        return create_value_error("art_remove expects a radix tree and a string key");
+    }
+    return create_value_bool(tonart_remove(art, args[1].data.string_val));
+}
+
+// art_size(tree) -> int
+Value tonlib_art_size(Value* args, int arg_count) {
+    TonART* art = art_arg(args, arg_count, 1);
+    if (!art) {
+        return create_value_error("art_size expects a radix tree");
+    }
+    return create_value_int(tonart_size(art));
+}
+
+// art_longest_prefix(tree, s) -> [key, value] pair of the longest key that is a prefix of s, or null
+Value tonlib_art_longest_prefix(Value* args, int arg_count) {
+    TonART* art = art_arg(args, arg_count, 2);
+    if (!art) {
+        return create_value_error("art_longest_prefix expects a radix tree and a string");
+    }
+    const ArtLeaf* leaf = tonart_longest_prefix(art, args[1].data.string_val);
+    if (!leaf) {
+        return create_value_null();
+    }
+    return art_pair(leaf);
+}
+
+// art_prefix(tree, prefix [, limit]) -> list of [key, value] pairs whose key starts with prefix, in key order
+Value tonlib_art_prefix(Value* args, int arg_count) {
+    TonART* art = art_arg(args, arg_count, arg_count == 3 ? 3 : 2);
+    if (!art || (arg_count == 3 && args[2].type != VALUE_INT)) {
+        return create_value_error("art_prefix expects a radix tree, a string prefix and an optional int limit");
+    }
+    ArtCollect collect;
+    collect.list = tonlist_create();
+    collect.limit = arg_count == 3 && args[2].data.int_val >= 0 ? args[2].data.int_val : -1;
+    if (!collect.list) {
+        return create_value_error("Failed to create list");
+    }
+    tonart_iter_prefix(art, args[1].data.string_val, art_collect, &collect);
+    return create_value_tonlist(collect.list);
+}
+
+// A field can be part of a key if it holds a scalar, a string or an
+// instance of a type that was already made hashable
+static int field_type_hashable(const char* type_name) {
+    static const char* const key_types[] = { "int", "float", "bool", "char", "string", "inferred" };
+    for (size_t i = 0; i < sizeof(key_types) / sizeof(key_types[0]); i++) {
+        if (strcmp(type_name, key_types[i]) == 0) return 1;
+    }
+    const TonStructType* field_type = find_struct_type(type_name);
+    return field_type && field_type->hashable;
+}
+
+// struct_hashable(type_name) -> true once instances of the type may be used as keys
+Value tonlib_struct_hashable(Value* args, int arg_count) {
+    if (arg_count != 1 || args[0].type != VALUE_STRING) {
+        return create_value_bool(0);
+    }
+    TonStructType* type = find_struct_type(args[0].data.string_val);
+    if (!type) {
+        return create_value_error("struct_hashable: unknown struct type");
+    }
+    for (int i = 0; i < type->num_fields; i++) {
+        if (!field_type_hashable(type->fields[i].type_name)) {
+            char message[160];
+            snprintf(message, sizeof(message), "struct_hashable: field '%s' cannot be part of a key", type->fields[i].name);
+            return create_value_error(message);
+        }
+    }
+    type->hashable = 1;
+    return create_value_bool(1);
+}
+
 // Type conversion functions
 Value tonlib_int_to_string(Value* args, int arg_count) {
     if (arg_count != 1 || args[0].type != VALUE_INT) {
@@ -289,6 +821,34 @@ Value tonlib_length(Value* args, int arg_count) {
     return create_value_int(strlen(args[0].data.string_val));
 }
 
+// Element count of a string, array, list, map, set, deque, priority queue, ordered map,
+// radix tree, cache, struct-of-arrays, persistent collection or bitmap
+Value tonlib_len(Value* args, int arg_count) {
+    if (arg_count != 1) {
+        return create_value_error("len expects 1 argument");
+    }
+    switch (args[0].type) {
+        case VALUE_STRING:  return create_value_int((int)strlen(args[0].data.string_val));
+        case VALUE_ARRAY:   return create_value_int((int)((TonArray*)args[0].data.array_val)->length);
+        case VALUE_TONLIST: return create_value_int(tonlist_size((TonList*)args[0].data.tonlist_val));
+        case VALUE_TONMAP:  return create_value_int(tonmap_size((TonMap*)args[0].data.tonmap_val));
+        case VALUE_TONSET:  return create_value_int(tonset_size((TonSet*)args[0].data.tonset_val));
+        case VALUE_TONDEQUE: return create_value_int(tondeque_size((TonDeque*)args[0].data.tondeque_val));
+        case VALUE_TONPQ:   return create_value_int(tonpq_size((TonPQ*)args[0].data.tonpq_val));
+        case VALUE_TONOMAP: return create_value_int(tonomap_size((TonOMap*)args[0].data.tonomap_val));
+        case VALUE_TONPVEC: return create_value_int(tonpvec_size((TonPVec*)args[0].data.tonpvec_val));
+        case VALUE_TONPMAP: return create_value_int(tonpmap_size((TonPMap*)args[0].data.tonpmap_val));
+        case VALUE_TONART:  return create_value_int(tonart_size((TonART*)args[0].data.tonart_val));
+        case VALUE_TONCACHE: return create_value_int(toncache_size((TonCache*)args[0].data.toncache_val));
+        case VALUE_TONSOA: return create_value_int(tonsoa_size((TonSoA*)args[0].data.tonsoa_val));
+        case VALUE_TONBITMAP: {
+            uint64_t count = bitmap_cardinality((TonBitmap*)args[0].data.tonbitmap_val);
+            return create_value_int(count > INT_MAX ? INT_MAX : (int)count);
+        }
+        default:            return create_value_error("len: value has no length");
+    }
+}
+
 Value tonlib_concat(Value* args, int arg_count) {
     if (arg_count != 2 || args[0].type != VALUE_STRING || args[1].type != VALUE_STRING) {
         return create_value_string("");
@@ -395,6 +955,44 @@ void install_tonlib_builtins(Environment* env) {
     env_add_function(env, "map_create", make_builtin_fn("map_create"));
     env_add_function(env, "set_create", make_builtin_fn("set_create"));
     env_add_function(env, "array_create", make_builtin_fn("array_create")); // Dodano array_create
+    env_add_function(env, "list_push", make_builtin_fn("list_push"));
+    env_add_function(env, "list_pop", make_builtin_fn("list_pop"));
+    env_add_function(env, "list_get", make_builtin_fn("list_get"));
+    env_add_function(env, "list_set", make_builtin_fn("list_set"));
+    env_add_function(env, "list_size", make_builtin_fn("list_size"));
+    env_add_function(env, "map_set", make_builtin_fn("map_set"));
+    env_add_function(env, "map_get", make_builtin_fn("map_get"));
+    env_add_function(env, "map_has", make_builtin_fn("map_has"));
+    env_add_function(env, "map_remove", make_builtin_fn("map_remove"));
+    env_add_function(env, "map_size", make_builtin_fn("map_size"));
+    env_add_function(env, "map_keys", make_builtin_fn("map_keys"));
+    env_add_function(env, "map_values", make_builtin_fn("map_values"));
+    env_add_function(env, "map_items", make_builtin_fn("map_items"));
+    env_add_function(env, "set_add", make_builtin_fn("set_add"));
+    env_add_function(env, "set_has", make_builtin_fn("set_has"));
+    env_add_function(env, "set_remove", make_builtin_fn("set_remove"));
+    env_add_function(env, "set_size", make_builtin_fn("set_size"));
+    env_add_function(env, "omap_create", make_builtin_fn("omap_create"));
+    env_add_function(env, "omap_from_sorted", make_builtin_fn("omap_from_sorted"));
+    env_add_function(env, "omap_set", make_builtin_fn("omap_set"));
+    env_add_function(env, "omap_get", make_builtin_fn("omap_get"));
+    env_add_function(env, "omap_has", make_builtin_fn("omap_has"));
+    env_add_function(env, "omap_remove", make_builtin_fn("omap_remove"));
+    env_add_function(env, "omap_size", make_builtin_fn("omap_size"));
+    env_add_function(env, "omap_first", make_builtin_fn("omap_first"));
+    env_add_function(env, "omap_last", make_builtin_fn("omap_last"));
+    env_add_function(env, "omap_lower_bound", make_builtin_fn("omap_lower_bound"));
+    env_add_function(env, "omap_range", make_builtin_fn("omap_range"));
+    env_add_function(env, "omap_pop_min", make_builtin_fn("omap_pop_min"));
+    env_add_function(env, "art_create", make_builtin_fn("art_create"));
+    env_add_function(env, "art_insert", make_builtin_fn("art_insert"));
+    env_add_function(env, "art_get", make_builtin_fn("art_get"));
+    env_add_function(env, "art_has", make_builtin_fn("art_has"));
+    env_add_function(env, "art_remove", make_builtin_fn("art_remove"));
+    env_add_function(env, "art_size", make_builtin_fn("art_size"));
+    env_add_function(env, "art_longest_prefix", make_builtin_fn("art_longest_prefix"));
+    env_add_function(env, "art_prefix", make_builtin_fn("art_prefix"));
+    env_add_function(env, "struct_hashable", make_builtin_fn("struct_hashable"));
     
     // Type conversions
     env_add_function(env, "int_to_string", make_builtin_fn("int_to_string"));
@@ -404,6 +1002,7 @@ void install_tonlib_builtins(Environment* env) {
     
     // String operations
     env_add_function(env, "length", make_builtin_fn("length"));
+    env_add_function(env, "len", make_builtin_fn("len"));
     env_add_function(env, "concat", make_builtin_fn("concat"));
     env_add_function(env, "substring", make_builtin_fn("substring"));
     env_add_function(env, "string_to_int_base", make_builtin_fn("string_to_int_base"));
@@ -437,6 +1036,82 @@ Value call_tonlib_function(const char* function_name, Value* args, int arg_count
         return tonlib_set_create(args, arg_count);
     } else if (strcmp(function_name, "array_create") == 0) {
         return tonlib_array_create(args, arg_count);
+    } else if (strcmp(function_name, "list_push") == 0) {
+        return tonlib_list_push(args, arg_count);
+    } else if (strcmp(function_name, "list_pop") == 0) {
+        return tonlib_list_pop(args, arg_count);
+    } else if (strcmp(function_name, "list_get") == 0) {
+        return tonlib_list_get(args, arg_count);
+    } else if (strcmp(function_name, "list_set") == 0) {
+        return tonlib_list_set(args, arg_count);
+    } else if (strcmp(function_name, "list_size") == 0) {
+        return tonlib_list_size(args, arg_count);
+    } else if (strcmp(function_name, "map_set") == 0) {
+        return tonlib_map_set(args, arg_count);
+    } else if (strcmp(function_name, "map_get") == 0) {
+        return tonlib_map_get(args, arg_count);
+    } else if (strcmp(function_name, "map_has") == 0) {
+        return tonlib_map_has(args, arg_count);
+    } else if (strcmp(function_name, "map_remove") == 0) {
+        return tonlib_map_remove(args, arg_count);
+    } else if (strcmp(function_name, "map_size") == 0) {
+        return tonlib_map_size(args, arg_count);
+    } else if (strcmp(function_name, "map_keys") == 0) {
+        return tonlib_map_keys(args, arg_count);
+    } else if (strcmp(function_name, "map_values") == 0) {
+        return tonlib_map_values(args, arg_count);
+    } else if (strcmp(function_name, "map_items") == 0) {
+        return tonlib_map_items(args, arg_count);
+    } else if (strcmp(function_name, "set_add") == 0) {
+        return tonlib_set_add(args, arg_count);
+    } else if (strcmp(function_name, "set_has") == 0) {
+        return tonlib_set_has(args, arg_count);
+    } else if (strcmp(function_name, "set_remove") == 0) {
+        return tonlib_set_remove(args, arg_count);
+    } else if (strcmp(function_name, "set_size") == 0) {
+        return tonlib_set_size(args, arg_count);
+    } else if (strcmp(function_name, "omap_create") == 0) {
+        return tonlib_omap_create(args, arg_count);
+    } else if (strcmp(function_name, "omap_from_sorted") == 0) {
+        return tonlib_omap_from_sorted(args, arg_count);
+    } else if (strcmp(function_name, "omap_set") == 0) {
+        return tonlib_omap_set(args, arg_count);
+    } else if (strcmp(function_name, "omap_get") == 0) {
+        return tonlib_omap_get(args, arg_count);
+    } else if (strcmp(function_name, "omap_has") == 0) {
+        return tonlib_omap_has(args, arg_count);
+    } else if (strcmp(function_name, "omap_remove") == 0) {
+        return tonlib_omap_remove(args, arg_count);
+    } else if (strcmp(function_name, "omap_size") == 0) {
+        return tonlib_omap_size(args, arg_count);
+    } else if (strcmp(function_name, "omap_first") == 0) {
+        return tonlib_omap_first(args, arg_count);
+    } else if (strcmp(function_name, "omap_last") == 0) {
+        return tonlib_omap_last(args, arg_count);
+    } else if (strcmp(function_name, "omap_lower_bound") == 0) {
+        return tonlib_omap_lower_bound(args, arg_count);
+    } else if (strcmp(function_name, "omap_range") == 0) {
+        return tonlib_omap_range(args, arg_count);
+    } else if (strcmp(function_name, "omap_pop_min") == 0) {
+        return tonlib_omap_pop_min(args, arg_count);
+    } else if (strcmp(function_name, "art_create") == 0) {
+        return tonlib_art_create(args, arg_count);
+    } else if (strcmp(function_name, "art_insert") == 0) {
+        return tonlib_art_insert(args, arg_count);
+    } else if (strcmp(function_name, "art_get") == 0) {
+        return tonlib_art_get(args, arg_count);
+    } else if (strcmp(function_name, "art_has") == 0) {
+        return tonlib_art_has(args, arg_count);
+    } else if (strcmp(function_name, "art_remove") == 0) {
+        return tonlib_art_remove(args, arg_count);
+    } else if (strcmp(function_name, "art_size") == 0) {
+        return tonlib_art_size(args, arg_count);
+    } else if (strcmp(function_name, "art_longest_prefix") == 0) {
+        return tonlib_art_longest_prefix(args, arg_count);
+    } else if (strcmp(function_name, "art_prefix") == 0) {
+        return tonlib_art_prefix(args, arg_count);
+    } else if (strcmp(function_name, "struct_hashable") == 0) {
+        return tonlib_struct_hashable(args, arg_count);
     } else if (strcmp(function_name, "int_to_string") == 0) {
         return tonlib_int_to_string(args, arg_count);
     } else if (strcmp(function_name, "float_to_string") == 0) {
@@ -447,6 +1122,8 @@ Value call_tonlib_function(const char* function_name, Value* args, int arg_count
         return tonlib_string_to_float(args, arg_count);
     } else if (strcmp(function_name, "length") == 0) {
         return tonlib_length(args, arg_count);
+    } else if (strcmp(function_name, "len") == 0) {
+        return tonlib_len(args, arg_count);
     } else if (strcmp(function_name, "concat") == 0) {
         return tonlib_concat(args, arg_count);
     } else if (strcmp(function_name, "substring") == 0) {
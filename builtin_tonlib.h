@@ -39,6 +39,7 @@ Value tonlib_random_int(Value* args, int arg_count);
 
 // String module functions
 Value tonlib_length(Value* args, int arg_count);
+Value tonlib_len(Value* args, int arg_count);
 Value tonlib_concat(Value* args, int arg_count);
 Value tonlib_substring(Value* args, int arg_count);
 Value tonlib_index_of(Value* args, int arg_count);
@@ -75,12 +76,38 @@ Value tonlib_map_get(Value* args, int arg_count);
 Value tonlib_map_has(Value* args, int arg_count);
 Value tonlib_map_remove(Value* args, int arg_count);
 Value tonlib_map_size(Value* args, int arg_count);
+Value tonlib_map_keys(Value* args, int arg_count);
+Value tonlib_map_values(Value* args, int arg_count);
+Value tonlib_map_items(Value* args, int arg_count);
 
 Value tonlib_set_create(Value* args, int arg_count);
 Value tonlib_set_add(Value* args, int arg_count);
 Value tonlib_set_has(Value* args, int arg_count);
 Value tonlib_set_remove(Value* args, int arg_count);
 Value tonlib_set_size(Value* args, int arg_count);
+Value tonlib_struct_hashable(Value* args, int arg_count);
+
+Value tonlib_omap_create(Value* args, int arg_count);
+Value tonlib_omap_from_sorted(Value* args, int arg_count);
+Value tonlib_omap_set(Value* args, int arg_count);
+Value tonlib_omap_get(Value* args, int arg_count);
+Value tonlib_omap_has(Value* args, int arg_count);
+Value tonlib_omap_remove(Value* args, int arg_count);
+Value tonlib_omap_size(Value* args, int arg_count);
+Value tonlib_omap_first(Value* args, int arg_count);
+Value tonlib_omap_last(Value* args, int arg_count);
+Value tonlib_omap_lower_bound(Value* args, int arg_count);
+Value tonlib_omap_range(Value* args, int arg_count);
+Value tonlib_omap_pop_min(Value* args, int arg_count);
+
+Value tonlib_art_create(Value* args, int arg_count);
+Value tonlib_art_insert(Value* args, int arg_count);
+Value tonlib_art_get(Value* args, int arg_count);
+Value tonlib_art_has(Value* args, int arg_count);
+Value tonlib_art_remove(Value* args, int arg_count);
+Value tonlib_art_size(Value* args, int arg_count);
+Value tonlib_art_longest_prefix(Value* args, int arg_count);
+Value tonlib_art_prefix(Value* args, int arg_count);
 
 // TonLib info functions
 Value* tonlib_init(Value* args, int arg_count);
@@ -137,4 +164,8 @@ Value tonlib_base64_decode(Value* args, int arg_count);
 Value tonlib_hex_encode(Value* args, int arg_count);
 Value tonlib_hex_decode(Value* args, int arg_count);
 
+// Base64 text for binary data (ton_malloc'd); decoding returns NULL for invalid input
+char* base64_encode(const unsigned char* data, size_t input_length);
+unsigned char* base64_decode(const char* data, size_t* output_length);
+
 #endif // TON_BUILTIN_TONLIB_H
\ No newline at end of file
@@ -0,0 +1,387 @@
+#include "cache.h"
+#include "collections.h"
+#include "array.h"
+#include "gc.h"
+#include "hash.h"
+#include "memory.h"
+#include <string.h>
+
+#define CACHE_MAX_CAPACITY (1 << 30)
+#define CACHE_INITIAL_ENTRIES 16
+#define CACHE_SKETCH_ROWS 4
+#define CACHE_SKETCH_MAX_WORDS (1u << 24)
+
+// ---------------------------------------------------------------------------
+// Frequency sketch (CACHE_TINYLFU): count-min with four rows folded into one
+// table of 4-bit counters. Counters saturate at 15 and are all halved once
+// enough increments have been seen, so old popularity fades.
+
+static int sketch_init(TonCache* cache) {
+    uint32_t words = 8;
+    while (words < (uint32_t)cache->capacity && words < CACHE_SKETCH_MAX_WORDS) words <<= 1;
+    cache->sketch = (uint64_t*)ton_calloc(words, sizeof(uint64_t));
+    if (!cache->sketch) return 0;
+    cache->sketch_mask = words - 1;
+    cache->sketch_additions = 0;
+    uint64_t sample = (uint64_t)cache->capacity * CACHE_SAMPLE_FACTOR;
+    cache->sketch_sample = sample > UINT32_MAX / 2 ? UINT32_MAX / 2 : (uint32_t)sample;
+    return 1;
+}
+
+// Row i uses word (a + i*b) and the counter picked by that word index's top bits
+static void sketch_increment(TonCache* cache, uint64_t hash) {
+    uint32_t a = (uint32_t)hash;
+    uint32_t b = (uint32_t)(hash >> 32) | 1;
+    int added = 0;
+    for (uint32_t i = 0; i < CACHE_SKETCH_ROWS; i++) {
+        uint32_t x = a + i * b;
+        uint64_t* word = &cache->sketch[x & cache->sketch_mask];
+        unsigned shift = (x >> 28) * 4;
+        if (((*word >> shift) & 15) < 15) {
+            *word += (uint64_t)1 << shift;
+            added = 1;
+        }
+    }
+    if (added && ++cache->sketch_additions >= cache->sketch_sample) {
+        for (uint32_t i = 0; i <= cache->sketch_mask; i++) {
+            cache->sketch[i] = (cache->sketch[i] >> 1) & 0x7777777777777777ULL;
+        }
+        cache->sketch_additions /= 2;
+    }
+}
+
+static unsigned sketch_frequency(const TonCache* cache, uint64_t hash) {
+    uint32_t a = (uint32_t)hash;
+    uint32_t b = (uint32_t)(hash >> 32) | 1;
+    unsigned frequency = 15;
+    for (uint32_t i = 0; i < CACHE_SKETCH_ROWS; i++) {
+        uint32_t x = a + i * b;
+        unsigned count = (unsigned)(cache->sketch[x & cache->sketch_mask] >> ((x >> 28) * 4)) & 15;
+        if (count < frequency) frequency = count;
+    }
+    return frequency;
+}
+
+// ---------------------------------------------------------------------------
+// Index: open addressing with linear probing over entry indices
+
+static int32_t find_entry(const TonCache* cache, const Value* key, uint64_t hash, uint32_t* slot_out) {
+    uint32_t slot = (uint32_t)hash & cache->slot_mask;
+    int32_t index;
+    while ((index = cache->slots[slot]) >= 0) {
+        const TonCacheEntry* entry = &cache->entries[index];
+        if (entry->hash == hash && tonmap_key_equal(&entry->key, key)) {
+            if (slot_out) *slot_out = slot;
+            return index;
+        }
+        slot = (slot + 1) & cache->slot_mask;
+    }
+    if (slot_out) *slot_out = slot;
+    return -1;
+}
+
+// Backward-shift deletion: later entries of the probe run move up, so no tombstones are needed
+static void slot_delete(TonCache* cache, int32_t index) {
+    uint32_t mask = cache->slot_mask;
+    uint32_t hole = (uint32_t)cache->entries[index].hash & mask;
+    while (cache->slots[hole] != index) hole = (hole + 1) & mask;
+    uint32_t next = hole;
+    for (;;) {
+        next = (next + 1) & mask;
+        int32_t moved = cache->slots[next];
+        if (moved < 0) break;
+        uint32_t home = (uint32_t)cache->entries[moved].hash & mask;
+        // Move unless the entry's home lies cyclically in (hole, next]
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            cache->slots[hole] = moved;
+            hole = next;
+        }
+    }
+    cache->slots[hole] = -1;
+}
+
+static int resize_slots(TonCache* cache, uint32_t slot_count) {
+    int32_t* slots = (int32_t*)ton_malloc(sizeof(int32_t) * slot_count);
+    if (!slots) return 0;
+    memset(slots, 0xFF, sizeof(int32_t) * slot_count);
+    for (int i = 0; i < cache->entries_used; i++) {
+        if (cache->entries[i].key.type == VALUE_NULL) continue;
+        uint32_t slot = (uint32_t)cache->entries[i].hash & (slot_count - 1);
+        while (slots[slot] >= 0) slot = (slot + 1) & (slot_count - 1);
+        slots[slot] = i;
+    }
+    ton_free(cache->slots);
+    cache->slots = slots;
+    cache->slot_mask = slot_count - 1;
+    return 1;
+}
+
+// ---------------------------------------------------------------------------
+// Entries and segment lists
+
+static void segment_push(TonCache* cache, int32_t index, int segment) {
+    TonCacheSegment* list = &cache->segments[segment];
+    TonCacheEntry* entry = &cache->entries[index];
+    entry->segment = (uint8_t)segment;
+    entry->prev = -1;
+    entry->next = list->head;
+    if (list->head >= 0) cache->entries[list->head].prev = index;
+    else list->tail = index;
+    list->head = index;
+    list->count++;
+}
+
+static void segment_unlink(TonCache* cache, int32_t index) {
+    TonCacheEntry* entry = &cache->entries[index];
+    TonCacheSegment* list = &cache->segments[entry->segment];
+    if (entry->prev >= 0) cache->entries[entry->prev].next = entry->next;
+    else list->head = entry->next;
+    if (entry->next >= 0) cache->entries[entry->next].prev = entry->prev;
+    else list->tail = entry->prev;
+    list->count--;
+}
+
+static void segment_move(TonCache* cache, int32_t index, int segment) {
+    segment_unlink(cache, index);
+    segment_push(cache, index, segment);
+}
+
+// Index of a free entry, growing the entry array if needed; -1 if out of memory
+static int32_t alloc_entry(TonCache* cache) {
+    if (cache->free_list >= 0) {
+        int32_t index = cache->free_list;
+        cache->free_list = cache->entries[index].next;
+        return index;
+    }
+    if (cache->entries_used == cache->entry_capacity) {
+        // An insert holds one entry over the limit until eviction runs
+        int limit = cache->capacity + 1;
+        int grown = cache->entry_capacity * 2 > limit ? limit : cache->entry_capacity * 2;
+        if (grown <= cache->entry_capacity) return -1;
+        TonCacheEntry* entries = (TonCacheEntry*)ton_realloc(cache->entries, sizeof(TonCacheEntry) * (size_t)grown);
+        if (!entries) return -1;
+        cache->entries = entries;
+        cache->entry_capacity = grown;
+        // Keep the index at most half full
+        uint32_t slot_count = cache->slot_mask + 1;
+        while (slot_count < (uint32_t)grown * 2) slot_count <<= 1;
+        if (slot_count != cache->slot_mask + 1 && !resize_slots(cache, slot_count)) return -1;
+    }
+    return cache->entries_used++;
+}
+
+static void remove_entry(TonCache* cache, int32_t index) {
+    TonCacheEntry* entry = &cache->entries[index];
+    segment_unlink(cache, index);
+    slot_delete(cache, index);
+    cache->bytes -= entry->bytes;
+    cache->size--;
+    value_release(&entry->key);
+    value_release(&entry->value);
+    entry->key.type = VALUE_NULL;
+    entry->next = cache->free_list;
+    cache->free_list = index;
+}
+
+static int over_limit(const TonCache* cache) {
+    return cache->size > cache->capacity || (cache->max_bytes && cache->bytes > cache->max_bytes);
+}
+
+static void evict(TonCache* cache, int32_t index) {
+    cache->evictions++;
+    remove_entry(cache, index);
+}
+
+static void enforce_limits(TonCache* cache) {
+    if (cache->policy == CACHE_TINYLFU) {
+        // Entries leaving the window compete with the main space's LRU victim
+        while (cache->segments[CACHE_WINDOW].count > cache->window_max) {
+            int32_t candidate = cache->segments[CACHE_WINDOW].tail;
+            segment_move(cache, candidate, CACHE_PROBATION);
+            if (!over_limit(cache)) continue;
+            int32_t victim = cache->segments[CACHE_PROBATION].tail;
+            if (victim == candidate) victim = cache->segments[CACHE_PROTECTED].tail;
+            if (victim >= 0 && sketch_frequency(cache, cache->entries[candidate].hash) >
+                               sketch_frequency(cache, cache->entries[victim].hash)) {
+                evict(cache, victim);
+            } else {
+                evict(cache, candidate);
+            }
+        }
+    }
+    while (over_limit(cache)) {
+        int32_t victim = cache->segments[CACHE_PROBATION].tail;
+        if (victim < 0) victim = cache->segments[CACHE_PROTECTED].tail;
+        if (victim < 0) victim = cache->segments[CACHE_WINDOW].tail;
+        evict(cache, victim);
+    }
+}
+
+// Record a use of a cached entry
+static void touch(TonCache* cache, int32_t index) {
+    TonCacheEntry* entry = &cache->entries[index];
+    if (cache->policy != CACHE_TINYLFU || entry->segment != CACHE_PROBATION) {
+        segment_move(cache, index, entry->segment);
+        return;
+    }
+    // A second use promotes a probation entry; the protected segment's LRU
+    // entry steps back down to make room
+    segment_move(cache, index, CACHE_PROTECTED);
+    if (cache->segments[CACHE_PROTECTED].count > cache->protected_max) {
+        segment_move(cache, cache->segments[CACHE_PROTECTED].tail, CACHE_PROBATION);
+    }
+}
+
+static size_t value_bytes(const Value* value) {
+    switch (value->type) {
+        case VALUE_STRING:  return value->data.string_val ? strlen(value->data.string_val) + 1 : 0;
+        case VALUE_ARRAY:   return ((TonArray*)value->data.array_val)->length * sizeof(Value);
+        case VALUE_TONLIST: return (size_t)tonlist_size((TonList*)value->data.tonlist_val) * sizeof(Value);
+        case VALUE_TONMAP:  return (size_t)tonmap_size((TonMap*)value->data.tonmap_val) * sizeof(TonMapEntry);
+        case VALUE_TONSET:  return (size_t)tonset_size((TonSet*)value->data.tonset_val) * sizeof(TonMapEntry);
+        default:            return 0;
+    }
+}
+
+size_t toncache_entry_bytes(const Value* key, const Value* value) {
+    return sizeof(TonCacheEntry) + value_bytes(key) + value_bytes(value);
+}
+
+// ---------------------------------------------------------------------------
+// Cache operations
+
+TonCache* toncache_create(int capacity, int policy, size_t max_bytes) {
+    if (capacity < 1 || capacity > CACHE_MAX_CAPACITY) return NULL;
+    TonCache* cache = gc_alloc(GC_KIND_CACHE, sizeof(TonCache));
+    if (!cache) return NULL;
+    cache->policy = policy;
+    cache->capacity = capacity;
+    cache->max_bytes = max_bytes;
+    cache->free_list = -1;
+    cache->seed = ton_hash_next_seed();
+    for (int i = 0; i < CACHE_SEGMENTS; i++) {
+        cache->segments[i].head = cache->segments[i].tail = -1;
+    }
+    cache->entry_capacity = capacity + 1 < CACHE_INITIAL_ENTRIES ? capacity + 1 : CACHE_INITIAL_ENTRIES;
+    cache->entries = (TonCacheEntry*)ton_malloc(sizeof(TonCacheEntry) * (size_t)cache->entry_capacity);
+    uint32_t slot_count = 8;
+    while (slot_count < (uint32_t)cache->entry_capacity * 2) slot_count <<= 1;
+    if (!cache->entries || !resize_slots(cache, slot_count)) return NULL;    // Reclaimed by the collector
+    if (policy == CACHE_TINYLFU) {
+        cache->window_max = capacity * CACHE_WINDOW_PERCENT / 100;
+        if (cache->window_max < 1) cache->window_max = 1;
+        cache->protected_max = (capacity - cache->window_max) * CACHE_PROTECTED_PERCENT / 100;
+        if (!sketch_init(cache)) return NULL;
+    }
+    return cache;
+}
+
+void toncache_destroy(TonCache* cache) {
+    if (!cache) return;
+    for (int i = 0; i < cache->entries_used; i++) {
+        if (cache->entries[i].key.type == VALUE_NULL) continue;
+        value_release(&cache->entries[i].key);
+        value_release(&cache->entries[i].value);
+    }
+    ton_free(cache->entries);
+    ton_free(cache->slots);
+    ton_free(cache->sketch);
+    gc_free(cache);
+}
+
+int toncache_get(TonCache* cache, const Value* key, Value* out) {
+    uint64_t hash;
+    if (!tonmap_hash_key(key, cache->seed, &hash)) return 0;
+    if (cache->sketch) sketch_increment(cache, hash);
+    int32_t index = find_entry(cache, key, hash, NULL);
+    if (index < 0) {
+        cache->misses++;
+        return 0;
+    }
+    cache->hits++;
+    touch(cache, index);
+    *out = cache->entries[index].value;
+    return 1;
+}
+
+int toncache_peek(const TonCache* cache, const Value* key, Value* out) {
+    uint64_t hash;
+    if (!tonmap_hash_key(key, cache->seed, &hash)) return 0;
+    int32_t index = find_entry(cache, key, hash, NULL);
+    if (index < 0) return 0;
+    *out = cache->entries[index].value;
+    return 1;
+}
+
+int toncache_put(TonCache* cache, const Value* key, Value value) {
+    uint64_t hash;
+    if (!tonmap_hash_key(key, cache->seed, &hash)) return -1;
+    size_t bytes = toncache_entry_bytes(key, &value);
+    int admissible = !cache->max_bytes || bytes <= cache->max_bytes;
+    if (cache->sketch) sketch_increment(cache, hash);
+
+    int32_t index = find_entry(cache, key, hash, NULL);
+    if (index >= 0) {
+        if (!admissible) {
+            remove_entry(cache, index);
+            return 0;
+        }
+        TonCacheEntry* entry = &cache->entries[index];
+        value_release(&entry->value);
+        entry->value = value_copy(&value);
+        cache->bytes += bytes - entry->bytes;
+        entry->bytes = bytes;
+        touch(cache, index);
+    } else {
+        if (!admissible) return 0;
+        index = alloc_entry(cache);
+        if (index < 0) return -1;
+        uint32_t slot;
+        find_entry(cache, key, hash, &slot);
+        cache->slots[slot] = index;
+        TonCacheEntry* entry = &cache->entries[index];
+        entry->key = value_copy(key);
+        entry->value = value_copy(&value);
+        entry->hash = hash;
+        entry->bytes = bytes;
+        segment_push(cache, index, cache->policy == CACHE_TINYLFU ? CACHE_WINDOW : CACHE_PROBATION);
+        cache->size++;
+        cache->bytes += bytes;
+    }
+    gc_write_barrier(cache, key);
+    gc_write_barrier(cache, &value);
+    enforce_limits(cache);
+    return cache->entries[index].key.type != VALUE_NULL;
+}
+
+int toncache_remove(TonCache* cache, const Value* key) {
+    uint64_t hash;
+    if (!tonmap_hash_key(key, cache->seed, &hash)) return 0;
+    int32_t index = find_entry(cache, key, hash, NULL);
+    if (index < 0) return 0;
+    remove_entry(cache, index);
+    return 1;
+}
+
+void toncache_clear(TonCache* cache) {
+    for (int i = 0; i < cache->entries_used; i++) {
+        if (cache->entries[i].key.type == VALUE_NULL) continue;
+        value_release(&cache->entries[i].key);
+        value_release(&cache->entries[i].value);
+    }
+    memset(cache->slots, 0xFF, sizeof(int32_t) * (cache->slot_mask + 1));
+    for (int i = 0; i < CACHE_SEGMENTS; i++) {
+        cache->segments[i].head = cache->segments[i].tail = -1;
+        cache->segments[i].count = 0;
+    }
+    if (cache->sketch) memset(cache->sketch, 0, sizeof(uint64_t) * (cache->sketch_mask + 1));
+    cache->sketch_additions = 0;
+    cache->entries_used = 0;
+    cache->free_list = -1;
+    cache->size = 0;
+    cache->bytes = 0;
+}
+
+int toncache_size(const TonCache* cache) {
+    return cache ? cache->size : 0;
+}
@@ -0,0 +1,97 @@
+#ifndef TON_CACHE_H
+#define TON_CACHE_H
+
+#include "value.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// TonCache - Bounded key/value cache. Holds at most `capacity` entries and,
+// when a byte budget is set, at most that many estimated bytes; inserting
+// past either limit evicts entries chosen by the policy.
+//
+// CACHE_LRU evicts the least recently used entry. CACHE_TINYLFU is
+// W-TinyLFU: new entries enter a small LRU window, and an entry leaving the
+// window only displaces the main space's LRU victim if a frequency sketch
+// says it has been asked for more often. The main space is a segmented LRU
+// (probation and protected), so one burst of new keys cannot flush the
+// entries that are used all the time.
+//
+// Keys are hashed like TonMap keys, with a per-cache seed. Entries live in
+// one array linked into recency lists by index, with an open-addressing
+// index over it, so get, put and remove are O(1).
+
+#define CACHE_LRU 0
+#define CACHE_TINYLFU 1
+
+#define CACHE_WINDOW 0                 // Segments; CACHE_LRU keeps every entry in CACHE_PROBATION
+#define CACHE_PROBATION 1
+#define CACHE_PROTECTED 2
+#define CACHE_SEGMENTS 3
+
+#define CACHE_WINDOW_PERCENT 1         // Share of the capacity given to the TinyLFU window
+#define CACHE_PROTECTED_PERCENT 80     // Share of the main space that may be protected
+#define CACHE_SAMPLE_FACTOR 10         // Sketch counters halve after capacity * this many increments
+
+typedef struct {
+    Value key;                    // VALUE_NULL while the entry is free
+    Value value;
+    uint64_t hash;
+    size_t bytes;                 // Estimated size, charged against the byte budget
+    int32_t prev;                 // Neighbours in the segment list (toward the MRU end)
+    int32_t next;                 // Toward the LRU end; also links free entries
+    uint8_t segment;
+} TonCacheEntry;
+
+typedef struct {
+    int32_t head;                 // Most recently used, -1 if empty
+    int32_t tail;                 // Least recently used
+    int count;
+} TonCacheSegment;
+
+typedef struct {
+    int policy;
+    int capacity;                 // Entry limit
+    size_t max_bytes;             // Byte budget, 0 for none
+    size_t bytes;                 // Estimated bytes of the live entries
+    int size;
+
+    TonCacheEntry* entries;
+    int entry_capacity;           // Grows by doubling up to `capacity`
+    int entries_used;             // Entries ever handed out; free ones are reused first
+    int32_t free_list;
+
+    int32_t* slots;               // Entry index per slot, -1 if empty; linear probing
+    uint32_t slot_mask;
+    uint64_t seed;
+
+    TonCacheSegment segments[CACHE_SEGMENTS];
+    int window_max;               // CACHE_TINYLFU segment limits
+    int protected_max;
+
+    uint64_t* sketch;             // CACHE_TINYLFU: 4-bit count-min counters, 16 per word
+    uint32_t sketch_mask;
+    uint32_t sketch_additions;
+    uint32_t sketch_sample;
+
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+} TonCache;
+
+// NULL if out of memory or capacity < 1
+TonCache* toncache_create(int capacity, int policy, size_t max_bytes);
+void toncache_destroy(TonCache* cache);
+// Value for `key`, marking it recently used; counts a hit or a miss
+int toncache_get(TonCache* cache, const Value* key, Value* out);
+// Lookup that changes neither recency nor the counters
+int toncache_peek(const TonCache* cache, const Value* key, Value* out);
+// Returns 1 if the key is cached afterwards, 0 if it was not admitted (it alone
+// exceeds the byte budget), -1 if out of memory or the key is not hashable
+int toncache_put(TonCache* cache, const Value* key, Value value);
+int toncache_remove(TonCache* cache, const Value* key);
+void toncache_clear(TonCache* cache);
+int toncache_size(const TonCache* cache);
+// Estimated bytes an entry for this key and value is charged
+size_t toncache_entry_bytes(const Value* key, const Value* value);
+
+#endif // TON_CACHE_H
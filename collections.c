@@ -1,55 +1,78 @@
 #include "collections.h"
+#include "gc.h"
+#include "hash.h"
+#include "memory.h"
+#include "struct.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
 
-#define TONMAP_BUCKET_COUNT 16
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TONMAP_USE_SSE2 1
+#else
+#define TONMAP_USE_SSE2 0
+#endif
 
 // TonList implementation
 TonList* tonlist_create() {
-    TonList* list = malloc(sizeof(TonList));
+    TonList* list = gc_alloc(GC_KIND_LIST, sizeof(TonList));
     if (!list) return NULL;
     
-    list->data = malloc(sizeof(Value) * TONLIST_INITIAL_CAPACITY);
-    if (!list->data) {
-        free(list);
+    list->data.raw = ton_malloc(sizeof(Value) * TONLIST_INITIAL_CAPACITY);
+    if (!list->data.raw) {
+        gc_free(list);
         return NULL;
     }
     
+    list->kind = ELEMENTS_BOXED;
     list->size = 0;
     list->capacity = TONLIST_INITIAL_CAPACITY;
+    list->locked = 0;
     return list;
 }
 
 void tonlist_destroy(TonList* list) {
     if (!list) return;
-    free(list->data);
-    free(list);
+    if (list->kind == ELEMENTS_BOXED) {
+        for (int i = 0; i < list->size; i++) {
+            value_release(&list->data.boxed[i]);
+        }
+    }
+    ton_free(list->data.raw);
+    gc_free(list);
 }
 
 int tonlist_push(TonList* list, Value value) {
-    if (!list) return 0;
+    if (!list || list->locked) return 0;
+    if (!elements_accept(&list->kind, &list->data, (size_t)list->size, (size_t)list->capacity, &value)) return 0;
     
     if (list->size >= list->capacity) {
         int new_capacity = list->capacity * 2;
-        Value* new_data = realloc(list->data, sizeof(Value) * new_capacity);
+        void* new_data = ton_realloc(list->data.raw, element_size(list->kind) * new_capacity);
         if (!new_data) return 0;
         
-        list->data = new_data;
+        list->data.raw = new_data;
         list->capacity = new_capacity;
     }
     
-    list->data[list->size++] = value;
+    if (list->kind == ELEMENTS_BOXED) {
+        list->data.boxed[list->size++] = value_copy(&value);
+        gc_write_barrier(list, &value);
+    } else {
+        elements_store(list->kind, list->data, (size_t)list->size++, &value);
+    }
     return 1;
 }
 
 Value tonlist_pop(TonList* list) {
-    if (!list || list->size == 0) {
+    if (!list || list->size == 0 || list->locked) {
         return create_value_null();
     }
     
-    return list->data[--list->size];
+    return elements_load(list->kind, list->data, (size_t)--list->size);
 }
 
 Value tonlist_get(TonList* list, int index) {
@@ -57,15 +80,22 @@ Value tonlist_get(TonList* list, int index) {
         return create_value_null();
     }
     
-    return list->data[index];
+    return elements_load(list->kind, list->data, (size_t)index);
 }
 
 int tonlist_set(TonList* list, int index, Value value) {
-    if (!list || index < 0 || index >= list->size) {
+    if (!list || list->locked || index < 0 || index >= list->size) {
         return 0;
     }
+    if (!elements_accept(&list->kind, &list->data, (size_t)list->size, (size_t)list->capacity, &value)) return 0;
     
-    list->data[index] = value;
+    if (list->kind != ELEMENTS_BOXED) {
+        elements_store(list->kind, list->data, (size_t)index, &value);
+        return 1;
+    }
+    value_release(&list->data.boxed[index]);
+    list->data.boxed[index] = value_copy(&value);
+    gc_write_barrier(list, &value);
     return 1;
 }
 
@@ -73,151 +103,1176 @@ int tonlist_size(TonList* list) {
     return list ? list->size : 0;
 }
 
-// TonMap implementation (simple hash table)
-static unsigned int hash_string(const char* str) {
-    unsigned int hash = 5381;
-    int c;
-    while ((c = *str++)) {
-        hash = ((hash << 5) + hash) + c;
+// TonDeque implementation: a ring buffer whose capacity is a power of two.
+// Growing unrolls the ring so the front lands back at slot 0.
+TonDeque* tondeque_create() {
+    TonDeque* deque = gc_alloc(GC_KIND_DEQUE, sizeof(TonDeque));
+    if (!deque) return NULL;
+
+    deque->data = (Value*)ton_malloc(sizeof(Value) * TONDEQUE_INITIAL_CAPACITY);
+    if (!deque->data) {
+        gc_free(deque);
+        return NULL;
+    }
+
+    deque->head = 0;
+    deque->size = 0;
+    deque->capacity = TONDEQUE_INITIAL_CAPACITY;
+    return deque;
+}
+
+void tondeque_destroy(TonDeque* deque) {
+    if (!deque) return;
+    for (int i = 0; i < deque->size; i++) {
+        value_release(&deque->data[TONDEQUE_SLOT(deque, i)]);
+    }
+    ton_free(deque->data);
+    gc_free(deque);
+}
+
+static int tondeque_grow(TonDeque* deque) {
+    int new_capacity = deque->capacity * 2;
+    Value* new_data = (Value*)ton_malloc(sizeof(Value) * new_capacity);
+    if (!new_data) return 0;
+
+    // Copy the part from head to the end of the buffer, then the wrapped part
+    int first = deque->capacity - deque->head;
+    if (first > deque->size) first = deque->size;
+    memcpy(new_data, deque->data + deque->head, sizeof(Value) * first);
+    memcpy(new_data + first, deque->data, sizeof(Value) * (deque->size - first));
+
+    ton_free(deque->data);
+    deque->data = new_data;
+    deque->head = 0;
+    deque->capacity = new_capacity;
+    return 1;
+}
+
+int tondeque_push_back(TonDeque* deque, Value value) {
+    if (!deque) return 0;
+    if (deque->size == deque->capacity && !tondeque_grow(deque)) return 0;
+
+    deque->data[TONDEQUE_SLOT(deque, deque->size)] = value_copy(&value);
+    deque->size++;
+    gc_write_barrier(deque, &value);
+    return 1;
+}
+
+int tondeque_push_front(TonDeque* deque, Value value) {
+    if (!deque) return 0;
+    if (deque->size == deque->capacity && !tondeque_grow(deque)) return 0;
+
+    deque->head = (deque->head - 1) & (deque->capacity - 1);
+    deque->data[deque->head] = value_copy(&value);
+    deque->size++;
+    gc_write_barrier(deque, &value);
+    return 1;
+}
+
+Value tondeque_pop_back(TonDeque* deque) {
+    if (!deque || deque->size == 0) {
+        return create_value_null();
+    }
+
+    deque->size--;
+    return deque->data[TONDEQUE_SLOT(deque, deque->size)];
+}
+
+Value tondeque_pop_front(TonDeque* deque) {
+    if (!deque || deque->size == 0) {
+        return create_value_null();
+    }
+
+    Value value = deque->data[deque->head];
+    deque->head = (deque->head + 1) & (deque->capacity - 1);
+    deque->size--;
+    return value;
+}
+
+Value tondeque_get(TonDeque* deque, int index) {
+    if (!deque || index < 0 || index >= deque->size) {
+        return create_value_null();
+    }
+
+    return deque->data[TONDEQUE_SLOT(deque, index)];
+}
+
+int tondeque_size(TonDeque* deque) {
+    return deque ? deque->size : 0;
+}
+
+// TonPQ implementation: a d-ary min-heap. A wider node makes the tree
+// shallower, so pops (the expensive side of a scheduler) compare against
+// fewer levels. Sifting only swaps elements, so every element stays in the
+// traced heap array while a user comparator runs.
+TonPQ* tonpq_create(Value less) {
+    TonPQ* pq = gc_alloc(GC_KIND_PQ, sizeof(TonPQ));
+    if (!pq) return NULL;
+
+    pq->data = (Value*)ton_malloc(sizeof(Value) * TONPQ_INITIAL_CAPACITY);
+    if (!pq->data) {
+        gc_free(pq);
+        return NULL;
+    }
+
+    pq->size = 0;
+    pq->capacity = TONPQ_INITIAL_CAPACITY;
+    pq->less = less;
+    pq->locked = 0;
+    gc_write_barrier(pq, &less);
+    return pq;
+}
+
+void tonpq_destroy(TonPQ* pq) {
+    if (!pq) return;
+    for (int i = 0; i < pq->size; i++) {
+        value_release(&pq->data[i]);
+    }
+    ton_free(pq->data);
+    gc_free(pq);
+}
+
+static inline void tonpq_swap(TonPQ* pq, int a, int b) {
+    Value t = pq->data[a];
+    pq->data[a] = pq->data[b];
+    pq->data[b] = t;
+}
+
+static void tonpq_sift_up(TonPQ* pq, int i, SortLessFn less, void* ctx) {
+    while (i > 0) {
+        int parent = (i - 1) / TONPQ_ARITY;
+        if (!less(&pq->data[i], &pq->data[parent], ctx)) return;
+        tonpq_swap(pq, i, parent);
+        i = parent;
+    }
+}
+
+// Restore heap order below i within the first n elements
+static void tonpq_sift_down(TonPQ* pq, int i, int n, SortLessFn less, void* ctx) {
+    for (;;) {
+        int first = TONPQ_ARITY * i + 1;
+        if (first >= n) return;
+        int last = first + TONPQ_ARITY;
+        if (last > n) last = n;
+
+        int best = first;
+        for (int c = first + 1; c < last; c++) {
+            if (less(&pq->data[c], &pq->data[best], ctx)) best = c;
+        }
+        if (!less(&pq->data[best], &pq->data[i], ctx)) return;
+        tonpq_swap(pq, i, best);
+        i = best;
+    }
+}
+
+int tonpq_push(TonPQ* pq, Value value, SortLessFn less, void* ctx) {
+    if (!pq || pq->locked) return 0;
+
+    if (pq->size >= pq->capacity) {
+        int new_capacity = pq->capacity * 2;
+        Value* new_data = (Value*)ton_realloc(pq->data, sizeof(Value) * new_capacity);
+        if (!new_data) return 0;
+
+        pq->data = new_data;
+        pq->capacity = new_capacity;
+    }
+
+    pq->data[pq->size] = value_copy(&value);
+    gc_write_barrier(pq, &value);
+    pq->locked = 1;
+    tonpq_sift_up(pq, pq->size++, less, ctx);
+    pq->locked = 0;
+    return 1;
+}
+
+Value tonpq_pop(TonPQ* pq, SortLessFn less, void* ctx) {
+    if (!pq || pq->size == 0 || pq->locked) {
+        return create_value_null();
+    }
+
+    // The least element moves to the end and stays counted (and traced)
+    // until the rest has been sifted back into order
+    int last = pq->size - 1;
+    tonpq_swap(pq, 0, last);
+    pq->locked = 1;
+    tonpq_sift_down(pq, 0, last, less, ctx);
+    pq->locked = 0;
+    pq->size = last;
+    return pq->data[last];
+}
+
+Value tonpq_peek(TonPQ* pq) {
+    if (!pq || pq->size == 0) {
+        return create_value_null();
+    }
+
+    return pq->data[0];
+}
+
+int tonpq_size(TonPQ* pq) {
+    return pq ? pq->size : 0;
+}
+
+// TonMap implementation: a compact, insertion-ordered dict. Entries are
+// appended to a dense array in insertion order; a Swiss-table index maps
+// hashes to entry positions. Every index slot has a control byte that is
+// either EMPTY, DELETED (tombstone) or the low 7 bits of the key's hash.
+// Lookups scan one 16-byte group of control bytes at a time (a single SSE2
+// compare when available) and only compare keys whose 7-bit tag matched.
+// Groups are probed in triangular order, which visits every group because
+// the group count is a power of two. Iteration walks the entries array.
+//
+// Keys are Values (int, float, bool, char, string or a struct instance whose
+// type was marked hashable). Each entry caches its key's hash, so rehashing
+// and tag mismatches never touch the key itself.
+//
+// Hashes are keyed with a per-table seed drawn from the random process seed,
+// so colliding keys cannot be precomputed, and copying one map into another
+// in slot order does not cluster. An insert that still has to probe more
+// than TONMAP_MAX_PROBE_GROUPS groups rehashes the table under a new seed.
+
+#define CTRL_EMPTY   0x80
+#define CTRL_DELETED 0xFE
+#define CTRL_IS_FULL(c) (((c) & 0x80) == 0)
+
+/**
+ * Hash a map key
+ * @param key Key to hash
+ * @param seed Table seed
+ * @param out Receives the hash
+ * @return 1 if the key is hashable, 0 otherwise
+ */
+int tonmap_hash_key(const Value* key, uint64_t seed, uint64_t* out) {
+    seed ^= (uint64_t)key->type * 0x9E3779B97F4A7C15ULL;
+    switch (key->type) {
+        case VALUE_INT:
+            *out = ton_hash_u64((uint64_t)(int64_t)key->data.int_val, seed);
+            return 1;
+        case VALUE_BOOL:
+            *out = ton_hash_u64((uint64_t)(key->data.bool_val != 0), seed);
+            return 1;
+        case VALUE_CHAR:
+            *out = ton_hash_u64((uint64_t)(unsigned char)key->data.char_val, seed);
+            return 1;
+        case VALUE_FLOAT: {
+            double d = key->data.float_val;
+            // NaN never equals itself, so every NaN key would be a new entry
+            // on one probe chain
+            if (d != d) return 0;
+            if (d == 0.0) d = 0.0; // -0.0 and 0.0 compare equal, so they must hash alike
+            uint64_t bits;
+            memcpy(&bits, &d, sizeof(bits));
+            *out = ton_hash_u64(bits, seed);
+            return 1;
+        }
+        case VALUE_STRING:
+            if (!key->data.string_val) return 0;
+            *out = ton_hash_bytes(key->data.string_val, strlen(key->data.string_val), seed);
+            return 1;
+        case VALUE_STRUCT: {
+            const TonStructInstance* si = (const TonStructInstance*)key->data.struct_val;
+            if (!si || !si->type || !si->type->hashable) return 0;
+            uint64_t hash = ton_hash_u64((uint64_t)(uintptr_t)si->type, seed);
+            for (int i = 0; i < si->type->num_fields; i++) {
+                if (!tonmap_hash_key(&si->field_values[i], hash, &hash)) return 0;
+            }
+            *out = hash;
+            return 1;
+        }
+        default:
+            return 0;
+    }
+}
+
+int tonmap_key_hashable(const Value* key) {
+    uint64_t hash;
+    return tonmap_hash_key(key, 0, &hash);
+}
+
+/**
+ * Compare two map keys (same type and same contents)
+ * @return 1 if equal
+ */
+int tonmap_key_equal(const Value* a, const Value* b) {
+    if (a->type != b->type) return 0;
+    switch (a->type) {
+        case VALUE_INT:    return a->data.int_val == b->data.int_val;
+        case VALUE_BOOL:   return (a->data.bool_val != 0) == (b->data.bool_val != 0);
+        case VALUE_CHAR:   return a->data.char_val == b->data.char_val;
+        case VALUE_FLOAT:  return a->data.float_val == b->data.float_val;
+        case VALUE_STRING: return strcmp(a->data.string_val, b->data.string_val) == 0;
+        case VALUE_STRUCT: {
+            const TonStructInstance* sa = (const TonStructInstance*)a->data.struct_val;
+            const TonStructInstance* sb = (const TonStructInstance*)b->data.struct_val;
+            if (sa == sb) return 1;
+            if (!sa || !sb || sa->type != sb->type) return 0;
+            for (int i = 0; i < sa->type->num_fields; i++) {
+                if (!tonmap_key_equal(&sa->field_values[i], &sb->field_values[i])) return 0;
+            }
+            return 1;
+        }
+        default:
+            return 0;
+    }
+}
+
+// Borrowed string key for the char* convenience API (no allocation)
+static Value string_key(const char* key) {
+    Value v;
+    v.type = VALUE_STRING;
+    v.ref_count = 1;
+    v.data.string_val = (char*)key;
+    return v;
+}
+
+static inline int lowest_bit(uint32_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(mask);
+#else
+    int i = 0;
+    while (!(mask & 1)) { mask >>= 1; i++; }
+    return i;
+#endif
+}
+
+// Bitmask of the positions in a group whose control byte equals `byte`
+static inline uint32_t group_match(const unsigned char* group, unsigned char byte) {
+#if TONMAP_USE_SSE2
+    __m128i ctrl = _mm_loadu_si128((const __m128i*)group);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)byte)));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < TONMAP_GROUP_WIDTH; i++) {
+        if (group[i] == byte) mask |= 1u << i;
+    }
+    return mask;
+#endif
+}
+
+// Bitmask of the EMPTY or DELETED positions in a group (both have the top bit set)
+static inline uint32_t group_match_free(const unsigned char* group) {
+#if TONMAP_USE_SSE2
+    return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)group));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < TONMAP_GROUP_WIDTH; i++) {
+        if (!CTRL_IS_FULL(group[i])) mask |= 1u << i;
+    }
+    return mask;
+#endif
+}
+
+static inline size_t probe_start(const TonMap* map, uint64_t hash) {
+    return (size_t)(hash >> 7) & (size_t)(map->capacity - 1) & ~(size_t)(TONMAP_GROUP_WIDTH - 1);
+}
+
+// Index slot pointing at `key`, or -1
+static int tonmap_find(const TonMap* map, const Value* key, uint64_t hash) {
+    size_t mask = (size_t)map->capacity - 1;
+    size_t pos = probe_start(map, hash);
+    unsigned char tag = (unsigned char)(hash & 0x7F);
+
+    for (size_t stride = TONMAP_GROUP_WIDTH; stride <= (size_t)map->capacity; stride += TONMAP_GROUP_WIDTH) {
+        const unsigned char* group = map->ctrl + pos;
+        uint32_t candidates = group_match(group, tag);
+        while (candidates) {
+            size_t slot = pos + (size_t)lowest_bit(candidates);
+            const TonMapEntry* entry = &map->entries[map->index[slot]];
+            if (entry->hash == hash && tonmap_key_equal(&entry->key, key)) return (int)slot;
+            candidates &= candidates - 1;
+        }
+        // An EMPTY byte means the key was never pushed past this group
+        if (group_match(group, CTRL_EMPTY)) return -1;
+        pos = (pos + stride) & mask;
+    }
+    return -1;
+}
+
+// First EMPTY or DELETED index slot on the probe sequence of `hash`;
+// `groups` (if given) receives the number of groups probed
+static size_t tonmap_find_free(const TonMap* map, uint64_t hash, int* groups) {
+    size_t mask = (size_t)map->capacity - 1;
+    size_t pos = probe_start(map, hash);
+    for (size_t stride = TONMAP_GROUP_WIDTH; ; stride += TONMAP_GROUP_WIDTH) {
+        uint32_t free_slots = group_match_free(map->ctrl + pos);
+        if (free_slots) {
+            if (groups) *groups = (int)(stride / TONMAP_GROUP_WIDTH);
+            return pos + (size_t)lowest_bit(free_slots);
+        }
+        pos = (pos + stride) & mask;
+    }
+}
+
+static int tonmap_alloc_table(TonMap* map, int capacity) {
+    unsigned char* ctrl = ton_malloc((size_t)capacity);
+    int32_t* index = ton_malloc(sizeof(int32_t) * (size_t)capacity);
+    TonMapEntry* entries = ton_malloc(sizeof(TonMapEntry) * (size_t)TONMAP_ENTRIES_MAX(capacity));
+    if (!ctrl || !index || !entries) {
+        ton_free(ctrl);
+        ton_free(index);
+        ton_free(entries);
+        return 0;
+    }
+    memset(ctrl, CTRL_EMPTY, (size_t)capacity);
+    map->ctrl = ctrl;
+    map->index = index;
+    map->entries = entries;
+    map->capacity = capacity;
+    map->entries_used = 0;
+    return 1;
+}
+
+// Rebuild the table at `capacity`: live entries are compacted to the front
+// of a new entries array in their original order and the index is rebuilt
+// without tombstones. Entries are moved, so keys and values keep their
+// ownership. Cached hashes are reused unless the table seed changed (`rekey`).
+static int tonmap_rebuild(TonMap* map, int capacity, int rekey) {
+    unsigned char* old_ctrl = map->ctrl;
+    int32_t* old_index = map->index;
+    TonMapEntry* old_entries = map->entries;
+    int old_capacity = map->capacity;
+    int old_used = map->entries_used;
+
+    if (!tonmap_alloc_table(map, capacity)) {
+        map->ctrl = old_ctrl;
+        map->index = old_index;
+        map->entries = old_entries;
+        map->capacity = old_capacity;
+        map->entries_used = old_used;
+        return 0;
+    }
+
+    for (int i = 0; i < old_used; i++) {
+        TonMapEntry* entry = &old_entries[i];
+        if (entry->key.type == VALUE_NULL) continue;
+        if (rekey) tonmap_hash_key(&entry->key, map->seed, &entry->hash);
+        size_t slot = tonmap_find_free(map, entry->hash, NULL);
+        map->ctrl[slot] = (unsigned char)(entry->hash & 0x7F);
+        map->index[slot] = map->entries_used;
+        map->entries[map->entries_used++] = *entry;
     }
-    return hash;
+    map->rebuilds++;
+
+    ton_free(old_ctrl);
+    ton_free(old_index);
+    ton_free(old_entries);
+    return 1;
 }
 
 TonMap* tonmap_create() {
-    TonMap* map = malloc(sizeof(TonMap));
+    TonMap* map = gc_alloc(GC_KIND_MAP, sizeof(TonMap));
     if (!map) return NULL;
     
-    map->buckets = calloc(TONMAP_BUCKET_COUNT, sizeof(TonMapEntry*));
-    if (!map->buckets) {
-        free(map);
+    if (!tonmap_alloc_table(map, TONMAP_INITIAL_CAPACITY)) {
+        gc_free(map);
         return NULL;
     }
-    
     map->size = 0;
+    map->reseeds = 0;
+    map->rebuilds = 0;
+    map->removals = 0;
+    map->seed = ton_hash_next_seed();
     return map;
 }
 
 void tonmap_destroy(TonMap* map) {
     if (!map) return;
     
-    for (int i = 0; i < TONMAP_BUCKET_COUNT; i++) {
-        TonMapEntry* entry = map->buckets[i];
-        while (entry) {
-            TonMapEntry* next = entry->next;
-            free(entry->key);
-            free(entry);
-            entry = next;
-        }
+    for (int i = 0; i < map->entries_used; i++) {
+        if (!TONMAP_ENTRY_LIVE(map, i)) continue;
+        value_release(&map->entries[i].key);
+        value_release(&map->entries[i].value);
     }
     
-    free(map->buckets);
-    free(map);
+    ton_free(map->ctrl);
+    ton_free(map->index);
+    ton_free(map->entries);
+    gc_free(map);
 }
 
-int tonmap_set(TonMap* map, const char* key, Value value) {
-    if (!map || !key) return 0;
+/**
+ * Insert or replace an entry. New keys are appended after all existing ones;
+ * replacing a value keeps the key's position.
+ * @param map Map to modify
+ * @param key Key (copied into the map)
+ * @param value Value (copied into the map)
+ * @return 1 on success, 0 if the key is not hashable or allocation failed
+ */
+int tonmap_set_value(TonMap* map, const Value* key, Value value) {
+    uint64_t hash;
+    if (!map || !key || !tonmap_hash_key(key, map->seed, &hash)) return 0;
     
-    unsigned int bucket = hash_string(key) % TONMAP_BUCKET_COUNT;
-    TonMapEntry* entry = map->buckets[bucket];
-    
-    // Check if key already exists
-    while (entry) {
-        if (strcmp(entry->key, key) == 0) {
-            entry->value = value;
-            return 1;
-        }
-        entry = entry->next;
+    int found = tonmap_find(map, key, hash);
+    if (found >= 0) {
+        TonMapEntry* entry = &map->entries[map->index[found]];
+        value_release(&entry->value);
+        entry->value = value_copy(&value);
+        gc_write_barrier(map, &value);
+        return 1;
     }
     
-    // Create new entry
-    TonMapEntry* new_entry = malloc(sizeof(TonMapEntry));
-    if (!new_entry) return 0;
-    
-    new_entry->key = strdup(key);
-    if (!new_entry->key) {
-        free(new_entry);
-        return 0;
+    // The entries array holds 7/8 of the index size. Every index tombstone
+    // has a matching hole in the entries, so a full entries array also bounds
+    // the index load at 7/8.
+    if (map->entries_used == TONMAP_ENTRIES_MAX(map->capacity)) {
+        // Mostly holes: compact in place instead of growing
+        int capacity = (map->size + 1) * 2 <= TONMAP_ENTRIES_MAX(map->capacity) ? map->capacity : map->capacity * 2;
+        if (!tonmap_rebuild(map, capacity, 0)) return 0;
     }
     
-    new_entry->value = value;
-    new_entry->next = map->buckets[bucket];
-    map->buckets[bucket] = new_entry;
+    Value key_copy = value_copy(key);
+    if (key_copy.type == VALUE_STRING && !key_copy.data.string_val) return 0;
+    
+    int groups;
+    size_t slot = tonmap_find_free(map, hash, &groups);
+    int pos = map->entries_used++;
+    map->ctrl[slot] = (unsigned char)(hash & 0x7F);
+    map->index[slot] = pos;
+    map->entries[pos].key = key_copy;
+    map->entries[pos].value = value_copy(&value);
+    map->entries[pos].hash = hash;
     map->size++;
+    gc_write_barrier(map, key);
+    gc_write_barrier(map, &value);
+    
+    // At 7/8 load a well-spread insert almost never probes this far; the
+    // keys collide under this seed, so draw another one
+    if (groups > TONMAP_MAX_PROBE_GROUPS && map->reseeds < TONMAP_MAX_RESEEDS) {
+        // The old table stays in place if the rebuild cannot allocate; it was
+        // hashed under the old seed, so that seed must come back with it
+        uint64_t old_seed = map->seed;
+        map->reseeds++;
+        map->seed = ton_hash_next_seed();
+        if (!tonmap_rebuild(map, map->capacity, 1)) {
+            map->seed = old_seed;
+            map->reseeds--;
+        }
+    }
     
     return 1;
 }
 
-Value tonmap_get(TonMap* map, const char* key) {
-    if (!map || !key) return create_value_null();
+Value tonmap_get_value(TonMap* map, const Value* key) {
+    uint64_t hash;
+    if (!map || !key || !tonmap_hash_key(key, map->seed, &hash)) return create_value_null();
     
-    unsigned int bucket = hash_string(key) % TONMAP_BUCKET_COUNT;
-    TonMapEntry* entry = map->buckets[bucket];
+    int slot = tonmap_find(map, key, hash);
+    return slot >= 0 ? map->entries[map->index[slot]].value : create_value_null();
+}
+
+int tonmap_has_value(TonMap* map, const Value* key) {
+    uint64_t hash;
+    if (!map || !key || !tonmap_hash_key(key, map->seed, &hash)) return 0;
+    return tonmap_find(map, key, hash) >= 0;
+}
+
+int tonmap_remove_value(TonMap* map, const Value* key) {
+    uint64_t hash;
+    if (!map || !key || !tonmap_hash_key(key, map->seed, &hash)) return 0;
     
-    while (entry) {
-        if (strcmp(entry->key, key) == 0) {
-            return entry->value;
-        }
-        entry = entry->next;
-    }
+    int slot = tonmap_find(map, key, hash);
+    if (slot < 0) return 0;
+    
+    // Leave a hole (null key) so later entries keep their order; the next
+    // rebuild compacts it away
+    TonMapEntry* entry = &map->entries[map->index[slot]];
+    value_release(&entry->key);
+    value_release(&entry->value);
+    entry->key = create_value_null();
+    entry->value = create_value_null();
     
-    return create_value_null();
+    // If the group still has an EMPTY byte no probe ever continued past it,
+    // so the slot can become EMPTY again; otherwise leave a tombstone.
+    const unsigned char* group = map->ctrl + ((size_t)slot & ~(size_t)(TONMAP_GROUP_WIDTH - 1));
+    map->ctrl[slot] = group_match(group, CTRL_EMPTY) ? CTRL_EMPTY : CTRL_DELETED;
+    map->size--;
+    map->removals++;
+    return 1;
+}
+
+/**
+ * Find the next live entry in insertion order
+ * @param map Map to scan
+ * @param pos Entry position to start from (0 for the first entry)
+ * @return Position of the next live entry at or after `pos`, or -1
+ */
+int tonmap_next(const TonMap* map, int pos) {
+    if (!map || pos < 0) return -1;
+    for (; pos < map->entries_used; pos++) {
+        if (TONMAP_ENTRY_LIVE(map, pos)) return pos;
+    }
+    return -1;
+}
+
+int tonmap_set(TonMap* map, const char* key, Value value) {
+    if (!key) return 0;
+    Value k = string_key(key);
+    return tonmap_set_value(map, &k, value);
+}
+
+Value tonmap_get(TonMap* map, const char* key) {
+    if (!key) return create_value_null();
+    Value k = string_key(key);
+    return tonmap_get_value(map, &k);
 }
 
 int tonmap_has(TonMap* map, const char* key) {
-    if (!map || !key) return 0;
-    
-    unsigned int bucket = hash_string(key) % TONMAP_BUCKET_COUNT;
-    TonMapEntry* entry = map->buckets[bucket];
-    
-    while (entry) {
-        if (strcmp(entry->key, key) == 0) {
-            return 1;
+    if (!key) return 0;
+    Value k = string_key(key);
+    return tonmap_has_value(map, &k);
+}
+
+int tonmap_remove(TonMap* map, const char* key) {
+    if (!key) return 0;
+    Value k = string_key(key);
+    return tonmap_remove_value(map, &k);
+}
+
+int tonmap_size(TonMap* map) {
+    return map ? map->size : 0;
+}
+
+// TonOMap implementation: a B+-tree with TONOMAP_NODE_KEYS keys per node.
+// Keys of a node sit in one array so a search touches few cache lines.
+// Separator keys in inner nodes are copies, independent of the leaves.
+// A leaf is freed as soon as it becomes empty; nodes are not merged when
+// they underflow, so depth only ever shrinks when a whole subtree empties.
+static int omap_compare(const TonOMap* map, TonOMapKey a, TonOMapKey b) {
+    if (map->key_type == VALUE_INT) return (a.int_key > b.int_key) - (a.int_key < b.int_key);
+    return strcmp(a.string_key, b.string_key);
+}
+
+// Key of an int or string Value; string keys are borrowed
+static TonOMapKey omap_key_of(const Value* key) {
+    TonOMapKey k;
+    if (key->type == VALUE_INT) k.int_key = key->data.int_val;
+    else k.string_key = key->data.string_val;
+    return k;
+}
+
+static int omap_copy_key(const TonOMap* map, TonOMapKey key, TonOMapKey* out) {
+    if (map->key_type != VALUE_STRING) {
+        *out = key;
+        return 1;
+    }
+    out->string_key = ton_strdup(key.string_key);
+    return out->string_key != NULL;
+}
+
+static void omap_free_key(const TonOMap* map, TonOMapKey key) {
+    if (map->key_type == VALUE_STRING) ton_free(key.string_key);
+}
+
+// First key position in the node that is not less than `key`
+static int omap_lower_index(const TonOMap* map, const TonOMapNode* node, TonOMapKey key) {
+    int lo = 0, hi = node->count;
+    if (map->key_type == VALUE_INT) {
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (node->keys[mid].int_key < key.int_key) lo = mid + 1;
+            else hi = mid;
         }
-        entry = entry->next;
+        return lo;
     }
-    
-    return 0;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (strcmp(node->keys[mid].string_key, key.string_key) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
 }
 
-int tonmap_remove(TonMap* map, const char* key) {
-    if (!map || !key) return 0;
-    
-    unsigned int bucket = hash_string(key) % TONMAP_BUCKET_COUNT;
-    TonMapEntry* entry = map->buckets[bucket];
-    TonMapEntry* prev = NULL;
-    
-    while (entry) {
-        if (strcmp(entry->key, key) == 0) {
-            if (prev) {
-                prev->next = entry->next;
-            } else {
-                map->buckets[bucket] = entry->next;
-            }
-            
-            free(entry->key);
-            free(entry);
-            map->size--;
-            return 1;
+// Child of an inner node whose range holds `key`: the number of separators <= key
+static int omap_child_index(const TonOMap* map, const TonOMapNode* node, TonOMapKey key) {
+    int lo = 0, hi = node->count;
+    if (map->key_type == VALUE_INT) {
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (node->keys[mid].int_key <= key.int_key) lo = mid + 1;
+            else hi = mid;
         }
-        prev = entry;
-        entry = entry->next;
+        return lo;
     }
-    
-    return 0;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (strcmp(node->keys[mid].string_key, key.string_key) <= 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
 }
 
-int tonmap_size(TonMap* map) {
+static TonOMapLeaf* omap_new_leaf(void) {
+    TonOMapLeaf* leaf = (TonOMapLeaf*)ton_malloc(sizeof(TonOMapLeaf));
+    if (!leaf) return NULL;
+    leaf->node.leaf = 1;
+    leaf->node.count = 0;
+    leaf->prev = NULL;
+    leaf->next = NULL;
+    return leaf;
+}
+
+static TonOMapInner* omap_new_inner(void) {
+    TonOMapInner* inner = (TonOMapInner*)ton_malloc(sizeof(TonOMapInner));
+    if (!inner) return NULL;
+    inner->node.leaf = 0;
+    inner->node.count = 0;
+    return inner;
+}
+
+// Free one node with its keys (and values, for a leaf) but not its children
+static void omap_free_node(const TonOMap* map, TonOMapNode* node) {
+    for (int i = 0; i < node->count; i++) omap_free_key(map, node->keys[i]);
+    if (node->leaf) {
+        TonOMapLeaf* leaf = (TonOMapLeaf*)node;
+        for (int i = 0; i < node->count; i++) value_release(&leaf->values[i]);
+    }
+    ton_free(node);
+}
+
+static void omap_free_tree(const TonOMap* map, TonOMapNode* node) {
+    if (!node->leaf) {
+        TonOMapInner* inner = (TonOMapInner*)node;
+        for (int i = 0; i <= node->count; i++) omap_free_tree(map, inner->children[i]);
+    }
+    omap_free_node(map, node);
+}
+
+static TonOMapLeaf* omap_find_leaf(const TonOMap* map, TonOMapKey key) {
+    TonOMapNode* node = map->root;
+    if (!node) return NULL;
+    while (!node->leaf) {
+        node = ((TonOMapInner*)node)->children[omap_child_index(map, node, key)];
+    }
+    return (TonOMapLeaf*)node;
+}
+
+TonOMap* tonomap_create() {
+    TonOMap* map = gc_alloc(GC_KIND_OMAP, sizeof(TonOMap));
+    if (!map) return NULL;
+
+    map->root = NULL;
+    map->first = NULL;
+    map->last = NULL;
+    map->size = 0;
+    map->key_type = VALUE_NULL;
+    map->version = 0;
+    return map;
+}
+
+void tonomap_destroy(TonOMap* map) {
+    if (!map) return;
+    if (map->root) omap_free_tree(map, map->root);
+    gc_free(map);
+}
+
+int tonomap_key_ok(const TonOMap* map, const Value* key) {
+    if (key->type != VALUE_INT && key->type != VALUE_STRING) return 0;
+    return map->key_type == VALUE_NULL || map->key_type == key->type;
+}
+
+// Upper half of a node that split while inserting: `separator` (owned) is
+// the least key under `right`
+typedef struct {
+    TonOMapNode* right;
+    TonOMapKey separator;
+} OMapSplit;
+
+static void omap_leaf_insert_at(TonOMap* map, TonOMapLeaf* leaf, int i, TonOMapKey key, const Value* value) {
+    int tail = leaf->node.count - i;
+    memmove(&leaf->node.keys[i + 1], &leaf->node.keys[i], sizeof(TonOMapKey) * tail);
+    memmove(&leaf->values[i + 1], &leaf->values[i], sizeof(Value) * tail);
+    leaf->node.keys[i] = key;
+    leaf->values[i] = value_copy(value);
+    leaf->node.count++;
+    gc_write_barrier(map, value);
+}
+
+static void omap_inner_insert_at(TonOMapInner* inner, int i, TonOMapKey separator, TonOMapNode* child) {
+    int tail = inner->node.count - i;
+    memmove(&inner->node.keys[i + 1], &inner->node.keys[i], sizeof(TonOMapKey) * tail);
+    memmove(&inner->children[i + 2], &inner->children[i + 1], sizeof(TonOMapNode*) * tail);
+    inner->node.keys[i] = separator;
+    inner->children[i + 1] = child;
+    inner->node.count++;
+}
+
+static int omap_insert_leaf(TonOMap* map, TonOMapLeaf* leaf, TonOMapKey key, const Value* value, OMapSplit* split) {
+    TonOMapNode* node = &leaf->node;
+    int i = omap_lower_index(map, node, key);
+    if (i < node->count && omap_compare(map, node->keys[i], key) == 0) {
+        value_release(&leaf->values[i]);
+        leaf->values[i] = value_copy(value);
+        gc_write_barrier(map, value);
+        return 0;
+    }
+
+    TonOMapKey owned;
+    if (!omap_copy_key(map, key, &owned)) return -1;
+    if (node->count < TONOMAP_NODE_KEYS) {
+        omap_leaf_insert_at(map, leaf, i, owned, value);
+        return 1;
+    }
+
+    // Split in half, except when appending past the greatest key: then the
+    // new key starts an empty right leaf, so ascending loads fill leaves
+    int start = (i == node->count && !leaf->next) ? node->count : node->count / 2;
+    int to_right = i > start || start == node->count;
+    TonOMapKey separator;
+    if (!omap_copy_key(map, (to_right && i == start) ? key : node->keys[start], &separator)) {
+        omap_free_key(map, owned);
+        return -1;
+    }
+    TonOMapLeaf* right = omap_new_leaf();
+    if (!right) {
+        omap_free_key(map, owned);
+        omap_free_key(map, separator);
+        return -1;
+    }
+
+    int moved = node->count - start;
+    memcpy(right->node.keys, &node->keys[start], sizeof(TonOMapKey) * moved);
+    memcpy(right->values, &leaf->values[start], sizeof(Value) * moved);
+    right->node.count = moved;
+    node->count = start;
+    if (to_right) omap_leaf_insert_at(map, right, i - start, owned, value);
+    else omap_leaf_insert_at(map, leaf, i, owned, value);
+
+    right->next = leaf->next;
+    right->prev = leaf;
+    if (right->next) right->next->prev = right;
+    else map->last = right;
+    leaf->next = right;
+
+    split->right = &right->node;
+    split->separator = separator;
+    return 1;
+}
+
+// Returns 1 if the key was added, 0 if an existing value was replaced, -1 if out of memory
+static int omap_insert(TonOMap* map, TonOMapNode* node, TonOMapKey key, const Value* value, OMapSplit* split) {
+    split->right = NULL;
+    if (node->leaf) return omap_insert_leaf(map, (TonOMapLeaf*)node, key, value, split);
+
+    // A full node splits if its child does; allocate the half now so that
+    // nothing can fail once the child has split
+    TonOMapInner* inner = (TonOMapInner*)node;
+    TonOMapInner* spare = NULL;
+    if (node->count == TONOMAP_NODE_KEYS) {
+        spare = omap_new_inner();
+        if (!spare) return -1;
+    }
+
+    int c = omap_child_index(map, node, key);
+    OMapSplit child;
+    int result = omap_insert(map, inner->children[c], key, value, &child);
+    if (!child.right) {
+        ton_free(spare);
+        return result;
+    }
+    if (!spare) {
+        omap_inner_insert_at(inner, c, child.separator, child.right);
+        return result;
+    }
+
+    // Lay out all TONOMAP_NODE_KEYS + 1 separators, then move the upper half
+    TonOMapKey keys[TONOMAP_NODE_KEYS + 1];
+    TonOMapNode* children[TONOMAP_NODE_KEYS + 2];
+    memcpy(keys, node->keys, sizeof(TonOMapKey) * c);
+    keys[c] = child.separator;
+    memcpy(&keys[c + 1], &node->keys[c], sizeof(TonOMapKey) * (node->count - c));
+    memcpy(children, inner->children, sizeof(TonOMapNode*) * (c + 1));
+    children[c + 1] = child.right;
+    memcpy(&children[c + 2], &inner->children[c + 1], sizeof(TonOMapNode*) * (node->count - c));
+
+    int total = TONOMAP_NODE_KEYS + 1;
+    int mid = total / 2;
+    node->count = mid;
+    memcpy(node->keys, keys, sizeof(TonOMapKey) * mid);
+    memcpy(inner->children, children, sizeof(TonOMapNode*) * (mid + 1));
+    spare->node.count = total - mid - 1;
+    memcpy(spare->node.keys, &keys[mid + 1], sizeof(TonOMapKey) * spare->node.count);
+    memcpy(spare->children, &children[mid + 1], sizeof(TonOMapNode*) * (spare->node.count + 1));
+
+    split->right = &spare->node;
+    split->separator = keys[mid];
+    return result;
+}
+
+int tonomap_set(TonOMap* map, const Value* key, Value value) {
+    if (!map || !tonomap_key_ok(map, key)) return 0;
+    if (map->key_type == VALUE_NULL) map->key_type = key->type;
+    TonOMapKey k = omap_key_of(key);
+
+    if (!map->root) {
+        TonOMapLeaf* leaf = omap_new_leaf();
+        TonOMapKey owned;
+        if (!leaf || !omap_copy_key(map, k, &owned)) {
+            ton_free(leaf);
+            return 0;
+        }
+        omap_leaf_insert_at(map, leaf, 0, owned, &value);
+        map->root = &leaf->node;
+        map->first = leaf;
+        map->last = leaf;
+        map->size = 1;
+        map->version++;
+        return 1;
+    }
+
+    TonOMapInner* new_root = NULL;
+    if (map->root->count == TONOMAP_NODE_KEYS) {
+        new_root = omap_new_inner();
+        if (!new_root) return 0;
+    }
+    OMapSplit split;
+    int result = omap_insert(map, map->root, k, &value, &split);
+    if (split.right) {
+        new_root->node.count = 1;
+        new_root->node.keys[0] = split.separator;
+        new_root->children[0] = map->root;
+        new_root->children[1] = split.right;
+        map->root = &new_root->node;
+    } else {
+        ton_free(new_root);
+    }
+    if (result < 0) return 0;
+    if (result > 0) {
+        map->size++;
+        map->version++;
+    }
+    return 1;
+}
+
+int tonomap_get(TonOMap* map, const Value* key, Value* out) {
+    if (!map || !map->root || !tonomap_key_ok(map, key)) return 0;
+    TonOMapKey k = omap_key_of(key);
+    TonOMapLeaf* leaf = omap_find_leaf(map, k);
+    int i = omap_lower_index(map, &leaf->node, k);
+    if (i == leaf->node.count || omap_compare(map, leaf->node.keys[i], k) != 0) return 0;
+    *out = leaf->values[i];
+    return 1;
+}
+
+// Returns 1 if the key was found; sets *emptied if `node` was freed
+static int omap_remove(TonOMap* map, TonOMapNode* node, TonOMapKey key, int* emptied) {
+    *emptied = 0;
+    if (node->leaf) {
+        TonOMapLeaf* leaf = (TonOMapLeaf*)node;
+        int i = omap_lower_index(map, node, key);
+        if (i == node->count || omap_compare(map, node->keys[i], key) != 0) return 0;
+
+        omap_free_key(map, node->keys[i]);
+        value_release(&leaf->values[i]);
+        int tail = node->count - i - 1;
+        memmove(&node->keys[i], &node->keys[i + 1], sizeof(TonOMapKey) * tail);
+        memmove(&leaf->values[i], &leaf->values[i + 1], sizeof(Value) * tail);
+        if (--node->count > 0) return 1;
+
+        if (leaf->prev) leaf->prev->next = leaf->next;
+        else map->first = leaf->next;
+        if (leaf->next) leaf->next->prev = leaf->prev;
+        else map->last = leaf->prev;
+        ton_free(leaf);
+        *emptied = 1;
+        return 1;
+    }
+
+    TonOMapInner* inner = (TonOMapInner*)node;
+    int c = omap_child_index(map, node, key);
+    int child_emptied;
+    if (!omap_remove(map, inner->children[c], key, &child_emptied)) return 0;
+    if (!child_emptied) return 1;
+
+    if (node->count == 0) {
+        ton_free(inner);
+        *emptied = 1;
+        return 1;
+    }
+    // Drop the child and the separator on its left (the first child has none;
+    // its right neighbour inherits the open lower bound)
+    int k = c > 0 ? c - 1 : 0;
+    omap_free_key(map, node->keys[k]);
+    memmove(&node->keys[k], &node->keys[k + 1], sizeof(TonOMapKey) * (node->count - k - 1));
+    memmove(&inner->children[c], &inner->children[c + 1], sizeof(TonOMapNode*) * (node->count - c));
+    node->count--;
+    return 1;
+}
+
+int tonomap_remove(TonOMap* map, const Value* key) {
+    if (!map || !map->root || !tonomap_key_ok(map, key)) return 0;
+    int emptied;
+    if (!omap_remove(map, map->root, omap_key_of(key), &emptied)) return 0;
+    map->size--;
+    map->version++;
+    if (emptied) {
+        map->root = NULL;
+        return 1;
+    }
+    // Inner roots left with a single child hand the root down
+    while (!map->root->leaf && map->root->count == 0) {
+        TonOMapNode* child = ((TonOMapInner*)map->root)->children[0];
+        ton_free(map->root);
+        map->root = child;
+    }
+    return 1;
+}
+
+int tonomap_size(TonOMap* map) {
     return map ? map->size : 0;
 }
 
-// TonSet implementation (using TonMap internally)
+// Nodes per level when `count` items are spread evenly over nodes of up to `per_node`
+static int omap_node_count(int count, int per_node) {
+    return (count + per_node - 1) / per_node;
+}
+
+int tonomap_load_sorted(TonOMap* map, const Value* keys, const Value* values, int count) {
+    if (!map || map->root || count < 0) return -1;
+    if (count == 0) return 1;
+
+    ValueType key_type = keys[0].type;
+    if (key_type != VALUE_INT && key_type != VALUE_STRING) return -1;
+    map->key_type = key_type;
+    for (int i = 0; i < count; i++) {
+        if (keys[i].type != key_type) return -1;
+        if (i > 0 && omap_compare(map, omap_key_of(&keys[i - 1]), omap_key_of(&keys[i])) >= 0) return -1;
+    }
+
+    // Every node built so far, so a failed allocation can unwind them all
+    int leaves = omap_node_count(count, TONOMAP_NODE_KEYS);
+    int capacity = leaves * 2 + 1;
+    TonOMapNode** built = (TonOMapNode**)ton_malloc(sizeof(TonOMapNode*) * capacity);
+    TonOMapNode** level = (TonOMapNode**)ton_malloc(sizeof(TonOMapNode*) * leaves);
+    TonOMapKey* mins = (TonOMapKey*)ton_malloc(sizeof(TonOMapKey) * leaves);
+    int built_count = 0;
+    int ok = built && level && mins;
+
+    // Leaves, packed full and evenly
+    TonOMapLeaf* prev = NULL;
+    int next_key = 0;
+    for (int n = 0; ok && n < leaves; n++) {
+        TonOMapLeaf* leaf = omap_new_leaf();
+        if (!leaf) {
+            ok = 0;
+            break;
+        }
+        built[built_count++] = &leaf->node;
+        int take = count / leaves + (n < count % leaves);
+        for (int i = 0; i < take && ok; i++, next_key++) {
+            ok = omap_copy_key(map, omap_key_of(&keys[next_key]), &leaf->node.keys[i]);
+            if (!ok) break;
+            Value value = values ? values[next_key] : create_value_null();
+            leaf->values[i] = value_copy(&value);
+            leaf->node.count++;
+            gc_write_barrier(map, &value);
+        }
+        leaf->prev = prev;
+        if (prev) prev->next = leaf;
+        prev = leaf;
+        level[n] = &leaf->node;
+        mins[n] = leaf->node.keys[0];
+    }
+
+    // Inner levels, bottom up; separators are copies of each child's least key
+    int width = leaves;
+    while (ok && width > 1) {
+        int parents = omap_node_count(width, TONOMAP_NODE_KEYS + 1);
+        int next_child = 0;
+        for (int p = 0; p < parents; p++) {
+            TonOMapInner* inner = omap_new_inner();
+            if (!inner) {
+                ok = 0;
+                break;
+            }
+            built[built_count++] = &inner->node;
+            int take = width / parents + (p < width % parents);
+            TonOMapKey least = mins[next_child];
+            for (int i = 0; i < take; i++, next_child++) {
+                inner->children[i] = level[next_child];
+                if (i == 0) continue;
+                if (!omap_copy_key(map, mins[next_child], &inner->node.keys[i - 1])) {
+                    ok = 0;
+                    break;
+                }
+                inner->node.count++;
+            }
+            if (!ok) break;
+            level[p] = &inner->node;
+            mins[p] = least;
+        }
+        width = parents;
+    }
+
+    if (ok) {
+        map->root = level[0];
+        map->first = (TonOMapLeaf*)built[0];
+        map->last = (TonOMapLeaf*)built[leaves - 1];
+        map->size = count;
+        map->version++;
+    } else if (built) {
+        for (int i = 0; i < built_count; i++) omap_free_node(map, built[i]);
+        map->key_type = VALUE_NULL;
+    }
+    ton_free(built);
+    ton_free(level);
+    ton_free(mins);
+    return ok;
+}
+
+TonOMapCursor tonomap_lower_bound(TonOMap* map, const Value* key) {
+    TonOMapCursor cursor = { NULL, 0 };
+    if (!map || !map->root || !tonomap_key_ok(map, key)) return cursor;
+    TonOMapKey k = omap_key_of(key);
+    cursor.leaf = omap_find_leaf(map, k);
+    cursor.index = omap_lower_index(map, &cursor.leaf->node, k);
+    if (cursor.index == cursor.leaf->node.count) {
+        cursor.leaf = cursor.leaf->next;
+        cursor.index = 0;
+    }
+    return cursor;
+}
+
+TonOMapCursor tonomap_begin(TonOMap* map) {
+    TonOMapCursor cursor = { map ? map->first : NULL, 0 };
+    return cursor;
+}
+
+TonOMapCursor tonomap_last(TonOMap* map) {
+    TonOMapCursor cursor = { map ? map->last : NULL, 0 };
+    if (cursor.leaf) cursor.index = cursor.leaf->node.count - 1;
+    return cursor;
+}
+
+void tonomap_cursor_next(TonOMapCursor* cursor) {
+    if (!cursor->leaf) return;
+    if (++cursor->index < cursor->leaf->node.count) return;
+    cursor->leaf = cursor->leaf->next;
+    cursor->index = 0;
+}
+
+// The key as a Value; string keys are borrowed from the leaf
+Value tonomap_cursor_key(const TonOMap* map, const TonOMapCursor* cursor) {
+    TonOMapKey key = cursor->leaf->node.keys[cursor->index];
+    if (map->key_type == VALUE_INT) return create_value_int(key.int_key);
+    Value value;
+    value.type = VALUE_STRING;
+    value.ref_count = 0;
+    value.data.string_val = key.string_key;
+    return value;
+}
+
+Value tonomap_cursor_value(const TonOMapCursor* cursor) {
+    return cursor->leaf->values[cursor->index];
+}
+
+// TonSet implementation: a value set sharing the TonMap table (values unused)
 TonSet* tonset_create() {
-    TonSet* set = malloc(sizeof(TonSet));
+    TonSet* set = gc_alloc(GC_KIND_SET, sizeof(TonSet));
     if (!set) return NULL;
     
     set->map = tonmap_create();
     if (!set->map) {
-        free(set);
+        gc_free(set);
         return NULL;
     }
     
@@ -227,24 +1282,42 @@ TonSet* tonset_create() {
 void tonset_destroy(TonSet* set) {
     if (!set) return;
     tonmap_destroy(set->map);
-    free(set);
+    gc_free(set);
 }
 
-int tonset_add(TonSet* set, const char* value) {
+int tonset_add_value(TonSet* set, const Value* value) {
     if (!set || !value) return 0;
-    return tonmap_set(set->map, value, create_value_bool(true));
+    return tonmap_set_value(set->map, value, create_value_null());
 }
 
-int tonset_has(TonSet* set, const char* value) {
+int tonset_has_value(TonSet* set, const Value* value) {
     if (!set || !value) return 0;
-    return tonmap_has(set->map, value);
+    return tonmap_has_value(set->map, value);
 }
 
-int tonset_remove(TonSet* set, const char* value) {
+int tonset_remove_value(TonSet* set, const Value* value) {
     if (!set || !value) return 0;
-    return tonmap_remove(set->map, value);
+    return tonmap_remove_value(set->map, value);
+}
+
+int tonset_add(TonSet* set, const char* value) {
+    if (!value) return 0;
+    Value v = string_key(value);
+    return tonset_add_value(set, &v);
+}
+
+int tonset_has(TonSet* set, const char* value) {
+    if (!value) return 0;
+    Value v = string_key(value);
+    return tonset_has_value(set, &v);
+}
+
+int tonset_remove(TonSet* set, const char* value) {
+    if (!value) return 0;
+    Value v = string_key(value);
+    return tonset_remove_value(set, &v);
 }
 
 int tonset_size(TonSet* set) {
     return set ? tonmap_size(set->map) : 0;
-}
\ No newline at end of file
+}
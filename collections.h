@@ -2,31 +2,117 @@
 #define COLLECTIONS_H
 
 #include "value.h"
+#include "elements.h"
+#include "sort.h"
+#include <stdint.h>
 
 #define TONLIST_INITIAL_CAPACITY 8
-#define TONMAP_INITIAL_CAPACITY 16
+#define TONDEQUE_INITIAL_CAPACITY 8  // Power of two
+#define TONPQ_INITIAL_CAPACITY 8
+#define TONPQ_ARITY 4                // Children per heap node
+#define TONMAP_INITIAL_CAPACITY 16   // Power of two, multiple of the group width
+#define TONMAP_GROUP_WIDTH 16        // Control bytes scanned per probe step
+#define TONMAP_MAX_PROBE_GROUPS 8    // Longer insert probes mean the table is being flooded
+#define TONMAP_MAX_RESEEDS 4         // Flood reseeds allowed per table
+#define TONOMAP_NODE_KEYS 32         // Keys per B+-tree node; inner nodes have one more child
 
-// TonList - Dynamic array of Values
+// TonList - Dynamic array of Values (unboxed while homogeneous)
 typedef struct {
-    Value* data;
+    ElementData data;             // Elements, laid out according to `kind`
+    ElementKind kind;             // Storage kind; boxed after a heterogeneous write
     int size;
     int capacity;
+    int locked;                   // Set while a native sort calls back into Ton; mutators refuse
 } TonList;
 
-// TonMap - Hash map with string keys and Value values
+// TonDeque - Double-ended queue on a ring buffer
+typedef struct {
+    Value* data;
+    int head;                     // Slot of the front element
+    int size;
+    int capacity;                 // Power of two, so slots wrap with a mask
+} TonDeque;
+
+// Slot of element i of a TonDeque, counted from the front
+#define TONDEQUE_SLOT(deque, i) (((deque)->head + (i)) & ((deque)->capacity - 1))
+
+// TonPQ - Priority queue on a d-ary min-heap: the least element comes out first
+typedef struct {
+    Value* data;                  // Heap order; children of i are ARITY*i+1 .. ARITY*i+ARITY
+    int size;
+    int capacity;
+    Value less;                   // Comparator function, or null for natural order
+    int locked;                   // Set while the comparator runs; mutators refuse
+} TonPQ;
+
+// TonMap - Insertion-ordered hash map keyed by Values (dense entries plus Swiss-table index)
 typedef struct TonMapEntry {
-    char* key;
+    Value key;                    // int, float, bool, char, string or hashable struct
     Value value;
-    struct TonMapEntry* next;
+    uint64_t hash;                // Cached hash of the key
 } TonMapEntry;
 
 typedef struct {
-    TonMapEntry** buckets;
-    int capacity;
-    int size;
+    unsigned char* ctrl;          // Per index slot: empty, deleted or 7-bit hash tag
+    int32_t* index;               // Per index slot: position of its entry in `entries`
+    TonMapEntry* entries;         // Entries in insertion order; removed ones are holes
+    int capacity;                 // Index slots (power of two)
+    int entries_used;             // Entries appended since the last rebuild, holes included
+    int size;                     // Live entries
+    int reseeds;                  // Times the table was rehashed under a new seed
+    unsigned rebuilds;            // Bumped by every rebuild, which compacts entry positions
+    unsigned removals;            // Bumped by every removal
+    uint64_t seed;                // Per-table hash seed
 } TonMap;
 
-// TonSet - Set of strings (using TonMap internally)
+// Entries array length for an index of `capacity` slots (7/8 load)
+#define TONMAP_ENTRIES_MAX(capacity) ((capacity) / 8 * 7)
+
+// True if entry i of a TonMap is live (removed entries have a null key)
+#define TONMAP_ENTRY_LIVE(map, i) ((map)->entries[i].key.type != VALUE_NULL)
+
+// TonOMap - Ordered map on a B+-tree. Keys are all ints or all strings; the
+// first key fixes which. Values live in the leaves, which are chained in key
+// order for range scans.
+typedef union {
+    int int_key;
+    char* string_key;             // Owned by the node holding it
+} TonOMapKey;
+
+typedef struct TonOMapNode {
+    int leaf;                     // Nodes are TonOMapLeaf or TonOMapInner
+    int count;                    // Keys in use
+    TonOMapKey keys[TONOMAP_NODE_KEYS];
+} TonOMapNode;
+
+typedef struct {
+    TonOMapNode node;             // keys[i] is the least key under children[i + 1]
+    TonOMapNode* children[TONOMAP_NODE_KEYS + 1];
+} TonOMapInner;
+
+typedef struct TonOMapLeaf {
+    TonOMapNode node;
+    Value values[TONOMAP_NODE_KEYS];
+    struct TonOMapLeaf* prev;
+    struct TonOMapLeaf* next;
+} TonOMapLeaf;
+
+typedef struct {
+    TonOMapNode* root;            // NULL while empty
+    TonOMapLeaf* first;           // Leaf holding the least key
+    TonOMapLeaf* last;            // Leaf holding the greatest key
+    int size;
+    ValueType key_type;           // VALUE_NULL until the first key, then VALUE_INT or VALUE_STRING
+    unsigned version;             // Bumped when keys are added or removed
+} TonOMap;
+
+// Position of one entry of a TonOMap; `leaf` is NULL past the end
+typedef struct {
+    TonOMapLeaf* leaf;
+    int index;
+} TonOMapCursor;
+
+// TonSet - Set of hashable Values (keys of a TonMap)
 typedef struct {
     TonMap* map;
 } TonSet;
@@ -40,18 +126,70 @@ Value tonlist_get(TonList* list, int index);
 int tonlist_set(TonList* list, int index, Value value);
 int tonlist_size(TonList* list);
 
+// TonDeque functions
+TonDeque* tondeque_create();
+void tondeque_destroy(TonDeque* deque);
+int tondeque_push_back(TonDeque* deque, Value value);
+int tondeque_push_front(TonDeque* deque, Value value);
+Value tondeque_pop_back(TonDeque* deque);
+Value tondeque_pop_front(TonDeque* deque);
+Value tondeque_get(TonDeque* deque, int index);
+int tondeque_size(TonDeque* deque);
+
+// TonPQ functions. `less` orders the elements; it may call back into Ton,
+// so push and pop lock the queue while they sift.
+TonPQ* tonpq_create(Value less);
+void tonpq_destroy(TonPQ* pq);
+int tonpq_push(TonPQ* pq, Value value, SortLessFn less, void* ctx);
+Value tonpq_pop(TonPQ* pq, SortLessFn less, void* ctx);
+Value tonpq_peek(TonPQ* pq);
+int tonpq_size(TonPQ* pq);
+
 // TonMap functions
 TonMap* tonmap_create();
 void tonmap_destroy(TonMap* map);
+int tonmap_set_value(TonMap* map, const Value* key, Value value);
+Value tonmap_get_value(TonMap* map, const Value* key);
+int tonmap_has_value(TonMap* map, const Value* key);
+int tonmap_remove_value(TonMap* map, const Value* key);
+int tonmap_hash_key(const Value* key, uint64_t seed, uint64_t* out);
+int tonmap_key_hashable(const Value* key);
+int tonmap_key_equal(const Value* a, const Value* b);
+// String-key convenience wrappers
 int tonmap_set(TonMap* map, const char* key, Value value);
 Value tonmap_get(TonMap* map, const char* key);
 int tonmap_has(TonMap* map, const char* key);
 int tonmap_remove(TonMap* map, const char* key);
 int tonmap_size(TonMap* map);
+// Iteration in insertion order: for (i = tonmap_next(m, 0); i >= 0; i = tonmap_next(m, i + 1))
+int tonmap_next(const TonMap* map, int pos);
+
+// TonOMap functions. Keys must be ints or strings of the map's key type
+// (tonomap_key_ok); values are copied in like TonMap values.
+TonOMap* tonomap_create();
+void tonomap_destroy(TonOMap* map);
+int tonomap_key_ok(const TonOMap* map, const Value* key);
+int tonomap_set(TonOMap* map, const Value* key, Value value);
+int tonomap_get(TonOMap* map, const Value* key, Value* out);
+int tonomap_remove(TonOMap* map, const Value* key);
+int tonomap_size(TonOMap* map);
+// Build an empty map from `count` strictly ascending keys; returns -1 if
+// they are not ascending or of one key type, 0 if out of memory
+int tonomap_load_sorted(TonOMap* map, const Value* keys, const Value* values, int count);
+// Cursors stay valid until the next insertion or removal
+TonOMapCursor tonomap_lower_bound(TonOMap* map, const Value* key);
+TonOMapCursor tonomap_begin(TonOMap* map);
+TonOMapCursor tonomap_last(TonOMap* map);
+void tonomap_cursor_next(TonOMapCursor* cursor);
+Value tonomap_cursor_key(const TonOMap* map, const TonOMapCursor* cursor);
+Value tonomap_cursor_value(const TonOMapCursor* cursor);
 
 // TonSet functions
 TonSet* tonset_create();
 void tonset_destroy(TonSet* set);
+int tonset_add_value(TonSet* set, const Value* value);
+int tonset_has_value(TonSet* set, const Value* value);
+int tonset_remove_value(TonSet* set, const Value* value);
 int tonset_add(TonSet* set, const char* value);
 int tonset_has(TonSet* set, const char* value);
 int tonset_remove(TonSet* set, const char* value);
@@ -0,0 +1,93 @@
+#include "digest.h"
+#include "gc.h"
+#include "memory.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char* const digest_names[] = { "sha256", "md5" };
+
+int tondigest_algorithm(const char* name) {
+    for (int i = 0; i < 2; i++) {
+        if (strcmp(name, digest_names[i]) == 0) return i;
+    }
+    return -1;
+}
+
+const char* tondigest_name(int algorithm) {
+    return digest_names[algorithm];
+}
+
+size_t tondigest_size(int algorithm) {
+    return algorithm == DIGEST_MD5 ? 16 : SHA256_BLOCK_SIZE;
+}
+
+static void digest_init(TonDigest* digest, int algorithm) {
+    digest->algorithm = algorithm;
+    digest->finished = 0;
+    if (algorithm == DIGEST_MD5) {
+        MD5_Init(&digest->ctx.md5);
+    } else {
+        sha256_init(&digest->ctx.sha256);
+    }
+}
+
+TonDigest* tondigest_create(int algorithm) {
+    TonDigest* digest = (TonDigest*)gc_alloc(GC_KIND_DIGEST, sizeof(TonDigest));
+    if (!digest) return NULL;
+    digest_init(digest, algorithm);
+    return digest;
+}
+
+void tondigest_destroy(TonDigest* digest) {
+    if (!digest) return;
+    gc_free(digest);
+}
+
+void tondigest_update(TonDigest* digest, const unsigned char* data, size_t len) {
+    if (digest->algorithm == DIGEST_MD5) {
+        // MD5_Update takes an unsigned long, which is 32 bits on some targets
+        while (len > 0) {
+            unsigned long piece = len > (1UL << 30) ? (1UL << 30) : (unsigned long)len;
+            MD5_Update(&digest->ctx.md5, data, piece);
+            data += piece;
+            len -= piece;
+        }
+    } else {
+        sha256_update(&digest->ctx.sha256, data, len);
+    }
+}
+
+void tondigest_final(TonDigest* digest, unsigned char* out) {
+    if (digest->algorithm == DIGEST_MD5) {
+        MD5_Final(out, &digest->ctx.md5);
+    } else {
+        sha256_final(&digest->ctx.sha256, out);
+    }
+    digest->finished = 1;
+}
+
+int tondigest_file(int algorithm, const char* path, unsigned char* out) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return 0;
+    // Reads go straight into one cache-line aligned buffer, without stdio's own copy
+    setvbuf(file, NULL, _IONBF, 0);
+    unsigned char* block = (unsigned char*)ton_malloc(DIGEST_FILE_CHUNK + 63);
+    if (!block) {
+        fclose(file);
+        return -1;
+    }
+    unsigned char* buffer = (unsigned char*)(((uintptr_t)block + 63) & ~(uintptr_t)63);
+
+    TonDigest digest;
+    digest_init(&digest, algorithm);
+    size_t got;
+    while ((got = fread(buffer, 1, DIGEST_FILE_CHUNK, file)) > 0) {
+        tondigest_update(&digest, buffer, got);
+    }
+    int ok = !ferror(file);
+    fclose(file);
+    ton_free(block);
+    if (ok) tondigest_final(&digest, out);
+    return ok;
+}
@@ -0,0 +1,44 @@
+#ifndef TON_DIGEST_H
+#define TON_DIGEST_H
+
+#include "sha256.h"
+#include "md5.h"
+#include <stddef.h>
+
+// TonDigest - Incremental message digest. Input is fed in pieces of any
+// size and only the algorithm's block buffer is kept, so memory stays
+// constant however long the message is.
+
+#define DIGEST_SHA256 0
+#define DIGEST_MD5 1
+
+#define DIGEST_MAX_SIZE SHA256_BLOCK_SIZE
+
+// hash_file reads the file in chunks of this many bytes
+#define DIGEST_FILE_CHUNK (1 << 20)
+
+typedef struct {
+    int algorithm;
+    int finished;                 // Set by tondigest_final; later updates are refused
+    union {
+        SHA256_CTX sha256;
+        MD5_CTX md5;
+    } ctx;
+} TonDigest;
+
+// Algorithm for a name such as "sha256" or "md5"; -1 if unknown
+int tondigest_algorithm(const char* name);
+const char* tondigest_name(int algorithm);
+// Digest length in bytes
+size_t tondigest_size(int algorithm);
+
+TonDigest* tondigest_create(int algorithm);
+void tondigest_destroy(TonDigest* digest);
+void tondigest_update(TonDigest* digest, const unsigned char* data, size_t len);
+// Write the digest to `out` (tondigest_size bytes) and finish the context
+void tondigest_final(TonDigest* digest, unsigned char* out);
+// Stream a file through a fresh context of `algorithm`. Returns 0 if the
+// file cannot be read, -1 if out of memory
+int tondigest_file(int algorithm, const char* path, unsigned char* out);
+
+#endif // TON_DIGEST_H
@@ -0,0 +1,106 @@
+#include "elements.h"
+#include "memory.h"
+#include <string.h>
+
+size_t element_size(ElementKind kind) {
+    switch (kind) {
+        case ELEMENTS_INT32:  return sizeof(int32_t);
+        case ELEMENTS_DOUBLE: return sizeof(double);
+        case ELEMENTS_BOOL:
+        case ELEMENTS_CHAR:   return sizeof(uint8_t);
+        default:              return sizeof(Value);
+    }
+}
+
+/**
+ * Unboxed kind that can hold a value
+ * @param value Value about to be stored
+ * @return Matching unboxed kind, or ELEMENTS_BOXED
+ */
+ElementKind element_kind_of(const Value* value) {
+    switch (value->type) {
+        case VALUE_INT:   return ELEMENTS_INT32;
+        case VALUE_FLOAT: return ELEMENTS_DOUBLE;
+        case VALUE_BOOL:  return ELEMENTS_BOOL;
+        case VALUE_CHAR:  return ELEMENTS_CHAR;
+        default:          return ELEMENTS_BOXED;
+    }
+}
+
+/**
+ * Storage kind for a declared element type ("int", "float", ...)
+ * @param type_name Element type name, may be NULL
+ * @return Unboxed kind for primitive types, ELEMENTS_BOXED otherwise
+ */
+ElementKind element_kind_for_type_name(const char* type_name) {
+    if (!type_name) return ELEMENTS_BOXED;
+    if (strcmp(type_name, "int") == 0) return ELEMENTS_INT32;
+    if (strcmp(type_name, "float") == 0) return ELEMENTS_DOUBLE;
+    if (strcmp(type_name, "bool") == 0) return ELEMENTS_BOOL;
+    if (strcmp(type_name, "char") == 0 || strcmp(type_name, "byte") == 0) return ELEMENTS_CHAR;
+    return ELEMENTS_BOXED;
+}
+
+Value elements_load(ElementKind kind, ElementData data, size_t index) {
+    switch (kind) {
+        case ELEMENTS_INT32:  return create_value_int(data.ints[index]);
+        case ELEMENTS_DOUBLE: return create_value_float(data.floats[index]);
+        case ELEMENTS_BOOL:   return create_value_bool(data.bytes[index]);
+        case ELEMENTS_CHAR:   return create_value_char((char)data.bytes[index]);
+        default:              return data.boxed[index];
+    }
+}
+
+void elements_store(ElementKind kind, ElementData data, size_t index, const Value* value) {
+    switch (kind) {
+        case ELEMENTS_INT32:  data.ints[index] = value->data.int_val; break;
+        case ELEMENTS_DOUBLE: data.floats[index] = value->data.float_val; break;
+        case ELEMENTS_BOOL:   data.bytes[index] = value->data.bool_val != 0; break;
+        case ELEMENTS_CHAR:   data.bytes[index] = (uint8_t)value->data.char_val; break;
+        default:              data.boxed[index] = *value; break;
+    }
+}
+
+/**
+ * Switch a buffer to boxed storage (first heterogeneous write)
+ * @param kind In/out storage kind
+ * @param data In/out element buffer; replaced by a Value buffer
+ * @param length Elements in use
+ * @param capacity Elements the new buffer must hold
+ * @return 1 on success, 0 if allocation failed (buffer unchanged)
+ */
+int elements_box(ElementKind* kind, ElementData* data, size_t length, size_t capacity) {
+    if (*kind == ELEMENTS_BOXED) return 1;
+    Value* boxed = (Value*)ton_malloc(sizeof(Value) * (capacity > 0 ? capacity : 1));
+    if (!boxed) return 0;
+    for (size_t i = 0; i < length; i++) {
+        boxed[i] = elements_load(*kind, *data, i);
+    }
+    ton_free(data->raw);
+    data->boxed = boxed;
+    *kind = ELEMENTS_BOXED;
+    return 1;
+}
+
+/**
+ * Prepare a buffer for a write of `value`
+ * @param kind In/out storage kind
+ * @param data In/out element buffer
+ * @param length Elements in use
+ * @param capacity Elements the buffer holds
+ * @param value Value about to be written
+ * @return 1 if the buffer can now store `value`, 0 if allocation failed
+ */
+int elements_accept(ElementKind* kind, ElementData* data, size_t length, size_t capacity, const Value* value) {
+    ElementKind wanted = element_kind_of(value);
+    if (*kind == wanted || (*kind == ELEMENTS_BOXED && length > 0)) return 1;
+    if (length == 0) {
+        // An empty container adopts the kind of its first element
+        void* resized = ton_realloc(data->raw, element_size(wanted) * (capacity > 0 ? capacity : 1));
+        if (!resized) return 0;
+        data->raw = resized;
+        *kind = wanted;
+        return 1;
+    }
+    return elements_box(kind, data, length, capacity);
+}
@@ -0,0 +1,42 @@
+#ifndef TON_ELEMENTS_H
+#define TON_ELEMENTS_H
+
+#include "value.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Element storage for TonList and TonArray. Homogeneous int, float, bool
+// and char sequences are stored unboxed; anything else (or a write that
+// breaks homogeneity) uses boxed Value storage.
+typedef enum {
+    ELEMENTS_BOXED,     // Value[]
+    ELEMENTS_INT32,     // int32_t[] (Ton ints are 32-bit)
+    ELEMENTS_DOUBLE,    // double[]
+    ELEMENTS_BOOL,      // uint8_t[]
+    ELEMENTS_CHAR       // uint8_t[]
+} ElementKind;
+
+// Pointer to the element buffer, viewed according to the container's kind
+typedef union {
+    Value* boxed;
+    int32_t* ints;
+    double* floats;
+    uint8_t* bytes;
+    void* raw;
+} ElementData;
+
+size_t element_size(ElementKind kind);
+ElementKind element_kind_of(const Value* value);
+ElementKind element_kind_for_type_name(const char* type_name);
+
+// Element i as a Value; boxed elements are borrowed, unboxed ones are scalars
+Value elements_load(ElementKind kind, ElementData data, size_t index);
+// Store `value` (whose kind must match an unboxed buffer) without copying
+void elements_store(ElementKind kind, ElementData data, size_t index, const Value* value);
+// Convert `length` elements to boxed storage with room for `capacity`
+int elements_box(ElementKind* kind, ElementData* data, size_t length, size_t capacity);
+// Make a buffer able to hold `value`: empty buffers adopt its kind, unboxed
+// buffers of another kind are boxed
+int elements_accept(ElementKind* kind, ElementData* data, size_t length, size_t capacity, const Value* value);
+
+#endif // TON_ELEMENTS_H
@@ -2,14 +2,20 @@
 #include "environment.h"
 #include "interpreter.h" // Include for Value definition
 #include "memory.h"
+#include "gc.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#define ENV_FRAME_POOL_SIZE 64
 
+// Released method frames. They keep a reference, so the GC treats them as
+// live, but they are emptied first and hold nothing for it to trace.
+static Environment* frame_pool[ENV_FRAME_POOL_SIZE];
+static int frame_pool_count = 0;
 
 Environment* create_environment() {
-    Environment* env = (Environment*)ton_malloc(sizeof(Environment));
+    Environment* env = (Environment*)gc_alloc(GC_KIND_ENV, sizeof(Environment));
     if (env == NULL) {
         runtime_error("Failed to allocate environment");
         return NULL;
@@ -17,12 +23,16 @@ Environment* create_environment() {
     env->parent = NULL;
     env->variables = NULL;
     env->functions = NULL;
+    env->ref_count = 1;
+    env->captured = 0;
+    env->self = create_value_null();
     return env;
 }
 
 Environment* create_child_environment(Environment* parent) {
     Environment* env = create_environment();
     env->parent = parent;
+    gc_write_barrier_object(env, parent);
     return env;
 }
 
@@ -40,26 +50,108 @@ void env_release(Environment* env) {
         return;
     }
 
+    // A closure may still reach this scope; leave it to the collector
+    if (env->captured) {
+        return;
+    }
+    env_destroy(env);
+}
+
+/**
+ * Mark an environment (and every enclosing scope) as reachable from a closure
+ * @param env Environment captured by a function declaration
+ */
+void env_capture(Environment* env) {
+    while (env && !env->captured) {
+        env->captured = 1;
+        env = env->parent;
+    }
+}
+
+static void env_clear(Environment* env) {
     Symbol* current = env->variables;
-     while (current) {
-         Symbol* next = current->next;
+    while (current) {
+        Symbol* next = current->next;
         ton_free(current->name);
         value_release(&current->value); // Release the value
         ton_free(current);
         current = next;
     }
+    env->variables = NULL;
 
     FunctionSymbol* current_func = env->functions;
     while (current_func != NULL) {
         FunctionSymbol* next_func = current_func->next;
         ton_free(current_func->name);
-        // The Function* itself might be freed elsewhere if it's shared,
-        // or it might be part of the AST which is freed separately.
-        // For now, we assume the Function* is not owned by the FunctionSymbol.
+        // User-defined functions are collected objects and builtins live for
+        // the whole run, so the symbol never owns the Function itself.
         ton_free(current_func);
         current_func = next_func;
     }
-    ton_free(env);
+    env->functions = NULL;
+
+    value_release(&env->self);
+    env->self = create_value_null();
+}
+
+/**
+ * Free an environment and its symbols. Values referring to collected objects
+ * are only dropped; the objects themselves are reclaimed by the GC.
+ * @param env Environment to destroy
+ */
+void env_destroy(Environment* env) {
+    if (!env) return;
+    env_clear(env);
+    gc_free(env);
+}
+
+/**
+ * Scope for one method call, taken from the frame pool when it has one
+ * @param parent Scope the method's class was declared in
+ * @param self Instance the method was called on
+ * @return The frame, or NULL if out of memory
+ */
+Environment* env_acquire_frame(Environment* parent, Value self) {
+    Environment* env = frame_pool_count > 0 ? frame_pool[--frame_pool_count] : create_environment();
+    if (!env) return NULL;
+    env->parent = parent;
+    gc_write_barrier_object(env, parent);
+    env->self = self;
+    gc_write_barrier(env, &self);
+    return env;
+}
+
+/**
+ * End a method call. A frame a closure captured, or that someone else still
+ * refers to, is released normally instead of being pooled.
+ * @param env Frame from env_acquire_frame
+ */
+void env_release_frame(Environment* env) {
+    if (!env) return;
+    if (env->ref_count > 1 || env->captured || frame_pool_count == ENV_FRAME_POOL_SIZE) {
+        env_release(env);
+        return;
+    }
+    env_clear(env);
+    env->parent = NULL;
+    frame_pool[frame_pool_count++] = env;
+}
+
+Value* env_get_this(Environment* env) {
+    for (; env; env = env->parent) {
+        if (env->self.type != VALUE_NULL) return &env->self;
+    }
+    return NULL;
+}
+
+/**
+ * Finalizer for user-defined functions reclaimed by the GC
+ * @param func Function to free
+ */
+void function_destroy(Function* func) {
+    if (!func) return;
+    ton_free(func->name);
+    gc_free(func);
 }
 
 void env_add_variable(Environment* env, const char* name, Value value, VariableType type) {
@@ -74,10 +166,11 @@ void env_add_variable(Environment* env, const char* name, Value value, VariableT
         ton_free(new_symbol);
         return;
     }
-    new_symbol->value = value;
+    new_symbol->value = value_copy(&value);
     new_symbol->type = type;
     new_symbol->next = env->variables;
     env->variables = new_symbol;
+    gc_write_barrier(env, &value);
 }
 
 Value* env_get_variable(Environment* env, const char* name) {
@@ -102,8 +195,8 @@ bool env_set_variable(Environment* env, const char* name, Value value) {
         while (current_var != NULL) {
             if (strcmp(current_var->name, name) == 0) {
                 value_release(&current_var->value); // Release the old value
-                current_var->value = value;
-                value_add_ref(&current_var->value); // Add reference to the new value
+                current_var->value = value_copy(&value); // Slots own their string payloads
+                gc_write_barrier(current_env, &value);
                 return true;
             }
             current_var = current_var->next;
@@ -128,6 +221,7 @@ void env_add_function(Environment* env, const char* name, Function* func) {
     new_func_symbol->func = func;
     new_func_symbol->next = env->functions;
     env->functions = new_func_symbol;
+    if (func && func->type == USER_DEFINED) gc_write_barrier_object(env, func);
 }
 
 Function* env_get_function(Environment* env, const char* name) {
@@ -25,6 +25,8 @@ typedef struct Environment {
     Symbol* variables;
     FunctionSymbol* functions;
     int ref_count; // Add reference count
+    int captured;  // Referenced by a closure; reclaimed by the GC instead of on release
+    Value self;    // `this` in a method call frame, VALUE_NULL in any other scope
 } Environment;
 
 // Function structure (moved from interpreter.h)
@@ -49,7 +51,17 @@ bool env_set_variable(Environment* env, const char* name, Value value);
 // Function handling
 void env_add_function(Environment* env, const char* name, Function* func);
 Function* env_get_function(Environment* env, const char* name);
+// Method call frames. A frame holds `this` in `self` rather than as a named
+// variable, and released frames are kept for the next call.
+Environment* env_acquire_frame(Environment* parent, Value self);
+void env_release_frame(Environment* env);
+// `this` of the innermost enclosing method frame, or NULL outside methods
+Value* env_get_this(Environment* env);
+
 void env_add_ref(Environment* env);
 void env_release(Environment* env);
+void env_capture(Environment* env);
+void env_destroy(Environment* env);
+void function_destroy(Function* func);
 
 #endif // ENVIRONMENT_H
\ No newline at end of file
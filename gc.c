@@ -0,0 +1,745 @@
+#include "gc.h"
+#include "memory.h"
+#include "collections.h"
+#include "persistent.h"
+#include "sketch.h"
+#include "art.h"
+#include "cache.h"
+#include "soa.h"
+#include "digest.h"
+#include "array.h"
+#include "struct.h"
+#include "environment.h"
+#include "error.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Generational, incremental mark-sweep collector for collections, struct
+// instances, closures and the environments they capture. Objects are only
+// reclaimed at safepoints (statement boundaries), so C code may hold raw
+// pointers between them as long as temporaries that outlive a nested call are
+// registered as roots.
+//
+// New objects start in the young generation. A minor collection traces the
+// young objects reachable from the roots and from the remembered set (old
+// objects that had a young value stored into them), frees the rest and
+// promotes the survivors. Major collections mark the whole heap in
+// budgeted steps spread over safepoints; stores into already-marked objects
+// shade the stored value and objects allocated mid-cycle start out marked,
+// so only the final root rescan and the sweep run as one pause.
+
+#define GC_HEADER_SIZE ((sizeof(GcHeader) + 15) & ~(size_t)15)
+
+#define GC_PAYLOAD(h) ((void*)((char*)(h) + GC_HEADER_SIZE))
+#define GC_HEADER(p)  ((GcHeader*)((char*)(p) - GC_HEADER_SIZE))
+
+typedef enum {
+    GC_PHASE_IDLE,
+    GC_PHASE_MARKING
+} GcPhase;
+
+static GcHeader* young_head = NULL;
+static GcHeader* old_head = NULL;
+static size_t gc_threshold = GC_DEFAULT_THRESHOLD;
+static size_t next_collection_at = GC_DEFAULT_THRESHOLD;
+static size_t nursery_size = GC_DEFAULT_NURSERY_SIZE;
+static size_t step_budget = GC_DEFAULT_STEP_BUDGET;
+static GcPhase phase = GC_PHASE_IDLE;
+static int major_requested = 0;
+static int minor_requested = 0;
+static int minor_marking = 0;
+static int collecting = 0;
+static int hooks_installed = 0;
+static GcStats stats;
+
+// Temporary roots: addresses of Value slots owned by C frames
+static Value** root_stack = NULL;
+static int root_count = 0;
+static int root_capacity = 0;
+
+// Gray objects waiting to be traced
+static GcHeader** mark_stack = NULL;
+static size_t mark_count = 0;
+static size_t mark_capacity = 0;
+
+// Old objects that may point at young ones
+static GcHeader** remembered = NULL;
+static size_t remembered_count = 0;
+static size_t remembered_capacity = 0;
+
+static void heap_link(GcHeader** head, GcHeader* h) {
+    h->prev = NULL;
+    h->next = *head;
+    if (*head) (*head)->prev = h;
+    *head = h;
+}
+
+static void heap_unlink(GcHeader** head, GcHeader* h) {
+    if (h->prev) h->prev->next = h->next;
+    else *head = h->next;
+    if (h->next) h->next->prev = h->prev;
+}
+
+static size_t gc_now_us(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (size_t)ts.tv_sec * 1000000 + (size_t)(ts.tv_nsec / 1000);
+}
+
+static void record_pause(size_t started_us) {
+    size_t now = gc_now_us();
+    size_t pause = now > started_us ? now - started_us : 0;
+    int bucket = 0;
+    size_t limit = 10;
+    while (bucket < GC_PAUSE_BUCKETS - 1 && pause >= limit) {
+        bucket++;
+        limit *= 10;
+    }
+    stats.pause_histogram[bucket]++;
+    stats.total_pause_us += pause;
+    if (pause > stats.max_pause_us) stats.max_pause_us = pause;
+}
+
+// Soft heap limit reached: start a major cycle at the next safepoint
+static void gc_on_soft_limit(void) {
+    if (phase == GC_PHASE_IDLE) major_requested = 1;
+}
+
+// Link a header into the young generation as a newly allocated object
+static void* gc_link_new(GcHeader* h) {
+    // Objects born during a major cycle are treated as already reachable
+    h->marked = phase == GC_PHASE_MARKING;
+    heap_link(&young_head, h);
+
+    stats.live_objects++;
+    stats.live_bytes += h->size;
+    stats.young_objects++;
+    stats.young_bytes += h->size;
+
+    if (!hooks_installed) {
+        ton_mem_set_report_hook(gc_print_stats);
+        ton_mem_set_limit_hook(gc_on_soft_limit);
+        hooks_installed = 1;
+    }
+
+    if (!collecting && phase == GC_PHASE_IDLE) {
+        if (ton_mem_usage() >= next_collection_at) {
+            major_requested = 1;
+        } else if (stats.young_bytes >= nursery_size) {
+            minor_requested = 1;
+        }
+    }
+    return GC_PAYLOAD(h);
+}
+
+/**
+ * Allocate a collected object with a zeroed payload (use the gc_alloc macro)
+ * @param kind Kind of object (decides how it is traced and finalized)
+ * @param size Payload size in bytes
+ * @param file Source file of the caller
+ * @param line Source line of the caller
+ * @return Pointer to the payload or NULL on failure
+ */
+void* gc_alloc_at(GcKind kind, size_t size, const char* file, int line) {
+    GcHeader* h = (GcHeader*)ton_calloc_at(1, GC_HEADER_SIZE + size, file, line);
+    if (!h) return NULL;
+
+    h->kind = (unsigned char)kind;
+    h->size = size;
+    return gc_link_new(h);
+}
+
+static void mark_stack_remove(GcHeader* h) {
+    for (size_t i = mark_count; i > 0; i--) {
+        if (mark_stack[i - 1] == h) {
+            mark_stack[i - 1] = mark_stack[--mark_count];
+            break;
+        }
+    }
+    h->gray = 0;
+}
+
+static void remembered_remove(GcHeader* h) {
+    for (size_t i = remembered_count; i > 0; i--) {
+        if (remembered[i - 1] == h) {
+            remembered[i - 1] = remembered[--remembered_count];
+            break;
+        }
+    }
+    h->remembered = 0;
+}
+
+/**
+ * Release a collected object immediately (used when ownership is known)
+ * @param obj Payload pointer returned by gc_alloc
+ */
+void gc_free(void* obj) {
+    if (!obj) return;
+    gc_detach(obj);
+    ton_free(GC_HEADER(obj));
+}
+
+/**
+ * Take an object off the heap lists, leaving its memory allocated
+ * @param obj Payload pointer returned by gc_alloc
+ */
+void gc_detach(void* obj) {
+    GcHeader* h = GC_HEADER(obj);
+
+    if (h->gray) mark_stack_remove(h);
+    if (h->remembered) remembered_remove(h);
+    heap_unlink(h->old ? &old_head : &young_head, h);
+
+    stats.live_objects--;
+    stats.live_bytes -= h->size;
+    if (!h->old) {
+        stats.young_objects--;
+        stats.young_bytes -= h->size;
+    }
+}
+
+/**
+ * Return a detached object to the heap as a fresh young object
+ * @param obj Payload pointer previously passed to gc_detach
+ * @return The same payload, zeroed
+ */
+void* gc_reuse(void* obj) {
+    GcHeader* h = GC_HEADER(obj);
+    memset(obj, 0, h->size);
+    h->old = 0;
+    h->gray = 0;
+    h->remembered = 0;
+    return gc_link_new(h);
+}
+
+void gc_push_root(Value* slot) {
+    if (root_count == root_capacity) {
+        int new_capacity = root_capacity ? root_capacity * 2 : 64;
+        Value** grown = (Value**)realloc(root_stack, sizeof(Value*) * new_capacity);
+        if (!grown) {
+            runtime_error("Failed to grow GC root stack");
+            return;
+        }
+        root_stack = grown;
+        root_capacity = new_capacity;
+    }
+    root_stack[root_count++] = slot;
+}
+
+void gc_pop_roots(int count) {
+    root_count -= count;
+    if (root_count < 0) root_count = 0;
+}
+
+// ---------------------------------------------------------------------------
+// Marking
+
+static void mark_object(void* obj) {
+    if (!obj) return;
+    GcHeader* h = GC_HEADER(obj);
+    if (h->marked) return;
+    if (minor_marking && h->old) return; // Old objects are live during a minor cycle
+    h->marked = 1;
+    h->gray = 1;
+
+    if (mark_count == mark_capacity) {
+        size_t new_capacity = mark_capacity ? mark_capacity * 2 : 256;
+        GcHeader** grown = (GcHeader**)realloc(mark_stack, sizeof(GcHeader*) * new_capacity);
+        if (!grown) {
+            runtime_error("Failed to grow GC mark stack");
+            return;
+        }
+        mark_stack = grown;
+        mark_capacity = new_capacity;
+    }
+    mark_stack[mark_count++] = h;
+}
+
+// Collected object a value refers to, or NULL for plain values
+static void* value_object(const Value* v) {
+    switch (v->type) {
+        case VALUE_ARRAY:   return v->data.array_val;
+        case VALUE_TONLIST: return v->data.tonlist_val;
+        case VALUE_TONMAP:  return v->data.tonmap_val;
+        case VALUE_TONSET:  return v->data.tonset_val;
+        case VALUE_TONDEQUE: return v->data.tondeque_val;
+        case VALUE_TONPQ:   return v->data.tonpq_val;
+        case VALUE_TONOMAP: return v->data.tonomap_val;
+        case VALUE_TONPVEC: return v->data.tonpvec_val;
+        case VALUE_TONPMAP: return v->data.tonpmap_val;
+        case VALUE_TONBLOOM: return v->data.tonbloom_val;
+        case VALUE_TONHLL:  return v->data.tonhll_val;
+        case VALUE_TONBITMAP: return v->data.tonbitmap_val;
+        case VALUE_TONART: return v->data.tonart_val;
+        case VALUE_TONCACHE: return v->data.toncache_val;
+        case VALUE_TONSOA: return v->data.tonsoa_val;
+        case VALUE_TONDIGEST: return v->data.tondigest_val;
+        case VALUE_STRUCT:  return v->data.struct_val;
+        case VALUE_FN:
+            if (v->data.function_value && v->data.function_value->type == USER_DEFINED) {
+                return v->data.function_value;
+            }
+            return NULL;
+        default:
+            return NULL;
+    }
+}
+
+static void mark_value(const Value* v) {
+    mark_object(value_object(v));
+}
+
+static int mark_art_leaf(void* ctx, const ArtLeaf* leaf) {
+    (void)ctx;
+    mark_value(&leaf->value);
+    return 0;
+}
+
+static void trace_object(GcHeader* h) {
+    void* obj = GC_PAYLOAD(h);
+    switch ((GcKind)h->kind) {
+        case GC_KIND_LIST: {
+            TonList* list = (TonList*)obj;
+            if (list->kind != ELEMENTS_BOXED) break;
+            for (int i = 0; i < list->size; i++) mark_value(&list->data.boxed[i]);
+            break;
+        }
+        case GC_KIND_MAP: {
+            TonMap* map = (TonMap*)obj;
+            for (int i = 0; i < map->entries_used; i++) {
+                if (!TONMAP_ENTRY_LIVE(map, i)) continue;
+                mark_value(&map->entries[i].key);
+                mark_value(&map->entries[i].value);
+            }
+            break;
+        }
+        case GC_KIND_SET:
+            mark_object(((TonSet*)obj)->map);
+            break;
+        case GC_KIND_DEQUE: {
+            TonDeque* deque = (TonDeque*)obj;
+            for (int i = 0; i < deque->size; i++) {
+                mark_value(&deque->data[(deque->head + i) & (deque->capacity - 1)]);
+            }
+            break;
+        }
+        case GC_KIND_PQ: {
+            TonPQ* pq = (TonPQ*)obj;
+            mark_value(&pq->less);
+            for (int i = 0; i < pq->size; i++) mark_value(&pq->data[i]);
+            break;
+        }
+        case GC_KIND_OMAP: {
+            // Keys are ints or strings; only the values in the leaves can hold objects
+            for (TonOMapLeaf* leaf = ((TonOMap*)obj)->first; leaf; leaf = leaf->next) {
+                for (int i = 0; i < leaf->node.count; i++) mark_value(&leaf->values[i]);
+            }
+            break;
+        }
+        case GC_KIND_PVEC:
+            mark_object(((TonPVec*)obj)->root);
+            mark_object(((TonPVec*)obj)->tail);
+            break;
+        case GC_KIND_PVEC_NODE: {
+            TonPVecNode* node = (TonPVecNode*)obj;
+            if (node->leaf) {
+                for (int i = 0; i < node->count; i++) mark_value(&node->slots.values[i]);
+            } else {
+                for (int i = 0; i < TONPVEC_WIDTH; i++) mark_object(node->slots.children[i]);
+            }
+            break;
+        }
+        case GC_KIND_PMAP:
+            mark_object(((TonPMap*)obj)->root);
+            break;
+        case GC_KIND_PMAP_NODE: {
+            TonPMapNode* node = (TonPMapNode*)obj;
+            for (int i = 0; i < node->entry_count; i++) {
+                mark_value(&node->entries[i].key);
+                mark_value(&node->entries[i].value);
+            }
+            for (int i = 0; i < node->child_count; i++) mark_object(node->children[i]);
+            break;
+        }
+        case GC_KIND_ART:
+            // Keys are plain strings; only the values in the leaves can hold objects
+            tonart_iter_prefix((TonART*)obj, "", mark_art_leaf, NULL);
+            break;
+        case GC_KIND_CACHE: {
+            TonCache* cache = (TonCache*)obj;
+            for (int i = 0; i < cache->entries_used; i++) {
+                if (cache->entries[i].key.type == VALUE_NULL) continue;
+                mark_value(&cache->entries[i].key);
+                mark_value(&cache->entries[i].value);
+            }
+            break;
+        }
+        case GC_KIND_SOA: {
+            // Only boxed columns can hold objects
+            TonSoA* soa = (TonSoA*)obj;
+            for (int i = 0; i < soa->type->num_fields; i++) {
+                if (soa->columns[i].kind != SOA_COLUMN_VALUE) continue;
+                for (int j = 0; j < soa->length; j++) mark_value(&soa->columns[i].data.values[j]);
+            }
+            break;
+        }
+        case GC_KIND_BLOOM:
+        case GC_KIND_HLL:
+        case GC_KIND_BITMAP:
+        case GC_KIND_DIGEST:
+            break; // Hashes and ints only
+        case GC_KIND_ARRAY: {
+            TonArray* arr = (TonArray*)obj;
+            if (arr->element_kind != ELEMENTS_BOXED) break;
+            for (size_t i = 0; i < arr->length; i++) mark_value(&arr->elements.boxed[i]);
+            break;
+        }
+        case GC_KIND_STRUCT: {
+            TonStructInstance* si = (TonStructInstance*)obj;
+            for (int i = 0; si->type && i < si->type->num_fields; i++) mark_value(&si->field_values[i]);
+            break;
+        }
+        case GC_KIND_FUNCTION:
+            mark_object(((Function*)obj)->closure_env);
+            break;
+        case GC_KIND_ENV: {
+            Environment* env = (Environment*)obj;
+            mark_object(env->parent);
+            mark_value(&env->self);
+            for (Symbol* s = env->variables; s; s = s->next) mark_value(&s->value);
+            for (FunctionSymbol* f = env->functions; f; f = f->next) {
+                if (f->func && f->func->type == USER_DEFINED) mark_object(f->func);
+            }
+            break;
+        }
+    }
+}
+
+/**
+ * Trace gray objects
+ * @param budget Maximum number of objects to trace (0 = until done)
+ * @return 1 if the mark stack is empty
+ */
+static int drain_mark_stack(size_t budget) {
+    size_t traced = 0;
+    while (mark_count > 0) {
+        if (budget && traced == budget) return 0;
+        GcHeader* h = mark_stack[--mark_count];
+        h->gray = 0;
+        trace_object(h);
+        traced++;
+    }
+    return 1;
+}
+
+static void mark_env_roots(GcHeader* head) {
+    // Environments still referenced by an active scope are roots
+    for (GcHeader* h = head; h; h = h->next) {
+        if (h->kind == GC_KIND_ENV && ((Environment*)GC_PAYLOAD(h))->ref_count > 0) {
+            mark_object(GC_PAYLOAD(h));
+        }
+    }
+}
+
+static void mark_roots(void) {
+    mark_env_roots(young_head);
+    if (!minor_marking) mark_env_roots(old_head);
+    for (int i = 0; i < root_count; i++) {
+        mark_value(root_stack[i]);
+    }
+}
+
+static void remember(GcHeader* h) {
+    if (remembered_count == remembered_capacity) {
+        size_t new_capacity = remembered_capacity ? remembered_capacity * 2 : 64;
+        GcHeader** grown = (GcHeader**)realloc(remembered, sizeof(GcHeader*) * new_capacity);
+        if (!grown) {
+            runtime_error("Failed to grow GC remembered set");
+            return;
+        }
+        remembered = grown;
+        remembered_capacity = new_capacity;
+    }
+    h->remembered = 1;
+    remembered[remembered_count++] = h;
+}
+
+static void clear_remembered(void) {
+    for (size_t i = 0; i < remembered_count; i++) remembered[i]->remembered = 0;
+    remembered_count = 0;
+}
+
+/**
+ * Record a store of a collected object into a collected owner. Keeps the
+ * remembered set and the incremental marking invariant intact.
+ * @param owner Payload pointer of the object written to
+ * @param target Payload pointer of the object stored (NULL for plain values)
+ */
+void gc_write_barrier_object(void* owner, void* target) {
+    if (!owner || !target) return;
+    GcHeader* h = GC_HEADER(owner);
+    if (phase == GC_PHASE_MARKING && h->marked) mark_object(target);
+    if (h->old && !h->remembered && !GC_HEADER(target)->old) remember(h);
+}
+
+/**
+ * Record a store of a value into a collected owner
+ * @param owner Payload pointer of the object written to
+ * @param value Value that was stored
+ */
+void gc_write_barrier(void* owner, const Value* value) {
+    gc_write_barrier_object(owner, value_object(value));
+}
+
+// ---------------------------------------------------------------------------
+// Sweeping
+
+static void finalize_object(GcHeader* h) {
+    void* obj = GC_PAYLOAD(h);
+    switch ((GcKind)h->kind) {
+        case GC_KIND_LIST:     tonlist_destroy((TonList*)obj); break;
+        case GC_KIND_MAP:      tonmap_destroy((TonMap*)obj); break;
+        case GC_KIND_SET:      gc_free(obj); break; // The backing map is swept on its own
+        case GC_KIND_DEQUE:    tondeque_destroy((TonDeque*)obj); break;
+        case GC_KIND_PQ:       tonpq_destroy((TonPQ*)obj); break;
+        case GC_KIND_OMAP:     tonomap_destroy((TonOMap*)obj); break;
+        case GC_KIND_PVEC:     tonpvec_destroy((TonPVec*)obj); break;
+        case GC_KIND_PVEC_NODE: tonpvec_node_destroy((TonPVecNode*)obj); break;
+        case GC_KIND_PMAP:     tonpmap_destroy((TonPMap*)obj); break;
+        case GC_KIND_PMAP_NODE: tonpmap_node_destroy((TonPMapNode*)obj); break;
+        case GC_KIND_BLOOM:    bloom_destroy((TonBloom*)obj); break;
+        case GC_KIND_HLL:      hll_destroy((TonHLL*)obj); break;
+        case GC_KIND_BITMAP:   bitmap_destroy((TonBitmap*)obj); break;
+        case GC_KIND_ART:      tonart_destroy((TonART*)obj); break;
+        case GC_KIND_CACHE:    toncache_destroy((TonCache*)obj); break;
+        case GC_KIND_SOA:      tonsoa_destroy((TonSoA*)obj); break;
+        case GC_KIND_DIGEST:   tondigest_destroy((TonDigest*)obj); break;
+        case GC_KIND_ARRAY:    destroy_array((TonArray*)obj); break;
+        case GC_KIND_STRUCT:   destroy_struct_instance((TonStructInstance*)obj); break;
+        case GC_KIND_FUNCTION: function_destroy((Function*)obj); break;
+        case GC_KIND_ENV:      env_destroy((Environment*)obj); break;
+    }
+}
+
+static size_t sweep_old(void) {
+    size_t freed = 0;
+    GcHeader* h = old_head;
+    while (h) {
+        GcHeader* next = h->next;
+        if (h->marked) {
+            h->marked = 0;
+        } else {
+            freed += h->size;
+            stats.freed_objects++;
+            stats.freed_bytes += h->size;
+            finalize_object(h);
+        }
+        h = next;
+    }
+    return freed;
+}
+
+// Free unmarked young objects and promote the survivors
+static size_t sweep_young(void) {
+    size_t freed = 0;
+    GcHeader* h = young_head;
+    while (h) {
+        GcHeader* next = h->next;
+        if (h->marked) {
+            h->marked = 0;
+            heap_unlink(&young_head, h);
+            h->old = 1;
+            heap_link(&old_head, h);
+            stats.promoted_objects++;
+            stats.promoted_bytes += h->size;
+            stats.young_objects--;
+            stats.young_bytes -= h->size;
+        } else {
+            freed += h->size;
+            stats.freed_objects++;
+            stats.freed_bytes += h->size;
+            finalize_object(h);
+        }
+        h = next;
+    }
+    // Nothing young is left, so no old object can point at one
+    clear_remembered();
+    return freed;
+}
+
+static void begin_major(void) {
+    major_requested = 0;
+    minor_requested = 0;
+    minor_marking = 0;
+    phase = GC_PHASE_MARKING;
+    mark_roots();
+}
+
+// Final atomic pause of a major cycle: rescan roots, finish marking, sweep
+static size_t finish_major(void) {
+    mark_roots();
+    drain_mark_stack(0);
+    size_t freed = sweep_old() + sweep_young();
+    phase = GC_PHASE_IDLE;
+    minor_requested = 0;
+
+    stats.major_collections++;
+    stats.collections++;
+
+    // Let the heap grow proportionally to what survived before collecting again
+    size_t in_use = ton_mem_usage();
+    next_collection_at = in_use * 2 > in_use + gc_threshold ? in_use * 2 : in_use + gc_threshold;
+    ton_mem_limit_rearm();
+    return freed;
+}
+
+static size_t collect_minor(void) {
+    minor_requested = 0;
+    minor_marking = 1;
+    mark_roots();
+    for (size_t i = 0; i < remembered_count; i++) {
+        trace_object(remembered[i]);
+    }
+    drain_mark_stack(0);
+    minor_marking = 0;
+    size_t freed = sweep_young();
+
+    stats.minor_collections++;
+    stats.collections++;
+    ton_mem_limit_rearm();
+    return freed;
+}
+
+/**
+ * Run a full collection, finishing any major cycle already in progress
+ * @return Number of payload bytes reclaimed
+ */
+size_t gc_collect(void) {
+    if (collecting) return 0;
+    collecting = 1;
+    size_t started = gc_now_us();
+
+    if (phase == GC_PHASE_IDLE) begin_major();
+    size_t freed = finish_major();
+
+    record_pause(started);
+    collecting = 0;
+    return freed;
+}
+
+/**
+ * Collect the young generation only
+ * @return Number of payload bytes reclaimed
+ */
+size_t gc_collect_minor(void) {
+    // A major cycle in progress already covers the young generation
+    if (collecting || phase != GC_PHASE_IDLE) return 0;
+    collecting = 1;
+    size_t started = gc_now_us();
+
+    size_t freed = collect_minor();
+
+    record_pause(started);
+    collecting = 0;
+    return freed;
+}
+
+/**
+ * Do pending collector work: one marking step of a major cycle, or a minor
+ * collection once the nursery is full
+ */
+void gc_safepoint(void) {
+    if (phase == GC_PHASE_IDLE && !major_requested && !minor_requested) return;
+    if (collecting) return;
+    collecting = 1;
+    size_t started = gc_now_us();
+
+    if (phase == GC_PHASE_IDLE && major_requested) {
+        begin_major();
+    }
+    if (phase == GC_PHASE_MARKING) {
+        stats.incremental_steps++;
+        if (drain_mark_stack(step_budget)) {
+            finish_major();
+        }
+    } else {
+        collect_minor();
+    }
+
+    record_pause(started);
+    collecting = 0;
+}
+
+/**
+ * Called once an allocation went past the hard heap limit: collect the whole
+ * heap and report whether usage is still over the limit. Clears the flag, so
+ * the caller raises at most one error per overrun.
+ * @return 1 if the heap is still over the hard limit
+ */
+int gc_check_heap_limit(void) {
+    if (!ton_mem_limit_exceeded()) return 0;
+    gc_collect();
+    if (!ton_mem_limit_exceeded()) return 0;
+    ton_mem_clear_limit_exceeded();
+    return 1;
+}
+
+void gc_set_threshold(size_t bytes) {
+    gc_threshold = bytes > 0 ? bytes : GC_DEFAULT_THRESHOLD;
+    next_collection_at = ton_mem_usage() + gc_threshold;
+}
+
+size_t gc_get_threshold(void) {
+    return gc_threshold;
+}
+
+void gc_set_nursery_size(size_t bytes) {
+    nursery_size = bytes > 0 ? bytes : GC_DEFAULT_NURSERY_SIZE;
+}
+
+size_t gc_get_nursery_size(void) {
+    return nursery_size;
+}
+
+/**
+ * Set how many objects a marking step may trace (0 disables incremental
+ * marking, so major cycles finish in a single pause)
+ * @param objects Objects traced per safepoint
+ */
+void gc_set_step_budget(size_t objects) {
+    step_budget = objects;
+}
+
+size_t gc_get_step_budget(void) {
+    return step_budget;
+}
+
+void gc_get_stats(GcStats* out) {
+    if (out) *out = stats;
+}
+
+/**
+ * Print collector statistics (also appended to ton_mem_report)
+ */
+void gc_print_stats(void) {
+    static const char* bucket_names[GC_PAUSE_BUCKETS] = {
+        "<10us", "<100us", "<1ms", "<10ms", "<100ms", ">=100ms"
+    };
+
+    printf("GC collections: %llu (%llu minor, %llu major, %llu marking steps)\n",
+           (unsigned long long)stats.collections, (unsigned long long)stats.minor_collections,
+           (unsigned long long)stats.major_collections, (unsigned long long)stats.incremental_steps);
+    printf("GC heap: %llu objects / %llu bytes live, %llu objects / %llu bytes young\n",
+           (unsigned long long)stats.live_objects, (unsigned long long)stats.live_bytes,
+           (unsigned long long)stats.young_objects, (unsigned long long)stats.young_bytes);
+    printf("GC promoted: %llu objects / %llu bytes, freed: %llu objects / %llu bytes\n",
+           (unsigned long long)stats.promoted_objects, (unsigned long long)stats.promoted_bytes,
+           (unsigned long long)stats.freed_objects, (unsigned long long)stats.freed_bytes);
+    printf("GC pauses: %llu us total, %llu us max\n",
+           (unsigned long long)stats.total_pause_us, (unsigned long long)stats.max_pause_us);
+    for (int i = 0; i < GC_PAUSE_BUCKETS; i++) {
+        printf("  %-8s %llu\n", bucket_names[i], (unsigned long long)stats.pause_histogram[i]);
+    }
+}
@@ -0,0 +1,105 @@
+#ifndef TON_GC_H
+#define TON_GC_H
+
+#include <stddef.h>
+#include "value.h"
+
+#define GC_DEFAULT_THRESHOLD (1024 * 1024)   // Heap growth (bytes) before the first collection
+#define GC_DEFAULT_NURSERY_SIZE (256 * 1024) // Young payload bytes before a minor collection
+#define GC_DEFAULT_STEP_BUDGET 1024          // Objects traced per incremental marking step
+#define GC_PAUSE_BUCKETS 6                   // <10us, <100us, <1ms, <10ms, <100ms, >=100ms
+
+/**
+ * Kinds of heap objects owned by the collector
+ */
+typedef enum {
+    GC_KIND_LIST,
+    GC_KIND_MAP,
+    GC_KIND_SET,
+    GC_KIND_DEQUE,
+    GC_KIND_PQ,
+    GC_KIND_OMAP,
+    GC_KIND_PVEC,
+    GC_KIND_PVEC_NODE,
+    GC_KIND_PMAP,
+    GC_KIND_PMAP_NODE,
+    GC_KIND_BLOOM,
+    GC_KIND_HLL,
+    GC_KIND_BITMAP,
+    GC_KIND_ART,
+    GC_KIND_CACHE,
+    GC_KIND_SOA,
+    GC_KIND_DIGEST,
+    GC_KIND_ARRAY,
+    GC_KIND_STRUCT,
+    GC_KIND_FUNCTION,
+    GC_KIND_ENV
+} GcKind;
+
+/**
+ * Header prepended to every collected object
+ */
+typedef struct GcHeader {
+    struct GcHeader* prev;        // Previous object in the heap list
+    struct GcHeader* next;        // Next object in the heap list
+    size_t size;                  // Payload size in bytes
+    unsigned char kind;           // GcKind of the payload
+    unsigned char marked;         // Mark bit for the current cycle
+    unsigned char old;            // Set once the object survived a collection
+    unsigned char gray;           // Waiting on the mark stack to be traced
+    unsigned char remembered;     // Old object in the remembered set
+} GcHeader;
+
+/**
+ * Collector statistics
+ */
+typedef struct GcStats {
+    size_t collections;           // Completed collection cycles (minor + major)
+    size_t minor_collections;     // Young-generation collections
+    size_t major_collections;     // Full-heap collections
+    size_t incremental_steps;     // Budgeted marking steps taken by major cycles
+    size_t live_objects;          // Objects currently on the heap lists
+    size_t live_bytes;            // Payload bytes of those objects
+    size_t young_objects;         // Objects allocated since the last collection
+    size_t young_bytes;           // Payload bytes of those objects
+    size_t promoted_objects;      // Objects moved to the old generation
+    size_t promoted_bytes;        // Payload bytes moved to the old generation
+    size_t freed_objects;         // Objects reclaimed over the whole run
+    size_t freed_bytes;           // Payload bytes reclaimed over the whole run
+    size_t pause_histogram[GC_PAUSE_BUCKETS]; // Pause counts per latency bucket
+    size_t total_pause_us;        // Time spent inside the collector
+    size_t max_pause_us;          // Longest single pause
+} GcStats;
+
+// Object allocation (gc_alloc records the caller for the allocation profiler)
+void* gc_alloc_at(GcKind kind, size_t size, const char* file, int line);
+#define gc_alloc(kind, size) gc_alloc_at((kind), (size), __FILE__, __LINE__)
+void  gc_free(void* obj);
+// Recycling: gc_detach takes an object off the heap without freeing it, and
+// gc_reuse puts it back as a newly allocated object with a zeroed payload
+void  gc_detach(void* obj);
+void* gc_reuse(void* obj);
+
+// Roots for temporaries held in C locals across calls that may collect
+void gc_push_root(Value* slot);
+void gc_pop_roots(int count);
+
+// Must be called after storing a value into a collected object
+void gc_write_barrier(void* owner, const Value* value);
+void gc_write_barrier_object(void* owner, void* target);
+
+// Collection control
+void   gc_safepoint(void);
+size_t gc_collect(void);
+size_t gc_collect_minor(void);
+int    gc_check_heap_limit(void);
+void   gc_set_threshold(size_t bytes);
+size_t gc_get_threshold(void);
+void   gc_set_nursery_size(size_t bytes);
+size_t gc_get_nursery_size(void);
+void   gc_set_step_budget(size_t objects);
+size_t gc_get_step_budget(void);
+void   gc_get_stats(GcStats* out);
+void   gc_print_stats(void);
+
+#endif // TON_GC_H
@@ -0,0 +1,165 @@
+#include "hash.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// wyhash: 64x64->128 multiply-and-fold over 8-byte words. Strings of up to
+// 16 bytes cost a single multiply round, longer ones consume 48 bytes per
+// iteration across three independent lanes.
+
+static const uint64_t WYP0 = 0x2d358dccaa6c78a5ULL;
+static const uint64_t WYP1 = 0x8bb84b93962eacc9ULL;
+static const uint64_t WYP2 = 0x4b33a62ed433d4a3ULL;
+static const uint64_t WYP3 = 0x4d5a2da51de1aa47ULL;
+
+static uint64_t process_seed = 0;
+static int seed_ready = 0;
+static uint64_t seed_counter = 0;
+
+static inline void wymum(uint64_t* a, uint64_t* b) {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t)*a * *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32);
+    uint64_t c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static inline uint64_t wymix(uint64_t a, uint64_t b) {
+    wymum(&a, &b);
+    return a ^ b;
+}
+
+// Unaligned native-endian loads; memcpy compiles to a single mov
+static inline uint64_t read64(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t read32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t read_small(const uint8_t* p, size_t k) {
+    return ((uint64_t)p[0] << 16) | ((uint64_t)p[k >> 1] << 8) | p[k - 1];
+}
+
+/**
+ * Hash a byte string
+ * @param data Bytes to hash
+ * @param len Number of bytes
+ * @param seed Hash seed; different seeds give unrelated hash functions
+ * @return 64-bit hash
+ */
+uint64_t ton_hash_bytes(const void* data, size_t len, uint64_t seed) {
+    const uint8_t* p = (const uint8_t*)data;
+    uint64_t a, b;
+    seed ^= wymix(seed ^ WYP0, WYP1);
+
+    if (len <= 16) {
+        if (len >= 4) {
+            a = (read32(p) << 32) | read32(p + ((len >> 3) << 2));
+            b = (read32(p + len - 4) << 32) | read32(p + len - 4 - ((len >> 3) << 2));
+        } else if (len > 0) {
+            a = read_small(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i >= 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = wymix(read64(p) ^ WYP1, read64(p + 8) ^ seed);
+                see1 = wymix(read64(p + 16) ^ WYP2, read64(p + 24) ^ see1);
+                see2 = wymix(read64(p + 32) ^ WYP3, read64(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i >= 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = wymix(read64(p) ^ WYP1, read64(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = read64(p + i - 16);
+        b = read64(p + i - 8);
+    }
+
+    a ^= WYP1;
+    b ^= seed;
+    wymum(&a, &b);
+    return wymix(a ^ WYP0 ^ len, b ^ WYP1);
+}
+
+/**
+ * Hash a single 64-bit word (same result as ton_hash_bytes over its 8 bytes
+ * on little-endian machines)
+ * @param x Word to hash
+ * @param seed Hash seed
+ * @return 64-bit hash
+ */
+uint64_t ton_hash_u64(uint64_t x, uint64_t seed) {
+    seed ^= wymix(seed ^ WYP0, WYP1);
+    uint64_t a = ((x & 0xFFFFFFFFULL) << 32) | (x >> 32);
+    uint64_t b = x;
+    a ^= WYP1;
+    b ^= seed;
+    wymum(&a, &b);
+    return wymix(a ^ WYP0 ^ 8, b ^ WYP1);
+}
+
+// Entropy for the process seed: the OS generator where there is one, mixed
+// with wall-clock time, CPU time and (address-space randomized) addresses.
+static uint64_t random_seed(void) {
+    uint64_t seed = 0;
+#if !defined(_WIN32)
+    FILE* urandom = fopen("/dev/urandom", "rb");
+    if (urandom) {
+        if (fread(&seed, 1, sizeof(seed), urandom) != sizeof(seed)) seed = 0;
+        fclose(urandom);
+    }
+#endif
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    seed ^= wymix((uint64_t)ts.tv_sec ^ WYP0, (uint64_t)ts.tv_nsec ^ WYP1);
+    seed ^= wymix((uint64_t)(uintptr_t)&ts ^ WYP2, (uint64_t)(uintptr_t)&process_seed ^ WYP3);
+    seed ^= wymix((uint64_t)clock() ^ WYP1, seed ^ WYP2);
+    return seed;
+}
+
+uint64_t ton_hash_seed(void) {
+    if (!seed_ready) {
+        process_seed = random_seed();
+        seed_ready = 1;
+    }
+    return process_seed;
+}
+
+/**
+ * Fix the process seed (reproducible runs and benchmarks)
+ * @param seed New seed; affects tables created afterwards
+ */
+void ton_hash_set_seed(uint64_t seed) {
+    process_seed = seed;
+    seed_ready = 1;
+    seed_counter = 0;
+}
+
+uint64_t ton_hash_next_seed(void) {
+    seed_counter += WYP0;
+    return wymix(ton_hash_seed() ^ seed_counter, WYP3 ^ (seed_counter << 1));
+}
@@ -0,0 +1,21 @@
+#ifndef TON_HASH_H
+#define TON_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Non-cryptographic keyed hashing for collections (wyhash construction).
+// Every process picks a random seed on first use so hash values, and with
+// them bucket collisions, cannot be predicted from outside.
+
+uint64_t ton_hash_bytes(const void* data, size_t len, uint64_t seed);
+uint64_t ton_hash_u64(uint64_t x, uint64_t seed);
+
+// Process-wide seed, randomized on first use unless set explicitly
+uint64_t ton_hash_seed(void);
+void ton_hash_set_seed(uint64_t seed);
+
+// Fresh seed derived from the process seed (per-table seeds, reseeding)
+uint64_t ton_hash_next_seed(void);
+
+#endif // TON_HASH_H
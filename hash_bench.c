@@ -0,0 +1,159 @@
+#include "hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Standalone benchmark for the collection hash: gcc -O2 hash_bench.c hash.c
+// Compares the old byte-at-a-time djb2 with ton_hash_bytes on the key shapes
+// maps see in practice, checks how evenly each spreads keys over buckets,
+// and counts distinct hashes over a family of djb2 collisions.
+
+#define BENCH_KEYS 200000
+#define BENCH_ROUNDS 20
+#define BUCKET_BITS 16
+#define FLOOD_BITS 16
+
+typedef uint64_t (*HashFn)(const char* key, size_t len, uint64_t seed);
+
+static uint64_t hash_djb2(const char* key, size_t len, uint64_t seed) {
+    (void)seed;
+    uint64_t hash = 5381;
+    for (size_t i = 0; i < len; i++) {
+        hash = ((hash << 5) + hash) + (unsigned char)key[i];
+    }
+    return hash;
+}
+
+static uint64_t hash_wy(const char* key, size_t len, uint64_t seed) {
+    return ton_hash_bytes(key, len, seed);
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t next_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+// Key shapes: decimal ids, short identifiers, and long URL-like paths
+static char* make_key(int shape, int i) {
+    char buffer[512];
+    switch (shape) {
+        case 0:
+            snprintf(buffer, sizeof(buffer), "%d", i);
+            break;
+        case 1:
+            snprintf(buffer, sizeof(buffer), "user_%08x", (unsigned)next_random());
+            break;
+        default: {
+            int n = snprintf(buffer, sizeof(buffer), "/api/v2/accounts/%d/orders/", i);
+            while (n < 200) {
+                n += snprintf(buffer + n, sizeof(buffer) - (size_t)n, "%c", 'a' + (int)(next_random() % 26));
+            }
+            break;
+        }
+    }
+    size_t len = strlen(buffer);
+    char* key = malloc(len + 1);
+    memcpy(key, buffer, len + 1);
+    return key;
+}
+
+static const char* shape_names[] = { "decimal ids", "identifiers", "200-byte paths" };
+
+// Chi-square of the bucket counts against a uniform spread (about 1.0 is ideal)
+static double bucket_chi(HashFn fn, char** keys, size_t* lens, int count, int shift) {
+    size_t buckets = (size_t)1 << BUCKET_BITS;
+    unsigned* counts = calloc(buckets, sizeof(unsigned));
+    for (int i = 0; i < count; i++) {
+        counts[(fn(keys[i], lens[i], 42) >> shift) & (buckets - 1)]++;
+    }
+    double expected = (double)count / (double)buckets;
+    double chi = 0;
+    for (size_t b = 0; b < buckets; b++) {
+        double d = (double)counts[b] - expected;
+        chi += d * d / expected;
+    }
+    free(counts);
+    return chi / (double)buckets;
+}
+
+static void bench_shape(int shape) {
+    char** keys = malloc(sizeof(char*) * BENCH_KEYS);
+    size_t* lens = malloc(sizeof(size_t) * BENCH_KEYS);
+    size_t bytes = 0;
+    for (int i = 0; i < BENCH_KEYS; i++) {
+        keys[i] = make_key(shape, i);
+        lens[i] = strlen(keys[i]);
+        bytes += lens[i];
+    }
+
+    HashFn fns[] = { hash_djb2, hash_wy };
+    const char* names[] = { "djb2", "wyhash" };
+    printf("%s (%d keys, %.1f bytes avg)\n", shape_names[shape], BENCH_KEYS, (double)bytes / BENCH_KEYS);
+    for (int f = 0; f < 2; f++) {
+        volatile uint64_t sink = 0;
+        double start = now_seconds();
+        for (int r = 0; r < BENCH_ROUNDS; r++) {
+            for (int i = 0; i < BENCH_KEYS; i++) sink ^= fns[f](keys[i], lens[i], (uint64_t)r);
+        }
+        double elapsed = now_seconds() - start;
+        double total = (double)BENCH_KEYS * BENCH_ROUNDS;
+        // Low bits and the bits TonMap uses for its probe start (hash >> 7)
+        printf("  %-7s %7.2f ns/key %8.1f MB/s   chi low %.2f   chi >>7 %.2f\n", names[f],
+               elapsed * 1e9 / total, (double)bytes * BENCH_ROUNDS / elapsed / 1e6,
+               bucket_chi(fns[f], keys, lens, BENCH_KEYS, 0),
+               bucket_chi(fns[f], keys, lens, BENCH_KEYS, 7));
+    }
+
+    for (int i = 0; i < BENCH_KEYS; i++) free(keys[i]);
+    free(keys);
+    free(lens);
+}
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+// "BA" and "Ab" collide under djb2 from any equal prefix state, so every
+// string built from those blocks shares one hash
+static void bench_flood(void) {
+    size_t count = (size_t)1 << FLOOD_BITS;
+    HashFn fns[] = { hash_djb2, hash_wy };
+    const char* names[] = { "djb2", "wyhash" };
+    uint64_t* hashes = malloc(sizeof(uint64_t) * count);
+    char key[2 * FLOOD_BITS + 1];
+
+    printf("flood (%zu strings colliding under djb2)\n", count);
+    for (int f = 0; f < 2; f++) {
+        uint64_t seed = ton_hash_seed();
+        for (size_t i = 0; i < count; i++) {
+            for (int bit = 0; bit < FLOOD_BITS; bit++) {
+                memcpy(key + 2 * bit, (i >> bit) & 1 ? "Ab" : "BA", 2);
+            }
+            key[2 * FLOOD_BITS] = '\0';
+            hashes[i] = fns[f](key, 2 * FLOOD_BITS, seed);
+        }
+        qsort(hashes, count, sizeof(uint64_t), compare_u64);
+        size_t distinct = 1;
+        for (size_t i = 1; i < count; i++) distinct += hashes[i] != hashes[i - 1];
+        printf("  %-7s %zu distinct hashes\n", names[f], distinct);
+    }
+    free(hashes);
+}
+
+int main(void) {
+    for (int shape = 0; shape < 3; shape++) bench_shape(shape);
+    bench_flood();
+    return 0;
+}
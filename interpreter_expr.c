@@ -7,16 +7,410 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "memory.h"
+#include "gc.h"
+#include "alloc_profile.h"
 #include "interpreter_stmt.h"
 #include "array.h"
 #include "collections.h"
+#include "persistent.h"
 #include "io.h"
 #include "builtin_tonlib.h"
 #include "builtin_crypto.h"
+#include "builtin_memory.h"
+#include "builtin_sort.h"
+#include "builtin_queue.h"
+#include "builtin_persistent.h"
+#include "builtin_sketch.h"
+#include "builtin_cache.h"
+#include "builtin_soa.h"
+#include "soa.h"
 #include "interpreter_macro.h"
 #include "bitops.h"
 
+// Result of `left op= right` for the compound assignment operators
+static TonError apply_compound_assignment(TokenType op, Value left_val, Value right_val, ASTNode* node, Value* out) {
+    switch (op) {
+        case TOKEN_PLUS_ASSIGN:
+            if (left_val.type == VALUE_INT && right_val.type == VALUE_INT) {
+                *out = create_value_int(left_val.data.int_val + right_val.data.int_val);
+            } else if (left_val.type == VALUE_FLOAT && right_val.type == VALUE_FLOAT) {
+                *out = create_value_float(left_val.data.float_val + right_val.data.float_val);
+            } else {
+                return ton_error(TON_ERR_TYPE, "Unsupported types for +=", node->line, node->column, __FILE__);
+            }
+            break;
+        case TOKEN_MINUS_ASSIGN:
+            if (left_val.type == VALUE_INT && right_val.type == VALUE_INT) {
+                *out = create_value_int(left_val.data.int_val - right_val.data.int_val);
+            } else if (left_val.type == VALUE_FLOAT && right_val.type == VALUE_FLOAT) {
+                *out = create_value_float(left_val.data.float_val - right_val.data.float_val);
+            } else {
+                return ton_error(TON_ERR_TYPE, "Unsupported types for -=", node->line, node->column, __FILE__);
+            }
+            break;
+        case TOKEN_STAR_ASSIGN:
+            if (left_val.type == VALUE_INT && right_val.type == VALUE_INT) {
+                *out = create_value_int(left_val.data.int_val * right_val.data.int_val);
+            } else if (left_val.type == VALUE_FLOAT && right_val.type == VALUE_FLOAT) {
+                *out = create_value_float(left_val.data.float_val * right_val.data.float_val);
+            } else {
+                return ton_error(TON_ERR_TYPE, "Unsupported types for *=", node->line, node->column, __FILE__);
+            }
+            break;
+        case TOKEN_SLASH_ASSIGN:
+            if (left_val.type == VALUE_INT && right_val.type == VALUE_INT) {
+                if (right_val.data.int_val == 0) return ton_error(TON_ERR_RUNTIME, "Division by zero", node->line, node->column, __FILE__);
+                *out = create_value_int(left_val.data.int_val / right_val.data.int_val);
+            } else if (left_val.type == VALUE_FLOAT && right_val.type == VALUE_FLOAT) {
+                if (right_val.data.float_val == 0.0) return ton_error(TON_ERR_RUNTIME, "Division by zero", node->line, node->column, __FILE__);
+                *out = create_value_float(left_val.data.float_val / right_val.data.float_val);
+            } else {
+                return ton_error(TON_ERR_TYPE, "Unsupported types for /=", node->line, node->column, __FILE__);
+            }
+            break;
+        case TOKEN_MODULO_ASSIGN:
+             if (left_val.type == VALUE_INT && right_val.type == VALUE_INT) {
+                if (right_val.data.int_val == 0) return ton_error(TON_ERR_RUNTIME, "Division by zero", node->line, node->column, __FILE__);
+                *out = create_value_int(left_val.data.int_val % right_val.data.int_val);
+            } else {
+                return ton_error(TON_ERR_TYPE, "Unsupported types for %=", node->line, node->column, __FILE__);
+            }
+            break;
+        default: // Should not happen
+            return ton_error(TON_ERR_RUNTIME, "Unhandled compound assignment", node->line, node->column, __FILE__);
+    }
+    return ton_ok();
+}
+
+// Number of elements an indexable value holds; -1 if it cannot be indexed
+static long indexable_length(const Value* container) {
+    switch (container->type) {
+        case VALUE_ARRAY:   return (long)((TonArray*)container->data.array_val)->length;
+        case VALUE_TONLIST: return tonlist_size((TonList*)container->data.tonlist_val);
+        case VALUE_TONPVEC: return tonpvec_size((TonPVec*)container->data.tonpvec_val);
+        case VALUE_TONSOA:  return tonsoa_size((TonSoA*)container->data.tonsoa_val);
+        case VALUE_STRING:  return container->data.string_val ? (long)strlen(container->data.string_val) : 0;
+        default:            return -1;
+    }
+}
+
+// Validate `container[index]`. Accesses marked bounds_hoisted sit in a counted
+// loop whose condition already proved 0 <= index < len, so they skip the range
+// check (for strings that also saves a strlen per access).
+static TonError check_index(const Value* container, const Value* index, ArrayAccessExpressionNode* access) {
+    ASTNode* node = (ASTNode*)access;
+    // TonError keeps a pointer to its message, so formatted ones need static storage
+    static char error_msg[128];
+    if (container->type != VALUE_ARRAY && container->type != VALUE_TONLIST && container->type != VALUE_TONPVEC &&
+        container->type != VALUE_TONSOA && container->type != VALUE_STRING) {
+        snprintf(error_msg, sizeof(error_msg), "Value of type %s is not indexable", value_type_to_string(container->type));
+        return ton_error(TON_ERR_TYPE, error_msg, node->line, node->column, __FILE__);
+    }
+    if (index->type != VALUE_INT) {
+        return ton_error(TON_ERR_TYPE, "Index must be an int", node->line, node->column, __FILE__);
+    }
+    if (access->bounds_hoisted) return ton_ok();
+
+    long length = indexable_length(container);
+    if (index->data.int_val < 0 || index->data.int_val >= length) {
+        snprintf(error_msg, sizeof(error_msg), "Index %d out of range for length %ld", index->data.int_val, length);
+        return ton_error(TON_ERR_INDEX, error_msg, node->line, node->column, __FILE__);
+    }
+    return ton_ok();
+}
+
+// Element at a checked index. Boxed elements are returned borrowed from the
+// container; the caller copies them if it keeps them. A struct-of-arrays
+// element is gathered into a new instance, so writes to it do not reach the
+// columns; member access on `arr[i]` goes to the columns directly instead.
+static Value load_indexed(const Value* container, int index) {
+    switch (container->type) {
+        case VALUE_ARRAY:   return array_get((TonArray*)container->data.array_val, (size_t)index);
+        case VALUE_TONLIST: return tonlist_get((TonList*)container->data.tonlist_val, index);
+        case VALUE_TONPVEC: return tonpvec_get((TonPVec*)container->data.tonpvec_val, index);
+        case VALUE_TONSOA: {
+            TonStructInstance* si = tonsoa_get((TonSoA*)container->data.tonsoa_val, index);
+            return si ? create_value_struct(si) : create_value_null();
+        }
+        default:            return create_value_char(container->data.string_val[index]);
+    }
+}
+
+static TonError store_indexed(Value* container, int index, Value value, ASTNode* node) {
+    int stored;
+    if ((container->type == VALUE_ARRAY && ((TonArray*)container->data.array_val)->locked) ||
+        (container->type == VALUE_TONLIST && ((TonList*)container->data.tonlist_val)->locked)) {
+        return ton_error(TON_ERR_RUNTIME, "Cannot modify a list or array while it is being sorted", node->line, node->column, __FILE__);
+    }
+    if (container->type == VALUE_TONPVEC) {
+        return ton_error(TON_ERR_TYPE, "Persistent vectors are immutable; use pvec_set", node->line, node->column, __FILE__);
+    }
+    switch (container->type) {
+        case VALUE_ARRAY:
+            stored = array_set((TonArray*)container->data.array_val, (size_t)index, value);
+            break;
+        case VALUE_TONLIST:
+            stored = tonlist_set((TonList*)container->data.tonlist_val, index, value);
+            break;
+        case VALUE_TONSOA: {
+            TonSoA* soa = (TonSoA*)container->data.tonsoa_val;
+            TonStructInstance* si = value.type == VALUE_STRUCT ? (TonStructInstance*)value.data.struct_val : NULL;
+            if (!si || si->type != soa->type || !tonsoa_set(soa, index, si)) {
+                return ton_error(TON_ERR_TYPE, "Only instances of the array's class can be stored in a struct-of-arrays",
+                                 node->line, node->column, __FILE__);
+            }
+            return ton_ok();
+        }
+        default:
+            // Strings are edited in place; the variable owns its buffer
+            if (value.type != VALUE_CHAR || value.data.char_val == '\0') {
+                return ton_error(TON_ERR_TYPE, "Only non-NUL chars can be stored in a string", node->line, node->column, __FILE__);
+            }
+            container->data.string_val[index] = value.data.char_val;
+            return ton_ok();
+    }
+    if (!stored) {
+        return ton_error(TON_ERR_MEMORY, "Failed to store element", node->line, node->column, __FILE__);
+    }
+    return ton_ok();
+}
+
+// Evaluate the container of an indexed assignment. A nested access such as
+// `grid[r][c] = v` must reach the stored row, not a copy of it, so element
+// containers are borrowed; *borrowed tells the caller not to release them.
+static TonError evaluate_index_target(ASTNode* expr, Environment* env, Value* out, int* borrowed) {
+    *borrowed = 0;
+    if (expr->type != NODE_ARRAY_ACCESS_EXPRESSION) {
+        return interpret_expression(expr, env, out);
+    }
+    ArrayAccessExpressionNode* access = (ArrayAccessExpressionNode*)expr;
+    Value container;
+    int container_borrowed;
+    TonError err = evaluate_index_target(access->array, env, &container, &container_borrowed);
+    if (err.code != TON_OK) return err;
+
+    Value index;
+    gc_push_root(&container);
+    err = interpret_expression(access->index, env, &index);
+    gc_pop_roots(1);
+    if (err.code == TON_OK) err = check_index(&container, &index, access);
+    if (err.code == TON_OK) {
+        *out = load_indexed(&container, index.data.int_val);
+        *borrowed = 1;
+    }
+    value_release(&index);
+    if (!container_borrowed) value_release(&container);
+    return err;
+}
+
+// `a[i] = v` and the compound forms `a[i] op= v`
+static TonError assign_indexed(BinaryExpressionNode* bin_node, Environment* env, Value* out_result) {
+    ASTNode* node = (ASTNode*)bin_node;
+    ArrayAccessExpressionNode* access = (ArrayAccessExpressionNode*)bin_node->left;
+
+    Value container;
+    int borrowed;
+    TonError err = evaluate_index_target(access->array, env, &container, &borrowed);
+    if (err.code != TON_OK) return err;
+    gc_push_root(&container);
+
+    Value index = create_value_null();
+    Value right_val = create_value_null();
+    err = interpret_expression(access->index, env, &index);
+    if (err.code == TON_OK) {
+        gc_push_root(&index);
+        err = interpret_expression(bin_node->right, env, &right_val);
+        gc_pop_roots(1);
+    }
+    // The right-hand side may have resized the container, so check afterwards
+    if (err.code == TON_OK) err = check_index(&container, &index, access);
+
+    if (err.code == TON_OK && bin_node->operator->type != TOKEN_ASSIGN) {
+        Value current = load_indexed(&container, index.data.int_val);
+        Value new_val;
+        err = apply_compound_assignment(bin_node->operator->type, current, right_val, node, &new_val);
+        if (err.code == TON_OK) {
+            value_release(&right_val);
+            right_val = new_val;
+        }
+    }
+    if (err.code == TON_OK) err = store_indexed(&container, index.data.int_val, right_val, node);
+
+    gc_pop_roots(1);
+    value_release(&index);
+    if (!borrowed) value_release(&container);
+    if (err.code != TON_OK) {
+        value_release(&right_val);
+        return err;
+    }
+    *out_result = right_val;
+    return ton_ok();
+}
+
+// Slot of the accessed field in `type`, -1 if it has none. The node
+// remembers the last type it saw, so while that type keeps coming back the
+// access is a pointer compare and an array index.
+static int member_slot(MemberAccessExpressionNode* member, const TonStructType* type) {
+    if (member->cached_type != type) {
+        int slot = struct_field_slot(type, member->member);
+        if (slot < 0) return -1;
+        member->cached_type = type;
+        member->cached_slot = slot;
+    }
+    return member->cached_slot;
+}
+
+static TonError missing_field(const TonStructType* type, const char* field, ASTNode* node) {
+    static char error_msg[128];
+    snprintf(error_msg, sizeof(error_msg), "Field '%s' not found in struct '%s'.", field, type->name);
+    return ton_error(TON_ERR_RUNTIME, error_msg, node->line, node->column, __FILE__);
+}
+
+// Evaluate the object of `obj.f`. When it is `arr[i]` on a struct-of-arrays,
+// *out is the array itself and *element the checked index, so the field is
+// read or written in its column; otherwise *element is -1.
+static TonError evaluate_member_object(MemberAccessExpressionNode* member, Environment* env, Value* out, int* element) {
+    *element = -1;
+    if (member->object->type != NODE_ARRAY_ACCESS_EXPRESSION) {
+        return interpret_expression(member->object, env, out);
+    }
+    ArrayAccessExpressionNode* access = (ArrayAccessExpressionNode*)member->object;
+    Value container;
+    TonError err = interpret_expression(access->array, env, &container);
+    if (err.code != TON_OK) return err;
+
+    Value index;
+    gc_push_root(&container);
+    err = interpret_expression(access->index, env, &index);
+    gc_pop_roots(1);
+    if (err.code == TON_OK) err = check_index(&container, &index, access);
+    if (err.code == TON_OK && container.type == VALUE_TONSOA) {
+        *out = container;
+        *element = index.data.int_val;
+        value_release(&index);
+        return ton_ok();
+    }
+    if (err.code == TON_OK) {
+        Value loaded = load_indexed(&container, index.data.int_val);
+        *out = value_copy(&loaded);
+    }
+    value_release(&index);
+    value_release(&container);
+    return err;
+}
+
+static TonError column_mismatch(const TonSoA* soa, int slot, ASTNode* node) {
+    static char error_msg[128];
+    snprintf(error_msg, sizeof(error_msg), "Value does not fit field '%s' (%s) of a struct-of-arrays.",
+             soa->type->fields[slot].name, soa->type->fields[slot].type_name);
+    return ton_error(TON_ERR_TYPE, error_msg, node->line, node->column, __FILE__);
+}
+
+// Field of `this` named by a bare identifier inside a method, or NULL; cached
+// on the identifier node like member_slot
+static Value* this_field(IdentifierExpressionNode* id, Environment* env, TonStructInstance** owner) {
+    Value* this_val = env_get_this(env);
+    if (!this_val || this_val->type != VALUE_STRUCT) return NULL;
+    TonStructInstance* instance = this_val->data.struct_val;
+    if (id->this_type != instance->type) {
+        int slot = struct_field_slot(instance->type, id->identifier);
+        if (slot < 0) return NULL;
+        id->this_type = instance->type;
+        id->this_slot = slot;
+    }
+    *owner = instance;
+    return &instance->field_values[id->this_slot];
+}
+
+// Store the right-hand side of `field = v` or `field op= v` into a field slot
+static TonError store_field(TonStructInstance* instance, int slot, BinaryExpressionNode* bin_node, Value* right_val) {
+    if (bin_node->operator->type != TOKEN_ASSIGN) {
+        Value new_val;
+        TonError err = apply_compound_assignment(bin_node->operator->type, instance->field_values[slot], *right_val,
+                                                 (ASTNode*)bin_node, &new_val);
+        if (err.code != TON_OK) return err;
+        value_release(right_val);
+        *right_val = new_val;
+    }
+    value_release(&instance->field_values[slot]);
+    instance->field_values[slot] = value_copy(right_val);
+    gc_write_barrier(instance, right_val);
+    return ton_ok();
+}
+
+// Method a call site invokes on instances of `type`. Hits are a scan of at
+// most METHOD_CACHE_SIZE type pointers; misses go to the type's vtable.
+static StructMethod* cached_method(MethodCallExpressionNode* call, const TonStructType* type) {
+    int count = call->cache_count < METHOD_CACHE_SIZE ? call->cache_count : METHOD_CACHE_SIZE;
+    for (int i = 0; i < count; ++i) {
+        if (call->cache[i].type == type) return call->cache[i].method;
+    }
+    StructMethod* method = struct_find_method(type, call->method_name);
+    if (method && call->cache_count <= METHOD_CACHE_SIZE) {
+        if (call->cache_count < METHOD_CACHE_SIZE) {
+            call->cache[call->cache_count].type = type;
+            call->cache[call->cache_count].method = method;
+        }
+        call->cache_count++; // Past METHOD_CACHE_SIZE the site is megamorphic
+    }
+    return method;
+}
+
+// `obj.f = v` and the compound forms `obj.f op= v`
+static TonError assign_member(BinaryExpressionNode* bin_node, Environment* env, Value* out_result) {
+    ASTNode* node = (ASTNode*)bin_node;
+    MemberAccessExpressionNode* member = (MemberAccessExpressionNode*)bin_node->left;
+
+    Value object_val;
+    int element;
+    TonError err = evaluate_member_object(member, env, &object_val, &element);
+    if (err.code != TON_OK) return err;
+    if (object_val.type != VALUE_STRUCT && element < 0) {
+        value_release(&object_val);
+        return ton_error(TON_ERR_TYPE, "Member access operator (.) can only be used on structs.", node->line, node->column, __FILE__);
+    }
 
+    Value right_val;
+    gc_push_root(&object_val);
+    err = interpret_expression(bin_node->right, env, &right_val);
+    gc_pop_roots(1);
+    if (err.code != TON_OK) {
+        value_release(&object_val);
+        return err;
+    }
+
+    if (element >= 0) {
+        TonSoA* soa = (TonSoA*)object_val.data.tonsoa_val;
+        int slot = member_slot(member, soa->type);
+        if (slot < 0) {
+            err = missing_field(soa->type, member->member, node);
+        } else {
+            if (bin_node->operator->type != TOKEN_ASSIGN) {
+                Value new_val;
+                err = apply_compound_assignment(bin_node->operator->type, tonsoa_get_field(soa, element, slot), right_val,
+                                                node, &new_val);
+                if (err.code == TON_OK) {
+                    value_release(&right_val);
+                    right_val = new_val;
+                }
+            }
+            if (err.code == TON_OK && !tonsoa_set_field(soa, element, slot, right_val)) {
+                err = column_mismatch(soa, slot, node);
+            }
+        }
+    } else {
+        TonStructInstance* instance = object_val.data.struct_val;
+        int slot = member_slot(member, instance->type);
+        err = slot < 0 ? missing_field(instance->type, member->member, node) : store_field(instance, slot, bin_node, &right_val);
+    }
+    value_release(&object_val);
+    if (err.code != TON_OK) {
+        value_release(&right_val);
+        return err;
+    }
+    *out_result = right_val;
+    return ton_ok();
+}
 
 TonError interpret_expression(ASTNode* node, Environment* env, Value* out_result) {
     if (!node || !env || !out_result) {
@@ -52,6 +446,16 @@ TonError interpret_expression(ASTNode* node, Environment* env, Value* out_result
         case NODE_IDENTIFIER_EXPRESSION: {
             IdentifierExpressionNode* id_expr = (IdentifierExpressionNode*)node;
 
+            if (id_expr->is_this) {
+                Value* self = env_get_this(env);
+                if (!self) {
+                    return ton_error(TON_ERR_RUNTIME, "'this' used outside a method", node->line, node->column, __FILE__);
+                }
+                *out_result = *self;
+                value_add_ref(out_result);
+                return ton_ok();
+            }
+
             // First try to find as a variable
             Value* var = env_get_variable(env, id_expr->identifier);
             if (var) {
@@ -67,16 +471,13 @@ TonError interpret_expression(ASTNode* node, Environment* env, Value* out_result
                 return ton_ok();
             }
             
-            // Check for 'this' and field access only if we haven't found the identifier yet
-            Value* this_val = env_get_variable(env, "this");
-            if (this_val && this_val->type == VALUE_STRUCT) {
-                TonStructInstance* instance = this_val->data.struct_val;
-                Value field_val = struct_get_field(instance, id_expr->identifier);
-                if (field_val.type != VALUE_NULL) {
-                    *out_result = field_val;
-                    value_add_ref(out_result);
-                    return ton_ok();
-                }
+            // Inside a method, a bare name may be a field of `this`
+            TonStructInstance* owner;
+            Value* field = this_field(id_expr, env, &owner);
+            if (field) {
+                *out_result = *field;
+                value_add_ref(out_result);
+                return ton_ok();
             }
             
             // Neither variable nor function found
@@ -125,19 +526,22 @@ TonError interpret_expression(ASTNode* node, Environment* env, Value* out_result
 
             // Handle built-in functions
             if (function->type == BUILT_IN) {
+                // Argument arrays are strictly nested, so they come from the scratch nursery
                 Value* args = NULL;
                 if (call_node->num_arguments > 0) {
-                    args = (Value*)ton_malloc(sizeof(Value) * call_node->num_arguments);
+                    args = (Value*)ton_scratch_alloc(call_node->num_arguments * sizeof(Value));
                     if (!args) {
                         return ton_error(TON_ERR_MEMORY, "Memory allocation failed for arguments", node->line, node->column, __FILE__);
                     }
                 }
+                for (int i = 0; i < call_node->num_arguments; i++) gc_push_root(&args[i]);
 
                 for (int i = 0; i < call_node->num_arguments; i++) {
                     err = interpret_expression(call_node->arguments[i], env, &args[i]);
                     if (err.code != TON_OK) {
+                        gc_pop_roots(call_node->num_arguments);
                         for (int j = 0; j < i; j++) value_release(&args[j]);
-                        if (args) ton_free(args);
+                        ton_scratch_free(args);
                         return err;
                     }
                 }
@@ -150,11 +554,18 @@ TonError interpret_expression(ASTNode* node, Environment* env, Value* out_result
                     strcmp(function->name, "map_create") == 0 ||
                     strcmp(function->name, "set_create") == 0 ||
                     strcmp(function->name, "array_create") == 0 || // Dodano array_create
+                    strncmp(function->name, "list_", 5) == 0 ||
+                    strncmp(function->name, "map_", 4) == 0 ||
+                    strncmp(function->name, "set_", 4) == 0 ||
+                    strncmp(function->name, "omap_", 5) == 0 ||
+                    strncmp(function->name, "art_", 4) == 0 ||
+                    strcmp(function->name, "struct_hashable") == 0 ||
                     strcmp(function->name, "int_to_string") == 0 ||
                     strcmp(function->name, "float_to_string") == 0 ||
                     strcmp(function->name, "string_to_int") == 0 ||
                     strcmp(function->name, "string_to_float") == 0 ||
                     strcmp(function->name, "length") == 0 ||
+                    strcmp(function->name, "len") == 0 ||
                     strcmp(function->name, "concat") == 0 ||
                     strcmp(function->name, "substring") == 0 ||
                     strcmp(function->name, "string_to_int_base") == 0 ||
@@ -166,6 +577,9 @@ TonError interpret_expression(ASTNode* node, Environment* env, Value* out_result
                     result = call_tonlib_function(function->name, args, call_node->num_arguments);
                 } else if (strncmp(function->name, "sha256_hash", 11) == 0 ||
                           strncmp(function->name, "md5_hash", 8) == 0 ||
+                          strcmp(function->name, "sha256_many") == 0 ||
+                          strcmp(function->name, "sha256_backend") == 0 ||
+                          strncmp(function->name, "hash_", 5) == 0 ||
                           strncmp(function->name, "base64_encode_text", 18) == 0 ||
                           strncmp(function->name, "base64_decode_text", 18) == 0 ||
                           strcmp(function->name, "random_int") == 0 ||
@@ -178,6 +592,22 @@ TonError interpret_expression(ASTNode* node, Environment* env, Value* out_result
                           strcmp(function->name, "char_from_code") == 0 ||
                           strcmp(function->name, "crypto_demo") == 0) {
                     result = call_crypto_function(function->name, args, call_node->num_arguments);
+                } else if (is_sort_function(function->name)) {
+                    // Comparators are Ton functions, so these need the caller's environment
+                    result = call_sort_function(function->name, args, call_node->num_arguments, env);
+                } else if (is_queue_function(function->name)) {
+                    result = call_queue_function(function->name, args, call_node->num_arguments, env);
+                } else if (is_persistent_function(function->name)) {
+                    result = call_persistent_function(function->name, args, call_node->num_arguments);
+                } else if (is_sketch_function(function->name)) {
+                    result = call_sketch_function(function->name, args, call_node->num_arguments);
+                } else if (is_cache_function(function->name)) {
+                    result = call_cache_function(function->name, args, call_node->num_arguments);
+                } else if (is_soa_function(function->name)) {
+                    result = call_soa_function(function->name, args, call_node->num_arguments);
+                } else if (strncmp(function->name, "gc_", 3) == 0 ||
+                           strncmp(function->name, "mem_", 4) == 0) {
+                    result = call_memory_function(function->name, args, call_node->num_arguments);
                 } else if (strcmp(function->name, "read_line") == 0) {
                     result = read_line_value();
                 } else if (strcmp(function->name, "bit_and") == 0) {
@@ -233,10 +663,22 @@ TonError interpret_expression(ASTNode* node, Environment* env, Value* out_result
                     result = create_value_null();
                 }
 
+                gc_pop_roots(call_node->num_arguments);
                 for (int i = 0; i < call_node->num_arguments; i++) {
                     value_release(&args[i]);
                 }
-                if (args) ton_free(args);
+                ton_scratch_free(args);
+
+                // Builtins do the bulk allocations, so report a heap overrun at the call
+                if (ton_mem_limit_exceeded()) {
+                    gc_push_root(&result);
+                    int over_limit = gc_check_heap_limit();
+                    gc_pop_roots(1);
+                    if (over_limit) {
+                        value_release(&result);
+                        return ton_error(TON_ERR_MEMORY, "Heap limit exceeded", node->line, node->column, __FILE__);
+                    }
+                }
 
                 *out_result = result;
                 return ton_ok();
@@ -249,17 +691,19 @@ TonError interpret_expression(ASTNode* node, Environment* env, Value* out_result
 
             Value* args = NULL;
             if (call_node->num_arguments > 0) {
-                args = (Value*)ton_malloc(sizeof(Value) * call_node->num_arguments);
+                args = (Value*)ton_scratch_alloc(call_node->num_arguments * sizeof(Value));
                 if (!args) {
                     return ton_error(TON_ERR_MEMORY, "Memory allocation failed for arguments", node->line, node->column, __FILE__);
                 }
             }
+            for (int i = 0; i < call_node->num_arguments; i++) gc_push_root(&args[i]);
 
             for (int i = 0; i < call_node->num_arguments; i++) {
                 err = interpret_expression(call_node->arguments[i], env, &args[i]);
                 if (err.code != TON_OK) {
+                    gc_pop_roots(call_node->num_arguments);
                     for (int j = 0; j < i; j++) value_release(&args[j]);
-                    if (args) ton_free(args);
+                    ton_scratch_free(args);
                     return err;
                 }
             }
@@ -268,21 +712,28 @@ TonError interpret_expression(ASTNode* node, Environment* env, Value* out_result
  
              for (int i = 0; i < function->num_parameters; i++) {
                  ParameterNode* param = function->parameters[i];
-                 value_add_ref(&args[i]);
                  env_add_variable(fn_env, param->identifier->lexeme, args[i], param->param_type);
              }
- 
-             err = interpret_statement(function->body, fn_env, out_result);
- 
+
+             gc_pop_roots(call_node->num_arguments);
              for (int i = 0; i < call_node->num_arguments; i++) {
                  value_release(&args[i]);
              }
-             if (args) ton_free(args);
+             ton_scratch_free(args);
+ 
+             alloc_profile_enter(function->name);
+             err = interpret_statement(function->body, fn_env, out_result);
+             alloc_profile_leave();
 
+             if (err.code == TON_RETURN) {
+                 // The result may borrow from the callee's scope; give the caller its own copy
+                 Value owned = value_copy(out_result);
+                 value_release(out_result);
+                 *out_result = owned;
+             }
              env_release(fn_env);
  
              if (err.code == TON_RETURN) {
-                 value_add_ref(out_result);
                  return ton_ok();
              } else if (err.code != TON_OK) {
                  return err;
@@ -298,6 +749,12 @@ TonError interpret_expression(ASTNode* node, Environment* env, Value* out_result
                 bin_node->operator->type == TOKEN_SLASH_ASSIGN ||
                 bin_node->operator->type == TOKEN_MODULO_ASSIGN) {
 
+                if (bin_node->left->type == NODE_ARRAY_ACCESS_EXPRESSION) {
+                    return assign_indexed(bin_node, env, out_result);
+                }
+                if (bin_node->left->type == NODE_MEMBER_ACCESS_EXPRESSION) {
+                    return assign_member(bin_node, env, out_result);
+                }
                 if (bin_node->left->type != NODE_IDENTIFIER_EXPRESSION) {
                     return ton_error(TON_ERR_RUNTIME, "Invalid assignment target.", node->line, node->column, __FILE__);
                 }
@@ -307,79 +764,38 @@ TonError interpret_expression(ASTNode* node, Environment* env, Value* out_result
                 TonError err = interpret_expression(bin_node->right, env, &right_val);
                 if (err.code != TON_OK) return err;
 
+                TonStructInstance* owner;
+                Value* field;
                 if (bin_node->operator->type != TOKEN_ASSIGN) {
                     Value* left_val_ptr = env_get_variable(env, ident_node->identifier);
+                    if (!left_val_ptr && (field = this_field(ident_node, env, &owner))) {
+                        err = store_field(owner, ident_node->this_slot, bin_node, &right_val);
+                        if (err.code != TON_OK) {
+                            value_release(&right_val);
+                            return err;
+                        }
+                        *out_result = right_val;
+                        return ton_ok();
+                    }
                     if (!left_val_ptr) {
                         char error_msg[256];
                         snprintf(error_msg, sizeof(error_msg), "Variable '%s' is not defined.", ident_node->identifier);
                         value_release(&right_val);
                         return ton_error(TON_ERR_RUNTIME, error_msg, node->line, node->column, __FILE__);
                     }
-                    Value left_val = *left_val_ptr;
-                    
                     Value new_val;
-
-                    switch (bin_node->operator->type) {
-                        case TOKEN_PLUS_ASSIGN:
-                            if (left_val.type == VALUE_INT && right_val.type == VALUE_INT) {
-                                new_val = create_value_int(left_val.data.int_val + right_val.data.int_val);
-                            } else if (left_val.type == VALUE_FLOAT && right_val.type == VALUE_FLOAT) {
-                                new_val = create_value_float(left_val.data.float_val + right_val.data.float_val);
-                            } else {
-                                value_release(&right_val);
-                                return ton_error(TON_ERR_TYPE, "Unsupported types for +=", node->line, node->column, __FILE__);
-                            }
-                            break;
-                        case TOKEN_MINUS_ASSIGN:
-                            if (left_val.type == VALUE_INT && right_val.type == VALUE_INT) {
-                                new_val = create_value_int(left_val.data.int_val - right_val.data.int_val);
-                            } else if (left_val.type == VALUE_FLOAT && right_val.type == VALUE_FLOAT) {
-                                new_val = create_value_float(left_val.data.float_val - right_val.data.float_val);
-                            } else {
-                                value_release(&right_val);
-                                return ton_error(TON_ERR_TYPE, "Unsupported types for -=", node->line, node->column, __FILE__);
-                            }
-                            break;
-                        case TOKEN_STAR_ASSIGN:
-                            if (left_val.type == VALUE_INT && right_val.type == VALUE_INT) {
-                                new_val = create_value_int(left_val.data.int_val * right_val.data.int_val);
-                            } else if (left_val.type == VALUE_FLOAT && right_val.type == VALUE_FLOAT) {
-                                new_val = create_value_float(left_val.data.float_val * right_val.data.float_val);
-                            } else {
-                                value_release(&right_val);
-                                return ton_error(TON_ERR_TYPE, "Unsupported types for *=", node->line, node->column, __FILE__);
-                            }
-                            break;
-                        case TOKEN_SLASH_ASSIGN:
-                            if (left_val.type == VALUE_INT && right_val.type == VALUE_INT) {
-                                if (right_val.data.int_val == 0) return ton_error(TON_ERR_RUNTIME, "Division by zero", node->line, node->column, __FILE__);
-                                new_val = create_value_int(left_val.data.int_val / right_val.data.int_val);
-                            } else if (left_val.type == VALUE_FLOAT && right_val.type == VALUE_FLOAT) {
-                                if (right_val.data.float_val == 0.0) return ton_error(TON_ERR_RUNTIME, "Division by zero", node->line, node->column, __FILE__);
-                                new_val = create_value_float(left_val.data.float_val / right_val.data.float_val);
-                            } else {
-                                value_release(&right_val);
-                                return ton_error(TON_ERR_TYPE, "Unsupported types for /=", node->line, node->column, __FILE__);
-                            }
-                            break;
-                        case TOKEN_MODULO_ASSIGN:
-                             if (left_val.type == VALUE_INT && right_val.type == VALUE_INT) {
-                                if (right_val.data.int_val == 0) return ton_error(TON_ERR_RUNTIME, "Division by zero", node->line, node->column, __FILE__);
-                                new_val = create_value_int(left_val.data.int_val % right_val.data.int_val);
-                            } else {
-                                value_release(&right_val);
-                                return ton_error(TON_ERR_TYPE, "Unsupported types for %=", node->line, node->column, __FILE__);
-                            }
-                            break;
-                        default: // Should not happen
-                            value_release(&right_val);
-                            return ton_error(TON_ERR_RUNTIME, "Unhandled compound assignment", node->line, node->column, __FILE__);
-                    }
+                    err = apply_compound_assignment(bin_node->operator->type, *left_val_ptr, right_val, node, &new_val);
                     value_release(&right_val);
+                    if (err.code != TON_OK) return err;
                     right_val = new_val;
                 }
 
                 if (!env_set_variable(env, ident_node->identifier, right_val)) {
+                    if ((field = this_field(ident_node, env, &owner))) {
+                        store_field(owner, ident_node->this_slot, bin_node, &right_val);
+                        *out_result = right_val;
+                        return ton_ok();
+                    }
                     char error_msg[256];
                     snprintf(error_msg, sizeof(error_msg), "Variable '%s' is not defined.", ident_node->identifier);
                     value_release(&right_val);
@@ -394,7 +810,9 @@ TonError interpret_expression(ASTNode* node, Environment* env, Value* out_result
             if (err.code != TON_OK) return err;
 
             Value right_val;
+            gc_push_root(&left_val);
             err = interpret_expression(bin_node->right, env, &right_val);
+            gc_pop_roots(1);
             if (err.code != TON_OK) {
                 value_release(&left_val);
                 return err;
@@ -476,6 +894,7 @@ TonError interpret_expression(ASTNode* node, Environment* env, Value* out_result
                              case VALUE_INT: eq = left_val.data.int_val == right_val.data.int_val; break;
                              case VALUE_FLOAT: eq = left_val.data.float_val == right_val.data.float_val; break;
                              case VALUE_BOOL: eq = left_val.data.bool_val == right_val.data.bool_val; break;
+                             case VALUE_CHAR: eq = left_val.data.char_val == right_val.data.char_val; break;
                              case VALUE_STRING: eq = strcmp(left_val.data.string_val, right_val.data.string_val) == 0; break;
                              default: return ton_error(TON_ERR_TYPE, "Unsupported types for ==", node->line, node->column, __FILE__);
                          }
@@ -490,6 +909,7 @@ TonError interpret_expression(ASTNode* node, Environment* env, Value* out_result
                              case VALUE_INT: neq = left_val.data.int_val != right_val.data.int_val; break;
                              case VALUE_FLOAT: neq = left_val.data.float_val != right_val.data.float_val; break;
                              case VALUE_BOOL: neq = left_val.data.bool_val != right_val.data.bool_val; break;
+                             case VALUE_CHAR: neq = left_val.data.char_val != right_val.data.char_val; break;
                              case VALUE_STRING: neq = strcmp(left_val.data.string_val, right_val.data.string_val) != 0; break;
                              default: return ton_error(TON_ERR_TYPE, "Unsupported types for !=", node->line, node->column, __FILE__);
                          }
@@ -657,29 +1077,42 @@ TonError interpret_expression(ASTNode* node, Environment* env, Value* out_result
         case NODE_MEMBER_ACCESS_EXPRESSION: {
             MemberAccessExpressionNode* member_node = (MemberAccessExpressionNode*)node;
             Value object_val;
-            TonError err = interpret_expression(member_node->object, env, &object_val);
+            int element;
+            TonError err = evaluate_member_object(member_node, env, &object_val, &element);
             if (err.code != TON_OK) return err;
 
+            if (element >= 0) {
+                TonSoA* soa = (TonSoA*)object_val.data.tonsoa_val;
+                int slot = member_slot(member_node, soa->type);
+                if (slot < 0) {
+                    err = missing_field(soa->type, member_node->member, node);
+                } else {
+                    Value field = tonsoa_get_field(soa, element, slot);
+                    *out_result = value_copy(&field);
+                }
+                value_release(&object_val);
+                return err;
+            }
             if (object_val.type != VALUE_STRUCT) {
                 value_release(&object_val);
                 return ton_error(TON_ERR_TYPE, "Member access operator (.) can only be used on structs.", node->line, node->column, __FILE__);
             }
 
             TonStructInstance* instance = (TonStructInstance*)object_val.data.struct_val;
-            *out_result = struct_get_field(instance, member_node->member);
+            int slot = member_slot(member_node, instance->type);
+            if (slot < 0) {
+                err = missing_field(instance->type, member_node->member, node);
+                value_release(&object_val);
+                return err;
+            }
+            *out_result = value_copy(&instance->field_values[slot]);
             value_release(&object_val);
             return ton_ok();
         }
         case NODE_METHOD_CALL_EXPRESSION: {
-            printf("Node type: %d\n", node->type);
-            if (node->type == NODE_METHOD_CALL_EXPRESSION) {
-                // Use direct field access through pointer arithmetic to avoid compilation issues
-                ASTNode* object = *(ASTNode**)((char*)node + sizeof(ASTNode));
-                char* method_name = *(char**)((char*)node + sizeof(ASTNode) + sizeof(ASTNode*));
-                // ASTNode** arguments and int num_arguments are commented out for now
-                
+            MethodCallExpressionNode* call = (MethodCallExpressionNode*)node;
             Value object_val;
-            TonError err = interpret_expression(object, env, &object_val);
+            TonError err = interpret_expression(call->object, env, &object_val);
             if (err.code != TON_OK) return err;
 
             if (object_val.type != VALUE_STRUCT) {
@@ -688,41 +1121,80 @@ TonError interpret_expression(ASTNode* node, Environment* env, Value* out_result
             }
 
             TonStructInstance* instance = (TonStructInstance*)object_val.data.struct_val;
-            FunctionDeclarationNode* method = struct_get_method(instance->type, method_name);
-
-            if (!method) {
+            StructMethod* resolved = cached_method(call, instance->type);
+            if (!resolved) {
+                static char error_msg[160];
+                snprintf(error_msg, sizeof(error_msg), "Method '%s' not found in struct '%s'.", call->method_name, instance->type->name);
                 value_release(&object_val);
-                char error_msg[256];
-                snprintf(error_msg, sizeof(error_msg), "Method '%s' not found in struct '%s'.", method_name, instance->type->name);
                 return ton_error(TON_ERR_RUNTIME, error_msg, node->line, node->column, __FILE__);
             }
+            FunctionDeclarationNode* method = resolved->function;
+            if (call->num_arguments != method->num_parameters) {
+                value_release(&object_val);
+                return ton_error(TON_ERR_TYPE, "Argument count mismatch", node->line, node->column, __FILE__);
+            }
 
-            Environment* method_env = create_child_environment(env);
-            env_add_variable(method_env, "this", object_val, value_type_to_variable_type(object_val.type));
-
-            /* Argument checking and processing commented out for now */
-
-                // Execute the method body
-                Value result;
-                err = interpret_statement((ASTNode*)method->body, method_env, &result);
-                if (err.code != TON_OK && err.code != TON_RETURN) {
+            Value* args = NULL;
+            if (call->num_arguments > 0) {
+                args = (Value*)ton_scratch_alloc(call->num_arguments * sizeof(Value));
+                if (!args) {
                     value_release(&object_val);
-                    env_release(method_env);
-                    return err;
+                    return ton_error(TON_ERR_MEMORY, "Memory allocation failed for arguments", node->line, node->column, __FILE__);
                 }
+            }
+            gc_push_root(&object_val);
+            for (int i = 0; i < call->num_arguments; i++) gc_push_root(&args[i]);
 
-                // Get the return value
-                if (err.code == TON_RETURN) {
-                    *out_result = result;
-                } else {
-                    *out_result = create_value_null();
+            for (int i = 0; i < call->num_arguments; i++) {
+                err = interpret_expression(call->arguments[i], env, &args[i]);
+                if (err.code != TON_OK) {
+                    gc_pop_roots(call->num_arguments + 1);
+                    for (int j = 0; j < i; j++) value_release(&args[j]);
+                    ton_scratch_free(args);
+                    value_release(&object_val);
+                    return err;
                 }
+            }
 
+            // `this` lives in the frame itself, so binding it costs no symbol
+            Environment* frame = env_acquire_frame(instance->type->closure_env ? instance->type->closure_env : env, object_val);
+            if (!frame) {
+                gc_pop_roots(call->num_arguments + 1);
+                for (int i = 0; i < call->num_arguments; i++) value_release(&args[i]);
+                ton_scratch_free(args);
                 value_release(&object_val);
-                env_release(method_env);
+                return ton_error(TON_ERR_MEMORY, "Failed to create call frame", node->line, node->column, __FILE__);
+            }
+            for (int i = 0; i < method->num_parameters; i++) {
+                ParameterNode* param = method->parameters[i];
+                env_add_variable(frame, param->identifier->lexeme, args[i], param->param_type);
+            }
+
+            gc_pop_roots(call->num_arguments + 1);
+            for (int i = 0; i < call->num_arguments; i++) {
+                value_release(&args[i]);
+            }
+            ton_scratch_free(args);
+            value_release(&object_val);
+
+            alloc_profile_enter(call->method_name);
+            err = interpret_statement((ASTNode*)method->body, frame, out_result);
+            alloc_profile_leave();
+
+            if (err.code == TON_RETURN) {
+                // The result may borrow from the frame; give the caller its own copy
+                Value owned = value_copy(out_result);
+                value_release(out_result);
+                *out_result = owned;
+            }
+            env_release_frame(frame);
+
+            if (err.code == TON_RETURN) {
                 return ton_ok();
+            } else if (err.code != TON_OK) {
+                return err;
             }
-            return ton_error(TON_ERR_RUNTIME, "Invalid node type in method call expression", node->line, node->column, __FILE__);
+            return ton_ok();
         }
         case NODE_SIZEOF_EXPRESSION: {
             SizeofExpressionNode* sizeof_node = (SizeofExpressionNode*)node;
@@ -766,7 +1238,10 @@ TonError interpret_expression(ASTNode* node, Environment* env, Value* out_result
         }
         case NODE_NEW_EXPRESSION: {
             NewExpressionNode* new_node = (NewExpressionNode*)node;
-            TonStructType* struct_type = find_struct_type(new_node->class_name);
+            // A name always resolves to the first class defined under it, and
+            // types are never freed, so the first successful lookup stays valid
+            TonStructType* struct_type = new_node->cached_type;
+            if (!struct_type) struct_type = new_node->cached_type = find_struct_type(new_node->class_name);
             if (!struct_type) {
                 char error_msg[256];
                 snprintf(error_msg, sizeof(error_msg), "Struct type '%s' not found.", new_node->class_name);
@@ -777,17 +1252,19 @@ TonError interpret_expression(ASTNode* node, Environment* env, Value* out_result
             if (!instance) {
                 return ton_error(TON_ERR_RUNTIME, "Failed to create struct instance.", node->line, node->column, __FILE__);
             }
+            Value instance_val = create_value_struct(instance);
+            gc_push_root(&instance_val);
 
             for (int i = 0; i < new_node->num_arguments; ++i) {
                 ASTNode* arg_node = new_node->arguments[i];
                 if (arg_node->type != NODE_BINARY_EXPRESSION || ((BinaryExpressionNode*)arg_node)->operator->type != TOKEN_COLON) {
-                    destroy_struct_instance(instance);
+                    gc_pop_roots(1);
                     return ton_error(TON_ERR_SYNTAX, "Invalid syntax for struct instantiation. Expected 'field: value'.", node->line, node->column, __FILE__);
                 }
 
                 BinaryExpressionNode* field_init_node = (BinaryExpressionNode*)arg_node;
                 if (field_init_node->left->type != NODE_IDENTIFIER_EXPRESSION) {
-                    destroy_struct_instance(instance);
+                    gc_pop_roots(1);
                     return ton_error(TON_ERR_SYNTAX, "Expected field name in struct instantiation.", node->line, node->column, __FILE__);
                 }
 
@@ -795,42 +1272,66 @@ TonError interpret_expression(ASTNode* node, Environment* env, Value* out_result
                 Value field_value;
                 TonError err = interpret_expression(field_init_node->right, env, &field_value);
                 if (err.code != TON_OK) {
-                    destroy_struct_instance(instance);
+                    gc_pop_roots(1);
                     return err;
                 }
 
                 if (!struct_set_field(instance, field_name, field_value)) {
                     char error_msg[256];
                     snprintf(error_msg, sizeof(error_msg), "Field '%s' not found in struct '%s'.", field_name, new_node->class_name);
-                    destroy_struct_instance(instance);
+                    gc_pop_roots(1);
                     value_release(&field_value);
                     return ton_error(TON_ERR_RUNTIME, error_msg, node->line, node->column, __FILE__);
                 }
                 value_release(&field_value);
             }
 
-            *out_result = create_value_struct(instance);
+            gc_pop_roots(1);
+            *out_result = instance_val;
             return ton_ok();
         }
         case NODE_ARRAY_LITERAL_EXPRESSION: {
             ArrayLiteralExpressionNode* array_lit = (ArrayLiteralExpressionNode*)node;
-            TonArray* arr = create_dynamic_array(0);
+            TonArray* arr = create_dynamic_array(array_lit->num_elements);
             if (!arr) {
                 return ton_error(TON_ERR_MEMORY, "Failed to create array", node->line, node->column, __FILE__);
             }
+            Value array_val = create_value_array(arr);
+            gc_push_root(&array_val);
 
             for (int i = 0; i < array_lit->num_elements; i++) {
                 Value element_val;
                 TonError err = interpret_expression(array_lit->elements[i], env, &element_val);
                 if (err.code != TON_OK) {
-                    destroy_array(arr);
+                    gc_pop_roots(1);
                     return err;
                 }
                 array_push(arr, element_val);
+                value_release(&element_val);
             }
-            *out_result = create_value_array(arr);
+            gc_pop_roots(1);
+            *out_result = array_val;
             return ton_ok();
         }
+        case NODE_ARRAY_ACCESS_EXPRESSION: {
+            ArrayAccessExpressionNode* access = (ArrayAccessExpressionNode*)node;
+            Value container;
+            TonError err = interpret_expression(access->array, env, &container);
+            if (err.code != TON_OK) return err;
+
+            Value index;
+            gc_push_root(&container);
+            err = interpret_expression(access->index, env, &index);
+            gc_pop_roots(1);
+            if (err.code == TON_OK) err = check_index(&container, &index, access);
+            if (err.code == TON_OK) {
+                Value element = load_indexed(&container, index.data.int_val);
+                *out_result = value_copy(&element);
+            }
+            value_release(&index);
+            value_release(&container);
+            return err;
+        }
         case NODE_MACRO_CALL_EXPRESSION: {
             MacroCallExpressionNode* macro_call = (MacroCallExpressionNode*)node;
             *out_result = evaluate_macro_call_expression(macro_call, env);
@@ -839,4 +1340,58 @@ TonError interpret_expression(ASTNode* node, Environment* env, Value* out_result
          default:
              return ton_error(TON_ERR_RUNTIME, "Unsupported expression type", node->line, node->column, __FILE__);
     }
-}
\ No newline at end of file
+}
+
+TonError call_frame_open(CallFrame* frame, const Value* callee, int arg_count, Environment* caller_env) {
+    frame->env = NULL;
+    if (callee->type != VALUE_FN || !callee->data.function_value) {
+        return ton_error(TON_ERR_TYPE, "Expected a function", 0, 0, __FILE__);
+    }
+    Function* function = callee->data.function_value;
+    if (function->type == BUILT_IN) {
+        return ton_error(TON_ERR_TYPE, "Builtin functions cannot be used as callbacks", 0, 0, __FILE__);
+    }
+    if (function->num_parameters != arg_count || arg_count > CALL_FRAME_MAX_ARGS) {
+        return ton_error(TON_ERR_TYPE, "Argument count mismatch", 0, 0, __FILE__);
+    }
+
+    frame->function = function;
+    frame->arg_count = arg_count;
+    frame->env = create_child_environment(function->closure_env ? function->closure_env : caller_env);
+    if (!frame->env) {
+        return ton_error(TON_ERR_MEMORY, "Failed to create call frame", 0, 0, __FILE__);
+    }
+    for (int i = 0; i < arg_count; i++) {
+        ParameterNode* param = function->parameters[i];
+        env_add_variable(frame->env, param->identifier->lexeme, create_value_null(), param->param_type);
+        frame->slots[i] = env_get_variable(frame->env, param->identifier->lexeme);
+    }
+    return ton_ok();
+}
+
+TonError call_frame_invoke(CallFrame* frame, const Value* args, Value* out_result) {
+    for (int i = 0; i < frame->arg_count; i++) {
+        value_release(frame->slots[i]);
+        *frame->slots[i] = value_copy(&args[i]);
+        gc_write_barrier(frame->env, &args[i]);
+    }
+
+    *out_result = create_value_null();
+    alloc_profile_enter(frame->function->name);
+    TonError err = interpret_statement(frame->function->body, frame->env, out_result);
+    alloc_profile_leave();
+
+    if (err.code == TON_RETURN) {
+        Value owned = value_copy(out_result);
+        value_release(out_result);
+        *out_result = owned;
+        return ton_ok();
+    }
+    if (err.code == TON_OK) *out_result = create_value_null(); // Fell off the end: returns null
+    return err;
+}
+
+void call_frame_close(CallFrame* frame) {
+    if (frame->env) env_release(frame->env);
+    frame->env = NULL;
+}
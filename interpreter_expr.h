@@ -8,4 +8,20 @@
 
 TonError interpret_expression(ASTNode* node, Environment* env, Value* out_result);
 
+#define CALL_FRAME_MAX_ARGS 4
+
+// Reusable frame for calling one Ton function many times from native code
+// (sort comparators, predicates). The environment and parameter slots are
+// set up once; each call only rebinds the arguments and runs the body.
+typedef struct CallFrame {
+    Function* function;
+    Environment* env;
+    Value* slots[CALL_FRAME_MAX_ARGS];
+    int arg_count;
+} CallFrame;
+
+TonError call_frame_open(CallFrame* frame, const Value* callee, int arg_count, Environment* caller_env);
+TonError call_frame_invoke(CallFrame* frame, const Value* args, Value* out_result);
+void call_frame_close(CallFrame* frame);
+
 #endif // INTERPRETER_EXPR_H
\ No newline at end of file
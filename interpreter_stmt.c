@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <string.h>
 #include "interpreter_stmt.h"
 #include "struct.h"
 #include "interpreter.h"
@@ -7,6 +8,11 @@
 #include "value.h"
 #include "builtin.h"
 #include "memory.h"
+#include "gc.h"
+#include "alloc_profile.h"
+#include "collections.h"
+#include "persistent.h"
+#include "array.h"
 
 #include "interpreter_expr.h"
 #include "interpreter_macro.h"
@@ -17,6 +23,7 @@ const char* variable_type_to_string(VariableType type) {
         case VAR_TYPE_FLOAT: return "float";
         case VAR_TYPE_STRING: return "string";
         case VAR_TYPE_BOOL: return "bool";
+        case VAR_TYPE_CHAR: return "char";
         case VAR_TYPE_VOID: return "void";
         case VAR_TYPE_FUNCTION: return "function";
         case VAR_TYPE_INFERRED: return "inferred";
@@ -24,11 +31,360 @@ const char* variable_type_to_string(VariableType type) {
     }
 }
 
+// Bounds-check hoisting for counted loops of the form
+//     for (let i = 0; i < len(a); i++) { ... a[i] ... }
+// If the body can neither rebind i or a nor change the length of a, the loop
+// condition already proves 0 <= i < len(a) whenever the body runs, so the
+// a[i] accesses inside it are marked to skip their own range checks. `a` must
+// be a variable: a bare field name in a method reads `this.a`, which any
+// member assignment or call could replace.
+
+#define HOIST_MAX_ACCESSES 64
+
+typedef struct {
+    const char* index;
+    const char* array;
+    Environment* env;
+    ArrayAccessExpressionNode* accesses[HOIST_MAX_ACCESSES];
+    int count;
+} HoistScan;
+
+// Builtins that never change the length of a list, array or string
+static const char* const length_preserving_builtins[] = {
+    "len", "length", "list_size", "list_get", "list_set",
+    "map_get", "map_has", "map_size", "set_has", "set_size",
+    "int_to_string", "float_to_string", "string_to_int", "string_to_float",
+    "concat", "substring", "upper_case", "lower_case", "strpos",
+    "char_code", "char_from_code", "math_pi", "math_e",
+    "bit_and", "bit_or", "bit_xor", "bit_not", "bit_shl", "bit_shr",
+    NULL
+};
+
+static bool is_identifier(const ASTNode* node, const char* name) {
+    return node && node->type == NODE_IDENTIFIER_EXPRESSION &&
+           strcmp(((const IdentifierExpressionNode*)node)->identifier, name) == 0;
+}
+
+static bool is_int_literal(const ASTNode* node) {
+    return node && node->type == NODE_LITERAL_EXPRESSION &&
+           ((const LiteralExpressionNode*)node)->value->type == TOKEN_INT_LITERAL;
+}
+
+static bool is_builtin(Environment* env, const char* name) {
+    Function* function = env_get_function(env, name);
+    return function && function->type == BUILT_IN;
+}
+
+static bool is_length_preserving_call(HoistScan* scan, const FunctionCallExpressionNode* call) {
+    if (!call->callee || call->callee->type != NODE_IDENTIFIER_EXPRESSION) return false;
+    const char* name = ((const IdentifierExpressionNode*)call->callee)->identifier;
+    for (int i = 0; length_preserving_builtins[i]; i++) {
+        if (strcmp(name, length_preserving_builtins[i]) == 0) return is_builtin(scan->env, name);
+    }
+    return false;
+}
+
+static bool binds_loop_name(HoistScan* scan, const char* name) {
+    return name && (strcmp(name, scan->index) == 0 || strcmp(name, scan->array) == 0);
+}
+
+static bool hoist_scan_block(HoistScan* scan, BlockStatementNode* block);
+
+// Walks the loop body; returns false as soon as it meets anything that could
+// invalidate the loop condition (unknown node types included)
+static bool hoist_scan(HoistScan* scan, ASTNode* node) {
+    if (!node) return true;
+    switch (node->type) {
+        case NODE_LITERAL_EXPRESSION:
+        case NODE_IDENTIFIER_EXPRESSION:
+        case NODE_BREAK_STATEMENT:
+        case NODE_CONTINUE_STATEMENT:
+            return true;
+        case NODE_BLOCK_STATEMENT:
+            return hoist_scan_block(scan, (BlockStatementNode*)node);
+        case NODE_EXPRESSION_STATEMENT:
+            return hoist_scan(scan, ((ExpressionStatementNode*)node)->expression);
+        case NODE_RETURN_STATEMENT:
+            return hoist_scan(scan, ((ReturnStatementNode*)node)->expression);
+        case NODE_PRINT_STATEMENT: {
+            PrintStatementNode* print = (PrintStatementNode*)node;
+            for (int i = 0; i < print->num_expressions; i++) {
+                if (!hoist_scan(scan, print->expressions[i])) return false;
+            }
+            return true;
+        }
+        case NODE_VAR_DECLARATION: {
+            VariableDeclarationNode* decl = (VariableDeclarationNode*)node;
+            return !binds_loop_name(scan, decl->identifier) && hoist_scan(scan, decl->initializer);
+        }
+        case NODE_IF_STATEMENT: {
+            IfStatementNode* if_stmt = (IfStatementNode*)node;
+            return hoist_scan(scan, if_stmt->condition) &&
+                   hoist_scan(scan, (ASTNode*)if_stmt->consequence) &&
+                   hoist_scan(scan, (ASTNode*)if_stmt->alternative);
+        }
+        case NODE_WHILE_STATEMENT: {
+            WhileStatementNode* while_stmt = (WhileStatementNode*)node;
+            return hoist_scan(scan, while_stmt->condition) && hoist_scan(scan, (ASTNode*)while_stmt->body);
+        }
+        case NODE_FOR_STATEMENT: {
+            ForStatementNode* for_stmt = (ForStatementNode*)node;
+            return hoist_scan(scan, for_stmt->init) && hoist_scan(scan, for_stmt->condition) &&
+                   hoist_scan(scan, for_stmt->update) && hoist_scan(scan, (ASTNode*)for_stmt->body);
+        }
+        case NODE_FOR_IN_STATEMENT: {
+            ForInStatementNode* for_in = (ForInStatementNode*)node;
+            return !binds_loop_name(scan, for_in->first_name) && !binds_loop_name(scan, for_in->second_name) &&
+                   hoist_scan(scan, for_in->iterable) && hoist_scan(scan, (ASTNode*)for_in->body);
+        }
+        case NODE_BINARY_EXPRESSION: {
+            BinaryExpressionNode* bin = (BinaryExpressionNode*)node;
+            TokenType op = bin->operator->type;
+            bool assigns = op == TOKEN_ASSIGN || op == TOKEN_PLUS_ASSIGN || op == TOKEN_MINUS_ASSIGN ||
+                           op == TOKEN_STAR_ASSIGN || op == TOKEN_SLASH_ASSIGN || op == TOKEN_MODULO_ASSIGN;
+            if (assigns && (is_identifier(bin->left, scan->index) || is_identifier(bin->left, scan->array))) return false;
+            // obj.f = v may replace the object the loop indexes
+            if (assigns && bin->left->type == NODE_MEMBER_ACCESS_EXPRESSION) return false;
+            return hoist_scan(scan, bin->left) && hoist_scan(scan, bin->right);
+        }
+        case NODE_UNARY_EXPRESSION: {
+            UnaryExpressionNode* unary = (UnaryExpressionNode*)node;
+            if ((unary->operator->type == TOKEN_INCREMENT || unary->operator->type == TOKEN_DECREMENT) &&
+                (is_identifier(unary->operand, scan->index) || is_identifier(unary->operand, scan->array))) {
+                return false;
+            }
+            return hoist_scan(scan, unary->operand);
+        }
+        case NODE_CONDITIONAL_EXPRESSION: {
+            ConditionalExpressionNode* cond = (ConditionalExpressionNode*)node;
+            return hoist_scan(scan, cond->condition) && hoist_scan(scan, cond->true_expr) && hoist_scan(scan, cond->false_expr);
+        }
+        case NODE_TYPEOF_EXPRESSION:
+            return hoist_scan(scan, ((TypeofExpressionNode*)node)->operand);
+        case NODE_SIZEOF_EXPRESSION:
+            return hoist_scan(scan, ((SizeofExpressionNode*)node)->operand);
+        case NODE_ALIGNOF_EXPRESSION:
+            return hoist_scan(scan, ((AlignofExpressionNode*)node)->operand);
+        case NODE_MEMBER_ACCESS_EXPRESSION:
+            return hoist_scan(scan, ((MemberAccessExpressionNode*)node)->object);
+        case NODE_ARRAY_LITERAL_EXPRESSION: {
+            ArrayLiteralExpressionNode* literal = (ArrayLiteralExpressionNode*)node;
+            for (int i = 0; i < literal->num_elements; i++) {
+                if (!hoist_scan(scan, literal->elements[i])) return false;
+            }
+            return true;
+        }
+        case NODE_FN_CALL_EXPRESSION: {
+            // User functions may reach `a` through a global or closure, so
+            // only builtins known not to resize anything are allowed.
+            // Method calls fall to the default case and stop hoisting.
+            FunctionCallExpressionNode* call = (FunctionCallExpressionNode*)node;
+            if (!is_length_preserving_call(scan, call)) return false;
+            for (int i = 0; i < call->num_arguments; i++) {
+                if (!hoist_scan(scan, call->arguments[i])) return false;
+            }
+            return true;
+        }
+        case NODE_ARRAY_ACCESS_EXPRESSION: {
+            ArrayAccessExpressionNode* access = (ArrayAccessExpressionNode*)node;
+            if (is_identifier(access->array, scan->array) && is_identifier(access->index, scan->index) &&
+                scan->count < HOIST_MAX_ACCESSES) {
+                scan->accesses[scan->count++] = access;
+            }
+            return hoist_scan(scan, access->array) && hoist_scan(scan, access->index);
+        }
+        default:
+            return false;
+    }
+}
+
+static bool hoist_scan_block(HoistScan* scan, BlockStatementNode* block) {
+    for (int i = 0; i < block->num_statements; i++) {
+        if (!hoist_scan(scan, block->statements[i])) return false;
+    }
+    return true;
+}
+
+// Index variable of `let i = <int>` or `i = <int>`; NULL for other inits
+static const char* counted_loop_index(ASTNode* init) {
+    if (!init) return NULL;
+    if (init->type == NODE_VAR_DECLARATION) {
+        VariableDeclarationNode* decl = (VariableDeclarationNode*)init;
+        if ((decl->var_type == VAR_TYPE_INT || decl->var_type == VAR_TYPE_INFERRED) && is_int_literal(decl->initializer)) {
+            return decl->identifier;
+        }
+        return NULL;
+    }
+    if (init->type == NODE_EXPRESSION_STATEMENT) init = ((ExpressionStatementNode*)init)->expression;
+    if (init && init->type == NODE_BINARY_EXPRESSION) {
+        BinaryExpressionNode* bin = (BinaryExpressionNode*)init;
+        if (bin->operator->type == TOKEN_ASSIGN && bin->left->type == NODE_IDENTIFIER_EXPRESSION && is_int_literal(bin->right)) {
+            return ((IdentifierExpressionNode*)bin->left)->identifier;
+        }
+    }
+    return NULL;
+}
+
+// Array name of `i < len(a)` (also length(a) and list_size(a)); NULL otherwise
+static const char* counted_loop_bound(ASTNode* condition, const char* index, Environment* env) {
+    if (!condition || condition->type != NODE_BINARY_EXPRESSION) return NULL;
+    BinaryExpressionNode* bin = (BinaryExpressionNode*)condition;
+    if (bin->operator->type != TOKEN_LT || !is_identifier(bin->left, index)) return NULL;
+    if (!bin->right || bin->right->type != NODE_FN_CALL_EXPRESSION) return NULL;
+
+    FunctionCallExpressionNode* call = (FunctionCallExpressionNode*)bin->right;
+    if (call->num_arguments != 1 || call->arguments[0]->type != NODE_IDENTIFIER_EXPRESSION) return NULL;
+    if (!call->callee || call->callee->type != NODE_IDENTIFIER_EXPRESSION) return NULL;
+    const char* name = ((IdentifierExpressionNode*)call->callee)->identifier;
+    if (strcmp(name, "len") != 0 && strcmp(name, "length") != 0 && strcmp(name, "list_size") != 0) return NULL;
+    if (!is_builtin(env, name)) return NULL;
+    return ((IdentifierExpressionNode*)call->arguments[0])->identifier;
+}
+
+// i++, ++i or i += 1. Larger strides could overflow past INT_MAX and wrap
+// around to a negative index that still satisfies the condition.
+static bool counted_loop_step(ASTNode* update, const char* index) {
+    if (!update) return false;
+    if (update->type == NODE_UNARY_EXPRESSION) {
+        UnaryExpressionNode* unary = (UnaryExpressionNode*)update;
+        return unary->operator->type == TOKEN_INCREMENT && is_identifier(unary->operand, index);
+    }
+    if (update->type == NODE_BINARY_EXPRESSION) {
+        BinaryExpressionNode* bin = (BinaryExpressionNode*)update;
+        return bin->operator->type == TOKEN_PLUS_ASSIGN && is_identifier(bin->left, index) &&
+               is_int_literal(bin->right) && strcmp(((LiteralExpressionNode*)bin->right)->value->lexeme, "1") == 0;
+    }
+    return false;
+}
+
+// Runs once per for-statement node, on its first execution
+static void hoist_loop_bounds_checks(ForStatementNode* for_stmt, Environment* env) {
+    HoistScan scan;
+    scan.index = counted_loop_index(for_stmt->init);
+    if (!scan.index) return;
+    scan.array = counted_loop_bound(for_stmt->condition, scan.index, env);
+    if (!scan.array || strcmp(scan.array, scan.index) == 0) return;
+    if (!env_get_variable(env, scan.array)) return;
+    if (!counted_loop_step(for_stmt->update, scan.index) || !for_stmt->body) return;
+
+    scan.env = env;
+    scan.count = 0;
+    if (!hoist_scan_block(&scan, for_stmt->body)) return;
+    for (int i = 0; i < scan.count; i++) {
+        scan.accesses[i]->bounds_hoisted = 1;
+    }
+}
+
+// Runs the body of a for-in loop once per element. The loop variables
+// already exist in loop_env and are rebound before each pass.
+static TonError run_for_in(ForInStatementNode* for_in, Value* iterable, Environment* loop_env, Value* out_result) {
+    ASTNode* node = (ASTNode*)for_in;
+    TonMap* map = NULL;
+    TonOMap* omap = NULL;
+    TonPMap* pmap = NULL;
+    if (iterable->type == VALUE_TONMAP) {
+        map = (TonMap*)iterable->data.tonmap_val;
+    } else if (iterable->type == VALUE_TONSET) {
+        if (for_in->second_name) {
+            return ton_error(TON_ERR_TYPE, "Set iteration takes a single loop variable", node->line, node->column, __FILE__);
+        }
+        map = ((TonSet*)iterable->data.tonset_val)->map;
+    } else if (iterable->type == VALUE_TONOMAP) {
+        omap = (TonOMap*)iterable->data.tonomap_val;
+    } else if (iterable->type == VALUE_TONPMAP) {
+        // A transient map may rebuild the nodes the walk is standing on
+        pmap = (TonPMap*)iterable->data.tonpmap_val;
+        if (pmap->edit) {
+            return ton_error(TON_ERR_RUNTIME, "Cannot iterate a transient persistent map", node->line, node->column, __FILE__);
+        }
+    } else if (iterable->type != VALUE_TONLIST && iterable->type != VALUE_ARRAY && iterable->type != VALUE_TONPVEC) {
+        return ton_error(TON_ERR_TYPE, "for-in expects a list, array, map, set, ordered map or persistent collection", node->line, node->column, __FILE__);
+    }
+
+    // Ordered maps are walked along their leaves, which insertions and
+    // removals can split or free, so any change to the keys ends the loop
+    TonOMapCursor cursor = tonomap_begin(omap);
+    unsigned omap_version = omap ? omap->version : 0;
+    TonPMapIter pmap_iter;
+    tonpmap_iter_init(&pmap_iter, pmap);
+
+    // Maps are walked by entry position. Insertions append, but one that
+    // fills the entries array rebuilds the table and compacts live entries
+    // to the front in order; the `visited` entries seen so far then sit at
+    // positions 0 .. visited-1, so the walk resumes at `visited`. Removals
+    // would shift that count, so they end the loop.
+    unsigned map_rebuilds = map ? map->rebuilds : 0;
+    unsigned map_removals = map ? map->removals : 0;
+    int position = 0;
+    int visited = 0;
+    for (int i = 0; ; i++) {
+        Value first;
+        Value second = create_value_null();
+        if (map) {
+            if (map->removals != map_removals) {
+                return ton_error(TON_ERR_RUNTIME, "Map changed size during iteration", node->line, node->column, __FILE__);
+            }
+            if (map->rebuilds != map_rebuilds) {
+                map_rebuilds = map->rebuilds;
+                position = visited;
+            }
+            position = tonmap_next(map, position);
+            if (position < 0) break;
+            first = map->entries[position].key;
+            second = map->entries[position].value;
+            position++;
+            visited++;
+        } else if (omap) {
+            if (omap->version != omap_version) {
+                return ton_error(TON_ERR_RUNTIME, "Ordered map changed during iteration", node->line, node->column, __FILE__);
+            }
+            if (!cursor.leaf) break;
+            first = tonomap_cursor_key(omap, &cursor);
+            second = tonomap_cursor_value(&cursor);
+            tonomap_cursor_next(&cursor);
+        } else if (pmap) {
+            const TonMapEntry* entry = tonpmap_iter_next(&pmap_iter);
+            if (!entry) break;
+            first = entry->key;
+            second = entry->value;
+        } else if (iterable->type == VALUE_TONPVEC) {
+            TonPVec* vec = (TonPVec*)iterable->data.tonpvec_val;
+            if (i >= vec->count) break;
+            second = tonpvec_get(vec, i);
+            first = for_in->second_name ? create_value_int(i) : second;
+        } else if (iterable->type == VALUE_TONLIST) {
+            TonList* list = (TonList*)iterable->data.tonlist_val;
+            if (i >= list->size) break;
+            second = tonlist_get(list, i);
+            first = for_in->second_name ? create_value_int(i) : second;
+        } else {
+            TonArray* array = (TonArray*)iterable->data.array_val;
+            if ((size_t)i >= array->length) break;
+            second = array_get(array, (size_t)i);
+            first = for_in->second_name ? create_value_int(i) : second;
+        }
+
+        env_set_variable(loop_env, for_in->first_name, first);
+        if (for_in->second_name) env_set_variable(loop_env, for_in->second_name, second);
+
+        TonError err = interpret_statement((ASTNode*)for_in->body, loop_env, out_result);
+        if (err.code == TON_BREAK) break;
+        if (err.code == TON_CONTINUE) continue;
+        if (err.code != TON_OK) return err;
+    }
+    return ton_ok();
+}
+
 TonError interpret_statement(ASTNode* node, Environment* env, Value* out_result) {
     if (!node || !env || !out_result) {
         return ton_error(TON_ERR_RUNTIME, "Invalid arguments", 0, 0, __FILE__);
     }
     *out_result = create_value_null();
+    gc_safepoint();
+    alloc_profile_line = node->line;
+    if (ton_mem_limit_exceeded() && gc_check_heap_limit()) {
+        return ton_error(TON_ERR_MEMORY, "Heap limit exceeded", node->line, node->column, __FILE__);
+    }
 
     switch (node->type) {
         case NODE_PROGRAM: {
@@ -111,6 +467,10 @@ TonError interpret_statement(ASTNode* node, Environment* env, Value* out_result)
         }
         case NODE_FOR_STATEMENT: {
             ForStatementNode* for_stmt = (ForStatementNode*)node;
+            if (!for_stmt->bounds_analyzed) {
+                hoist_loop_bounds_checks(for_stmt, env);
+                for_stmt->bounds_analyzed = 1;
+            }
             Environment* loop_env = create_child_environment(env);
             TonError err;
             if (for_stmt->init) {
@@ -170,6 +530,24 @@ TonError interpret_statement(ASTNode* node, Environment* env, Value* out_result)
             env_release(loop_env);
             return ton_ok();
         }
+        case NODE_FOR_IN_STATEMENT: {
+            ForInStatementNode* for_in = (ForInStatementNode*)node;
+            Value iterable;
+            TonError err = interpret_expression(for_in->iterable, env, &iterable);
+            if (err.code != TON_OK) return err;
+            gc_push_root(&iterable);
+
+            Environment* loop_env = create_child_environment(env);
+            env_add_variable(loop_env, for_in->first_name, create_value_null(), VAR_TYPE_INFERRED);
+            if (for_in->second_name) {
+                env_add_variable(loop_env, for_in->second_name, create_value_null(), VAR_TYPE_INFERRED);
+            }
+            err = run_for_in(for_in, &iterable, loop_env, out_result);
+            env_release(loop_env);
+            gc_pop_roots(1);
+            value_release(&iterable);
+            return err;
+        }
         case NODE_LOOP_STATEMENT: {
             LoopStatementNode* loop = (LoopStatementNode*)node;
             TonError err;
@@ -187,6 +565,7 @@ TonError interpret_statement(ASTNode* node, Environment* env, Value* out_result)
             Value switch_val;
             TonError err = interpret_expression(switch_stmt->expression, env, &switch_val);
             if (err.code != TON_OK) return err;
+            gc_push_root(&switch_val);
 
             bool matched = false;
             bool fallthrough = false;
@@ -203,6 +582,7 @@ TonError interpret_statement(ASTNode* node, Environment* env, Value* out_result)
                 Value case_val;
                 err = interpret_expression(case_stmt->value, env, &case_val);
                 if (err.code != TON_OK) {
+                    gc_pop_roots(1);
                     value_release(&switch_val);
                     return err;
                 }
@@ -218,6 +598,7 @@ TonError interpret_statement(ASTNode* node, Environment* env, Value* out_result)
                             break;
                         }
                         if (err.code != TON_OK) {
+                            gc_pop_roots(1);
                             value_release(&switch_val);
                             value_release(&case_val);
                             return err;
@@ -231,12 +612,14 @@ TonError interpret_statement(ASTNode* node, Environment* env, Value* out_result)
                 for (int j = 0; j < default_case->num_statements; j++) {
                     err = interpret_statement(default_case->statements[j], env, out_result);
                     if (err.code != TON_OK && err.code != TON_BREAK) {
+                        gc_pop_roots(1);
                         value_release(&switch_val);
                         return err;
                     }
                 }
             }
 
+            gc_pop_roots(1);
             value_release(&switch_val);
             return ton_ok();
         }
@@ -270,12 +653,25 @@ TonError interpret_statement(ASTNode* node, Environment* env, Value* out_result)
                     case VALUE_STRING: printf("%s", val.data.string_val); break;
                     case VALUE_FLOAT: printf("%.6f", val.data.float_val); break;
                     case VALUE_BOOL: printf("%s", val.data.bool_val ? "true" : "false"); break;
+                    case VALUE_CHAR: printf("%c", val.data.char_val); break;
                     case VALUE_NULL: printf("null"); break;
                     case VALUE_POINTER: printf("pointer"); break;
                     case VALUE_ERROR: printf("Error: %s", val.data.error_message); break;
                     case VALUE_TONLIST: printf("TonList"); break;
                     case VALUE_TONMAP: printf("TonMap"); break;
                     case VALUE_TONSET: printf("TonSet"); break;
+                    case VALUE_TONDEQUE: printf("TonDeque"); break;
+                    case VALUE_TONPQ: printf("TonPQ"); break;
+                    case VALUE_TONOMAP: printf("TonOMap"); break;
+                    case VALUE_TONPVEC: printf("TonPVec"); break;
+                    case VALUE_TONPMAP: printf("TonPMap"); break;
+                    case VALUE_TONBLOOM: printf("TonBloom"); break;
+                    case VALUE_TONHLL: printf("TonHLL"); break;
+                    case VALUE_TONBITMAP: printf("TonBitmap"); break;
+                    case VALUE_TONART: printf("TonART"); break;
+                    case VALUE_TONCACHE: printf("TonCache"); break;
+                    case VALUE_TONSOA: printf("TonSoA"); break;
+                    case VALUE_TONDIGEST: printf("TonDigest"); break;
                     case VALUE_ARRAY: printf("Array"); break;
                     default: printf("<unknown>");
                 }
@@ -293,12 +689,16 @@ TonError interpret_statement(ASTNode* node, Environment* env, Value* out_result)
         }
         case NODE_FN_DECLARATION: {
             FunctionDeclarationNode* fn_decl = (FunctionDeclarationNode*)node;
-            Function* func = (Function*)ton_malloc(sizeof(Function));
+            Function* func = (Function*)gc_alloc(GC_KIND_FUNCTION, sizeof(Function));
+            if (!func) {
+                return ton_error(TON_ERR_MEMORY, "Memory allocation failed for function.", node->line, node->column, __FILE__);
+            }
             func->type = USER_DEFINED;
             func->name = ton_strdup(fn_decl->identifier->lexeme);
             func->body = (ASTNode*)fn_decl->body;
             func->closure_env = env;
-            env_add_ref(env); // Add reference to the closure environment
+            gc_write_barrier_object(func, env);
+            env_capture(env); // The closure keeps this scope alive until collected
 
             func->parameters = fn_decl->parameters; // Assuming AST ownership
             func->num_parameters = fn_decl->num_parameters;
@@ -311,17 +711,37 @@ TonError interpret_statement(ASTNode* node, Environment* env, Value* out_result)
         }
         case NODE_CLASS_DECLARATION: {
             ClassDeclarationNode* class_decl = (ClassDeclarationNode*)node;
-        
-            int num_fields = class_decl->num_fields;
-            StructField* fields = (StructField*)ton_malloc(sizeof(StructField) * num_fields);
-            if (!fields && num_fields > 0) {
+
+            TonStructType* parent = NULL;
+            if (class_decl->parent_name) {
+                parent = find_struct_type(class_decl->parent_name);
+                if (!parent) {
+                    return ton_error(TON_ERR_RUNTIME, "Parent class not found", node->line, node->column, __FILE__);
+                }
+            }
+
+            // Inherited fields keep the parent's slots, so code that works on
+            // the parent finds them at the same place in every subclass
+            int inherited = parent ? parent->num_fields : 0;
+            int num_fields = inherited;
+            StructField* fields = (StructField*)ton_malloc(sizeof(StructField) * (inherited + class_decl->num_fields));
+            if (!fields && inherited + class_decl->num_fields > 0) {
                 return ton_error(TON_ERR_RUNTIME, "Memory allocation failed for class fields.", node->line, node->column, __FILE__);
             }
-        
-            for (int i = 0; i < num_fields; ++i) {
-                fields[i].name = class_decl->field_names[i];
-                fields[i].type_name = variable_type_to_string(class_decl->field_types[i]);
-                fields[i].access = class_decl->field_access ? (AccessModifier)class_decl->field_access[i] : ACCESS_PUBLIC;
+            if (inherited > 0) memcpy(fields, parent->fields, sizeof(StructField) * inherited);
+
+            for (int i = 0; i < class_decl->num_fields; ++i) {
+                int redeclared = 0;
+                for (int j = 0; j < inherited; ++j) {
+                    if (strcmp(fields[j].name, class_decl->field_names[i]) == 0) redeclared = 1;
+                }
+                if (redeclared) continue; // Same field as the parent's
+                fields[num_fields].name = class_decl->field_names[i];
+                fields[num_fields].type_name = class_decl->field_type_names[i]
+                    ? class_decl->field_type_names[i]
+                    : variable_type_to_string(class_decl->field_types[i]);
+                fields[num_fields].access = class_decl->field_access ? (AccessModifier)class_decl->field_access[i] : ACCESS_PUBLIC;
+                num_fields++;
             }
         
             // Method handling
@@ -339,7 +759,7 @@ TonError interpret_statement(ASTNode* node, Environment* env, Value* out_result)
                     methods[i].name = method_node->identifier->lexeme;
                     methods[i].function = method_node;
                     methods[i].access = class_decl->method_access ? (AccessModifier)class_decl->method_access[i] : ACCESS_PUBLIC;
-                    methods[i].is_virtual = 0;
+                    methods[i].is_virtual = 1; // Every method dispatches through the vtable
                     methods[i].is_constructor = 0;
                     methods[i].is_destructor = 0;
                 }
@@ -352,15 +772,14 @@ TonError interpret_statement(ASTNode* node, Environment* env, Value* out_result)
                 return ton_error(TON_ERR_RUNTIME, "Failed to define class type.", node->line, node->column, __FILE__);
             }
         
-            if (class_decl->parent_name) {
-                new_type->parent = find_struct_type(class_decl->parent_name);
-                if (!new_type->parent) {
-                    ton_free(fields);
-                    if (methods) ton_free(methods);
-                    destroy_struct_type(new_type);
-                    return ton_error(TON_ERR_RUNTIME, "Parent class not found", node->line, node->column, __FILE__);
-                }
+            new_type->parent_name = class_decl->parent_name;
+            new_type->parent = parent;
+            if (!struct_build_vtable(new_type)) {
+                return ton_error(TON_ERR_MEMORY, "Memory allocation failed for class vtable.", node->line, node->column, __FILE__);
             }
+            // Types live for the whole run, so the class keeps its scope alive
+            new_type->closure_env = env;
+            env_add_ref(env);
         
             return ton_ok();
         }
@@ -397,6 +816,7 @@ TonError interpret_statement(ASTNode* node, Environment* env, Value* out_result)
             } else {
                 env_add_variable(env, var_decl->identifier, initializer_val, var_decl->var_type);
             }
+            value_release(&initializer_val);
             return ton_ok();
         }
         case NODE_MACRO_DECLARATION: {
@@ -439,6 +859,7 @@ TonError interpret_statement(ASTNode* node, Environment* env, Value* out_result)
                     if (catch_block->exception_var) {
                         Value exception_val = create_value_string(try_err.message ? try_err.message : "Unknown error");
                         env_add_variable(catch_env, catch_block->exception_var, exception_val, VAR_TYPE_STRING);
+                        value_release(&exception_val);
                     }
                     
                     // Execute catch block
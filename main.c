@@ -7,6 +7,9 @@
 #include "memory.h"
 #include "builtin.h"
 #include "error.h"
+#include "gc.h"
+#include "alloc_profile.h"
+#include "hash.h"
 
 #include <string.h>
 #include "lexer.h"
@@ -16,6 +19,13 @@
 // Global variable to store program exit code
 int program_exit_code = 0;
 
+// Print collector statistics before exiting (--gc-stats)
+static bool print_gc_stats = false;
+
+// Allocation profiler output file and sampling rate (--alloc-profile)
+static const char* alloc_profile_path = NULL;
+static size_t alloc_profile_rate = ALLOC_PROFILE_DEFAULT_RATE;
+
 /**
  * Check for runtime errors and handle them appropriately
  * @param err The error to check
@@ -39,6 +49,100 @@ static bool check_and_handle_error(TonError err, Value* result) {
     return false;
 }
 
+/**
+ * Parse a byte count with an optional k/m/g suffix (e.g. "64m")
+ * @param text Text to parse
+ * @param out Parsed size in bytes
+ * @return true on success
+ */
+static bool parse_size_arg(const char* text, size_t* out) {
+    char* end = NULL;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (end == text) return false;
+    switch (*end) {
+        case 'k': case 'K': value *= 1024ULL; end++; break;
+        case 'm': case 'M': value *= 1024ULL * 1024ULL; end++; break;
+        case 'g': case 'G': value *= 1024ULL * 1024ULL * 1024ULL; end++; break;
+        default: break;
+    }
+    if (*end != '\0' || value == 0) return false;
+    *out = (size_t)value;
+    return true;
+}
+
+/**
+ * Apply a "--name=value" command-line option
+ * @param arg Option text
+ * @return true if the option was recognised and valid
+ */
+static bool apply_option(const char* arg) {
+    size_t size = 0;
+    if (strncmp(arg, "--gc-threshold=", 15) == 0 && parse_size_arg(arg + 15, &size)) {
+        gc_set_threshold(size);
+        return true;
+    }
+    if (strncmp(arg, "--gc-nursery=", 13) == 0 && parse_size_arg(arg + 13, &size)) {
+        gc_set_nursery_size(size);
+        return true;
+    }
+    if (strncmp(arg, "--gc-step-budget=", 17) == 0) {
+        char* end = NULL;
+        unsigned long long objects = strtoull(arg + 17, &end, 10);
+        if (end == arg + 17 || *end != '\0') return false;
+        gc_set_step_budget((size_t)objects);
+        return true;
+    }
+    if (strncmp(arg, "--heap-limit=", 13) == 0 && parse_size_arg(arg + 13, &size)) {
+        size_t soft = ton_mem_soft_limit();
+        ton_mem_set_limits(soft && soft <= size ? soft : size / 4 * 3, size);
+        return true;
+    }
+    if (strncmp(arg, "--heap-soft-limit=", 18) == 0 && parse_size_arg(arg + 18, &size)) {
+        size_t hard = ton_mem_hard_limit();
+        if (hard && size > hard) return false;
+        ton_mem_set_limits(size, hard);
+        return true;
+    }
+    if (strcmp(arg, "--alloc-profile") == 0) {
+        alloc_profile_path = "ton_alloc.collapsed";
+        return true;
+    }
+    if (strncmp(arg, "--alloc-profile=", 16) == 0 && arg[16] != '\0') {
+        alloc_profile_path = arg + 16;
+        return true;
+    }
+    if (strncmp(arg, "--alloc-profile-rate=", 21) == 0 && parse_size_arg(arg + 21, &size)) {
+        alloc_profile_rate = size;
+        return true;
+    }
+    if (strcmp(arg, "--gc-stats") == 0) {
+        print_gc_stats = true;
+        return true;
+    }
+    if (strncmp(arg, "--hash-seed=", 12) == 0 && arg[12] != '\0') {
+        char* end;
+        unsigned long long seed = strtoull(arg + 12, &end, 0);
+        if (*end != '\0') return false;
+        ton_hash_set_seed((uint64_t)seed);
+        return true;
+    }
+    return false;
+}
+
+static void print_usage(const char* program) {
+    fprintf(stderr, "Usage: %s [options] [file.ton]\n", program);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --gc-threshold=<bytes>   Heap growth before a collection (k/m/g suffixes allowed)\n");
+    fprintf(stderr, "  --gc-nursery=<bytes>     Young-generation size before a minor collection\n");
+    fprintf(stderr, "  --gc-step-budget=<n>     Objects traced per incremental marking step (0 = stop-the-world)\n");
+    fprintf(stderr, "  --gc-stats               Print collector statistics at exit\n");
+    fprintf(stderr, "  --alloc-profile[=<file>] Sample allocations; print top callsites and write collapsed stacks\n");
+    fprintf(stderr, "  --alloc-profile-rate=<bytes> Mean bytes between samples (default 512k)\n");
+    fprintf(stderr, "  --heap-limit=<bytes>     Hard heap limit; exceeding it raises a Memory Error\n");
+    fprintf(stderr, "  --heap-soft-limit=<bytes> Heap size that triggers a collection (default: 3/4 of the hard limit)\n");
+    fprintf(stderr, "  --hash-seed=<n>          Fixed seed for map and set hashing (random by default)\n");
+}
+
 /**
  * Run the interactive REPL (Read-Eval-Print Loop)
  */
@@ -80,12 +184,29 @@ void run_repl() {
 }
 
 int main(int argc, char* argv[]) {
-    if (argc < 2) {
+    const char* filename = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--", 2) == 0) {
+            if (!apply_option(argv[i])) {
+                fprintf(stderr, "Invalid option \"%s\".\n", argv[i]);
+                print_usage(argv[0]);
+                return 1;
+            }
+        } else if (!filename) {
+            filename = argv[i];
+        }
+    }
+
+    if (alloc_profile_path) {
+        alloc_profile_start(alloc_profile_rate, alloc_profile_path);
+    }
+
+    if (!filename) {
         run_repl();
+        alloc_profile_finish();
         return 0;
     }
 
-    const char* filename = argv[1];
     FILE* file = fopen(filename, "rb");
     if (file == NULL) {
         fprintf(stderr, "Could not open file \"%s\".\n", filename);
@@ -146,7 +267,9 @@ int main(int argc, char* argv[]) {
         Environment* main_env = create_child_environment(global_env);
 
         // Interpret the body of the main function
+        alloc_profile_enter("main");
         TonError err = interpret_statement((ASTNode*)main_func->body, main_env, &result);
+        alloc_profile_leave();
         if (check_and_handle_error(err, &result)) {
             program_exit_code = 1;
             env_release(main_env);
@@ -184,6 +307,11 @@ cleanup:
         free_token(parser.peek_token);
     }
     
+    if (print_gc_stats) {
+        gc_print_stats();
+    }
+    alloc_profile_finish();
+
     // Final memory cleanup
     ton_mem_cleanup();
     
@@ -0,0 +1,215 @@
+#include "collections.h"
+#include "memory.h"
+#include "value.h"
+#include <stdio.h>
+
+// Standalone test of the Swiss-table TonMap: make map_test.exe
+// Checks growth across several resizes, remove/re-insert churn over
+// tombstones (compacted in place at TONMAP_ENTRIES_MAX), insertion order
+// after removals, and the rehash under a new seed when keys collide, also
+// when a heap limit makes that rehash fail.
+
+static int failures = 0;
+
+static void check(int ok, const char* what) {
+    if (!ok) {
+        printf("  FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+static Value int_key(int i) {
+    return create_value_int(i);
+}
+
+static int has_int(TonMap* map, int i) {
+    Value key = int_key(i);
+    return tonmap_has_value(map, &key);
+}
+
+static int get_int(TonMap* map, int i) {
+    Value key = int_key(i);
+    Value value = tonmap_get_value(map, &key);
+    return value.type == VALUE_INT ? value.data.int_val : -1;
+}
+
+static void set_int(TonMap* map, int i, int value) {
+    Value key = int_key(i);
+    tonmap_set_value(map, &key, create_value_int(value));
+}
+
+static void remove_int(TonMap* map, int i) {
+    Value key = int_key(i);
+    tonmap_remove_value(map, &key);
+}
+
+static void test_growth(void) {
+    printf("Test 1: Growth across several resizes\n");
+    TonMap* map = tonmap_create();
+    int resizes = 0;
+    int capacity = map->capacity;
+    for (int i = 0; i < 20000; i++) {
+        set_int(map, i, i * 3);
+        if (map->capacity != capacity) {
+            check(map->capacity == capacity * 2, "capacity doubles");
+            capacity = map->capacity;
+            resizes++;
+        }
+    }
+    check(resizes >= 10, "at least ten resizes");
+    check(tonmap_size(map) == 20000, "size after growth");
+    check(map->entries_used <= TONMAP_ENTRIES_MAX(map->capacity), "entries fit the table");
+    int found = 0;
+    for (int i = 0; i < 20000; i++) {
+        if (get_int(map, i) == i * 3) found++;
+    }
+    check(found == 20000, "every key found after growth");
+    check(!has_int(map, 20000) && !has_int(map, -1), "absent keys stay absent");
+    tonmap_destroy(map);
+}
+
+static void test_churn(void) {
+    printf("Test 2: Remove/re-insert churn over tombstones\n");
+    TonMap* map = tonmap_create();
+    for (int i = 0; i < 100; i++) set_int(map, i, i);
+    int capacity = 0;
+    unsigned rebuilds = 0;
+
+    // The live count never exceeds 100. Once the table has room for twice
+    // that, holes are compacted in place each time the entries array fills
+    // instead of growing the table
+    for (int round = 0; round < 50; round++) {
+        if (round == 1) {
+            capacity = map->capacity;
+            rebuilds = map->rebuilds;
+        }
+        for (int i = 0; i < 100; i += 2) remove_int(map, i + round * 100);
+        for (int i = 0; i < 100; i += 2) set_int(map, i + (round + 1) * 100, round);
+        for (int i = 1; i < 100; i += 2) {
+            remove_int(map, i + round * 100);
+            set_int(map, i + (round + 1) * 100, round);
+        }
+        check(tonmap_size(map) == 100, "size stays at 100");
+    }
+    check(map->capacity == capacity, "churn does not grow the table");
+    check(map->rebuilds > rebuilds, "full entries array is compacted");
+    int found = 0;
+    for (int i = 5000; i < 5100; i++) {
+        if (get_int(map, i) == 49) found++;
+    }
+    check(found == 100, "live keys found past tombstones");
+    int stale = 0;
+    for (int i = 0; i < 5000; i++) stale += has_int(map, i);
+    check(stale == 0, "removed keys are gone");
+    tonmap_destroy(map);
+}
+
+static void test_order(void) {
+    printf("Test 3: Insertion order after removals\n");
+    TonMap* map = tonmap_create();
+    for (int i = 0; i < 10; i++) set_int(map, i, i);
+    for (int i = 0; i < 10; i += 2) remove_int(map, i);
+    set_int(map, 4, 40);   // Re-inserted keys go last
+    set_int(map, 3, 30);   // Replacing a value keeps the position
+
+    int expected[] = { 1, 3, 5, 7, 9, 4 };
+    int n = 0;
+    int ordered = 1;
+    for (int pos = tonmap_next(map, 0); pos >= 0; pos = tonmap_next(map, pos + 1)) {
+        if (n >= 6 || map->entries[pos].key.data.int_val != expected[n]) ordered = 0;
+        n++;
+    }
+    check(ordered && n == 6, "order before compaction");
+    check(get_int(map, 3) == 30, "replaced value");
+
+    // Fill the entries array so the holes are compacted; order must survive
+    for (int i = 100; map->rebuilds == 0; i++) set_int(map, i, i);
+    n = 0;
+    ordered = 1;
+    for (int pos = tonmap_next(map, 0); pos >= 0 && n < 6; pos = tonmap_next(map, pos + 1)) {
+        if (pos != n || map->entries[pos].key.data.int_val != expected[n]) ordered = 0;
+        n++;
+    }
+    check(ordered && n == 6, "order after compaction");
+    tonmap_destroy(map);
+}
+
+// Keys whose probe starts at group 0 under `seed` for every capacity up to 4096
+static int colliding_keys(uint64_t seed, int* keys, int count) {
+    int found = 0;
+    for (int i = 0; found < count; i++) {
+        Value key = int_key(i);
+        uint64_t hash;
+        tonmap_hash_key(&key, seed, &hash);
+        if (((hash >> 7) & 4095 & ~(uint64_t)(TONMAP_GROUP_WIDTH - 1)) == 0) keys[found++] = i;
+    }
+    return found;
+}
+
+static void test_reseed(void) {
+    printf("Test 4: Rehash under a new seed when keys collide\n");
+    TonMap* map = tonmap_create();
+    uint64_t seed = map->seed;
+
+    // The colliding keys share one probe sequence; the 129th needs a ninth
+    // group and forces a reseed
+    int keys[160];
+    int count = colliding_keys(seed, keys, 160);
+    for (int i = 0; i < count; i++) set_int(map, keys[i], i);
+
+    check(map->reseeds == 1, "one reseed");
+    check(map->seed != seed, "seed changed");
+    int found = 0;
+    for (int i = 0; i < count; i++) {
+        if (get_int(map, keys[i]) == i) found++;
+    }
+    check(found == count, "every key found after the reseed");
+    check(map->entries[tonmap_next(map, 0)].key.data.int_val == keys[0], "reseed keeps insertion order");
+    tonmap_destroy(map);
+}
+
+static void test_reseed_out_of_memory(void) {
+    printf("Test 5: Failed rehash under a heap limit keeps the old seed\n");
+    TonMap* map = tonmap_create();
+    uint64_t seed = map->seed;
+    int keys[160];
+    int count = colliding_keys(seed, keys, 160);
+    for (int i = 0; i < 128; i++) set_int(map, keys[i], i);
+    check(map->reseeds == 0, "no reseed before the ninth group");
+
+    // Usage well past the hard limit plus its reserve: every allocation
+    // fails, as it does for a script after mem_set_limit
+    void* ballast = ton_malloc(256 * 1024);
+    ton_mem_set_limits(0, 1);
+    set_int(map, keys[128], 128);
+    check(map->reseeds == 0 && map->seed == seed, "seed kept when the rebuild fails");
+    int found = 0;
+    for (int i = 0; i <= 128; i++) {
+        if (get_int(map, keys[i]) == i) found++;
+    }
+    check(found == 129, "every key found after the failed rebuild");
+    set_int(map, keys[0], 1000);
+    check(tonmap_size(map) == 129 && get_int(map, keys[0]) == 1000, "existing key replaced, not duplicated");
+
+    ton_mem_set_limits(0, 0);
+    ton_free(ballast);
+    for (int i = 129; i < count; i++) set_int(map, keys[i], i);
+    check(map->reseeds == 1 && map->seed != seed, "reseed succeeds once memory is available");
+    found = 0;
+    for (int i = 1; i < count; i++) {
+        if (get_int(map, keys[i]) == i) found++;
+    }
+    check(found == count - 1 && tonmap_size(map) == count, "every key found after the reseed");
+    tonmap_destroy(map);
+}
+
+int main() {
+    printf("--- Running Map Test ---\n");
+    test_growth();
+    test_churn();
+    test_order();
+    test_reseed();
+    test_reseed_out_of_memory();
+    printf("--- Map Test Finished: %s ---\n", failures ? "FAILED" : "passed");
+    return failures ? 1 : 0;
+}
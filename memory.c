@@ -1,20 +1,130 @@
 #include "memory.h"
+#include "alloc_profile.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 
-// Global allocation tracking
-static Allocation* allocation_head = NULL;
+#define ALLOCATION_TABLE_INITIAL_CAPACITY 1024
+
+// Global allocation tracking: records are chained in a pointer-hashed table so
+// that ton_free/ton_realloc stay O(1) no matter how many blocks are live.
+static Allocation** allocation_table = NULL;
+static size_t allocation_table_capacity = 0;
+static size_t allocation_count = 0;
 static size_t total_allocated = 0;
+static void (*report_hook)(void) = NULL;
+
+// Heap limits. Allocations only leave the fast path once total_allocated
+// would cross limit_watermark (the soft limit, or the hard limit once the
+// soft one has fired). Past the hard limit a small reserve is still handed
+// out so the interpreter can unwind and raise a catchable error.
+#define HEAP_LIMIT_MIN_RESERVE (64 * 1024)
+
+static size_t soft_limit = 0;
+static size_t hard_limit = 0;
+static size_t limit_watermark = SIZE_MAX;
+static int limit_exceeded = 0;
+static size_t limit_refused = 0;       // Size of the last allocation refused by the hard limit
+static void (*soft_limit_hook)(void) = NULL;
+
+// Scratch nursery: bump-allocated chunks for short-lived buffers that are
+// released in strict LIFO order (e.g. call argument arrays). Each block is
+// preceded by the chunk offset it was carved from, so freeing pops the bump
+// pointer back instead of touching the allocation table.
+#define SCRATCH_CHUNK_SIZE (64 * 1024)
+#define SCRATCH_ALIGN(n) (((n) + 15) & ~(size_t)15)
+#define SCRATCH_CHUNK_HEADER SCRATCH_ALIGN(sizeof(ScratchChunk))
+#define SCRATCH_BLOCK_HEADER SCRATCH_ALIGN(sizeof(size_t))
+
+typedef struct ScratchChunk {
+    struct ScratchChunk* prev;    // Chunk below this one on the scratch stack
+    size_t capacity;              // Usable bytes after the chunk header
+    size_t used;                  // Bump offset
+} ScratchChunk;
+
+static ScratchChunk* scratch_top = NULL;
+static ScratchChunk* scratch_spare = NULL;
+static size_t scratch_in_use = 0;
+static size_t scratch_peak = 0;
+
+static size_t allocation_bucket(const void* ptr, size_t capacity) {
+    uint64_t h = (uint64_t)(uintptr_t)ptr;
+    h ^= h >> 4;
+    h *= 0x9E3779B97F4A7C15ULL;
+    return (size_t)(h >> 32) & (capacity - 1);
+}
+
+static int allocation_table_grow(void) {
+    size_t new_capacity = allocation_table_capacity ? allocation_table_capacity * 2 : ALLOCATION_TABLE_INITIAL_CAPACITY;
+    Allocation** new_table = (Allocation**)calloc(new_capacity, sizeof(Allocation*));
+    if (!new_table) return 0;
+
+    for (size_t i = 0; i < allocation_table_capacity; i++) {
+        Allocation* current = allocation_table[i];
+        while (current) {
+            Allocation* next = current->next;
+            size_t bucket = allocation_bucket(current->ptr, new_capacity);
+            current->next = new_table[bucket];
+            new_table[bucket] = current;
+            current = next;
+        }
+    }
+
+    free(allocation_table);
+    allocation_table = new_table;
+    allocation_table_capacity = new_capacity;
+    return 1;
+}
+
+static Allocation** allocation_find(const void* ptr) {
+    if (!allocation_table) return NULL;
+    Allocation** current = &allocation_table[allocation_bucket(ptr, allocation_table_capacity)];
+    while (*current) {
+        if ((*current)->ptr == ptr) return current;
+        current = &(*current)->next;
+    }
+    return NULL;
+}
+
+/**
+ * Slow path for an allocation that would cross the limit watermark
+ * @param size Bytes about to be added to the heap
+ * @return 1 if the allocation may proceed
+ */
+static int heap_limit_allows(size_t size) {
+    size_t after = total_allocated + size;
+    if (hard_limit && after > hard_limit) {
+        limit_exceeded = 1;
+        size_t reserve = hard_limit / 16 > HEAP_LIMIT_MIN_RESERVE ? hard_limit / 16 : HEAP_LIMIT_MIN_RESERVE;
+        if (after <= hard_limit + reserve) return 1;
+        limit_refused = size;
+        return 0;
+    }
+    if (soft_limit && after > soft_limit) {
+        // Fire once; ton_mem_limit_rearm re-enables the check after a collection
+        limit_watermark = hard_limit ? hard_limit : SIZE_MAX;
+        if (soft_limit_hook) soft_limit_hook();
+    }
+    return 1;
+}
 
 /**
- * Allocate memory and track the allocation
+ * Allocate memory and track the allocation (use the ton_malloc macro)
  * @param size Size in bytes to allocate
+ * @param file Source file of the caller, for the allocation profiler
+ * @param line Source line of the caller
  * @return Pointer to allocated memory or NULL on failure
  */
-void* ton_malloc(size_t size) {
+void* ton_malloc_at(size_t size, const char* file, int line) {
     if (size == 0) return NULL;
-    
+    if (total_allocated + size > limit_watermark && !heap_limit_allows(size)) return NULL;
+    if ((alloc_profile_countdown -= (long long)size) < 0) alloc_profile_sample(size, file, line);
+
+    if (allocation_count >= allocation_table_capacity && !allocation_table_grow()) {
+        return NULL;
+    }
+
     void* ptr = malloc(size);
     if (!ptr) return NULL;
 
@@ -24,10 +134,12 @@ void* ton_malloc(size_t size) {
         return NULL;
     }
 
+    size_t bucket = allocation_bucket(ptr, allocation_table_capacity);
     new_alloc->ptr = ptr;
     new_alloc->size = size;
-    new_alloc->next = allocation_head;
-    allocation_head = new_alloc;
+    new_alloc->next = allocation_table[bucket];
+    allocation_table[bucket] = new_alloc;
+    allocation_count++;
     total_allocated += size;
 
     return ptr;
@@ -40,75 +152,230 @@ void* ton_malloc(size_t size) {
 void ton_free(void* ptr) {
     if (!ptr) return;
 
-    Allocation** current = &allocation_head;
-    while (*current) {
-        if ((*current)->ptr == ptr) {
-            Allocation* to_free = *current;
-            *current = to_free->next;
-            total_allocated -= to_free->size;
-            free(to_free->ptr);
-            free(to_free);
-            return;
-        }
-        current = &(*current)->next;
+    Allocation** slot = allocation_find(ptr);
+    if (slot) {
+        Allocation* to_free = *slot;
+        *slot = to_free->next;
+        total_allocated -= to_free->size;
+        allocation_count--;
+        free(to_free->ptr);
+        free(to_free);
+        return;
     }
-    
+
     // If we reach here, the pointer wasn't tracked - free it anyway
     free(ptr);
 }
 
-void* ton_calloc(size_t num, size_t size) {
+void* ton_calloc_at(size_t num, size_t size, const char* file, int line) {
     size_t total_size = num * size;
-    void* ptr = ton_malloc(total_size);
+    void* ptr = ton_malloc_at(total_size, file, line);
     if (ptr) {
         memset(ptr, 0, total_size);
     }
     return ptr;
 }
 
-void* ton_realloc(void* ptr, size_t new_size) {
-    if (!ptr) return ton_malloc(new_size);
+void* ton_realloc_at(void* ptr, size_t new_size, const char* file, int line) {
+    if (!ptr) return ton_malloc_at(new_size, file, line);
 
-    Allocation** current = &allocation_head;
-    while (*current) {
-        if ((*current)->ptr == ptr) {
-            void* new_ptr = realloc(ptr, new_size);
-            if (!new_ptr) return NULL; // Realloc failed
-
-            total_allocated -= (*current)->size;
-            total_allocated += new_size;
-            (*current)->ptr = new_ptr;
-            (*current)->size = new_size;
-            return new_ptr;
-        }
-        current = &(*current)->next;
+    Allocation** slot = allocation_find(ptr);
+    if (!slot) return NULL; // Should not happen if ptr is valid
+
+    size_t old_size = (*slot)->size;
+    if (new_size > old_size && total_allocated + (new_size - old_size) > limit_watermark &&
+        !heap_limit_allows(new_size - old_size)) {
+        return NULL;
+    }
+    if (new_size > old_size && (alloc_profile_countdown -= (long long)(new_size - old_size)) < 0) {
+        alloc_profile_sample(new_size - old_size, file, line);
     }
 
-    return NULL; // Should not happen if ptr is valid
+    void* new_ptr = realloc(ptr, new_size);
+    if (!new_ptr) return NULL; // Realloc failed
+
+    Allocation* record = *slot;
+    total_allocated -= record->size;
+    total_allocated += new_size;
+    record->size = new_size;
+    if (new_ptr != ptr) {
+        // The block moved, so its record belongs to a different bucket now
+        *slot = record->next;
+        size_t bucket = allocation_bucket(new_ptr, allocation_table_capacity);
+        record->ptr = new_ptr;
+        record->next = allocation_table[bucket];
+        allocation_table[bucket] = record;
+    }
+    return new_ptr;
 }
 
-char* ton_strdup(const char* s) {
+char* ton_strdup_at(const char* s, const char* file, int line) {
     if (!s) return NULL;
     size_t len = strlen(s) + 1;
-    char* new_str = (char*)ton_malloc(len);
+    char* new_str = (char*)ton_malloc_at(len, file, line);
     if (!new_str) return NULL;
     memcpy(new_str, s, len);
     return new_str;
 }
 
+/**
+ * Allocate a zeroed block from the scratch nursery
+ * @param size Size in bytes to allocate
+ * @return Pointer to the block or NULL on failure
+ */
+void* ton_scratch_alloc(size_t size) {
+    if (size == 0) return NULL;
+    size_t need = SCRATCH_BLOCK_HEADER + SCRATCH_ALIGN(size);
+
+    if (!scratch_top || scratch_top->capacity - scratch_top->used < need) {
+        ScratchChunk* chunk = NULL;
+        if (scratch_spare && scratch_spare->capacity >= need) {
+            chunk = scratch_spare;
+            scratch_spare = NULL;
+        } else {
+            size_t capacity = need > SCRATCH_CHUNK_SIZE ? need : SCRATCH_CHUNK_SIZE;
+            chunk = (ScratchChunk*)ton_malloc(SCRATCH_CHUNK_HEADER + capacity);
+            if (!chunk) return NULL;
+            chunk->capacity = capacity;
+        }
+        chunk->used = 0;
+        chunk->prev = scratch_top;
+        scratch_top = chunk;
+    }
+
+    char* block = (char*)scratch_top + SCRATCH_CHUNK_HEADER + scratch_top->used;
+    *(size_t*)block = scratch_top->used;
+    scratch_top->used += need;
+    scratch_in_use += need;
+    if (scratch_in_use > scratch_peak) scratch_peak = scratch_in_use;
+
+    void* ptr = block + SCRATCH_BLOCK_HEADER;
+    memset(ptr, 0, size);
+    return ptr;
+}
+
+/**
+ * Release the most recent scratch block (blocks must be freed in LIFO order)
+ * @param ptr Pointer returned by ton_scratch_alloc
+ */
+void ton_scratch_free(void* ptr) {
+    if (!ptr || !scratch_top) return;
+
+    size_t offset = *(size_t*)((char*)ptr - SCRATCH_BLOCK_HEADER);
+    scratch_in_use -= scratch_top->used - offset;
+    scratch_top->used = offset;
+
+    if (offset == 0 && scratch_top->prev) {
+        // Keep one empty chunk around so call-heavy loops do not thrash malloc
+        ScratchChunk* empty = scratch_top;
+        scratch_top = empty->prev;
+        if (scratch_spare && scratch_spare->capacity >= empty->capacity) {
+            ton_free(empty);
+        } else {
+            ton_free(scratch_spare);
+            scratch_spare = empty;
+        }
+    }
+}
+
+/**
+ * Get the high-water mark of the scratch nursery
+ * @return Peak bytes handed out by ton_scratch_alloc
+ */
+size_t ton_scratch_peak() {
+    return scratch_peak;
+}
+
+/**
+ * Configure heap limits
+ * @param soft Usage at which the soft-limit hook fires (0 = none)
+ * @param hard Usage past which allocations fail and the limit flag is set (0 = none)
+ */
+void ton_mem_set_limits(size_t soft, size_t hard) {
+    soft_limit = soft;
+    hard_limit = hard;
+    limit_exceeded = 0;
+    limit_refused = 0;
+    ton_mem_limit_rearm();
+}
+
+size_t ton_mem_soft_limit() {
+    return soft_limit;
+}
+
+size_t ton_mem_hard_limit() {
+    return hard_limit;
+}
+
+/**
+ * Register the callback run when usage first crosses the soft limit
+ * @param hook Function to call (typically requests a collection)
+ */
+void ton_mem_set_limit_hook(void (*hook)(void)) {
+    soft_limit_hook = hook;
+}
+
+/**
+ * Re-evaluate the limits after memory was reclaimed: re-arms the soft limit
+ * and clears the exceeded flag if usage dropped back under the hard limit
+ */
+void ton_mem_limit_rearm() {
+    // A refused allocation still counts: the script needs that much to go on
+    if (!hard_limit || total_allocated + limit_refused <= hard_limit) {
+        limit_exceeded = 0;
+        limit_refused = 0;
+    }
+    if (soft_limit && total_allocated < soft_limit) {
+        limit_watermark = soft_limit;
+    } else {
+        limit_watermark = hard_limit ? hard_limit : SIZE_MAX;
+    }
+}
+
+/**
+ * Check whether an allocation went past the hard limit
+ * @return 1 if the hard limit was exceeded since the flag was last cleared
+ */
+int ton_mem_limit_exceeded() {
+    return limit_exceeded;
+}
+
+void ton_mem_clear_limit_exceeded() {
+    limit_exceeded = 0;
+    limit_refused = 0;
+}
+
+/**
+ * Register a callback that appends subsystem statistics to ton_mem_report
+ * @param hook Function to call at the end of the report (NULL to remove)
+ */
+void ton_mem_set_report_hook(void (*hook)(void)) {
+    report_hook = hook;
+}
+
 void ton_mem_report() {
     printf("--- Memory Report ---\n");
     printf("Total allocated: %llu bytes\n", (unsigned long long)total_allocated);
+    printf("Scratch nursery: %llu bytes in use, %llu bytes peak\n",
+           (unsigned long long)scratch_in_use, (unsigned long long)scratch_peak);
+    if (soft_limit || hard_limit) {
+        printf("Heap limits: soft %llu bytes, hard %llu bytes%s\n",
+               (unsigned long long)soft_limit, (unsigned long long)hard_limit,
+               limit_exceeded ? " (exceeded)" : "");
+    }
     printf("Active allocations:\n");
 
-    Allocation* current = allocation_head;
     int count = 0;
-    while (current) {
-        printf("  - %p: %llu bytes\n", current->ptr, (unsigned long long)current->size);
-        current = current->next;
-        count++;
+    for (size_t i = 0; i < allocation_table_capacity; i++) {
+        Allocation* current = allocation_table[i];
+        while (current) {
+            printf("  - %p: %llu bytes\n", current->ptr, (unsigned long long)current->size);
+            current = current->next;
+            count++;
+        }
     }
     printf("Total active allocations: %d\n", count);
+    if (report_hook) report_hook();
     printf("---------------------\n");
 }
 
@@ -127,15 +394,28 @@ void*  ptr_sub(void* base, ptrdiff_t bytes) { return (void*)((char*)base - bytes
  * Clean up all remaining allocations (for program shutdown)
  */
 void ton_mem_cleanup() {
-    while (allocation_head) {
-        Allocation* to_free = allocation_head;
-        allocation_head = allocation_head->next;
-        if (to_free->ptr) {
-            free(to_free->ptr);
+    for (size_t i = 0; i < allocation_table_capacity; i++) {
+        Allocation* current = allocation_table[i];
+        while (current) {
+            Allocation* next = current->next;
+            if (current->ptr) {
+                free(current->ptr);
+            }
+            free(current);
+            current = next;
         }
-        free(to_free);
     }
+    free(allocation_table);
+    allocation_table = NULL;
+    allocation_table_capacity = 0;
+    allocation_count = 0;
     total_allocated = 0;
+    scratch_top = NULL;
+    scratch_spare = NULL;
+    scratch_in_use = 0;
+    limit_exceeded = 0;
+    limit_refused = 0;
+    ton_mem_limit_rearm();
 }
 
 /**
@@ -144,4 +424,4 @@ void ton_mem_cleanup() {
  */
 size_t ton_mem_usage() {
     return total_allocated;
-}
\ No newline at end of file
+}
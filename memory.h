@@ -9,18 +9,39 @@
 typedef struct Allocation {
     void* ptr;                    // Pointer to allocated memory
     size_t size;                  // Size of allocation in bytes
-    struct Allocation* next;      // Next allocation in linked list
+    struct Allocation* next;      // Next allocation in the same hash bucket
 } Allocation;
 
-// Core memory management functions
-void* ton_malloc(size_t size);
-void* ton_calloc(size_t num, size_t size);
-void* ton_realloc(void* ptr, size_t new_size);
+// Core memory management functions. The allocating entry points are macros
+// so the allocation profiler can attribute each block to its C callsite.
+void* ton_malloc_at(size_t size, const char* file, int line);
+void* ton_calloc_at(size_t num, size_t size, const char* file, int line);
+void* ton_realloc_at(void* ptr, size_t new_size, const char* file, int line);
 void ton_free(void* ptr);
-char* ton_strdup(const char* s);
+char* ton_strdup_at(const char* s, const char* file, int line);
+
+#define ton_malloc(size)            ton_malloc_at((size), __FILE__, __LINE__)
+#define ton_calloc(num, size)       ton_calloc_at((num), (size), __FILE__, __LINE__)
+#define ton_realloc(ptr, new_size)  ton_realloc_at((ptr), (new_size), __FILE__, __LINE__)
+#define ton_strdup(s)               ton_strdup_at((s), __FILE__, __LINE__)
+
+// Scratch nursery for short-lived, LIFO-released buffers
+void* ton_scratch_alloc(size_t size);
+void ton_scratch_free(void* ptr);
+size_t ton_scratch_peak();
+
+// Heap limits (0 = unlimited)
+void ton_mem_set_limits(size_t soft, size_t hard);
+size_t ton_mem_soft_limit();
+size_t ton_mem_hard_limit();
+void ton_mem_set_limit_hook(void (*hook)(void));
+void ton_mem_limit_rearm();
+int ton_mem_limit_exceeded();
+void ton_mem_clear_limit_exceeded();
 
 // Memory tracking and cleanup functions
 void ton_mem_report();
+void ton_mem_set_report_hook(void (*hook)(void));
 void ton_mem_cleanup();
 size_t ton_mem_usage();
 
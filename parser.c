@@ -431,7 +431,53 @@ ASTNode* parse_finally_statement(Parser* parser);
      return (ASTNode*)loop_stmt;
  }
 
+// for item in collection { ... } / for k, v in collection { ... }
+static ASTNode* parse_for_in_statement(Parser* parser) {
+    ForInStatementNode* for_in = (ForInStatementNode*)ton_malloc(sizeof(ForInStatementNode));
+    if (!for_in) {
+        parser_error(parser, "Out of memory while parsing for-in statement");
+        return NULL;
+    }
+    for_in->type = NODE_FOR_IN_STATEMENT;
+    for_in->line = parser->current_token->line;
+    for_in->column = parser->current_token->column;
+    for_in->second_name = NULL;
+    for_in->iterable = NULL;
+    for_in->body = NULL;
+    next_token(parser); // consume 'for'
+
+    for_in->first_name = my_strdup_parser(parser->current_token->lexeme);
+    next_token(parser);
+    if (match_token(parser, TOKEN_COMMA)) {
+        next_token(parser);
+        if (!match_token(parser, TOKEN_IDENTIFIER)) {
+            parser_error(parser, "Expected second loop variable after ','");
+            free_ast_node((ASTNode*)for_in);
+            return NULL;
+        }
+        for_in->second_name = my_strdup_parser(parser->current_token->lexeme);
+        next_token(parser);
+    }
+
+    TonError err = expect_token(parser, TOKEN_IN, "Expected 'in' after loop variables");
+    if (ton_error_is_error(err)) {
+        free_ast_node((ASTNode*)for_in);
+        return NULL;
+    }
+    next_token(parser);
+    for_in->iterable = parse_expression(parser, 0);
+
+    parser->loop_depth++;
+    for_in->body = (BlockStatementNode*)parse_block_statement(parser);
+    parser->loop_depth--;
+    return (ASTNode*)for_in;
+}
+
 ASTNode* parse_for_statement(Parser* parser) {
+    if (parser->peek_token->type == TOKEN_IDENTIFIER) {
+        return parse_for_in_statement(parser);
+    }
+
     ForStatementNode* for_stmt = (ForStatementNode*)ton_malloc(sizeof(ForStatementNode));
     if (!for_stmt) parser_error(parser, "Out of memory while parsing for-statement");
     for_stmt->type = NODE_FOR_STATEMENT;
@@ -441,6 +487,7 @@ ASTNode* parse_for_statement(Parser* parser) {
     for_stmt->condition = NULL;
     for_stmt->update = NULL;
     for_stmt->body = NULL;
+    for_stmt->bounds_analyzed = 0;
 
     TonError err = expect_token(parser, TOKEN_FOR, "Expected 'for'");
     if (ton_error_is_error(err)) {
@@ -877,6 +924,7 @@ ASTNode* parse_continue_statement(Parser* parser) {
          }
          case TOKEN_THIS: {
              left = (ASTNode*)create_identifier_expression_node("this", parser->current_token->line, parser->current_token->column);
+             ((IdentifierExpressionNode*)left)->is_this = 1;
              next_token(parser);
              break;
          }
@@ -1012,7 +1060,15 @@ ASTNode* parse_continue_statement(Parser* parser) {
                              capacity *= 2;
                              arguments = ton_realloc(arguments, sizeof(ASTNode*) * capacity);
                          }
-                         arguments[num_arguments++] = parse_expression(parser, 0);
+                         if (match_token(parser, TOKEN_IDENTIFIER) && parser->peek_token->type == TOKEN_COLON) {
+                             // Field initializer `name: value`
+                             ASTNode* field = (ASTNode*)create_identifier_expression_node(parser->current_token->lexeme, parser->current_token->line, parser->current_token->column);
+                             next_token(parser); // consume field name
+                             next_token(parser); // consume ':'
+                             arguments[num_arguments++] = create_binary_expression_node(field, TOKEN_COLON, parse_expression(parser, 0));
+                         } else {
+                             arguments[num_arguments++] = parse_expression(parser, 0);
+                         }
                          
                          if (match_token(parser, TOKEN_COMMA)) {
                              next_token(parser);
@@ -1083,6 +1139,7 @@ ASTNode* parse_continue_statement(Parser* parser) {
             access->base.column = parser->current_token->column;
             access->array = left;
             access->index = index;
+            access->bounds_hoisted = 0;
             left = (ASTNode*)access;
             continue;
         }
@@ -1108,6 +1165,7 @@ ASTNode* parse_continue_statement(Parser* parser) {
                 method_call->method_name = member_name;
                 method_call->arguments = NULL;
                 method_call->num_arguments = 0;
+                method_call->cache_count = 0;
 
                 if (!match_token(parser, TOKEN_RPAREN)) {
                     // Parse arguments
@@ -1135,6 +1193,8 @@ ASTNode* parse_continue_statement(Parser* parser) {
                 member_access->base.column = dot_column;
                 member_access->object = left;
                 member_access->member = member_name;
+                member_access->cached_type = NULL;
+                member_access->cached_slot = -1;
                 left = (ASTNode*)member_access;
             }
             continue;
@@ -1762,6 +1822,7 @@ ASTNode* parse_class_declaration(Parser* parser) {
     // Parse fields and methods
     char** field_names = NULL;
     VariableType* field_types = NULL;
+    char** field_type_names = NULL;
     int* field_access = NULL;
     int num_fields = 0;
     int field_capacity = 4;
@@ -1774,6 +1835,7 @@ ASTNode* parse_class_declaration(Parser* parser) {
     
     field_names = malloc(field_capacity * sizeof(char*));
     field_types = malloc(field_capacity * sizeof(VariableType));
+    field_type_names = malloc(field_capacity * sizeof(char*));
     field_access = malloc(field_capacity * sizeof(int));
     
     methods = malloc(method_capacity * sizeof(FunctionDeclarationNode*));
@@ -1793,7 +1855,7 @@ ASTNode* parse_class_declaration(Parser* parser) {
                 method_flags = realloc(method_flags, method_capacity * sizeof(int));
             }
             
-            ASTNode* method = parse_function_declaration(parser, true);
+            ASTNode* method = parse_function_declaration(parser, false);
             if (method) {
                 methods[num_methods] = (FunctionDeclarationNode*)method;
                 method_access[num_methods] = access;
@@ -1809,6 +1871,7 @@ ASTNode* parse_class_declaration(Parser* parser) {
                 field_capacity *= 2;
                 field_names = realloc(field_names, field_capacity * sizeof(char*));
                 field_types = realloc(field_types, field_capacity * sizeof(VariableType));
+                field_type_names = realloc(field_type_names, field_capacity * sizeof(char*));
                 field_access = realloc(field_access, field_capacity * sizeof(int));
             }
             
@@ -1824,9 +1887,13 @@ ASTNode* parse_class_declaration(Parser* parser) {
                 // Cleanup and return NULL
                 free(class_name);
                 if (parent_name) free(parent_name);
-                for (int i = 0; i < num_fields; i++) free(field_names[i]);
+                for (int i = 0; i < num_fields; i++) {
+                    free(field_names[i]);
+                    free(field_type_names[i]);
+                }
                 free(field_names);
                 free(field_types);
+                free(field_type_names);
                 free(field_access);
                 for (int i = 0; i < num_methods; i++) free_ast((ASTNode*)methods[i]);
                 free(methods);
@@ -1835,6 +1902,7 @@ ASTNode* parse_class_declaration(Parser* parser) {
                 return NULL;
             }
             field_types[num_fields] = type_node->var_type;
+            field_type_names[num_fields] = type_node->var_type == VAR_TYPE_STRUCT ? type_node->type_name : NULL;
             field_access[num_fields] = access;
             free(type_node);
             
@@ -1861,6 +1929,7 @@ ASTNode* parse_class_declaration(Parser* parser) {
     class_node->parent_name = parent_name;
     class_node->field_names = field_names;
     class_node->field_types = field_types;
+    class_node->field_type_names = field_type_names;
     class_node->field_access = field_access;
     class_node->num_fields = num_fields;
     class_node->methods = methods;
@@ -1948,6 +2017,12 @@ ASTNode* parse_catch_statement(Parser* parser) {
                 exception_type = first_identifier;
                 exception_var = my_strdup_parser(parser->current_token->lexeme);
                 next_token(parser);
+            } else if (parser->current_token->type == TOKEN_COLON) {
+                // Annotated form: catch (varName: Type)
+                exception_var = first_identifier;
+                next_token(parser);
+                exception_type = my_strdup_parser(parser->current_token->lexeme);
+                next_token(parser);
             } else {
                 // Only variable name provided
                 exception_var = first_identifier;
@@ -0,0 +1,694 @@
+#include "persistent.h"
+#include "gc.h"
+#include "hash.h"
+#include "memory.h"
+#include <stddef.h>
+#include <string.h>
+
+// Edit ids are never reused, so nodes left behind by a retired transient
+// can never again be modified in place
+static uint64_t next_edit = 1;
+
+// ---------------------------------------------------------------------------
+// Persistent vector
+
+static TonPVecNode* pvec_node_new(int leaf, uint64_t edit) {
+    size_t slots = leaf ? sizeof(Value) * TONPVEC_WIDTH : sizeof(TonPVecNode*) * TONPVEC_WIDTH;
+    TonPVecNode* node = gc_alloc(GC_KIND_PVEC_NODE, offsetof(TonPVecNode, slots) + slots);
+    if (!node) return NULL;
+    node->edit = edit;
+    node->leaf = leaf;
+    node->count = 0;
+    return node;
+}
+
+// Copy of `node` owned by transient `edit` (0 for a persistent copy)
+static TonPVecNode* pvec_node_copy(TonPVecNode* node, uint64_t edit) {
+    TonPVecNode* copy = pvec_node_new(node->leaf, edit);
+    if (!copy) return NULL;
+    if (node->leaf) {
+        for (int i = 0; i < node->count; i++) {
+            copy->slots.values[i] = value_copy(&node->slots.values[i]);
+            gc_write_barrier(copy, &node->slots.values[i]);
+        }
+        copy->count = node->count;
+    } else {
+        for (int i = 0; i < TONPVEC_WIDTH; i++) {
+            copy->slots.children[i] = node->slots.children[i];
+            gc_write_barrier_object(copy, node->slots.children[i]);
+        }
+    }
+    return copy;
+}
+
+// `node` itself if transient `edit` owns it, otherwise a copy that it owns
+static TonPVecNode* pvec_editable(TonPVecNode* node, uint64_t edit) {
+    if (edit && node->edit == edit) return node;
+    return pvec_node_copy(node, edit);
+}
+
+static void pvec_leaf_store(TonPVecNode* leaf, int i, const Value* value) {
+    if (i < leaf->count) value_release(&leaf->slots.values[i]);
+    leaf->slots.values[i] = value_copy(value);
+    if (i >= leaf->count) leaf->count = i + 1;
+    gc_write_barrier(leaf, value);
+}
+
+static void pvec_child_store(TonPVecNode* node, int i, TonPVecNode* child) {
+    node->slots.children[i] = child;
+    gc_write_barrier_object(node, child);
+}
+
+static TonPVec* pvec_new(int count, int shift, TonPVecNode* root, TonPVecNode* tail, uint64_t edit) {
+    TonPVec* vec = gc_alloc(GC_KIND_PVEC, sizeof(TonPVec));
+    if (!vec) return NULL;
+    vec->count = count;
+    vec->shift = shift;
+    vec->root = root;
+    vec->tail = tail;
+    vec->edit = edit;
+    vec->retired = 0;
+    gc_write_barrier_object(vec, root);
+    gc_write_barrier_object(vec, tail);
+    return vec;
+}
+
+// The outcome of an update: the transient itself, or a new persistent version
+static TonPVec* pvec_result(TonPVec* vec, int count, int shift, TonPVecNode* root, TonPVecNode* tail) {
+    if (!root || !tail) return NULL;
+    if (!vec->edit) return pvec_new(count, shift, root, tail, 0);
+    vec->count = count;
+    vec->shift = shift;
+    vec->root = root;
+    vec->tail = tail;
+    gc_write_barrier_object(vec, root);
+    gc_write_barrier_object(vec, tail);
+    return vec;
+}
+
+// Index of the first value held in the tail rather than the trie
+static int pvec_tail_offset(int count) {
+    return count < TONPVEC_WIDTH ? 0 : ((count - 1) >> TONPVEC_BITS) << TONPVEC_BITS;
+}
+
+static TonPVecNode* pvec_leaf_for(const TonPVec* vec, int index) {
+    if (index >= pvec_tail_offset(vec->count)) return vec->tail;
+    TonPVecNode* node = vec->root;
+    for (int level = vec->shift; level > 0; level -= TONPVEC_BITS) {
+        node = node->slots.children[(index >> level) & TONPVEC_MASK];
+    }
+    return node;
+}
+
+// Chain of single-child inner nodes from `level` down to `node`
+static TonPVecNode* pvec_new_path(int level, TonPVecNode* node, uint64_t edit) {
+    if (level == 0) return node;
+    TonPVecNode* parent = pvec_node_new(0, edit);
+    TonPVecNode* child = pvec_new_path(level - TONPVEC_BITS, node, edit);
+    if (!parent || !child) return NULL;
+    pvec_child_store(parent, 0, child);
+    return parent;
+}
+
+// Hang the full tail leaf under `parent` (at `level`); count is the size before the push
+static TonPVecNode* pvec_push_tail(int count, int level, TonPVecNode* parent, TonPVecNode* tail, uint64_t edit) {
+    TonPVecNode* node = pvec_editable(parent, edit);
+    if (!node) return NULL;
+    int sub = ((count - 1) >> level) & TONPVEC_MASK;
+    TonPVecNode* child;
+    if (level == TONPVEC_BITS) {
+        child = tail;
+    } else if (node->slots.children[sub]) {
+        child = pvec_push_tail(count, level - TONPVEC_BITS, node->slots.children[sub], tail, edit);
+    } else {
+        child = pvec_new_path(level - TONPVEC_BITS, tail, edit);
+    }
+    if (!child) return NULL;
+    pvec_child_store(node, sub, child);
+    return node;
+}
+
+static TonPVecNode* pvec_assoc(int level, TonPVecNode* node, int index, const Value* value, uint64_t edit) {
+    TonPVecNode* copy = pvec_editable(node, edit);
+    if (!copy) return NULL;
+    if (level == 0) {
+        pvec_leaf_store(copy, index & TONPVEC_MASK, value);
+        return copy;
+    }
+    int sub = (index >> level) & TONPVEC_MASK;
+    TonPVecNode* child = pvec_assoc(level - TONPVEC_BITS, copy->slots.children[sub], index, value, edit);
+    if (!child) return NULL;
+    pvec_child_store(copy, sub, child);
+    return copy;
+}
+
+// Drop the rightmost leaf below `node`; NULL with *failed clear means the
+// node is left empty
+static TonPVecNode* pvec_pop_tail(int count, int level, TonPVecNode* node, uint64_t edit, int* failed) {
+    int sub = ((count - 2) >> level) & TONPVEC_MASK;
+    TonPVecNode* child = NULL;
+    if (level > TONPVEC_BITS) {
+        child = pvec_pop_tail(count, level - TONPVEC_BITS, node->slots.children[sub], edit, failed);
+        if (*failed) return NULL;
+    }
+    if (!child && sub == 0) return NULL;
+
+    TonPVecNode* copy = pvec_editable(node, edit);
+    if (!copy) {
+        *failed = 1;
+        return NULL;
+    }
+    pvec_child_store(copy, sub, child);
+    return copy;
+}
+
+TonPVec* tonpvec_create(void) {
+    TonPVecNode* root = pvec_node_new(0, 0);
+    TonPVecNode* tail = pvec_node_new(1, 0);
+    if (!root || !tail) return NULL;
+    return pvec_new(0, TONPVEC_BITS, root, tail, 0);
+}
+
+TonPVec* tonpvec_push(TonPVec* vec, Value value) {
+    if (!vec || vec->retired) return NULL;
+    uint64_t edit = vec->edit;
+    int count = vec->count;
+    int tail_offset = pvec_tail_offset(count);
+
+    if (count - tail_offset < TONPVEC_WIDTH) {
+        TonPVecNode* tail = pvec_editable(vec->tail, edit);
+        if (!tail) return NULL;
+        pvec_leaf_store(tail, count - tail_offset, &value);
+        return pvec_result(vec, count + 1, vec->shift, vec->root, tail);
+    }
+
+    // The tail is full: it moves into the trie, growing a level if the root is full
+    TonPVecNode* root;
+    int shift = vec->shift;
+    if ((count >> TONPVEC_BITS) > (1 << vec->shift)) {
+        root = pvec_node_new(0, edit);
+        TonPVecNode* path = pvec_new_path(vec->shift, vec->tail, edit);
+        if (!root || !path) return NULL;
+        pvec_child_store(root, 0, vec->root);
+        pvec_child_store(root, 1, path);
+        shift += TONPVEC_BITS;
+    } else {
+        root = pvec_push_tail(count, vec->shift, vec->root, vec->tail, edit);
+    }
+    TonPVecNode* tail = pvec_node_new(1, edit);
+    if (!root || !tail) return NULL;
+    pvec_leaf_store(tail, 0, &value);
+    return pvec_result(vec, count + 1, shift, root, tail);
+}
+
+TonPVec* tonpvec_set(TonPVec* vec, int index, Value value) {
+    if (!vec || vec->retired || index < 0 || index >= vec->count) return NULL;
+    if (index >= pvec_tail_offset(vec->count)) {
+        TonPVecNode* tail = pvec_editable(vec->tail, vec->edit);
+        if (!tail) return NULL;
+        pvec_leaf_store(tail, index & TONPVEC_MASK, &value);
+        return pvec_result(vec, vec->count, vec->shift, vec->root, tail);
+    }
+    TonPVecNode* root = pvec_assoc(vec->shift, vec->root, index, &value, vec->edit);
+    return pvec_result(vec, vec->count, vec->shift, root, vec->tail);
+}
+
+TonPVec* tonpvec_pop(TonPVec* vec) {
+    if (!vec || vec->retired || vec->count == 0) return NULL;
+    uint64_t edit = vec->edit;
+    int count = vec->count;
+
+    if (count == 1) {
+        return pvec_result(vec, 0, TONPVEC_BITS, pvec_node_new(0, edit), pvec_node_new(1, edit));
+    }
+    if (count - pvec_tail_offset(count) > 1) {
+        TonPVecNode* tail = pvec_editable(vec->tail, edit);
+        if (!tail) return NULL;
+        value_release(&tail->slots.values[--tail->count]);
+        return pvec_result(vec, count - 1, vec->shift, vec->root, tail);
+    }
+
+    // The tail empties: the rightmost leaf of the trie becomes the tail
+    TonPVecNode* tail = pvec_leaf_for(vec, count - 2);
+    int failed = 0;
+    TonPVecNode* root = pvec_pop_tail(count, vec->shift, vec->root, edit, &failed);
+    if (failed) return NULL;
+    int shift = vec->shift;
+    if (!root) {
+        root = pvec_node_new(0, edit);
+    } else if (shift > TONPVEC_BITS && !root->slots.children[1]) {
+        root = root->slots.children[0];
+        shift -= TONPVEC_BITS;
+    }
+    return pvec_result(vec, count - 1, shift, root, tail);
+}
+
+Value tonpvec_get(TonPVec* vec, int index) {
+    if (!vec || index < 0 || index >= vec->count) {
+        return create_value_null();
+    }
+    return pvec_leaf_for(vec, index)->slots.values[index & TONPVEC_MASK];
+}
+
+int tonpvec_size(TonPVec* vec) {
+    return vec ? vec->count : 0;
+}
+
+TonPVec* tonpvec_transient(TonPVec* vec) {
+    if (!vec || vec->retired) return NULL;
+    return pvec_new(vec->count, vec->shift, vec->root, vec->tail, next_edit++);
+}
+
+TonPVec* tonpvec_persistent(TonPVec* vec) {
+    if (!vec || vec->retired) return NULL;
+    if (!vec->edit) return vec;
+    TonPVec* frozen = pvec_new(vec->count, vec->shift, vec->root, vec->tail, 0);
+    if (!frozen) return NULL;
+    vec->edit = 0;
+    vec->retired = 1;
+    return frozen;
+}
+
+void tonpvec_destroy(TonPVec* vec) {
+    if (vec) gc_free(vec);
+}
+
+void tonpvec_node_destroy(TonPVecNode* node) {
+    if (!node) return;
+    if (node->leaf) {
+        for (int i = 0; i < node->count; i++) value_release(&node->slots.values[i]);
+    }
+    gc_free(node);
+}
+
+// ---------------------------------------------------------------------------
+// Persistent hash map (CHAMP): each node keeps its inline entries and its
+// children in two dense arrays indexed by popcount over the bitmaps, and a
+// subtree holding a single entry is always inlined into its parent, so every
+// map has exactly one shape.
+
+static inline int pmap_popcount(uint32_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcount(x);
+#else
+    x = x - ((x >> 1) & 0x55555555u);
+    x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+    return (int)((((x + (x >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24);
+#endif
+}
+
+static inline uint32_t pmap_bit(uint64_t hash, int shift) {
+    return 1u << ((hash >> shift) & 31);
+}
+
+// Position in a dense array for `bit`: the number of lower bits set in `bitmap`
+static inline int pmap_index(uint32_t bitmap, uint32_t bit) {
+    return pmap_popcount(bitmap & (bit - 1));
+}
+
+static TonPMapNode* pmap_node_new(uint64_t edit, int entry_capacity, int child_capacity) {
+    TonPMapNode* node = gc_alloc(GC_KIND_PMAP_NODE, sizeof(TonPMapNode));
+    if (!node) return NULL;
+    node->edit = edit;
+    if (entry_capacity > 0) {
+        node->entries = (TonMapEntry*)ton_malloc(sizeof(TonMapEntry) * entry_capacity);
+        node->entry_capacity = entry_capacity;
+    }
+    if (child_capacity > 0) {
+        node->children = (TonPMapNode**)ton_malloc(sizeof(TonPMapNode*) * child_capacity);
+        node->child_capacity = child_capacity;
+    }
+    if ((entry_capacity > 0 && !node->entries) || (child_capacity > 0 && !node->children)) {
+        ton_free(node->entries);
+        ton_free(node->children);
+        gc_free(node);
+        return NULL;
+    }
+    return node;
+}
+
+// Copy of `node`, owned by transient `edit`, with room for more entries and children
+static TonPMapNode* pmap_node_copy(TonPMapNode* node, uint64_t edit, int more_entries, int more_children) {
+    TonPMapNode* copy = pmap_node_new(edit, node->entry_count + more_entries, node->child_count + more_children);
+    if (!copy) return NULL;
+    copy->datamap = node->datamap;
+    copy->nodemap = node->nodemap;
+    copy->collision = node->collision;
+    for (int i = 0; i < node->entry_count; i++) {
+        TonMapEntry* entry = &node->entries[i];
+        copy->entries[i].key = value_copy(&entry->key);
+        copy->entries[i].value = value_copy(&entry->value);
+        copy->entries[i].hash = entry->hash;
+        gc_write_barrier(copy, &entry->key);
+        gc_write_barrier(copy, &entry->value);
+    }
+    copy->entry_count = node->entry_count;
+    for (int i = 0; i < node->child_count; i++) {
+        copy->children[i] = node->children[i];
+        gc_write_barrier_object(copy, node->children[i]);
+    }
+    copy->child_count = node->child_count;
+    return copy;
+}
+
+// Grow a node's arrays in place (only for nodes the caller owns)
+static int pmap_reserve(TonPMapNode* node, int more_entries, int more_children) {
+    int entries = node->entry_count + more_entries;
+    if (entries > node->entry_capacity) {
+        int capacity = entries * 2;
+        TonMapEntry* grown = (TonMapEntry*)ton_realloc(node->entries, sizeof(TonMapEntry) * capacity);
+        if (!grown) return 0;
+        node->entries = grown;
+        node->entry_capacity = capacity;
+    }
+    int children = node->child_count + more_children;
+    if (children > node->child_capacity) {
+        int capacity = children * 2;
+        TonPMapNode** grown = (TonPMapNode**)ton_realloc(node->children, sizeof(TonPMapNode*) * capacity);
+        if (!grown) return 0;
+        node->children = grown;
+        node->child_capacity = capacity;
+    }
+    return 1;
+}
+
+// `node` itself if transient `edit` owns it, otherwise a copy that it owns;
+// either way with room for the given number of additions
+static TonPMapNode* pmap_editable(TonPMapNode* node, uint64_t edit, int more_entries, int more_children) {
+    if (edit && node->edit == edit) {
+        return pmap_reserve(node, more_entries, more_children) ? node : NULL;
+    }
+    return pmap_node_copy(node, edit, more_entries, more_children);
+}
+
+static void pmap_insert_entry(TonPMapNode* node, int i, const Value* key, const Value* value, uint64_t hash) {
+    memmove(&node->entries[i + 1], &node->entries[i], sizeof(TonMapEntry) * (node->entry_count - i));
+    node->entries[i].key = value_copy(key);
+    node->entries[i].value = value_copy(value);
+    node->entries[i].hash = hash;
+    node->entry_count++;
+    gc_write_barrier(node, key);
+    gc_write_barrier(node, value);
+}
+
+static void pmap_remove_entry(TonPMapNode* node, int i) {
+    value_release(&node->entries[i].key);
+    value_release(&node->entries[i].value);
+    memmove(&node->entries[i], &node->entries[i + 1], sizeof(TonMapEntry) * (node->entry_count - i - 1));
+    node->entry_count--;
+}
+
+static void pmap_set_entry_value(TonPMapNode* node, int i, const Value* value) {
+    value_release(&node->entries[i].value);
+    node->entries[i].value = value_copy(value);
+    gc_write_barrier(node, value);
+}
+
+static void pmap_insert_child(TonPMapNode* node, int i, TonPMapNode* child) {
+    memmove(&node->children[i + 1], &node->children[i], sizeof(TonPMapNode*) * (node->child_count - i));
+    node->children[i] = child;
+    node->child_count++;
+    gc_write_barrier_object(node, child);
+}
+
+static void pmap_remove_child(TonPMapNode* node, int i) {
+    memmove(&node->children[i], &node->children[i + 1], sizeof(TonPMapNode*) * (node->child_count - i - 1));
+    node->child_count--;
+}
+
+static void pmap_set_child(TonPMapNode* node, int i, TonPMapNode* child) {
+    node->children[i] = child;
+    gc_write_barrier_object(node, child);
+}
+
+// Subtree holding `existing` and the new entry, whose hashes agree below `shift`
+static TonPMapNode* pmap_merge(const TonMapEntry* existing, const Value* key, const Value* value, uint64_t hash, int shift, uint64_t edit) {
+    if (shift >= TONPMAP_MAX_SHIFT) {
+        TonPMapNode* node = pmap_node_new(edit, 2, 0);
+        if (!node) return NULL;
+        node->collision = 1;
+        pmap_insert_entry(node, 0, &existing->key, &existing->value, existing->hash);
+        pmap_insert_entry(node, 1, key, value, hash);
+        return node;
+    }
+
+    uint32_t old_bit = pmap_bit(existing->hash, shift);
+    uint32_t new_bit = pmap_bit(hash, shift);
+    if (old_bit != new_bit) {
+        TonPMapNode* node = pmap_node_new(edit, 2, 0);
+        if (!node) return NULL;
+        node->datamap = old_bit | new_bit;
+        pmap_insert_entry(node, 0, &existing->key, &existing->value, existing->hash);
+        pmap_insert_entry(node, new_bit < old_bit ? 0 : 1, key, value, hash);
+        return node;
+    }
+
+    TonPMapNode* child = pmap_merge(existing, key, value, hash, shift + TONPMAP_BITS, edit);
+    TonPMapNode* node = child ? pmap_node_new(edit, 0, 1) : NULL;
+    if (!node) return NULL;
+    node->nodemap = old_bit;
+    pmap_insert_child(node, 0, child);
+    return node;
+}
+
+// Returns the updated node (`node` itself if it was changed in place), or
+// NULL if out of memory. Sets *added when the key was not present before.
+static TonPMapNode* pmap_insert(TonPMapNode* node, const Value* key, uint64_t hash, const Value* value, int shift, uint64_t edit, int* added) {
+    if (node->collision) {
+        for (int i = 0; i < node->entry_count; i++) {
+            if (!tonmap_key_equal(&node->entries[i].key, key)) continue;
+            TonPMapNode* updated = pmap_editable(node, edit, 0, 0);
+            if (updated) pmap_set_entry_value(updated, i, value);
+            return updated;
+        }
+        TonPMapNode* updated = pmap_editable(node, edit, 1, 0);
+        if (!updated) return NULL;
+        pmap_insert_entry(updated, updated->entry_count, key, value, hash);
+        *added = 1;
+        return updated;
+    }
+
+    uint32_t bit = pmap_bit(hash, shift);
+    if (node->datamap & bit) {
+        int i = pmap_index(node->datamap, bit);
+        const TonMapEntry* entry = &node->entries[i];
+        if (entry->hash == hash && tonmap_key_equal(&entry->key, key)) {
+            TonPMapNode* updated = pmap_editable(node, edit, 0, 0);
+            if (updated) pmap_set_entry_value(updated, i, value);
+            return updated;
+        }
+        // Two keys in one slot: push both down into a new subtree
+        TonPMapNode* child = pmap_merge(entry, key, value, hash, shift + TONPMAP_BITS, edit);
+        TonPMapNode* updated = child ? pmap_editable(node, edit, 0, 1) : NULL;
+        if (!updated) return NULL;
+        pmap_remove_entry(updated, i);
+        updated->datamap ^= bit;
+        pmap_insert_child(updated, pmap_index(updated->nodemap, bit), child);
+        updated->nodemap |= bit;
+        *added = 1;
+        return updated;
+    }
+
+    if (node->nodemap & bit) {
+        int c = pmap_index(node->nodemap, bit);
+        TonPMapNode* child = node->children[c];
+        TonPMapNode* new_child = pmap_insert(child, key, hash, value, shift + TONPMAP_BITS, edit, added);
+        if (!new_child) return NULL;
+        if (new_child == child) return node;
+        TonPMapNode* updated = pmap_editable(node, edit, 0, 0);
+        if (updated) pmap_set_child(updated, c, new_child);
+        return updated;
+    }
+
+    TonPMapNode* updated = pmap_editable(node, edit, 1, 0);
+    if (!updated) return NULL;
+    pmap_insert_entry(updated, pmap_index(node->datamap, bit), key, value, hash);
+    updated->datamap |= bit;
+    *added = 1;
+    return updated;
+}
+
+// Returns the updated node (`node` itself if nothing changed or it was
+// changed in place), or NULL if out of memory. Sets *removed when the key was found.
+static TonPMapNode* pmap_delete(TonPMapNode* node, const Value* key, uint64_t hash, int shift, uint64_t edit, int* removed) {
+    if (node->collision) {
+        for (int i = 0; i < node->entry_count; i++) {
+            if (!tonmap_key_equal(&node->entries[i].key, key)) continue;
+            TonPMapNode* updated = pmap_editable(node, edit, 0, 0);
+            if (!updated) return NULL;
+            pmap_remove_entry(updated, i);
+            *removed = 1;
+            return updated;
+        }
+        return node;
+    }
+
+    uint32_t bit = pmap_bit(hash, shift);
+    if (node->datamap & bit) {
+        int i = pmap_index(node->datamap, bit);
+        const TonMapEntry* entry = &node->entries[i];
+        if (entry->hash != hash || !tonmap_key_equal(&entry->key, key)) return node;
+        TonPMapNode* updated = pmap_editable(node, edit, 0, 0);
+        if (!updated) return NULL;
+        pmap_remove_entry(updated, i);
+        updated->datamap ^= bit;
+        *removed = 1;
+        return updated;
+    }
+
+    if (!(node->nodemap & bit)) return node;
+    int c = pmap_index(node->nodemap, bit);
+    TonPMapNode* child = node->children[c];
+    TonPMapNode* new_child = pmap_delete(child, key, hash, shift + TONPMAP_BITS, edit, removed);
+    if (!new_child) return NULL;
+    if (!*removed) return node;
+
+    if (new_child->child_count == 0 && new_child->entry_count == 1) {
+        // The subtree shrank to one entry, which moves up into this node
+        TonPMapNode* updated = pmap_editable(node, edit, 1, 0);
+        if (!updated) return NULL;
+        const TonMapEntry* entry = &new_child->entries[0];
+        pmap_remove_child(updated, c);
+        updated->nodemap ^= bit;
+        pmap_insert_entry(updated, pmap_index(updated->datamap, bit), &entry->key, &entry->value, entry->hash);
+        updated->datamap |= bit;
+        return updated;
+    }
+    if (new_child == child) return node;
+    TonPMapNode* updated = pmap_editable(node, edit, 0, 0);
+    if (updated) pmap_set_child(updated, c, new_child);
+    return updated;
+}
+
+static TonPMap* pmap_new(int count, TonPMapNode* root, uint64_t edit) {
+    TonPMap* map = gc_alloc(GC_KIND_PMAP, sizeof(TonPMap));
+    if (!map) return NULL;
+    map->count = count;
+    map->root = root;
+    map->edit = edit;
+    map->retired = 0;
+    gc_write_barrier_object(map, root);
+    return map;
+}
+
+// The outcome of an update: the transient itself, or a new persistent version
+static TonPMap* pmap_result(TonPMap* map, int count, TonPMapNode* root) {
+    if (!root) return NULL;
+    if (!map->edit) return pmap_new(count, root, 0);
+    map->count = count;
+    map->root = root;
+    gc_write_barrier_object(map, root);
+    return map;
+}
+
+TonPMap* tonpmap_create(void) {
+    TonPMapNode* root = pmap_node_new(0, 0, 0);
+    if (!root) return NULL;
+    return pmap_new(0, root, 0);
+}
+
+TonPMap* tonpmap_set(TonPMap* map, const Value* key, Value value) {
+    uint64_t hash;
+    if (!map || map->retired || !tonmap_hash_key(key, ton_hash_seed(), &hash)) return NULL;
+    int added = 0;
+    TonPMapNode* root = pmap_insert(map->root, key, hash, &value, 0, map->edit, &added);
+    return pmap_result(map, map->count + added, root);
+}
+
+TonPMap* tonpmap_remove(TonPMap* map, const Value* key) {
+    uint64_t hash;
+    if (!map || map->retired || !tonmap_hash_key(key, ton_hash_seed(), &hash)) return NULL;
+    int removed = 0;
+    TonPMapNode* root = pmap_delete(map->root, key, hash, 0, map->edit, &removed);
+    if (root && !removed && !map->edit) return map; // Nothing to remove: the version is unchanged
+    return pmap_result(map, map->count - removed, root);
+}
+
+int tonpmap_get(TonPMap* map, const Value* key, Value* out) {
+    uint64_t hash;
+    if (!map || !tonmap_hash_key(key, ton_hash_seed(), &hash)) return 0;
+    TonPMapNode* node = map->root;
+    for (int shift = 0; ; shift += TONPMAP_BITS) {
+        if (node->collision) {
+            for (int i = 0; i < node->entry_count; i++) {
+                if (tonmap_key_equal(&node->entries[i].key, key)) {
+                    *out = node->entries[i].value;
+                    return 1;
+                }
+            }
+            return 0;
+        }
+        uint32_t bit = pmap_bit(hash, shift);
+        if (node->datamap & bit) {
+            const TonMapEntry* entry = &node->entries[pmap_index(node->datamap, bit)];
+            if (entry->hash != hash || !tonmap_key_equal(&entry->key, key)) return 0;
+            *out = entry->value;
+            return 1;
+        }
+        if (!(node->nodemap & bit)) return 0;
+        node = node->children[pmap_index(node->nodemap, bit)];
+    }
+}
+
+int tonpmap_size(TonPMap* map) {
+    return map ? map->count : 0;
+}
+
+TonPMap* tonpmap_transient(TonPMap* map) {
+    if (!map || map->retired) return NULL;
+    return pmap_new(map->count, map->root, next_edit++);
+}
+
+TonPMap* tonpmap_persistent(TonPMap* map) {
+    if (!map || map->retired) return NULL;
+    if (!map->edit) return map;
+    TonPMap* frozen = pmap_new(map->count, map->root, 0);
+    if (!frozen) return NULL;
+    map->edit = 0;
+    map->retired = 1;
+    return frozen;
+}
+
+void tonpmap_destroy(TonPMap* map) {
+    if (map) gc_free(map);
+}
+
+void tonpmap_node_destroy(TonPMapNode* node) {
+    if (!node) return;
+    for (int i = 0; i < node->entry_count; i++) {
+        value_release(&node->entries[i].key);
+        value_release(&node->entries[i].value);
+    }
+    ton_free(node->entries);
+    ton_free(node->children);
+    gc_free(node);
+}
+
+void tonpmap_iter_init(TonPMapIter* iter, TonPMap* map) {
+    iter->depth = 0;
+    if (!map || !map->root) return;
+    iter->nodes[0] = map->root;
+    iter->entry_pos[0] = 0;
+    iter->child_pos[0] = 0;
+    iter->depth = 1;
+}
+
+// Entries of a node come before those of its children
+const TonMapEntry* tonpmap_iter_next(TonPMapIter* iter) {
+    while (iter->depth > 0) {
+        int d = iter->depth - 1;
+        TonPMapNode* node = iter->nodes[d];
+        if (iter->entry_pos[d] < node->entry_count) {
+            return &node->entries[iter->entry_pos[d]++];
+        }
+        if (iter->child_pos[d] < node->child_count && iter->depth < TONPMAP_MAX_DEPTH) {
+            iter->nodes[iter->depth] = node->children[iter->child_pos[d]++];
+            iter->entry_pos[iter->depth] = 0;
+            iter->child_pos[iter->depth] = 0;
+            iter->depth++;
+            continue;
+        }
+        iter->depth--;
+    }
+    return NULL;
+}
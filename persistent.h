@@ -0,0 +1,108 @@
+#ifndef TON_PERSISTENT_H
+#define TON_PERSISTENT_H
+
+#include "collections.h"
+#include <stdint.h>
+
+#define TONPVEC_BITS 5                       // Index bits consumed per trie level
+#define TONPVEC_WIDTH (1 << TONPVEC_BITS)    // Slots per node
+#define TONPVEC_MASK (TONPVEC_WIDTH - 1)
+#define TONPMAP_BITS 5                       // Hash bits consumed per trie level
+#define TONPMAP_MAX_SHIFT 64                 // Past this, keys with equal hashes share a collision node
+
+// Persistent collections: every update returns a new version and leaves the
+// old one intact. Versions share all nodes off the updated path, so an
+// update copies O(log32 n) nodes. Nodes are collected objects and may be
+// shared by any number of versions.
+//
+// A transient is a version that may be updated in place. Nodes record the
+// transient (by edit id) that created them; a transient mutates its own
+// nodes directly and copies anything else on first write. Turning it back
+// into a persistent version ends the transient, so batches of updates cost
+// one copy per touched node instead of one path copy per update.
+
+// Node of a persistent vector trie: a leaf of values or an inner node of children
+typedef struct TonPVecNode {
+    uint64_t edit;                // Transient that may modify this node in place, 0 if none
+    int leaf;
+    int count;                    // Values in use (leaves only)
+    union {
+        struct TonPVecNode* children[TONPVEC_WIDTH];
+        Value values[TONPVEC_WIDTH];
+    } slots;
+} TonPVecNode;
+
+// TonPVec - Persistent vector: a 32-way trie of full leaves plus a tail leaf
+// that takes pushes until it fills
+typedef struct {
+    int count;
+    int shift;                    // Index bits below the root (TONPVEC_BITS for one level)
+    TonPVecNode* root;
+    TonPVecNode* tail;            // Last count - tail offset values
+    uint64_t edit;                // Nonzero while transient
+    int retired;                  // Transient already turned persistent; refuses further use
+} TonPVec;
+
+// Node of a persistent map (CHAMP layout): inline entries for the hash
+// fragments in `datamap`, child nodes for those in `nodemap`. Past the last
+// level, a collision node lists every entry with the same full hash.
+typedef struct TonPMapNode {
+    uint64_t edit;                // Transient that may modify this node in place, 0 if none
+    uint32_t datamap;
+    uint32_t nodemap;
+    int collision;                // Collision node: `entry_count` entries, no bitmaps
+    int entry_count;
+    int child_count;
+    int entry_capacity;
+    int child_capacity;
+    TonMapEntry* entries;         // In fragment order (insertion order in collision nodes)
+    struct TonPMapNode** children; // In fragment order
+} TonPMapNode;
+
+// TonPMap - Persistent hash map (hash array mapped trie) keyed by hashable Values
+typedef struct {
+    int count;
+    TonPMapNode* root;
+    uint64_t edit;                // Nonzero while transient
+    int retired;                  // Transient already turned persistent; refuses further use
+} TonPMap;
+
+#define TONPMAP_MAX_DEPTH (TONPMAP_MAX_SHIFT / TONPMAP_BITS + 2)
+
+// Depth-first walk over the entries of a TonPMap
+typedef struct {
+    TonPMapNode* nodes[TONPMAP_MAX_DEPTH];
+    int entry_pos[TONPMAP_MAX_DEPTH];
+    int child_pos[TONPMAP_MAX_DEPTH];
+    int depth;
+} TonPMapIter;
+
+// TonPVec functions. Updates return the new version (the vector itself if
+// it is transient) or NULL if out of memory.
+TonPVec* tonpvec_create(void);
+TonPVec* tonpvec_push(TonPVec* vec, Value value);
+TonPVec* tonpvec_set(TonPVec* vec, int index, Value value);
+TonPVec* tonpvec_pop(TonPVec* vec);
+Value tonpvec_get(TonPVec* vec, int index);
+int tonpvec_size(TonPVec* vec);
+TonPVec* tonpvec_transient(TonPVec* vec);
+TonPVec* tonpvec_persistent(TonPVec* vec);
+void tonpvec_destroy(TonPVec* vec);
+void tonpvec_node_destroy(TonPVecNode* node);
+
+// TonPMap functions. Keys must be hashable (tonmap_key_hashable); updates
+// return the new version (the map itself if it is transient) or NULL if out
+// of memory.
+TonPMap* tonpmap_create(void);
+TonPMap* tonpmap_set(TonPMap* map, const Value* key, Value value);
+TonPMap* tonpmap_remove(TonPMap* map, const Value* key);
+int tonpmap_get(TonPMap* map, const Value* key, Value* out);
+int tonpmap_size(TonPMap* map);
+TonPMap* tonpmap_transient(TonPMap* map);
+TonPMap* tonpmap_persistent(TonPMap* map);
+void tonpmap_destroy(TonPMap* map);
+void tonpmap_node_destroy(TonPMapNode* node);
+void tonpmap_iter_init(TonPMapIter* iter, TonPMap* map);
+const TonMapEntry* tonpmap_iter_next(TonPMapIter* iter);
+
+#endif // TON_PERSISTENT_H
@@ -16,6 +16,12 @@
 #include "sha256.h"
 #include <string.h>
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SHA256_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
 /****************************** MACROS ******************************/
 #define ROTLEFT(a,b) (((a) << (b)) | ((a) >> (32-(b))))
 #define ROTRIGHT(a,b) (((a) >> (b)) | ((a) << (32-(b))))
@@ -36,50 +42,180 @@ static const WORD k[64] = {
 	0x27b70a85,0x2e1b2138,0x4d2c6dfc,0x53380d13,0x650a7354,0x766a0abb,0x81c2c92e,0x92722c85,
 	0xa2bfe8a1,0xa81a664b,0xc24b8b70,0xc76c51a3,0xd192e819,0xd6990624,0xf40e3585,0x106aa070,
 	0x19a4c116,0x1e376c08,0x2748774c,0x34b0bcb5,0x391c0cb3,0x4ed8aa4a,0x5b9cca4f,0x682e6ff3,
-	0x748f82ee,0x78a5636f,0x84c87814,0x8cc70208,0x90befffa,0x98385313,0xa4506ceb,0xbef9a3f7
+	0x748f82ee,0x78a5636f,0x84c87814,0x8cc70208,0x90befffa,0xa4506ceb,0xbef9a3f7,0xc67178f2
 };
 
 /*********************** FUNCTION DEFINITIONS ***********************/
-void sha256_transform(SHA256_CTX *ctx, const BYTE data[])
+static WORD load_be32(const BYTE *p)
+{
+	return ((WORD)p[0] << 24) | ((WORD)p[1] << 16) | ((WORD)p[2] << 8) | (WORD)p[3];
+}
+
+static void sha256_blocks_scalar(WORD state[8], const BYTE data[], size_t blocks)
+{
+	WORD a, b, c, d, e, f, g, h, i, t1, t2, m[64];
+
+	for ( ; blocks > 0; --blocks, data += 64) {
+		for (i = 0; i < 16; ++i)
+			m[i] = load_be32(data + i * 4);
+
+		for ( ; i < 64; ++i)
+			m[i] = SIG1(m[i - 2]) + m[i - 7] + SIG0(m[i - 15]) + m[i - 16];
+
+		a = state[0];
+		b = state[1];
+		c = state[2];
+		d = state[3];
+		e = state[4];
+		f = state[5];
+		g = state[6];
+		h = state[7];
+
+		for (i = 0; i < 64; ++i) {
+			t1 = h + EP1(e) + CH(e,f,g) + k[i] + m[i];
+			t2 = EP0(a) + MAJ(a,b,c);
+			h = g;
+			g = f;
+			f = e;
+			e = d + t1;
+			d = c;
+			c = b;
+			b = a;
+			a = t1 + t2;
+		}
+
+		state[0] += a;
+		state[1] += b;
+		state[2] += c;
+		state[3] += d;
+		state[4] += e;
+		state[5] += f;
+		state[6] += g;
+		state[7] += h;
+	}
+}
+
+#ifdef SHA256_X86
+// SHA extensions: SHA256RNDS2 does two rounds on the state kept as ABEF and
+// CDGH halves, SHA256MSG1/MSG2 extend the message schedule four words at a time.
+__attribute__((target("sha,sse4.1,ssse3")))
+static void sha256_blocks_shani(WORD state[8], const BYTE data[], size_t blocks)
 {
-	WORD a, b, c, d, e, f, g, h, i, j, t1, t2, m[64];
-
-	for (i = 0, j = 0; i < 16; ++i, j += 4)
-		m[i] = (data[j] << 24) | (data[j + 1] << 16) | (data[j + 2] << 8) | (data[j + 3]);
-
-	for ( ; i < 64; ++i)
-		m[i] = SIG1(m[i - 2]) + m[i - 7] + SIG0(m[i - 15]) + m[i - 16];
-
-	a = ctx->state[0];
-	b = ctx->state[1];
-	c = ctx->state[2];
-	d = ctx->state[3];
-	e = ctx->state[4];
-	f = ctx->state[5];
-	g = ctx->state[6];
-	h = ctx->state[7];
-
-	for (i = 0; i < 64; ++i) {
-		t1 = h + EP1(e) + CH(e,f,g) + k[i] + m[i];
-		t2 = EP0(a) + MAJ(a,b,c);
-		h = g;
-		g = f;
-		f = e;
-		e = d + t1;
-		d = c;
-		c = b;
-		b = a;
-		a = t1 + t2;
+	const __m128i byteswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+	__m128i tmp = _mm_loadu_si128((const __m128i *)&state[0]);
+	__m128i state1 = _mm_loadu_si128((const __m128i *)&state[4]);
+	tmp = _mm_shuffle_epi32(tmp, 0xB1);                // CDAB
+	state1 = _mm_shuffle_epi32(state1, 0x1B);          // EFGH
+	__m128i state0 = _mm_alignr_epi8(tmp, state1, 8);  // ABEF
+	state1 = _mm_blend_epi16(state1, tmp, 0xF0);       // CDGH
+
+	for ( ; blocks > 0; --blocks, data += 64) {
+		__m128i abef = state0, cdgh = state1, w[4];
+		int i;
+		for (i = 0; i < 4; ++i)
+			w[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + i * 16)), byteswap);
+		for (i = 0; i < 16; ++i) {
+			if (i >= 4) {
+				// w[i & 3] holds W[i-4]; the others are W[i-3], W[i-2], W[i-1]
+				__m128i next = _mm_sha256msg1_epu32(w[i & 3], w[(i + 1) & 3]);
+				next = _mm_add_epi32(next, _mm_alignr_epi8(w[(i + 3) & 3], w[(i + 2) & 3], 4));
+				w[i & 3] = _mm_sha256msg2_epu32(next, w[(i + 3) & 3]);
+			}
+			__m128i msg = _mm_add_epi32(w[i & 3], _mm_loadu_si128((const __m128i *)&k[i * 4]));
+			state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+			msg = _mm_shuffle_epi32(msg, 0x0E);
+			state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+		}
+		state0 = _mm_add_epi32(state0, abef);
+		state1 = _mm_add_epi32(state1, cdgh);
 	}
 
-	ctx->state[0] += a;
-	ctx->state[1] += b;
-	ctx->state[2] += c;
-	ctx->state[3] += d;
-	ctx->state[4] += e;
-	ctx->state[5] += f;
-	ctx->state[6] += g;
-	ctx->state[7] += h;
+	tmp = _mm_shuffle_epi32(state0, 0x1B);             // FEBA
+	state1 = _mm_shuffle_epi32(state1, 0xB1);          // DCHG
+	state0 = _mm_blend_epi16(tmp, state1, 0xF0);       // DCBA
+	state1 = _mm_alignr_epi8(state1, tmp, 8);          // HGFE
+	_mm_storeu_si128((__m128i *)&state[0], state0);
+	_mm_storeu_si128((__m128i *)&state[4], state1);
+}
+#endif
+
+/************************** BACKEND SELECTION ***********************/
+#define SHA256_BACKEND_SCALAR 0
+#define SHA256_BACKEND_AVX2 1
+#define SHA256_BACKEND_SHANI 2
+
+static const char *const backend_names[] = { "scalar", "avx2", "sha-ni" };
+static int backend = -1;
+static void (*sha256_blocks)(WORD state[8], const BYTE data[], size_t blocks) = sha256_blocks_scalar;
+
+static int backend_supported(int which)
+{
+#ifdef SHA256_X86
+	unsigned int eax, ebx, ecx, edx, ecx1;
+	if (which == SHA256_BACKEND_SCALAR)
+		return 1;
+	if (!__get_cpuid(1, &eax, &ebx, &ecx1, &edx) || !__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+		return 0;
+	if (which == SHA256_BACKEND_SHANI)
+		return (ebx & (1u << 29)) && (ecx1 & (1u << 19)) && (ecx1 & (1u << 9));
+	// AVX2 also needs the OS to save the YMM registers (OSXSAVE and XCR0 bits 1-2)
+	if (!(ebx & (1u << 5)) || !(ecx1 & (1u << 27)))
+		return 0;
+	unsigned int xcr0_lo, xcr0_hi;
+	__asm__ volatile ("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+	(void)xcr0_hi;
+	return (xcr0_lo & 6) == 6;
+#else
+	return which == SHA256_BACKEND_SCALAR;
+#endif
+}
+
+static void use_backend(int which)
+{
+	backend = which;
+	sha256_blocks = sha256_blocks_scalar;
+#ifdef SHA256_X86
+	if (which == SHA256_BACKEND_SHANI)
+		sha256_blocks = sha256_blocks_shani;
+#endif
+}
+
+static void select_backend(void)
+{
+	if (backend >= 0)
+		return;
+	if (backend_supported(SHA256_BACKEND_SHANI))
+		use_backend(SHA256_BACKEND_SHANI);
+	else if (backend_supported(SHA256_BACKEND_AVX2))
+		use_backend(SHA256_BACKEND_AVX2);
+	else
+		use_backend(SHA256_BACKEND_SCALAR);
+}
+
+const char *sha256_backend(void)
+{
+	select_backend();
+	return backend_names[backend];
+}
+
+int sha256_set_backend(const char *name)
+{
+	for (int i = 0; i < 3; ++i) {
+		if (strcmp(name, backend_names[i]) == 0) {
+			if (!backend_supported(i))
+				return 0;
+			use_backend(i);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/*********************** STREAMING INTERFACE ************************/
+void sha256_transform(SHA256_CTX *ctx, const BYTE data[])
+{
+	select_backend();
+	sha256_blocks(ctx->state, data, 1);
 }
 
 void sha256_init(SHA256_CTX *ctx)
@@ -98,17 +234,36 @@ void sha256_init(SHA256_CTX *ctx)
 
 void sha256_update(SHA256_CTX *ctx, const BYTE data[], size_t len)
 {
-	WORD i;
+	size_t blocks;
 
-	for (i = 0; i < len; ++i) {
-		ctx->data[ctx->datalen] = data[i];
-		ctx->datalen++;
-		if (ctx->datalen == 64) {
-			sha256_transform(ctx, ctx->data);
-			ctx->bitlen += 512;
-			ctx->datalen = 0;
-		}
+	select_backend();
+	// Top up a partially filled block first
+	if (ctx->datalen > 0) {
+		size_t take = 64 - ctx->datalen;
+		if (take > len)
+			take = len;
+		memcpy(ctx->data + ctx->datalen, data, take);
+		ctx->datalen += take;
+		data += take;
+		len -= take;
+		if (ctx->datalen < 64)
+			return;
+		sha256_blocks(ctx->state, ctx->data, 1);
+		ctx->bitlen += 512;
+		ctx->datalen = 0;
 	}
+
+	// Whole blocks are compressed straight from the input
+	blocks = len / 64;
+	if (blocks > 0) {
+		sha256_blocks(ctx->state, data, blocks);
+		ctx->bitlen += 512ULL * blocks;
+		data += blocks * 64;
+		len -= blocks * 64;
+	}
+
+	memcpy(ctx->data, data, len);
+	ctx->datalen = len;
 }
 
 void sha256_final(SHA256_CTX *ctx, BYTE hash[])
@@ -155,4 +310,195 @@ void sha256_final(SHA256_CTX *ctx, BYTE hash[])
 		hash[i + 24] = (ctx->state[6] >> (24 - i * 8)) & 0x000000ff;
 		hash[i + 28] = (ctx->state[7] >> (24 - i * 8)) & 0x000000ff;
 	}
-}
\ No newline at end of file
+}
+
+/************************* MULTI-BUFFER HASHING *********************/
+static void sha256_digest(const BYTE data[], size_t len, BYTE hash[])
+{
+	SHA256_CTX ctx;
+	sha256_init(&ctx);
+	sha256_update(&ctx, data, len);
+	sha256_final(&ctx, hash);
+}
+
+#ifdef SHA256_X86
+#define SHA256_LANES 8
+
+// One message in a group of lanes: its whole blocks are read in place, the
+// padded remainder (one or two blocks) from `tail`
+typedef struct {
+	const BYTE *data;
+	size_t full;
+	size_t blocks;
+	BYTE tail[128];
+	size_t index;
+} Sha256Lane;
+
+static void lane_init(Sha256Lane *lane, const BYTE data[], size_t len, size_t index)
+{
+	size_t rem = len % 64, tail_blocks = rem < 56 ? 1 : 2;
+	unsigned long long bits = (unsigned long long)len * 8;
+	lane->data = data;
+	lane->full = len / 64;
+	lane->blocks = lane->full + tail_blocks;
+	lane->index = index;
+	memset(lane->tail, 0, sizeof(lane->tail));
+	memcpy(lane->tail, data + lane->full * 64, rem);
+	lane->tail[rem] = 0x80;
+	for (int i = 0; i < 8; ++i)
+		lane->tail[tail_blocks * 64 - 1 - i] = (BYTE)(bits >> (i * 8));
+}
+
+static const BYTE *lane_block(const Sha256Lane *lane, size_t b)
+{
+	return b < lane->full ? lane->data + b * 64 : lane->tail + (b - lane->full) * 64;
+}
+
+#define ROR256(x, n) _mm256_or_si256(_mm256_srli_epi32((x), (n)), _mm256_slli_epi32((x), 32 - (n)))
+
+// Hash up to eight messages side by side, one per 32-bit lane. Lanes run in
+// lockstep for the longest message; a lane's digest is taken as soon as its
+// own last block is done, so the blocks it compresses after that are ignored.
+__attribute__((target("avx2")))
+static void sha256_lanes_avx2(Sha256Lane *lanes[SHA256_LANES], int used, BYTE hashes[][SHA256_BLOCK_SIZE])
+{
+	static const BYTE zero_block[64];
+	size_t max_blocks = 0;
+	__m256i s[8], w[16];
+	WORD out[8][SHA256_LANES];
+	int lane, i;
+
+	static const WORD init[8] = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+	};
+	for (i = 0; i < 8; ++i)
+		s[i] = _mm256_set1_epi32((int)init[i]);
+	for (lane = 0; lane < used; ++lane)
+		if (lanes[lane]->blocks > max_blocks)
+			max_blocks = lanes[lane]->blocks;
+
+	for (size_t b = 0; b < max_blocks; ++b) {
+		const BYTE *p[SHA256_LANES];
+		for (lane = 0; lane < SHA256_LANES; ++lane)
+			p[lane] = lane < used && b < lanes[lane]->blocks ? lane_block(lanes[lane], b) : zero_block;
+		for (i = 0; i < 16; ++i)
+			w[i] = _mm256_set_epi32((int)load_be32(p[7] + i * 4), (int)load_be32(p[6] + i * 4),
+			                        (int)load_be32(p[5] + i * 4), (int)load_be32(p[4] + i * 4),
+			                        (int)load_be32(p[3] + i * 4), (int)load_be32(p[2] + i * 4),
+			                        (int)load_be32(p[1] + i * 4), (int)load_be32(p[0] + i * 4));
+
+		__m256i a = s[0], bb = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+		for (i = 0; i < 64; ++i) {
+			__m256i m;
+			if (i < 16) {
+				m = w[i];
+			} else {
+				// Schedule kept as a ring of the last 16 words
+				__m256i w2 = w[(i - 2) & 15], w15 = w[(i - 15) & 15];
+				__m256i s1 = _mm256_xor_si256(_mm256_xor_si256(ROR256(w2, 17), ROR256(w2, 19)), _mm256_srli_epi32(w2, 10));
+				__m256i s0 = _mm256_xor_si256(_mm256_xor_si256(ROR256(w15, 7), ROR256(w15, 18)), _mm256_srli_epi32(w15, 3));
+				m = _mm256_add_epi32(_mm256_add_epi32(s1, w[(i - 7) & 15]), _mm256_add_epi32(s0, w[i & 15]));
+				w[i & 15] = m;
+			}
+			__m256i ep1 = _mm256_xor_si256(_mm256_xor_si256(ROR256(e, 6), ROR256(e, 11)), ROR256(e, 25));
+			__m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+			__m256i t1 = _mm256_add_epi32(_mm256_add_epi32(h, ep1),
+			                              _mm256_add_epi32(_mm256_add_epi32(ch, m), _mm256_set1_epi32((int)k[i])));
+			__m256i ep0 = _mm256_xor_si256(_mm256_xor_si256(ROR256(a, 2), ROR256(a, 13)), ROR256(a, 22));
+			__m256i maj = _mm256_xor_si256(_mm256_xor_si256(_mm256_and_si256(a, bb), _mm256_and_si256(a, c)),
+			                               _mm256_and_si256(bb, c));
+			__m256i t2 = _mm256_add_epi32(ep0, maj);
+			h = g;
+			g = f;
+			f = e;
+			e = _mm256_add_epi32(d, t1);
+			d = c;
+			c = bb;
+			bb = a;
+			a = _mm256_add_epi32(t1, t2);
+		}
+		s[0] = _mm256_add_epi32(s[0], a);
+		s[1] = _mm256_add_epi32(s[1], bb);
+		s[2] = _mm256_add_epi32(s[2], c);
+		s[3] = _mm256_add_epi32(s[3], d);
+		s[4] = _mm256_add_epi32(s[4], e);
+		s[5] = _mm256_add_epi32(s[5], f);
+		s[6] = _mm256_add_epi32(s[6], g);
+		s[7] = _mm256_add_epi32(s[7], h);
+
+		int finished = 0;
+		for (lane = 0; lane < used; ++lane)
+			finished |= lanes[lane]->blocks == b + 1;
+		if (!finished)
+			continue;
+		for (i = 0; i < 8; ++i)
+			_mm256_storeu_si256((__m256i *)out[i], s[i]);
+		for (lane = 0; lane < used; ++lane) {
+			if (lanes[lane]->blocks != b + 1)
+				continue;
+			BYTE *hash = hashes[lanes[lane]->index];
+			for (i = 0; i < 8; ++i) {
+				hash[i * 4]     = (BYTE)(out[i][lane] >> 24);
+				hash[i * 4 + 1] = (BYTE)(out[i][lane] >> 16);
+				hash[i * 4 + 2] = (BYTE)(out[i][lane] >> 8);
+				hash[i * 4 + 3] = (BYTE)out[i][lane];
+			}
+		}
+	}
+}
+
+static size_t padded_blocks(size_t len)
+{
+	return len / 64 + (len % 64 < 56 ? 1 : 2);
+}
+
+// Sort key for grouping messages of similar length into the same lanes
+static const size_t *sort_lens;
+
+static int compare_by_blocks(const void *x, const void *y)
+{
+	size_t a = padded_blocks(sort_lens[*(const size_t *)x]), b = padded_blocks(sort_lens[*(const size_t *)y]);
+	return a < b ? -1 : a > b;
+}
+
+static int sha256_many_avx2(const BYTE *const data[], const size_t lens[], size_t count, BYTE hashes[][SHA256_BLOCK_SIZE])
+{
+	size_t *order = (size_t *)malloc(count * sizeof(size_t));
+	Sha256Lane *group = (Sha256Lane *)malloc(SHA256_LANES * sizeof(Sha256Lane));
+	Sha256Lane *lanes[SHA256_LANES];
+	if (!order || !group) {
+		free(order);
+		free(group);
+		return 0;
+	}
+	for (size_t i = 0; i < count; ++i)
+		order[i] = i;
+	sort_lens = lens;
+	qsort(order, count, sizeof(size_t), compare_by_blocks);
+
+	for (size_t start = 0; start < count; start += SHA256_LANES) {
+		int used = count - start < SHA256_LANES ? (int)(count - start) : SHA256_LANES;
+		for (int lane = 0; lane < used; ++lane) {
+			size_t index = order[start + lane];
+			lane_init(&group[lane], data[index], lens[index], index);
+			lanes[lane] = &group[lane];
+		}
+		sha256_lanes_avx2(lanes, used, hashes);
+	}
+	free(order);
+	free(group);
+	return 1;
+}
+#endif
+
+int sha256_many(const BYTE *const data[], const size_t lens[], size_t count, BYTE hashes[][SHA256_BLOCK_SIZE])
+{
+	select_backend();
+#ifdef SHA256_X86
+	if (backend == SHA256_BACKEND_AVX2 && count > 1)
+		return sha256_many_avx2(data, lens, count, hashes);
+#endif
+	for (size_t i = 0; i < count; ++i)
+		sha256_digest(data[i], lens[i], hashes[i]);
+	return 1;
+}
@@ -31,4 +31,16 @@ void sha256_init(SHA256_CTX *ctx);
 void sha256_update(SHA256_CTX *ctx, const BYTE data[], size_t len);
 void sha256_final(SHA256_CTX *ctx, BYTE hash[]);
 
+// Digest `count` independent messages into hashes[i]. With the "avx2"
+// backend, eight messages are compressed at once in SIMD lanes.
+// Returns 0 if out of memory.
+int sha256_many(const BYTE *const data[], const size_t lens[], size_t count, BYTE hashes[][SHA256_BLOCK_SIZE]);
+
+// Implementation in use: "sha-ni" (x86 SHA extensions), "avx2" (scalar
+// blocks, 8-lane sha256_many) or "scalar". The best one the CPU supports is
+// chosen on first use.
+const char *sha256_backend(void);
+// Switch to a named backend; returns 0 if it is unknown or unsupported here
+int sha256_set_backend(const char *name);
+
 #endif   // SHA256_H
\ No newline at end of file
@@ -0,0 +1,1006 @@
+#include "sketch.h"
+#include "collections.h"
+#include "gc.h"
+#include "memory.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const double LN2 = 0.69314718055994530942;
+
+int sketch_hash_key(const Value* key, uint64_t* out) {
+    return tonmap_hash_key(key, SKETCH_HASH_SEED, out);
+}
+
+static inline int popcount64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(x);
+#else
+    int n = 0;
+    while (x) { x &= x - 1; n++; }
+    return n;
+#endif
+}
+
+// Leading zero bits of a nonzero word
+static inline int leading_zeros64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_clzll(x);
+#else
+    int n = 0;
+    while (!(x & 0x8000000000000000ULL)) { x <<= 1; n++; }
+    return n;
+#endif
+}
+
+static inline int lowest_bit64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(x);
+#else
+    int i = 0;
+    while (!(x & 1)) { x >>= 1; i++; }
+    return i;
+#endif
+}
+
+// Little-endian encoding for the serialized forms
+
+static void put_u16(unsigned char* p, uint16_t v) {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+}
+
+static void put_u32(unsigned char* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static void put_u64(unsigned char* p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static uint16_t get_u16(const unsigned char* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const unsigned char* p) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; i++) v |= (uint32_t)p[i] << (8 * i);
+    return v;
+}
+
+static uint64_t get_u64(const unsigned char* p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++) v |= (uint64_t)p[i] << (8 * i);
+    return v;
+}
+
+// ---------------------------------------------------------------------------
+// Bloom filter
+
+#define BLOOM_MAX_BLOCKS (1u << 25)    // 1 GiB of filter
+
+// Odd multipliers that spread a key over the eight words of its block
+static const uint32_t bloom_salts[BLOOM_BLOCK_WORDS] = {
+    0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du,
+    0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u
+};
+
+static inline uint32_t bloom_block_index(uint32_t block_count, uint64_t hash) {
+    return (uint32_t)(((hash >> 32) * (uint64_t)block_count) >> 32);
+}
+
+// The eight bit masks for a key; a plain loop of independent lanes, which
+// compilers turn into a single vector multiply and shift
+static inline void bloom_masks(uint64_t hash, uint32_t masks[BLOOM_BLOCK_WORDS]) {
+    uint32_t key = (uint32_t)hash;
+    for (int i = 0; i < BLOOM_BLOCK_WORDS; i++) {
+        masks[i] = 1u << ((key * bloom_salts[i]) >> 27);
+    }
+}
+
+// Expected false positive rate with `keys` keys in `block_count` blocks. The
+// number of keys per block is Poisson distributed, and a block holding i keys
+// answers wrongly when all eight probed bits are among those they set.
+static double bloom_expected_fpr(double block_count, double keys) {
+    double lambda = keys / block_count;
+    if (lambda <= 0) return 0.0;
+    double limit = lambda + 12.0 * sqrt(lambda) + 20.0;
+    double log_p = -lambda;           // log Poisson(0; lambda)
+    double fpr = 0.0;
+    for (double i = 1; i <= limit; i++) {
+        log_p += log(lambda) - log(i);
+        double word = 1.0 - pow(31.0 / 32.0, i);
+        fpr += exp(log_p) * pow(word, BLOOM_BLOCK_WORDS);
+    }
+    return fpr;
+}
+
+static TonBloom* bloom_alloc(uint32_t block_count) {
+    TonBloom* bloom = gc_alloc(GC_KIND_BLOOM, sizeof(TonBloom));
+    if (!bloom) return NULL;
+    bloom->blocks = (uint32_t*)ton_calloc((size_t)block_count * BLOOM_BLOCK_WORDS, sizeof(uint32_t));
+    if (!bloom->blocks) {
+        gc_free(bloom);
+        return NULL;
+    }
+    bloom->block_count = block_count;
+    return bloom;
+}
+
+TonBloom* bloom_create(uint64_t expected, double fpr) {
+    if (!(fpr > 0.0 && fpr < 1.0)) return NULL;
+    if (expected == 0) expected = 1;
+
+    // Start from the classic bits-per-key formula, then search for the
+    // smallest block count whose blocked rate meets the target
+    double bits = -(double)expected * log(fpr) / (LN2 * LN2);
+    uint64_t low = (uint64_t)(bits / (32.0 * BLOOM_BLOCK_WORDS)) / 2 + 1;
+    if (low > BLOOM_MAX_BLOCKS) return NULL;
+    uint64_t high = low * 2;
+    while (bloom_expected_fpr((double)high, (double)expected) > fpr) {
+        if (high >= BLOOM_MAX_BLOCKS) return NULL;
+        low = high;
+        high *= 2;
+    }
+    if (high > BLOOM_MAX_BLOCKS) high = BLOOM_MAX_BLOCKS;
+    while (low < high) {
+        uint64_t mid = low + (high - low) / 2;
+        if (bloom_expected_fpr((double)mid, (double)expected) > fpr) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return bloom_alloc((uint32_t)high);
+}
+
+void bloom_destroy(TonBloom* bloom) {
+    if (!bloom) return;
+    ton_free(bloom->blocks);
+    gc_free(bloom);
+}
+
+int bloom_add_hash(TonBloom* bloom, uint64_t hash) {
+    uint32_t* block = &bloom->blocks[(size_t)bloom_block_index(bloom->block_count, hash) * BLOOM_BLOCK_WORDS];
+    uint32_t masks[BLOOM_BLOCK_WORDS];
+    bloom_masks(hash, masks);
+    uint32_t missing = 0;
+    for (int i = 0; i < BLOOM_BLOCK_WORDS; i++) {
+        missing |= masks[i] & ~block[i];
+        block[i] |= masks[i];
+    }
+    if (!missing) return 1;
+    bloom->added++;
+    return 0;
+}
+
+int bloom_has_hash(const TonBloom* bloom, uint64_t hash) {
+    const uint32_t* block = &bloom->blocks[(size_t)bloom_block_index(bloom->block_count, hash) * BLOOM_BLOCK_WORDS];
+    uint32_t masks[BLOOM_BLOCK_WORDS];
+    bloom_masks(hash, masks);
+    uint32_t missing = 0;
+    for (int i = 0; i < BLOOM_BLOCK_WORDS; i++) {
+        missing |= masks[i] & ~block[i];
+    }
+    return missing == 0;
+}
+
+int bloom_merge(TonBloom* bloom, const TonBloom* other) {
+    if (bloom->block_count != other->block_count) return 0;
+    size_t words = (size_t)bloom->block_count * BLOOM_BLOCK_WORDS;
+    for (size_t i = 0; i < words; i++) bloom->blocks[i] |= other->blocks[i];
+    bloom->added += other->added;
+    return 1;
+}
+
+// "TBLM", u32 block count, u64 added, then the words
+#define BLOOM_HEADER 16
+
+size_t bloom_serialize(const TonBloom* bloom, unsigned char** out) {
+    size_t words = (size_t)bloom->block_count * BLOOM_BLOCK_WORDS;
+    size_t len = BLOOM_HEADER + words * 4;
+    unsigned char* data = (unsigned char*)ton_malloc(len);
+    if (!data) return 0;
+    memcpy(data, "TBLM", 4);
+    put_u32(data + 4, bloom->block_count);
+    put_u64(data + 8, bloom->added);
+    for (size_t i = 0; i < words; i++) put_u32(data + BLOOM_HEADER + i * 4, bloom->blocks[i]);
+    *out = data;
+    return len;
+}
+
+TonBloom* bloom_deserialize(const unsigned char* data, size_t len) {
+    if (len < BLOOM_HEADER || memcmp(data, "TBLM", 4) != 0) return NULL;
+    uint32_t block_count = get_u32(data + 4);
+    if (block_count == 0 || block_count > BLOOM_MAX_BLOCKS) return NULL;
+    size_t words = (size_t)block_count * BLOOM_BLOCK_WORDS;
+    if (len != BLOOM_HEADER + words * 4) return NULL;
+    TonBloom* bloom = bloom_alloc(block_count);
+    if (!bloom) return NULL;
+    bloom->added = get_u64(data + 8);
+    for (size_t i = 0; i < words; i++) bloom->blocks[i] = get_u32(data + BLOOM_HEADER + i * 4);
+    return bloom;
+}
+
+// ---------------------------------------------------------------------------
+// HyperLogLog++
+
+#define HLL_SPARSE_RANK_BITS 6
+#define HLL_SPARSE_MAX_RANK (64 - HLL_SPARSE_PRECISION + 1)
+
+static inline uint32_t hll_pair_index(uint32_t pair) {
+    return pair >> HLL_SPARSE_RANK_BITS;
+}
+
+static inline int hll_pair_rank(uint32_t pair) {
+    return (int)(pair & ((1u << HLL_SPARSE_RANK_BITS) - 1));
+}
+
+static inline size_t hll_register_count(const TonHLL* hll) {
+    return (size_t)1 << hll->precision;
+}
+
+// Position of the first set bit after the index bits, counting from 1
+static inline int hll_rank(uint64_t hash, int precision) {
+    uint64_t rest = hash << precision;
+    return rest ? leading_zeros64(rest) + 1 : 64 - precision + 1;
+}
+
+// A sparse pair folded down to a dense (register, rank)
+static inline void hll_pair_to_dense(uint32_t pair, int precision, uint32_t* index, int* rank) {
+    int extra = HLL_SPARSE_PRECISION - precision;
+    uint32_t sparse_index = hll_pair_index(pair);
+    uint32_t low = sparse_index & ((1u << extra) - 1);
+    *index = sparse_index >> extra;
+    if (low) {
+        *rank = extra - (63 - leading_zeros64(low));
+    } else {
+        *rank = extra + hll_pair_rank(pair);
+    }
+}
+
+static TonHLL* hll_alloc(int precision) {
+    if (precision < HLL_MIN_PRECISION || precision > HLL_MAX_PRECISION) return NULL;
+    TonHLL* hll = gc_alloc(GC_KIND_HLL, sizeof(TonHLL));
+    if (!hll) return NULL;
+    hll->precision = precision;
+    hll->sparse = 1;
+    return hll;
+}
+
+TonHLL* hll_create(int precision) {
+    return hll_alloc(precision);
+}
+
+void hll_destroy(TonHLL* hll) {
+    if (!hll) return;
+    ton_free(hll->registers);
+    ton_free(hll->pairs);
+    gc_free(hll);
+}
+
+static int compare_u32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Merge two sorted pair lists into `out`, keeping the highest rank per index.
+// Within one list equal indexes are adjacent with the highest rank last.
+static int hll_merge_pairs(const uint32_t* a, int na, const uint32_t* b, int nb, uint32_t* out) {
+    int i = 0, j = 0, n = 0;
+    while (i < na || j < nb) {
+        uint32_t next;
+        if (j >= nb || (i < na && a[i] <= b[j])) {
+            next = a[i++];
+        } else {
+            next = b[j++];
+        }
+        if (n > 0 && hll_pair_index(out[n - 1]) == hll_pair_index(next)) {
+            if (next > out[n - 1]) out[n - 1] = next;
+        } else {
+            out[n++] = next;
+        }
+    }
+    return n;
+}
+
+// Merge `count` pairs into the sorted list
+static int hll_absorb_pairs(TonHLL* hll, const uint32_t* pairs, int count) {
+    if (count == 0) return 1;
+    int capacity = hll->pair_count + count;
+    uint32_t* merged = (uint32_t*)ton_malloc(sizeof(uint32_t) * capacity);
+    if (!merged) return 0;
+    hll->pair_count = hll_merge_pairs(hll->pairs, hll->pair_count, pairs, count, merged);
+    ton_free(hll->pairs);
+    hll->pairs = merged;
+    hll->pair_capacity = capacity;
+    return 1;
+}
+
+static int hll_flush(TonHLL* hll) {
+    if (hll->buffered == 0) return 1;
+    qsort(hll->buffer, (size_t)hll->buffered, sizeof(uint32_t), compare_u32);
+    int ok = hll_absorb_pairs(hll, hll->buffer, hll->buffered);
+    if (ok) hll->buffered = 0;
+    return ok;
+}
+
+static inline void hll_dense_update(TonHLL* hll, uint32_t index, int rank) {
+    if (rank > hll->registers[index]) hll->registers[index] = (uint8_t)rank;
+}
+
+static int hll_to_dense(TonHLL* hll) {
+    uint8_t* registers = (uint8_t*)ton_calloc(hll_register_count(hll), 1);
+    if (!registers) return 0;
+    hll->registers = registers;
+    for (int i = 0; i < hll->pair_count + hll->buffered; i++) {
+        uint32_t pair = i < hll->pair_count ? hll->pairs[i] : hll->buffer[i - hll->pair_count];
+        uint32_t index;
+        int rank;
+        hll_pair_to_dense(pair, hll->precision, &index, &rank);
+        hll_dense_update(hll, index, rank);
+    }
+    ton_free(hll->pairs);
+    hll->pairs = NULL;
+    hll->pair_count = 0;
+    hll->pair_capacity = 0;
+    hll->buffered = 0;
+    hll->sparse = 0;
+    return 1;
+}
+
+// Sparse pairs cost four bytes each; past one byte per register, dense wins
+static int hll_check_sparse_size(TonHLL* hll) {
+    if ((size_t)hll->pair_count * 4 > hll_register_count(hll)) return hll_to_dense(hll);
+    return 1;
+}
+
+int hll_add_hash(TonHLL* hll, uint64_t hash) {
+    if (!hll->sparse) {
+        hll_dense_update(hll, (uint32_t)(hash >> (64 - hll->precision)), hll_rank(hash, hll->precision));
+        return 1;
+    }
+    uint32_t index = (uint32_t)(hash >> (64 - HLL_SPARSE_PRECISION));
+    int rank = hll_rank(hash, HLL_SPARSE_PRECISION);
+    hll->buffer[hll->buffered++] = (index << HLL_SPARSE_RANK_BITS) | (uint32_t)rank;
+    if (hll->buffered < HLL_SPARSE_BUFFER) return 1;
+    return hll_flush(hll) && hll_check_sparse_size(hll);
+}
+
+// sigma and tau from Ertl, "New cardinality estimation algorithms for
+// HyperLogLog sketches" (2017)
+static double hll_sigma(double x) {
+    if (x == 1.0) return INFINITY;
+    double y = 1.0;
+    double z = x;
+    double previous;
+    do {
+        x *= x;
+        previous = z;
+        z += x * y;
+        y += y;
+    } while (z != previous);
+    return z;
+}
+
+static double hll_tau(double x) {
+    if (x == 0.0 || x == 1.0) return 0.0;
+    double y = 1.0;
+    double z = 1.0 - x;
+    double previous;
+    do {
+        x = sqrt(x);
+        previous = z;
+        y *= 0.5;
+        z -= (1.0 - x) * (1.0 - x) * y;
+    } while (z != previous);
+    return z / 3.0;
+}
+
+double hll_estimate(TonHLL* hll) {
+    if (hll->sparse) {
+        hll_flush(hll);
+        // Linear counting over the 2^25 sparse registers, which is exact
+        // enough while so few of them are set
+        double m = (double)(1u << HLL_SPARSE_PRECISION);
+        return m * log(m / (m - (double)hll->pair_count));
+    }
+
+    int q = 64 - hll->precision;
+    double m = (double)hll_register_count(hll);
+    double histogram[66] = {0};
+    for (size_t i = 0; i < hll_register_count(hll); i++) histogram[hll->registers[i]]++;
+
+    double z = m * hll_tau(1.0 - histogram[q + 1] / m);
+    for (int k = q; k >= 1; k--) {
+        z = 0.5 * (z + histogram[k]);
+    }
+    z += m * hll_sigma(histogram[0] / m);
+    return m * m / (2.0 * LN2 * z);
+}
+
+int hll_merge(TonHLL* hll, TonHLL* other) {
+    if (hll->precision != other->precision) return 0;
+    if (!hll_flush(other)) return 0;
+    if (hll->sparse && other->sparse) {
+        return hll_flush(hll) && hll_absorb_pairs(hll, other->pairs, other->pair_count) &&
+               hll_check_sparse_size(hll);
+    }
+    if (hll->sparse && !hll_to_dense(hll)) return 0;
+    if (other->sparse) {
+        for (int i = 0; i < other->pair_count; i++) {
+            uint32_t index;
+            int rank;
+            hll_pair_to_dense(other->pairs[i], hll->precision, &index, &rank);
+            hll_dense_update(hll, index, rank);
+        }
+    } else {
+        for (size_t i = 0; i < hll_register_count(hll); i++) {
+            if (other->registers[i] > hll->registers[i]) hll->registers[i] = other->registers[i];
+        }
+    }
+    return 1;
+}
+
+// "THLL", u8 precision, u8 sparse, u16 zero, u32 pair count, then the
+// sorted pairs or the registers
+#define HLL_HEADER 12
+
+size_t hll_serialize(TonHLL* hll, unsigned char** out) {
+    if (hll->sparse && !hll_flush(hll)) return 0;
+    size_t body = hll->sparse ? (size_t)hll->pair_count * 4 : hll_register_count(hll);
+    unsigned char* data = (unsigned char*)ton_malloc(HLL_HEADER + body);
+    if (!data) return 0;
+    memcpy(data, "THLL", 4);
+    data[4] = (unsigned char)hll->precision;
+    data[5] = (unsigned char)hll->sparse;
+    put_u16(data + 6, 0);
+    put_u32(data + 8, hll->sparse ? (uint32_t)hll->pair_count : 0);
+    if (hll->sparse) {
+        for (int i = 0; i < hll->pair_count; i++) put_u32(data + HLL_HEADER + i * 4, hll->pairs[i]);
+    } else {
+        memcpy(data + HLL_HEADER, hll->registers, body);
+    }
+    *out = data;
+    return HLL_HEADER + body;
+}
+
+TonHLL* hll_deserialize(const unsigned char* data, size_t len) {
+    if (len < HLL_HEADER || memcmp(data, "THLL", 4) != 0 || data[5] > 1) return NULL;
+    TonHLL* hll = hll_alloc(data[4]);
+    if (!hll) return NULL;
+    size_t registers = hll_register_count(hll);
+    if (data[5]) {
+        uint32_t count = get_u32(data + 8);
+        if ((size_t)count * 4 > registers || len != HLL_HEADER + (size_t)count * 4) goto invalid;
+        hll->pairs = (uint32_t*)ton_malloc(sizeof(uint32_t) * (count > 0 ? count : 1));
+        if (!hll->pairs) goto invalid;
+        hll->pair_capacity = (int)count;
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t pair = get_u32(data + HLL_HEADER + i * 4);
+            int rank = hll_pair_rank(pair);
+            if (rank < 1 || rank > HLL_SPARSE_MAX_RANK) goto invalid;
+            if (hll_pair_index(pair) >= (1u << HLL_SPARSE_PRECISION)) goto invalid;
+            if (i > 0 && hll_pair_index(pair) <= hll_pair_index(hll->pairs[i - 1])) goto invalid;
+            hll->pairs[i] = pair;
+        }
+        hll->pair_count = (int)count;
+    } else {
+        if (len != HLL_HEADER + registers) goto invalid;
+        hll->registers = (uint8_t*)ton_malloc(registers);
+        if (!hll->registers) goto invalid;
+        hll->sparse = 0;
+        for (size_t i = 0; i < registers; i++) {
+            if (data[HLL_HEADER + i] > 64 - hll->precision + 1) goto invalid;
+            hll->registers[i] = data[HLL_HEADER + i];
+        }
+    }
+    return hll;
+
+invalid:
+    hll_destroy(hll);
+    return NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Roaring-style bitmap
+
+#define BITMAP_CHUNK_BYTES (BITMAP_CHUNK_WORDS * sizeof(uint64_t))
+
+static inline int container_is_bitmap(const BitmapContainer* c) {
+    return c->bits != NULL;
+}
+
+static void container_free(BitmapContainer* c) {
+    ton_free(c->array);
+    ton_free(c->bits);
+    c->array = NULL;
+    c->bits = NULL;
+}
+
+static int container_init_array(BitmapContainer* c, uint16_t key, int capacity) {
+    memset(c, 0, sizeof(*c));
+    c->key = key;
+    if (capacity < 4) capacity = 4;
+    c->array = (uint16_t*)ton_malloc(sizeof(uint16_t) * capacity);
+    if (!c->array) return 0;
+    c->capacity = capacity;
+    return 1;
+}
+
+static int container_init_bitmap(BitmapContainer* c, uint16_t key) {
+    memset(c, 0, sizeof(*c));
+    c->key = key;
+    c->bits = (uint64_t*)ton_calloc(BITMAP_CHUNK_WORDS, sizeof(uint64_t));
+    return c->bits != NULL;
+}
+
+// First position in a sorted array holding a value >= low
+static int array_lower_bound(const uint16_t* array, int count, uint16_t low) {
+    int lo = 0, hi = count;
+    while (lo < hi) {
+        int mid = (lo + hi) >> 1;
+        if (array[mid] < low) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+static int container_contains(const BitmapContainer* c, uint16_t low) {
+    if (container_is_bitmap(c)) return (c->bits[low >> 6] >> (low & 63)) & 1;
+    int i = array_lower_bound(c->array, c->cardinality, low);
+    return i < c->cardinality && c->array[i] == low;
+}
+
+static int container_array_to_bitmap(BitmapContainer* c) {
+    uint64_t* bits = (uint64_t*)ton_calloc(BITMAP_CHUNK_WORDS, sizeof(uint64_t));
+    if (!bits) return 0;
+    for (int i = 0; i < c->cardinality; i++) bits[c->array[i] >> 6] |= 1ULL << (c->array[i] & 63);
+    ton_free(c->array);
+    c->array = NULL;
+    c->capacity = 0;
+    c->bits = bits;
+    return 1;
+}
+
+static int container_bitmap_to_array(BitmapContainer* c) {
+    uint16_t* array = (uint16_t*)ton_malloc(sizeof(uint16_t) * (c->cardinality > 4 ? c->cardinality : 4));
+    if (!array) return 0;
+    int n = 0;
+    for (int w = 0; w < BITMAP_CHUNK_WORDS; w++) {
+        for (uint64_t word = c->bits[w]; word; word &= word - 1) {
+            array[n++] = (uint16_t)(w * 64 + lowest_bit64(word));
+        }
+    }
+    ton_free(c->bits);
+    c->bits = NULL;
+    c->array = array;
+    c->capacity = c->cardinality > 4 ? c->cardinality : 4;
+    return 1;
+}
+
+// Pick the smaller representation after a bulk operation
+static int container_normalize(BitmapContainer* c) {
+    if (container_is_bitmap(c) && c->cardinality <= BITMAP_ARRAY_MAX) return container_bitmap_to_array(c);
+    if (!container_is_bitmap(c) && c->cardinality > BITMAP_ARRAY_MAX) return container_array_to_bitmap(c);
+    return 1;
+}
+
+static int container_add(BitmapContainer* c, uint16_t low) {
+    if (container_is_bitmap(c)) {
+        uint64_t bit = 1ULL << (low & 63);
+        if (c->bits[low >> 6] & bit) return 0;
+        c->bits[low >> 6] |= bit;
+        c->cardinality++;
+        return 1;
+    }
+    int i = array_lower_bound(c->array, c->cardinality, low);
+    if (i < c->cardinality && c->array[i] == low) return 0;
+    if (c->cardinality == BITMAP_ARRAY_MAX) {
+        if (!container_array_to_bitmap(c)) return -1;
+        return container_add(c, low);
+    }
+    if (c->cardinality == c->capacity) {
+        int capacity = c->capacity * 2 < BITMAP_ARRAY_MAX ? c->capacity * 2 : BITMAP_ARRAY_MAX;
+        uint16_t* grown = (uint16_t*)ton_realloc(c->array, sizeof(uint16_t) * capacity);
+        if (!grown) return -1;
+        c->array = grown;
+        c->capacity = capacity;
+    }
+    memmove(&c->array[i + 1], &c->array[i], sizeof(uint16_t) * (c->cardinality - i));
+    c->array[i] = low;
+    c->cardinality++;
+    return 1;
+}
+
+static int container_remove(BitmapContainer* c, uint16_t low) {
+    if (container_is_bitmap(c)) {
+        uint64_t bit = 1ULL << (low & 63);
+        if (!(c->bits[low >> 6] & bit)) return 0;
+        c->bits[low >> 6] &= ~bit;
+        c->cardinality--;
+        // Shrinking back to an array can only fail for lack of memory, which
+        // leaves a valid (if oversized) bitmap container
+        if (c->cardinality <= BITMAP_ARRAY_MAX) container_bitmap_to_array(c);
+        return 1;
+    }
+    int i = array_lower_bound(c->array, c->cardinality, low);
+    if (i >= c->cardinality || c->array[i] != low) return 0;
+    memmove(&c->array[i], &c->array[i + 1], sizeof(uint16_t) * (c->cardinality - i - 1));
+    c->cardinality--;
+    return 1;
+}
+
+// Position of the container for `key`, or -(insertion point) - 1
+static int bitmap_find(const TonBitmap* bitmap, uint16_t key) {
+    int lo = 0, hi = bitmap->count;
+    while (lo < hi) {
+        int mid = (lo + hi) >> 1;
+        if (bitmap->containers[mid].key < key) lo = mid + 1; else hi = mid;
+    }
+    if (lo < bitmap->count && bitmap->containers[lo].key == key) return lo;
+    return -lo - 1;
+}
+
+static int bitmap_reserve(TonBitmap* bitmap, int count) {
+    if (count <= bitmap->capacity) return 1;
+    int capacity = bitmap->capacity ? bitmap->capacity * 2 : 4;
+    if (capacity < count) capacity = count;
+    BitmapContainer* grown = (BitmapContainer*)ton_realloc(bitmap->containers, sizeof(BitmapContainer) * capacity);
+    if (!grown) return 0;
+    bitmap->containers = grown;
+    bitmap->capacity = capacity;
+    return 1;
+}
+
+// Append a container built in key order; empty ones are dropped
+static int bitmap_append(TonBitmap* bitmap, BitmapContainer* c) {
+    if (c->cardinality == 0) {
+        container_free(c);
+        return 1;
+    }
+    if (!container_normalize(c) || !bitmap_reserve(bitmap, bitmap->count + 1)) {
+        container_free(c);
+        return 0;
+    }
+    bitmap->containers[bitmap->count++] = *c;
+    return 1;
+}
+
+TonBitmap* bitmap_create(void) {
+    return gc_alloc(GC_KIND_BITMAP, sizeof(TonBitmap));
+}
+
+void bitmap_destroy(TonBitmap* bitmap) {
+    if (!bitmap) return;
+    for (int i = 0; i < bitmap->count; i++) container_free(&bitmap->containers[i]);
+    ton_free(bitmap->containers);
+    gc_free(bitmap);
+}
+
+int bitmap_add(TonBitmap* bitmap, uint32_t value) {
+    uint16_t key = (uint16_t)(value >> 16);
+    int i = bitmap_find(bitmap, key);
+    if (i < 0) {
+        i = -i - 1;
+        BitmapContainer c;
+        if (!bitmap_reserve(bitmap, bitmap->count + 1) || !container_init_array(&c, key, 4)) return -1;
+        memmove(&bitmap->containers[i + 1], &bitmap->containers[i], sizeof(BitmapContainer) * (bitmap->count - i));
+        bitmap->containers[i] = c;
+        bitmap->count++;
+    }
+    return container_add(&bitmap->containers[i], (uint16_t)value);
+}
+
+int bitmap_remove(TonBitmap* bitmap, uint32_t value) {
+    int i = bitmap_find(bitmap, (uint16_t)(value >> 16));
+    if (i < 0) return 0;
+    BitmapContainer* c = &bitmap->containers[i];
+    if (!container_remove(c, (uint16_t)value)) return 0;
+    if (c->cardinality == 0) {
+        container_free(c);
+        memmove(&bitmap->containers[i], &bitmap->containers[i + 1], sizeof(BitmapContainer) * (bitmap->count - i - 1));
+        bitmap->count--;
+    }
+    return 1;
+}
+
+int bitmap_contains(const TonBitmap* bitmap, uint32_t value) {
+    int i = bitmap_find(bitmap, (uint16_t)(value >> 16));
+    return i >= 0 && container_contains(&bitmap->containers[i], (uint16_t)value);
+}
+
+uint64_t bitmap_cardinality(const TonBitmap* bitmap) {
+    uint64_t total = 0;
+    for (int i = 0; i < bitmap->count; i++) total += (uint64_t)bitmap->containers[i].cardinality;
+    return total;
+}
+
+static int container_copy(BitmapContainer* out, const BitmapContainer* c) {
+    if (container_is_bitmap(c)) {
+        if (!container_init_bitmap(out, c->key)) return 0;
+        memcpy(out->bits, c->bits, BITMAP_CHUNK_BYTES);
+    } else {
+        if (!container_init_array(out, c->key, c->cardinality)) return 0;
+        memcpy(out->array, c->array, sizeof(uint16_t) * c->cardinality);
+    }
+    out->cardinality = c->cardinality;
+    return 1;
+}
+
+// Expand any container into a fresh bitmap container
+static int container_bits_of(BitmapContainer* out, const BitmapContainer* c) {
+    if (!container_init_bitmap(out, c->key)) return 0;
+    if (container_is_bitmap(c)) {
+        memcpy(out->bits, c->bits, BITMAP_CHUNK_BYTES);
+    } else {
+        for (int i = 0; i < c->cardinality; i++) out->bits[c->array[i] >> 6] |= 1ULL << (c->array[i] & 63);
+    }
+    out->cardinality = c->cardinality;
+    return 1;
+}
+
+static int bits_cardinality(const uint64_t* bits) {
+    int total = 0;
+    for (int w = 0; w < BITMAP_CHUNK_WORDS; w++) total += popcount64(bits[w]);
+    return total;
+}
+
+static int container_or(BitmapContainer* out, const BitmapContainer* a, const BitmapContainer* b) {
+    if (!container_is_bitmap(a) && !container_is_bitmap(b) && a->cardinality + b->cardinality <= BITMAP_ARRAY_MAX) {
+        if (!container_init_array(out, a->key, a->cardinality + b->cardinality)) return 0;
+        int i = 0, j = 0, n = 0;
+        while (i < a->cardinality || j < b->cardinality) {
+            if (j >= b->cardinality || (i < a->cardinality && a->array[i] < b->array[j])) {
+                out->array[n++] = a->array[i++];
+            } else if (i >= a->cardinality || b->array[j] < a->array[i]) {
+                out->array[n++] = b->array[j++];
+            } else {
+                out->array[n++] = a->array[i++];
+                j++;
+            }
+        }
+        out->cardinality = n;
+        return 1;
+    }
+    if (!container_is_bitmap(a)) {
+        const BitmapContainer* t = a;
+        a = b;
+        b = t;
+    }
+    if (!container_bits_of(out, a)) return 0;
+    if (container_is_bitmap(b)) {
+        for (int w = 0; w < BITMAP_CHUNK_WORDS; w++) out->bits[w] |= b->bits[w];
+    } else {
+        for (int i = 0; i < b->cardinality; i++) out->bits[b->array[i] >> 6] |= 1ULL << (b->array[i] & 63);
+    }
+    out->cardinality = bits_cardinality(out->bits);
+    return 1;
+}
+
+// Intersection (keep_common) or difference a - b (!keep_common)
+static int container_filter(BitmapContainer* out, const BitmapContainer* a, const BitmapContainer* b, int keep_common) {
+    if (container_is_bitmap(a) && container_is_bitmap(b)) {
+        if (!container_init_bitmap(out, a->key)) return 0;
+        for (int w = 0; w < BITMAP_CHUNK_WORDS; w++) {
+            out->bits[w] = keep_common ? a->bits[w] & b->bits[w] : a->bits[w] & ~b->bits[w];
+        }
+        out->cardinality = bits_cardinality(out->bits);
+        return 1;
+    }
+    if (container_is_bitmap(a)) {
+        if (!keep_common) {
+            if (!container_bits_of(out, a)) return 0;
+            for (int i = 0; i < b->cardinality; i++) out->bits[b->array[i] >> 6] &= ~(1ULL << (b->array[i] & 63));
+            out->cardinality = bits_cardinality(out->bits);
+            return 1;
+        }
+        // The common values are a subset of b's array
+        const BitmapContainer* t = a;
+        a = b;
+        b = t;
+    }
+    if (!container_init_array(out, a->key, a->cardinality)) return 0;
+    int n = 0;
+    for (int i = 0; i < a->cardinality; i++) {
+        if (container_contains(b, a->array[i]) == keep_common) out->array[n++] = a->array[i];
+    }
+    out->cardinality = n;
+    return 1;
+}
+
+TonBitmap* bitmap_or(const TonBitmap* a, const TonBitmap* b) {
+    TonBitmap* out = bitmap_create();
+    if (!out) return NULL;
+    int i = 0, j = 0;
+    while (i < a->count || j < b->count) {
+        BitmapContainer c;
+        int ok;
+        if (j >= b->count || (i < a->count && a->containers[i].key < b->containers[j].key)) {
+            ok = container_copy(&c, &a->containers[i++]);
+        } else if (i >= a->count || b->containers[j].key < a->containers[i].key) {
+            ok = container_copy(&c, &b->containers[j++]);
+        } else {
+            ok = container_or(&c, &a->containers[i++], &b->containers[j++]);
+        }
+        if (!ok || !bitmap_append(out, &c)) {
+            bitmap_destroy(out);
+            return NULL;
+        }
+    }
+    return out;
+}
+
+TonBitmap* bitmap_and(const TonBitmap* a, const TonBitmap* b) {
+    TonBitmap* out = bitmap_create();
+    if (!out) return NULL;
+    int i = 0, j = 0;
+    while (i < a->count && j < b->count) {
+        if (a->containers[i].key < b->containers[j].key) {
+            i++;
+        } else if (b->containers[j].key < a->containers[i].key) {
+            j++;
+        } else {
+            BitmapContainer c;
+            if (!container_filter(&c, &a->containers[i++], &b->containers[j++], 1) || !bitmap_append(out, &c)) {
+                bitmap_destroy(out);
+                return NULL;
+            }
+        }
+    }
+    return out;
+}
+
+TonBitmap* bitmap_andnot(const TonBitmap* a, const TonBitmap* b) {
+    TonBitmap* out = bitmap_create();
+    if (!out) return NULL;
+    int j = 0;
+    for (int i = 0; i < a->count; i++) {
+        while (j < b->count && b->containers[j].key < a->containers[i].key) j++;
+        BitmapContainer c;
+        int ok;
+        if (j < b->count && b->containers[j].key == a->containers[i].key) {
+            ok = container_filter(&c, &a->containers[i], &b->containers[j], 0);
+        } else {
+            ok = container_copy(&c, &a->containers[i]);
+        }
+        if (!ok || !bitmap_append(out, &c)) {
+            bitmap_destroy(out);
+            return NULL;
+        }
+    }
+    return out;
+}
+
+static int container_and_cardinality(const BitmapContainer* a, const BitmapContainer* b) {
+    if (container_is_bitmap(a) && container_is_bitmap(b)) {
+        int total = 0;
+        for (int w = 0; w < BITMAP_CHUNK_WORDS; w++) total += popcount64(a->bits[w] & b->bits[w]);
+        return total;
+    }
+    if (container_is_bitmap(a)) {
+        const BitmapContainer* t = a;
+        a = b;
+        b = t;
+    }
+    int total = 0;
+    for (int i = 0; i < a->cardinality; i++) total += container_contains(b, a->array[i]);
+    return total;
+}
+
+uint64_t bitmap_and_cardinality(const TonBitmap* a, const TonBitmap* b) {
+    uint64_t total = 0;
+    int i = 0, j = 0;
+    while (i < a->count && j < b->count) {
+        if (a->containers[i].key < b->containers[j].key) {
+            i++;
+        } else if (b->containers[j].key < a->containers[i].key) {
+            j++;
+        } else {
+            total += (uint64_t)container_and_cardinality(&a->containers[i++], &b->containers[j++]);
+        }
+    }
+    return total;
+}
+
+size_t bitmap_to_array(const TonBitmap* bitmap, uint32_t* out, size_t max) {
+    size_t n = 0;
+    for (int i = 0; i < bitmap->count && n < max; i++) {
+        const BitmapContainer* c = &bitmap->containers[i];
+        uint32_t high = (uint32_t)c->key << 16;
+        if (!container_is_bitmap(c)) {
+            for (int k = 0; k < c->cardinality && n < max; k++) out[n++] = high | c->array[k];
+            continue;
+        }
+        for (int w = 0; w < BITMAP_CHUNK_WORDS && n < max; w++) {
+            for (uint64_t word = c->bits[w]; word && n < max; word &= word - 1) {
+                out[n++] = high | (uint32_t)(w * 64 + lowest_bit64(word));
+            }
+        }
+    }
+    return n;
+}
+
+// "TRBM", u32 container count, then per container: u16 key, u16 kind
+// (0 array, 1 bitmap), u32 cardinality and the sorted u16 values or the
+// 1024 bitmap words
+#define BITMAP_HEADER 8
+#define BITMAP_CONTAINER_HEADER 8
+
+size_t bitmap_serialize(const TonBitmap* bitmap, unsigned char** out) {
+    size_t len = BITMAP_HEADER;
+    for (int i = 0; i < bitmap->count; i++) {
+        const BitmapContainer* c = &bitmap->containers[i];
+        len += BITMAP_CONTAINER_HEADER + (container_is_bitmap(c) ? BITMAP_CHUNK_BYTES : (size_t)c->cardinality * 2);
+    }
+    unsigned char* data = (unsigned char*)ton_malloc(len);
+    if (!data) return 0;
+    memcpy(data, "TRBM", 4);
+    put_u32(data + 4, (uint32_t)bitmap->count);
+    unsigned char* p = data + BITMAP_HEADER;
+    for (int i = 0; i < bitmap->count; i++) {
+        const BitmapContainer* c = &bitmap->containers[i];
+        put_u16(p, c->key);
+        put_u16(p + 2, (uint16_t)container_is_bitmap(c));
+        put_u32(p + 4, (uint32_t)c->cardinality);
+        p += BITMAP_CONTAINER_HEADER;
+        if (container_is_bitmap(c)) {
+            for (int w = 0; w < BITMAP_CHUNK_WORDS; w++, p += 8) put_u64(p, c->bits[w]);
+        } else {
+            for (int k = 0; k < c->cardinality; k++, p += 2) put_u16(p, c->array[k]);
+        }
+    }
+    *out = data;
+    return len;
+}
+
+TonBitmap* bitmap_deserialize(const unsigned char* data, size_t len) {
+    if (len < BITMAP_HEADER || memcmp(data, "TRBM", 4) != 0) return NULL;
+    uint32_t count = get_u32(data + 4);
+    if (count > 65536) return NULL;
+    TonBitmap* bitmap = bitmap_create();
+    if (!bitmap || !bitmap_reserve(bitmap, (int)count)) goto invalid;
+
+    const unsigned char* p = data + BITMAP_HEADER;
+    const unsigned char* end = data + len;
+    for (uint32_t i = 0; i < count; i++) {
+        if ((size_t)(end - p) < BITMAP_CONTAINER_HEADER) goto invalid;
+        uint16_t key = get_u16(p);
+        uint16_t kind = get_u16(p + 2);
+        uint32_t cardinality = get_u32(p + 4);
+        p += BITMAP_CONTAINER_HEADER;
+        if (i > 0 && key <= bitmap->containers[bitmap->count - 1].key) goto invalid;
+
+        BitmapContainer c;
+        if (kind == 1) {
+            if (cardinality <= BITMAP_ARRAY_MAX || cardinality > 65536 || (size_t)(end - p) < BITMAP_CHUNK_BYTES) goto invalid;
+            if (!container_init_bitmap(&c, key)) goto invalid;
+            for (int w = 0; w < BITMAP_CHUNK_WORDS; w++, p += 8) c.bits[w] = get_u64(p);
+            c.cardinality = bits_cardinality(c.bits);
+        } else if (kind == 0) {
+            if (cardinality == 0 || cardinality > BITMAP_ARRAY_MAX || (size_t)(end - p) < (size_t)cardinality * 2) goto invalid;
+            if (!container_init_array(&c, key, (int)cardinality)) goto invalid;
+            for (uint32_t k = 0; k < cardinality; k++, p += 2) {
+                c.array[k] = get_u16(p);
+                if (k > 0 && c.array[k] <= c.array[k - 1]) {
+                    container_free(&c);
+                    goto invalid;
+                }
+            }
+            c.cardinality = (int)cardinality;
+        } else {
+            goto invalid;
+        }
+        if ((uint32_t)c.cardinality != cardinality) {
+            container_free(&c);
+            goto invalid;
+        }
+        bitmap->containers[bitmap->count++] = c;
+    }
+    if (p != end) goto invalid;
+    return bitmap;
+
+invalid:
+    bitmap_destroy(bitmap);
+    return NULL;
+}
@@ -0,0 +1,117 @@
+#ifndef TON_SKETCH_H
+#define TON_SKETCH_H
+
+#include "value.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Compact set summaries for large streams of keys: a Bloom filter for
+// membership, HyperLogLog for distinct counts and a Roaring-style bitmap for
+// exact sets of non-negative ints. None of them stores the keys themselves.
+//
+// Keys are hashed with a fixed seed rather than the per-process one, so a
+// serialized filter or sketch still matches the same keys when it is loaded
+// by another process. Serialized forms are little-endian byte strings that
+// start with a four-byte tag.
+
+// Seed for every sketch hash; part of the serialized formats, never change it
+#define SKETCH_HASH_SEED 0x5D588B656C078965ULL
+
+// 64-bit sketch hash of a hashable key; 0 if the key cannot be hashed
+int sketch_hash_key(const Value* key, uint64_t* out);
+
+// ---------------------------------------------------------------------------
+// Bloom filter: split-block layout. Every key maps to one 256-bit block and
+// sets one bit in each of its eight 32-bit words, so a lookup touches a
+// single cache line and the eight probes are independent lanes.
+
+#define BLOOM_BLOCK_WORDS 8
+
+typedef struct {
+    uint32_t* blocks;             // block_count * BLOOM_BLOCK_WORDS words
+    uint32_t block_count;
+    uint64_t added;               // add calls that set at least one new bit
+} TonBloom;
+
+// Filter sized so that `expected` keys give a false positive rate of at most `fpr`
+TonBloom* bloom_create(uint64_t expected, double fpr);
+void bloom_destroy(TonBloom* bloom);
+// Returns 1 if the key may have been added before, 0 if it was new
+int bloom_add_hash(TonBloom* bloom, uint64_t hash);
+int bloom_has_hash(const TonBloom* bloom, uint64_t hash);
+// OR `other` into `bloom`; both must have the same block count
+int bloom_merge(TonBloom* bloom, const TonBloom* other);
+size_t bloom_serialize(const TonBloom* bloom, unsigned char** out);
+TonBloom* bloom_deserialize(const unsigned char* data, size_t len);
+
+// ---------------------------------------------------------------------------
+// HyperLogLog++: 2^precision one-byte registers, preceded by a sparse mode
+// that keeps (index, rank) pairs at precision HLL_SPARSE_PRECISION while the
+// pairs take less room than the registers would. Estimates use Ertl's
+// improved estimator, which needs no empirical bias tables.
+
+#define HLL_MIN_PRECISION 4
+#define HLL_MAX_PRECISION 18
+#define HLL_SPARSE_PRECISION 25
+#define HLL_SPARSE_BUFFER 256          // Unsorted sparse pairs held before a merge
+
+typedef struct {
+    int precision;
+    int sparse;                   // Still in sparse mode
+    uint8_t* registers;           // Dense mode: 2^precision ranks
+    uint32_t* pairs;              // Sparse mode: sorted (index << 6 | rank), one per index
+    int pair_count;
+    int pair_capacity;
+    uint32_t buffer[HLL_SPARSE_BUFFER]; // Sparse mode: pairs not yet merged into `pairs`
+    int buffered;
+} TonHLL;
+
+TonHLL* hll_create(int precision);
+void hll_destroy(TonHLL* hll);
+int hll_add_hash(TonHLL* hll, uint64_t hash);
+double hll_estimate(TonHLL* hll);
+// Fold `other` into `hll`; both must have the same precision
+int hll_merge(TonHLL* hll, TonHLL* other);
+size_t hll_serialize(TonHLL* hll, unsigned char** out);
+TonHLL* hll_deserialize(const unsigned char* data, size_t len);
+
+// ---------------------------------------------------------------------------
+// Roaring-style bitmap of uint32 values: one container per distinct high 16
+// bits, holding the low 16 bits either as a sorted array (sparse chunks) or
+// as a 65536-bit bitmap (dense chunks), whichever is smaller.
+
+#define BITMAP_ARRAY_MAX 4096          // Array containers convert to bitmaps past this
+#define BITMAP_CHUNK_WORDS 1024        // 64-bit words in a bitmap container
+
+typedef struct {
+    uint16_t key;                 // High 16 bits shared by the container's values
+    int cardinality;
+    int capacity;                 // Array containers: allocated slots; 0 for bitmaps
+    uint16_t* array;              // Sorted low bits, or NULL for a bitmap container
+    uint64_t* bits;               // BITMAP_CHUNK_WORDS words, or NULL for an array container
+} BitmapContainer;
+
+typedef struct {
+    BitmapContainer* containers;  // Sorted by key
+    int count;
+    int capacity;
+} TonBitmap;
+
+TonBitmap* bitmap_create(void);
+void bitmap_destroy(TonBitmap* bitmap);
+// Returns 1 if the value was added, 0 if it was present, -1 if out of memory
+int bitmap_add(TonBitmap* bitmap, uint32_t value);
+int bitmap_remove(TonBitmap* bitmap, uint32_t value);
+int bitmap_contains(const TonBitmap* bitmap, uint32_t value);
+uint64_t bitmap_cardinality(const TonBitmap* bitmap);
+// New bitmaps; NULL if out of memory
+TonBitmap* bitmap_or(const TonBitmap* a, const TonBitmap* b);
+TonBitmap* bitmap_and(const TonBitmap* a, const TonBitmap* b);
+TonBitmap* bitmap_andnot(const TonBitmap* a, const TonBitmap* b);
+uint64_t bitmap_and_cardinality(const TonBitmap* a, const TonBitmap* b);
+// Values in ascending order; writes at most `max` and returns how many were written
+size_t bitmap_to_array(const TonBitmap* bitmap, uint32_t* out, size_t max);
+size_t bitmap_serialize(const TonBitmap* bitmap, unsigned char** out);
+TonBitmap* bitmap_deserialize(const unsigned char* data, size_t len);
+
+#endif // TON_SKETCH_H
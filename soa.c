@@ -0,0 +1,153 @@
+#include "soa.h"
+#include "gc.h"
+#include "memory.h"
+#include <string.h>
+
+static int column_kind(const StructField* field) {
+    if (strcmp(field->type_name, "int") == 0) return SOA_COLUMN_INT;
+    if (strcmp(field->type_name, "float") == 0) return SOA_COLUMN_FLOAT;
+    if (strcmp(field->type_name, "bool") == 0) return SOA_COLUMN_BOOL;
+    return SOA_COLUMN_VALUE;
+}
+
+static size_t column_width(int kind) {
+    switch (kind) {
+        case SOA_COLUMN_INT:   return sizeof(int);
+        case SOA_COLUMN_FLOAT: return sizeof(double);
+        case SOA_COLUMN_BOOL:  return sizeof(unsigned char);
+        default:               return sizeof(Value);
+    }
+}
+
+// Grow every column to hold `capacity` elements; the new tail is zeroed,
+// which reads back as 0, 0.0, false or the int 0 of a fresh instance
+static int soa_reserve(TonSoA* soa, int capacity) {
+    if (capacity <= soa->capacity) return 1;
+    for (int i = 0; i < soa->type->num_fields; i++) {
+        TonSoAColumn* column = &soa->columns[i];
+        size_t width = column_width(column->kind);
+        void* grown = ton_realloc(column->data.raw, width * (size_t)capacity);
+        if (!grown) return 0;
+        memset((char*)grown + width * (size_t)soa->capacity, 0, width * (size_t)(capacity - soa->capacity));
+        column->data.raw = grown;
+    }
+    soa->capacity = capacity;
+    return 1;
+}
+
+TonSoA* tonsoa_create(const TonStructType* type, int length) {
+    if (!type || length < 0) return NULL;
+    TonSoA* soa = (TonSoA*)gc_alloc(GC_KIND_SOA, sizeof(TonSoA));
+    if (!soa) return NULL;
+    soa->type = type;
+    soa->columns = (TonSoAColumn*)ton_calloc(type->num_fields > 0 ? type->num_fields : 1, sizeof(TonSoAColumn));
+    if (!soa->columns) {
+        gc_free(soa);
+        return NULL;
+    }
+    for (int i = 0; i < type->num_fields; i++) {
+        soa->columns[i].kind = column_kind(&type->fields[i]);
+    }
+    if (!soa_reserve(soa, length)) {
+        tonsoa_destroy(soa);
+        return NULL;
+    }
+    soa->length = length;
+    return soa;
+}
+
+void tonsoa_destroy(TonSoA* soa) {
+    if (!soa) return;
+    for (int i = 0; i < soa->type->num_fields; i++) {
+        TonSoAColumn* column = &soa->columns[i];
+        if (column->kind == SOA_COLUMN_VALUE && column->data.values) {
+            for (int j = 0; j < soa->length; j++) value_release(&column->data.values[j]);
+        }
+        ton_free(column->data.raw);
+    }
+    ton_free(soa->columns);
+    gc_free(soa);
+}
+
+int tonsoa_size(const TonSoA* soa) {
+    return soa->length;
+}
+
+Value tonsoa_get_field(const TonSoA* soa, int index, int slot) {
+    const TonSoAColumn* column = &soa->columns[slot];
+    switch (column->kind) {
+        case SOA_COLUMN_INT:   return create_value_int(column->data.ints[index]);
+        case SOA_COLUMN_FLOAT: return create_value_float(column->data.floats[index]);
+        case SOA_COLUMN_BOOL:  return create_value_bool(column->data.bools[index]);
+        default:               return column->data.values[index];
+    }
+}
+
+int tonsoa_set_field(TonSoA* soa, int index, int slot, Value value) {
+    TonSoAColumn* column = &soa->columns[slot];
+    switch (column->kind) {
+        case SOA_COLUMN_INT:
+            if (value.type != VALUE_INT) return 0;
+            column->data.ints[index] = value.data.int_val;
+            return 1;
+        case SOA_COLUMN_FLOAT:
+            if (value.type == VALUE_FLOAT) {
+                column->data.floats[index] = value.data.float_val;
+            } else if (value.type == VALUE_INT) {
+                column->data.floats[index] = (double)value.data.int_val;
+            } else {
+                return 0;
+            }
+            return 1;
+        case SOA_COLUMN_BOOL:
+            // An unset field of a fresh instance holds the int 0
+            if (value.type == VALUE_BOOL) {
+                column->data.bools[index] = value.data.bool_val ? 1 : 0;
+            } else if (value.type == VALUE_INT) {
+                column->data.bools[index] = value.data.int_val != 0;
+            } else {
+                return 0;
+            }
+            return 1;
+        default:
+            value_release(&column->data.values[index]);
+            column->data.values[index] = value_copy(&value);
+            gc_write_barrier(soa, &value);
+            return 1;
+    }
+}
+
+int tonsoa_set(TonSoA* soa, int index, const TonStructInstance* si) {
+    // Check every field first so a mismatch leaves the element unchanged
+    for (int i = 0; i < soa->type->num_fields; i++) {
+        Value v = si->field_values[i];
+        int kind = soa->columns[i].kind;
+        if ((kind == SOA_COLUMN_INT && v.type != VALUE_INT) ||
+            (kind == SOA_COLUMN_FLOAT && v.type != VALUE_FLOAT && v.type != VALUE_INT) ||
+            (kind == SOA_COLUMN_BOOL && v.type != VALUE_BOOL && v.type != VALUE_INT)) {
+            return 0;
+        }
+    }
+    for (int i = 0; i < soa->type->num_fields; i++) {
+        tonsoa_set_field(soa, index, i, si->field_values[i]);
+    }
+    return 1;
+}
+
+int tonsoa_push(TonSoA* soa, const TonStructInstance* si) {
+    if (soa->length == soa->capacity && !soa_reserve(soa, soa->capacity < 8 ? 8 : soa->capacity * 2)) return 0;
+    if (!tonsoa_set(soa, soa->length, si)) return -1;
+    soa->length++;
+    return 1;
+}
+
+TonStructInstance* tonsoa_get(const TonSoA* soa, int index) {
+    TonStructInstance* si = create_struct_instance(soa->type);
+    if (!si) return NULL;
+    for (int i = 0; i < soa->type->num_fields; i++) {
+        Value v = tonsoa_get_field(soa, index, i);
+        si->field_values[i] = value_copy(&v);
+        gc_write_barrier(si, &v);
+    }
+    return si;
+}
@@ -0,0 +1,53 @@
+#ifndef TON_SOA_H
+#define TON_SOA_H
+
+#include "value.h"
+#include "struct.h"
+
+// TonSoA - Array of instances of one class, stored as a struct of arrays:
+// each field is a column holding that field for every element, so a pass
+// over one field reads a single dense array instead of one heap block per
+// element. Columns are typed by the field's declared type. int fields are
+// int columns, float fields double columns and bool fields byte columns.
+// Fields of any other type are columns of boxed values.
+
+#define SOA_COLUMN_INT 0
+#define SOA_COLUMN_FLOAT 1
+#define SOA_COLUMN_BOOL 2
+#define SOA_COLUMN_VALUE 3
+
+typedef struct {
+    int kind;
+    union {
+        int* ints;
+        double* floats;
+        unsigned char* bools;
+        Value* values;
+        void* raw;
+    } data;
+} TonSoAColumn;
+
+typedef struct {
+    const TonStructType* type;
+    TonSoAColumn* columns;        // One per field, in slot order
+    int length;
+    int capacity;
+} TonSoA;
+
+// `length` elements with every field zeroed; NULL if out of memory
+TonSoA* tonsoa_create(const TonStructType* type, int length);
+void tonsoa_destroy(TonSoA* soa);
+int tonsoa_size(const TonSoA* soa);
+// Append the fields of an instance of the array's class. Returns 1, 0 if out
+// of memory, or -1 if a field does not fit its column
+int tonsoa_push(TonSoA* soa, const TonStructInstance* si);
+// Field `slot` of element `index`; values of boxed columns are borrowed
+Value tonsoa_get_field(const TonSoA* soa, int index, int slot);
+// Returns 0 if the value does not fit the column's type
+int tonsoa_set_field(TonSoA* soa, int index, int slot, Value value);
+// New instance holding a copy of element `index`
+TonStructInstance* tonsoa_get(const TonSoA* soa, int index);
+// Store the fields of an instance of the array's class; 0 if one does not fit
+int tonsoa_set(TonSoA* soa, int index, const TonStructInstance* si);
+
+#endif // TON_SOA_H
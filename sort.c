@@ -0,0 +1,472 @@
+#include "sort.h"
+#include "gc.h"
+#include "memory.h"
+#include <stdint.h>
+#include <string.h>
+
+#define INSERTION_SORT_THRESHOLD 24  // Ranges shorter than this are insertion sorted
+#define NINTHER_THRESHOLD 128        // Ranges longer than this use Tukey's ninther as pivot
+#define PARTIAL_INSERTION_LIMIT 8    // Moves allowed when guessing a range is already sorted
+#define MERGE_RUN 16                 // Stable sort insertion sorts runs of this length first
+
+// Every loop below checks its bounds explicitly instead of relying on a
+// sentinel element: user comparators may be inconsistent and must not be
+// able to walk the algorithms off the end of the buffer.
+
+void sort_span_init(SortSpan* span, ElementKind kind, ElementData data, SortLessFn less, void* ctx) {
+    span->kind = kind;
+    span->data = data;
+    span->width = element_size(kind);
+    span->less = less;
+    span->ctx = ctx;
+    span->stop = NULL;
+    span->owner = NULL;
+    span->scratch_owner = NULL;
+}
+
+static inline unsigned char* element_at(const SortSpan* s, size_t i) {
+    return (unsigned char*)s->data.raw + i * s->width;
+}
+
+static inline void swap_elements(const SortSpan* s, size_t i, size_t j) {
+    // Fixed-size copies per kind, so each swap compiles to a few moves
+    switch (s->kind) {
+        case ELEMENTS_BOXED: {
+            Value t = s->data.boxed[i];
+            s->data.boxed[i] = s->data.boxed[j];
+            s->data.boxed[j] = t;
+            break;
+        }
+        case ELEMENTS_INT32: {
+            int32_t t = s->data.ints[i];
+            s->data.ints[i] = s->data.ints[j];
+            s->data.ints[j] = t;
+            break;
+        }
+        case ELEMENTS_DOUBLE: {
+            double t = s->data.floats[i];
+            s->data.floats[i] = s->data.floats[j];
+            s->data.floats[j] = t;
+            break;
+        }
+        default: {
+            uint8_t t = s->data.bytes[i];
+            s->data.bytes[i] = s->data.bytes[j];
+            s->data.bytes[j] = t;
+            break;
+        }
+    }
+}
+
+// elements_load, inlined: boxed elements are compared where they lie
+static inline Value load_element(const SortSpan* s, ElementData data, size_t i) {
+    Value v;
+    v.ref_count = 0;
+    switch (s->kind) {
+        case ELEMENTS_BOXED:
+            return data.boxed[i];
+        case ELEMENTS_INT32:
+            v.type = VALUE_INT;
+            v.data.int_val = data.ints[i];
+            return v;
+        case ELEMENTS_DOUBLE:
+            v.type = VALUE_FLOAT;
+            v.data.float_val = data.floats[i];
+            return v;
+        default:
+            return elements_load(s->kind, data, i);
+    }
+}
+
+static inline int less_at(const SortSpan* s, size_t i, size_t j) {
+    if (s->kind == ELEMENTS_BOXED) return s->less(&s->data.boxed[i], &s->data.boxed[j], s->ctx);
+    Value a = load_element(s, s->data, i);
+    Value b = load_element(s, s->data, j);
+    return s->less(&a, &b, s->ctx);
+}
+
+static inline int stopped(const SortSpan* s) {
+    return s->stop && *s->stop;
+}
+
+static inline void sort2(const SortSpan* s, size_t a, size_t b) {
+    if (less_at(s, b, a)) swap_elements(s, a, b);
+}
+
+// Leaves the median of the three elements at b
+static inline void sort3(const SortSpan* s, size_t a, size_t b, size_t c) {
+    sort2(s, a, b);
+    sort2(s, b, c);
+    sort2(s, a, b);
+}
+
+// Swap-based so that no element ever lives only in a C local
+static void insertion_sort(const SortSpan* s, size_t begin, size_t end) {
+    for (size_t i = begin + 1; i < end; i++) {
+        for (size_t j = i; j > begin && less_at(s, j, j - 1); j--) {
+            swap_elements(s, j, j - 1);
+        }
+    }
+}
+
+// Insertion sort that gives up after PARTIAL_INSERTION_LIMIT moves
+static int partial_insertion_sort(const SortSpan* s, size_t begin, size_t end) {
+    size_t moves = 0;
+    for (size_t i = begin + 1; i < end; i++) {
+        size_t j = i;
+        while (j > begin && less_at(s, j, j - 1)) {
+            swap_elements(s, j, j - 1);
+            j--;
+        }
+        moves += i - j;
+        if (moves > PARTIAL_INSERTION_LIMIT) return 0;
+    }
+    return 1;
+}
+
+static void sift_down(const SortSpan* s, size_t begin, size_t root, size_t n) {
+    for (;;) {
+        size_t child = 2 * root + 1;
+        if (child >= n) return;
+        if (child + 1 < n && less_at(s, begin + child, begin + child + 1)) child++;
+        if (!less_at(s, begin + root, begin + child)) return;
+        swap_elements(s, begin + root, begin + child);
+        root = child;
+    }
+}
+
+static void heap_sort(const SortSpan* s, size_t begin, size_t end) {
+    size_t n = end - begin;
+    for (size_t i = n / 2; i-- > 0;) sift_down(s, begin, i, n);
+    for (size_t i = n; i-- > 1;) {
+        swap_elements(s, begin, begin + i);
+        sift_down(s, begin, 0, i);
+    }
+}
+
+/**
+ * Partition [begin, end) around the pivot at begin: smaller elements to the
+ * left, elements not less than the pivot to the right
+ * @param already Set to 1 if no element had to move
+ * @return Final position of the pivot
+ */
+static size_t partition_right(const SortSpan* s, size_t begin, size_t end, int* already) {
+    size_t first = begin + 1;
+    size_t last = end;
+    while (first < last && less_at(s, first, begin)) first++;
+    while (first < last && !less_at(s, last - 1, begin)) last--;
+    *already = first >= last;
+
+    while (first < last) {
+        swap_elements(s, first, last - 1);
+        first++;
+        last--;
+        while (first < last && less_at(s, first, begin)) first++;
+        while (first < last && !less_at(s, last - 1, begin)) last--;
+    }
+
+    size_t pivot = first - 1;
+    swap_elements(s, begin, pivot);
+    return pivot;
+}
+
+// Partition with elements equal to the pivot on the left. Used when the pivot
+// equals the element before the range, so the left side is all equal to it.
+static size_t partition_left(const SortSpan* s, size_t begin, size_t end) {
+    size_t first = begin + 1;
+    size_t last = end;
+    while (first < last && less_at(s, begin, last - 1)) last--;
+    while (first < last && !less_at(s, begin, first)) first++;
+
+    while (first < last) {
+        swap_elements(s, first, last - 1);
+        first++;
+        last--;
+        while (first < last && less_at(s, begin, last - 1)) last--;
+        while (first < last && !less_at(s, begin, first)) first++;
+    }
+
+    size_t pivot = first - 1;
+    swap_elements(s, begin, pivot);
+    return pivot;
+}
+
+static int floor_log2(size_t n) {
+    int log = 0;
+    while (n >>= 1) log++;
+    return log;
+}
+
+static void pdq_loop(const SortSpan* s, size_t begin, size_t end, int bad_allowed, int leftmost) {
+    for (;;) {
+        if (stopped(s)) return;
+        size_t size = end - begin;
+        if (size < INSERTION_SORT_THRESHOLD) {
+            insertion_sort(s, begin, end);
+            return;
+        }
+
+        size_t half = size / 2;
+        if (size > NINTHER_THRESHOLD) {
+            sort3(s, begin, begin + half, end - 1);
+            sort3(s, begin + 1, begin + half - 1, end - 2);
+            sort3(s, begin + 2, begin + half + 1, end - 3);
+            sort3(s, begin + half - 1, begin + half, begin + half + 1);
+            swap_elements(s, begin, begin + half);
+        } else {
+            sort3(s, begin + half, begin, end - 1);
+        }
+
+        // Runs of equal elements: the pivot equals its left neighbour, so
+        // everything equal to it is already in its final place
+        if (!leftmost && !less_at(s, begin - 1, begin)) {
+            begin = partition_left(s, begin, end) + 1;
+            continue;
+        }
+
+        int already;
+        size_t pivot = partition_right(s, begin, end, &already);
+        size_t left_size = pivot - begin;
+        size_t right_size = end - (pivot + 1);
+
+        if (left_size < size / 8 || right_size < size / 8) {
+            // Bad pivot: fall back to heapsort after too many, otherwise
+            // break up the pattern that produced it
+            if (--bad_allowed == 0) {
+                heap_sort(s, begin, end);
+                return;
+            }
+            if (left_size >= INSERTION_SORT_THRESHOLD) {
+                swap_elements(s, begin, begin + left_size / 4);
+                swap_elements(s, pivot - 1, pivot - left_size / 4);
+            }
+            if (right_size >= INSERTION_SORT_THRESHOLD) {
+                swap_elements(s, pivot + 1, pivot + 1 + right_size / 4);
+                swap_elements(s, end - 1, end - right_size / 4);
+            }
+        } else if (already && partial_insertion_sort(s, begin, pivot) &&
+                   partial_insertion_sort(s, pivot + 1, end)) {
+            return;
+        }
+
+        // Recurse into the smaller side so the stack stays O(log n)
+        if (left_size < right_size) {
+            pdq_loop(s, begin, pivot, bad_allowed, leftmost);
+            begin = pivot + 1;
+            leftmost = 0;
+        } else {
+            pdq_loop(s, pivot + 1, end, bad_allowed, 0);
+            end = pivot;
+        }
+    }
+}
+
+void sort_unstable(SortSpan* span, size_t n) {
+    if (n < 2) return;
+    pdq_loop(span, 0, n, floor_log2(n), 1);
+}
+
+static void merge_sort(const SortSpan* s, ElementData scratch, size_t begin, size_t end) {
+    if (end - begin <= MERGE_RUN) {
+        insertion_sort(s, begin, end);
+        return;
+    }
+    size_t mid = begin + (end - begin) / 2;
+    merge_sort(s, scratch, begin, mid);
+    merge_sort(s, scratch, mid, end);
+    if (stopped(s) || !less_at(s, mid, mid - 1)) return;
+
+    // Move the left run out of the way, then merge back into [begin, end)
+    size_t left = mid - begin;
+    memcpy(scratch.raw, element_at(s, begin), left * s->width);
+    if (s->kind == ELEMENTS_BOXED && s->scratch_owner) {
+        for (size_t i = 0; i < left; i++) gc_write_barrier(s->scratch_owner, &scratch.boxed[i]);
+    }
+
+    size_t i = 0, j = mid, k = begin;
+    while (i < left && j < end) {
+        Value a = load_element(s, scratch, i);
+        Value b = load_element(s, s->data, j);
+        // Take from the right run only when strictly smaller: keeps equal elements in order
+        if (s->less(&b, &a, s->ctx)) {
+            memcpy(element_at(s, k++), element_at(s, j++), s->width);
+        } else {
+            memcpy(element_at(s, k++), (unsigned char*)scratch.raw + i++ * s->width, s->width);
+        }
+    }
+    if (i < left) {
+        memcpy(element_at(s, k), (unsigned char*)scratch.raw + i * s->width, (left - i) * s->width);
+    }
+    if (s->kind == ELEMENTS_BOXED && s->owner) {
+        for (size_t m = begin; m < end; m++) gc_write_barrier(s->owner, &s->data.boxed[m]);
+    }
+}
+
+void sort_stable(SortSpan* span, size_t n, ElementData scratch) {
+    if (n < 2) return;
+    merge_sort(span, scratch, 0, n);
+}
+
+void sort_select(SortSpan* span, size_t n, size_t nth) {
+    if (nth >= n) return;
+    size_t begin = 0, end = n;
+    int budget = 2 * floor_log2(n) + 2;
+    while (end - begin > INSERTION_SORT_THRESHOLD) {
+        if (stopped(span)) return;
+        if (budget-- == 0) {
+            heap_sort(span, begin, end);
+            return;
+        }
+        size_t half = (end - begin) / 2;
+        sort3(span, begin + half, begin, end - 1);
+        int already;
+        size_t pivot = partition_right(span, begin, end, &already);
+        if (pivot == nth) return;
+        if (nth < pivot) end = pivot;
+        else begin = pivot + 1;
+    }
+    insertion_sort(span, begin, end);
+}
+
+size_t sort_partition(SortSpan* span, size_t n, SortPredFn pred, void* ctx) {
+    size_t first = 0, last = n;
+    for (;;) {
+        while (first < last && !stopped(span)) {
+            Value v = load_element(span, span->data, first);
+            if (!pred(&v, ctx)) break;
+            first++;
+        }
+        while (first < last && !stopped(span)) {
+            Value v = load_element(span, span->data, last - 1);
+            if (pred(&v, ctx)) break;
+            last--;
+        }
+        if (first >= last || stopped(span)) return first;
+        swap_elements(span, first, last - 1);
+        first++;
+        last--;
+    }
+}
+
+size_t sort_lower_bound(SortSpan* span, size_t n, const Value* value) {
+    size_t lo = 0, hi = n;
+    while (lo < hi && !stopped(span)) {
+        size_t mid = lo + (hi - lo) / 2;
+        Value v = load_element(span, span->data, mid);
+        if (span->less(&v, value, span->ctx)) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// LSD radix sort of unsigned keys, one byte per pass. Passes where every
+// key has the same digit are skipped.
+#define DEFINE_RADIX_SORT(name, key_t)                                          \
+    static int name(key_t* keys, size_t n) {                                    \
+        enum { KEY_BYTES = sizeof(key_t) };                                     \
+        key_t* tmp = (key_t*)ton_malloc(n * sizeof(key_t));                     \
+        if (!tmp) return 0;                                                     \
+        size_t counts[KEY_BYTES][256];                                          \
+        memset(counts, 0, sizeof(counts));                                      \
+        for (size_t i = 0; i < n; i++) {                                        \
+            key_t k = keys[i];                                                  \
+            for (int b = 0; b < KEY_BYTES; b++) counts[b][(k >> (8 * b)) & 0xFF]++; \
+        }                                                                       \
+        key_t* src = keys;                                                      \
+        key_t* dst = tmp;                                                       \
+        for (int b = 0; b < KEY_BYTES; b++) {                                   \
+            int shift = 8 * b;                                                  \
+            if (counts[b][(src[0] >> shift) & 0xFF] == n) continue;             \
+            size_t offsets[256];                                                \
+            size_t sum = 0;                                                     \
+            for (int d = 0; d < 256; d++) {                                     \
+                offsets[d] = sum;                                               \
+                sum += counts[b][d];                                            \
+            }                                                                   \
+            for (size_t i = 0; i < n; i++) dst[offsets[(src[i] >> shift) & 0xFF]++] = src[i]; \
+            key_t* t = src;                                                     \
+            src = dst;                                                          \
+            dst = t;                                                            \
+        }                                                                       \
+        if (src != keys) memcpy(keys, src, n * sizeof(key_t));                  \
+        ton_free(tmp);                                                          \
+        return 1;                                                               \
+    }
+
+DEFINE_RADIX_SORT(radix_sort_u32, uint32_t)
+DEFINE_RADIX_SORT(radix_sort_u64, uint64_t)
+
+// Doubles map to unsigned keys with the same order: flip the sign bit of
+// positives, every bit of negatives
+static uint64_t double_key(double d) {
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    return (bits >> 63) ? ~bits : bits | 0x8000000000000000ULL;
+}
+
+static double key_double(uint64_t key) {
+    uint64_t bits = (key >> 63) ? key & 0x7FFFFFFFFFFFFFFFULL : ~key;
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+int sort_radix(ElementKind kind, ElementData data, size_t n) {
+    if (n < 2 || kind == ELEMENTS_BOXED) return 1;
+
+    if (kind == ELEMENTS_BOOL || kind == ELEMENTS_CHAR) {
+        // Counting sort; chars order as signed bytes like their Values do
+        size_t counts[256] = {0};
+        for (size_t i = 0; i < n; i++) counts[data.bytes[i]]++;
+        size_t k = 0;
+        for (int d = 0; d < 256; d++) {
+            int byte = kind == ELEMENTS_CHAR ? (d + 128) & 0xFF : d;
+            for (size_t c = counts[byte]; c > 0; c--) data.bytes[k++] = (uint8_t)byte;
+        }
+        return 1;
+    }
+
+    if (kind == ELEMENTS_INT32) {
+        // Ints are biased to unsigned keys in place and sorted where they lie
+        uint32_t* keys = (uint32_t*)data.ints;
+        for (size_t i = 0; i < n; i++) keys[i] ^= 0x80000000u;
+        int ok = radix_sort_u32(keys, n);
+        for (size_t i = 0; i < n; i++) keys[i] ^= 0x80000000u;
+        return ok;
+    }
+
+    uint64_t* keys = (uint64_t*)ton_malloc(n * sizeof(uint64_t));
+    if (!keys) return 0;
+    for (size_t i = 0; i < n; i++) keys[i] = double_key(data.floats[i]);
+    int ok = radix_sort_u64(keys, n);
+    if (ok) {
+        for (size_t i = 0; i < n; i++) data.floats[i] = key_double(keys[i]);
+    }
+    ton_free(keys);
+    return ok;
+}
+
+int sort_compare_natural(const Value* a, const Value* b, int* comparable) {
+    *comparable = 1;
+    if (a->type == VALUE_INT && b->type == VALUE_INT) {
+        return (a->data.int_val > b->data.int_val) - (a->data.int_val < b->data.int_val);
+    }
+    if ((a->type == VALUE_INT || a->type == VALUE_FLOAT) && (b->type == VALUE_INT || b->type == VALUE_FLOAT)) {
+        double x = a->type == VALUE_INT ? (double)a->data.int_val : a->data.float_val;
+        double y = b->type == VALUE_INT ? (double)b->data.int_val : b->data.float_val;
+        return (x > y) - (x < y);
+    }
+    if (a->type == b->type) {
+        switch (a->type) {
+            case VALUE_STRING: {
+                int c = strcmp(a->data.string_val, b->data.string_val);
+                return (c > 0) - (c < 0);
+            }
+            case VALUE_CHAR: return (a->data.char_val > b->data.char_val) - (a->data.char_val < b->data.char_val);
+            case VALUE_BOOL: return (a->data.bool_val != 0) - (b->data.bool_val != 0);
+            default: break;
+        }
+    }
+    *comparable = 0;
+    return 0;
+}
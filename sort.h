@@ -0,0 +1,46 @@
+#ifndef TON_SORT_H
+#define TON_SORT_H
+
+#include "elements.h"
+#include <stddef.h>
+
+// Ordering callbacks. A callback that fails records the error in its context
+// and returns 0 from then on, so the algorithms below wind down safely.
+typedef int (*SortLessFn)(const Value* a, const Value* b, void* ctx);
+typedef int (*SortPredFn)(const Value* value, void* ctx);
+
+// A run of elements in any ElementKind storage. The algorithms only swap
+// elements of the run in place (stable sort also copies through `scratch`),
+// so a boxed run stays fully visible to the collector while callbacks run.
+typedef struct {
+    ElementKind kind;
+    ElementData data;
+    size_t width;              // element_size(kind)
+    SortLessFn less;
+    void* ctx;
+    const int* stop;           // Optional; nonzero aborts the algorithm early
+    void* owner;               // Collected object holding the run, or NULL
+    void* scratch_owner;       // Collected object holding the scratch buffer, or NULL
+} SortSpan;
+
+void   sort_span_init(SortSpan* span, ElementKind kind, ElementData data, SortLessFn less, void* ctx);
+
+// Pattern-defeating quicksort: O(n log n) worst case, linear on sorted input
+void   sort_unstable(SortSpan* span, size_t n);
+// Merge sort; `scratch` must hold n elements of the span's kind
+void   sort_stable(SortSpan* span, size_t n, ElementData scratch);
+// Reorder so element `nth` is the one a full sort would put there
+void   sort_select(SortSpan* span, size_t n, size_t nth);
+// Move elements satisfying `pred` to the front; returns how many there are
+size_t sort_partition(SortSpan* span, size_t n, SortPredFn pred, void* ctx);
+// First position whose element is not less than `value`
+size_t sort_lower_bound(SortSpan* span, size_t n, const Value* value);
+
+// Natural order of unboxed storage: LSD radix sort for ints and floats,
+// counting sort for bools and chars. Returns 0 if scratch allocation failed.
+int    sort_radix(ElementKind kind, ElementData data, size_t n);
+
+// Natural order of two values (numbers, strings, chars, bools)
+int    sort_compare_natural(const Value* a, const Value* b, int* comparable);
+
+#endif // TON_SORT_H
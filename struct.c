@@ -1,11 +1,93 @@
 #include "struct.h"
 #include "memory.h"
+#include "gc.h"
 #include "value.h"
+#include "hash.h"
 #include <string.h>
 
-// Global list of defined struct types
+// Global list of defined struct types, in definition order, with an
+// open-addressing index by name over it
 static TonStructType** defined_struct_types = NULL;
+static uint32_t* defined_struct_hashes = NULL;
 static int num_defined_struct_types = 0;
+static int defined_struct_capacity = 0;
+static int32_t* struct_type_index = NULL;
+static uint32_t struct_type_index_mask = 0;
+
+static uint32_t member_name_hash(const char* name) {
+    return (uint32_t)ton_hash_bytes(name, strlen(name), 0);
+}
+
+// Empty name index with room for `count` names at half load
+static int32_t* create_name_index(int count, uint32_t* mask) {
+    uint32_t size = 4;
+    while (size < (uint32_t)count * 2) size <<= 1;
+    int32_t* index = (int32_t*)ton_malloc(sizeof(int32_t) * size);
+    if (!index) return NULL;
+    memset(index, 0xff, sizeof(int32_t) * size);
+    *mask = size - 1;
+    return index;
+}
+
+static void name_index_insert(int32_t* index, uint32_t mask, const char* name, int32_t slot) {
+    uint32_t pos = member_name_hash(name) & mask;
+    while (index[pos] >= 0) pos = (pos + 1) & mask;
+    index[pos] = slot;
+}
+
+// Index the field names so lookups hash once instead of comparing every name
+static int build_field_index(TonStructType* t) {
+    t->field_index = create_name_index(t->num_fields, &t->field_index_mask);
+    if (!t->field_index) return 0;
+    for (int i = 0; i < t->num_fields; ++i) {
+        name_index_insert(t->field_index, t->field_index_mask, t->fields[i].name, i);
+    }
+    return 1;
+}
+
+static void struct_type_index_insert(int32_t slot) {
+    uint32_t pos = defined_struct_hashes[slot] & struct_type_index_mask;
+    while (struct_type_index[pos] >= 0) pos = (pos + 1) & struct_type_index_mask;
+    struct_type_index[pos] = slot;
+}
+
+// Add a type to the registry. The list and its index double when full, so
+// registration is amortized O(1). Types are reinserted in definition order,
+// so a lookup still finds the first type defined under a name.
+static int register_struct_type(TonStructType* t) {
+    if (num_defined_struct_types == defined_struct_capacity) {
+        int capacity = defined_struct_capacity ? defined_struct_capacity * 2 : 16;
+        TonStructType** types = ton_realloc(defined_struct_types, capacity * sizeof(TonStructType*));
+        if (!types) return 0;
+        defined_struct_types = types;
+        uint32_t* hashes = ton_realloc(defined_struct_hashes, capacity * sizeof(uint32_t));
+        if (!hashes) return 0;
+        defined_struct_hashes = hashes;
+        uint32_t mask;
+        int32_t* index = create_name_index(capacity, &mask);
+        if (!index) return 0;
+        ton_free(struct_type_index);
+        struct_type_index = index;
+        struct_type_index_mask = mask;
+        defined_struct_capacity = capacity;
+        for (int i = 0; i < num_defined_struct_types; ++i) struct_type_index_insert(i);
+    }
+    defined_struct_types[num_defined_struct_types] = t;
+    defined_struct_hashes[num_defined_struct_types] = member_name_hash(t->name);
+    struct_type_index_insert(num_defined_struct_types);
+    num_defined_struct_types++;
+    return 1;
+}
+
+static int method_slot(const TonStructType* t, const char* method_name) {
+    uint32_t pos = member_name_hash(method_name) & t->method_index_mask;
+    int32_t slot;
+    while ((slot = t->method_index[pos]) >= 0) {
+        if (strcmp(t->vtable[slot]->name, method_name) == 0) return slot;
+        pos = (pos + 1) & t->method_index_mask;
+    }
+    return -1;
+}
 
 TonStructType* define_struct_type(const char* name, StructField* fields, int num_fields, StructMethod* methods, int num_methods) {
     TonStructType* t = (TonStructType*)ton_malloc(sizeof(TonStructType));
@@ -19,9 +101,19 @@ TonStructType* define_struct_type(const char* name, StructField* fields, int num
     t->methods = methods;
     t->constructor = NULL;
     t->destructor = NULL;
-    t->vtable = (StructMethod**)ton_malloc(sizeof(StructMethod*) * t->num_methods);
+    t->vtable = NULL;
     t->vtable_size = 0;
+    t->method_index = NULL;
+    t->method_index_mask = 0;
     t->total_size = sizeof(TonStructType*) + (num_fields * sizeof(Value));
+    t->hashable = 0;
+    t->closure_env = NULL;
+    t->pool = NULL;
+    t->pool_count = 0;
+    if (!build_field_index(t)) {
+        ton_free(t);
+        return NULL;
+    }
     
     // Find constructor and destructor
     for (int i = 0; i < num_methods; i++) {
@@ -34,9 +126,11 @@ TonStructType* define_struct_type(const char* name, StructField* fields, int num
     }
     
     // Add to global list
-    defined_struct_types = ton_realloc(defined_struct_types, (num_defined_struct_types + 1) * sizeof(TonStructType*));
-    defined_struct_types[num_defined_struct_types] = t;
-    num_defined_struct_types++;
+    if (!register_struct_type(t)) {
+        ton_free(t->field_index);
+        ton_free(t);
+        return NULL;
+    }
     
     return t;
 }
@@ -46,55 +140,121 @@ void destroy_struct_type(TonStructType* t) {
     if (t->vtable) {
         ton_free(t->vtable);
     }
+    ton_free(t->field_index);
+    ton_free(t->method_index);
     ton_free(t);
 }
 
 TonStructInstance* create_struct_instance(const TonStructType* t) {
     if (!t) return NULL;
-    TonStructInstance* si = (TonStructInstance*)ton_malloc(sizeof(TonStructInstance));
-    if (!si) return NULL;
+    TonStructType* type = (TonStructType*)t;
+    TonStructInstance* si;
+    if (type->pool) {
+        si = type->pool;
+        type->pool = si->next_free;
+        type->pool_count--;
+        gc_reuse(si);
+    } else {
+        si = (TonStructInstance*)gc_alloc(GC_KIND_STRUCT, sizeof(TonStructInstance) + t->num_fields * sizeof(Value));
+        if (!si) return NULL;
+    }
     si->type = t;
-    si->field_values = (Value*)ton_calloc(t->num_fields, sizeof(Value));
+    si->field_values = (Value*)(si + 1);
     return si;
 }
 
 void destroy_struct_instance(TonStructInstance* si) {
     if (!si) return;
-    if (si->field_values) { ton_free(si->field_values); }
-    ton_free(si);
+    TonStructType* type = (TonStructType*)si->type;
+    for (int i = 0; i < type->num_fields; ++i) {
+        value_release(&si->field_values[i]);
+    }
+    if (type->pool_count == STRUCT_POOL_MAX) {
+        gc_free(si);
+        return;
+    }
+    gc_detach(si);
+    si->next_free = type->pool;
+    type->pool = si;
+    type->pool_count++;
+}
+
+int struct_field_slot(const TonStructType* t, const char* field_name) {
+    if (!t || !field_name) return -1;
+    uint32_t pos = member_name_hash(field_name) & t->field_index_mask;
+    int32_t slot;
+    while ((slot = t->field_index[pos]) >= 0) {
+        if (strcmp(t->fields[slot].name, field_name) == 0) return slot;
+        pos = (pos + 1) & t->field_index_mask;
+    }
+    return -1;
 }
 
 int struct_set_field(TonStructInstance* si, const char* field_name, Value v) {
     if (!si || !si->type) return 0;
-    for (int i = 0; i < si->type->num_fields; ++i) {
-        if (strcmp(si->type->fields[i].name, field_name) == 0) {
-            si->field_values[i] = v;
-            return 1;
-        }
-    }
-    return 0;
+    int slot = struct_field_slot(si->type, field_name);
+    if (slot < 0) return 0;
+    value_release(&si->field_values[slot]);
+    si->field_values[slot] = value_copy(&v);
+    gc_write_barrier(si, &v);
+    return 1;
 }
 
 Value struct_get_field(const TonStructInstance* si, const char* field_name) {
     Value out; out.type = VALUE_INT; out.data.int_val = 0;
     if (!si || !si->type) return out;
-    for (int i = 0; i < si->type->num_fields; ++i) {
-        if (strcmp(si->type->fields[i].name, field_name) == 0) {
-            return si->field_values[i];
-        }
-    }
-    return out;
+    int slot = struct_field_slot(si->type, field_name);
+    if (slot < 0) return out;
+    return si->field_values[slot];
 }
 
 // Method support functions
-FunctionDeclarationNode* struct_get_method(const TonStructType* t, const char* method_name) {
-    if (!t || !method_name) return NULL;
+int struct_build_vtable(TonStructType* t) {
+    if (!t) return 0;
+    int inherited = t->parent ? t->parent->vtable_size : 0;
+    StructMethod** vtable = (StructMethod**)ton_malloc(sizeof(StructMethod*) * (inherited + t->num_methods + 1));
+    uint32_t mask;
+    int32_t* index = create_name_index(inherited + t->num_methods, &mask);
+    if (!vtable || !index) {
+        ton_free(vtable);
+        ton_free(index);
+        return 0;
+    }
+    ton_free(t->vtable);
+    ton_free(t->method_index);
+    t->vtable = vtable;
+    t->method_index = index;
+    t->method_index_mask = mask;
+    t->vtable_size = 0;
+
+    if (inherited > 0) {
+        memcpy(vtable, t->parent->vtable, sizeof(StructMethod*) * inherited);
+        for (int i = 0; i < inherited; ++i) name_index_insert(index, mask, vtable[i]->name, i);
+        t->vtable_size = inherited;
+    }
     for (int i = 0; i < t->num_methods; ++i) {
-        if (strcmp(t->methods[i].name, method_name) == 0) {
-            return t->methods[i].function;
+        int slot = method_slot(t, t->methods[i].name);
+        if (slot >= 0) {
+            vtable[slot] = &t->methods[i]; // Override
+        } else {
+            vtable[t->vtable_size] = &t->methods[i];
+            name_index_insert(index, mask, t->methods[i].name, t->vtable_size);
+            t->vtable_size++;
         }
     }
-    return NULL;
+    return 1;
+}
+
+StructMethod* struct_find_method(const TonStructType* t, const char* method_name) {
+    if (!t || !method_name) return NULL;
+    if (!t->method_index) return find_method_in_hierarchy(t, method_name);
+    int slot = method_slot(t, method_name);
+    return slot >= 0 ? t->vtable[slot] : NULL;
+}
+
+FunctionDeclarationNode* struct_get_method(const TonStructType* t, const char* method_name) {
+    StructMethod* method = struct_find_method(t, method_name);
+    return method ? method->function : NULL;
 }
 
 Value struct_call_method(TonStructInstance* si, const char* method_name, Value* args, int num_args) {
@@ -193,12 +353,16 @@ void destroy_struct_with_destructor(TonStructInstance* si) {
 
 // Function to find struct type by name
 TonStructType* find_struct_type(const char* name) {
-    if (!name) return NULL;
+    if (!name || !struct_type_index) return NULL;
     
-    for (int i = 0; i < num_defined_struct_types; i++) {
-        if (defined_struct_types[i] && strcmp(defined_struct_types[i]->name, name) == 0) {
-            return defined_struct_types[i];
+    uint32_t hash = member_name_hash(name);
+    uint32_t pos = hash & struct_type_index_mask;
+    int32_t slot;
+    while ((slot = struct_type_index[pos]) >= 0) {
+        if (defined_struct_hashes[slot] == hash && strcmp(defined_struct_types[slot]->name, name) == 0) {
+            return defined_struct_types[slot];
         }
+        pos = (pos + 1) & struct_type_index_mask;
     }
     
     return NULL;
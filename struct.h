@@ -3,6 +3,7 @@
 
 
 #include <stddef.h>
+#include <stdint.h>
 
 // Forward declarations
 typedef struct FunctionDeclarationNode FunctionDeclarationNode;
@@ -34,34 +35,60 @@ typedef struct TonStructType {
     const char* name;
     const char* parent_name;    // New: for inheritance
     struct TonStructType* parent; // New: parent class pointer
-    int         num_fields;
+    int         num_fields;       // Including inherited fields, which come first
     StructField* fields;
+    int32_t*    field_index;      // Field slot per hash slot, -1 if empty; linear probing
+    uint32_t    field_index_mask;
     // Methods support
     int num_methods;
     StructMethod* methods;
     // OOP support
     StructMethod* constructor;   // New: default constructor
     StructMethod* destructor;    // New: destructor
-    StructMethod** vtable;       // New: virtual method table
-    int vtable_size;             // New: vtable size
+    StructMethod** vtable;       // Inherited and own methods, parent slots first; see struct_build_vtable
+    int vtable_size;
+    int32_t* method_index;       // vtable slot per hash slot, -1 if empty; linear probing
+    uint32_t method_index_mask;
     size_t total_size;           // New: total size of instance including type pointer
+    int hashable;                // Instances may be used as map keys / set members
+    struct Environment* closure_env; // Scope the class was declared in; methods run in frames below it
+    struct TonStructInstance* pool; // Collected instances kept for reuse, linked by next_free
+    int pool_count;
 } TonStructType;
 
+#define STRUCT_POOL_MAX 256      // Recycled instances kept per type
+
+// One allocation per instance: the field slots follow the header inline
 typedef struct TonStructInstance {
-    const TonStructType* type;
-    Value* field_values;
+    union {
+        const TonStructType* type;
+        struct TonStructInstance* next_free; // While waiting in the type's pool
+    };
+    Value* field_values;         // Points just past this header
 } TonStructInstance;
 
 TonStructType* define_struct_type(const char* name, StructField* fields, int num_fields, StructMethod* methods, int num_methods);
 void           destroy_struct_type(TonStructType* t);
 
+// Instances are collected objects; destroying one recycles it into its type's pool
 TonStructInstance* create_struct_instance(const TonStructType* t);
 void               destroy_struct_instance(TonStructInstance* si);
 
+// Slot of a field in field_values, or -1 if the type has no such field. A
+// type's layout never changes once defined, so callers may cache the slot
+// per type and skip the lookup while they see the same type again.
+int   struct_field_slot(const TonStructType* t, const char* field_name);
 int   struct_set_field(TonStructInstance* si, const char* field_name, Value v);
 Value struct_get_field(const TonStructInstance* si, const char* field_name);
 
 // Method support functions
+
+// Fill the vtable once the parent is set. The parent's entries keep their
+// slots, a method with the name of an inherited one replaces that entry, and
+// new methods are appended, so a method has the same slot in every subclass.
+int struct_build_vtable(TonStructType* t);
+// Method called for `name` on instances of t, searching parents too; NULL if none
+StructMethod* struct_find_method(const TonStructType* t, const char* method_name);
 FunctionDeclarationNode* struct_get_method(const TonStructType* t, const char* method_name);
 Value struct_call_method(TonStructInstance* si, const char* method_name, Value* args, int num_args);
 
@@ -0,0 +1,25 @@
+#!/bin/sh
+# alloc_profile_test.sh - run alloc_profile_test.ton under --alloc-profile and
+# check that both reports name the allocating call site
+# usage: sh test/alloc_profile_test.sh [path/to/ton.exe]
+TON=${1:-./ton.exe}
+DIR=$(dirname "$0")
+OUT=${TMPDIR:-/tmp}/ton_alloc_profile_test.collapsed
+rm -f "$OUT"
+
+REPORT=$("$TON" --alloc-profile="$OUT" --alloc-profile-rate=4096 "$DIR/alloc_profile_test.ton" 2>&1) || {
+    echo "FAIL: interpreter exited with status $?"
+    exit 1
+}
+# Top-sites table: list growth in collections.c charged to Ton line 8 (list_push in build)
+echo "$REPORT" | grep -q "collections\.c:[0-9]* *8$" || {
+    echo "FAIL: report does not name the list_push call site"
+    exit 1
+}
+# Collapsed stacks: main -> build at line 8 -> the C allocation
+grep -q "^<toplevel>:[0-9]*;main:[0-9]*;build:8;collections\.c:[0-9]* [0-9]*$" "$OUT" || {
+    echo "FAIL: collapsed stacks lack main;build:8"
+    exit 1
+}
+rm -f "$OUT"
+echo "PASS"
@@ -102,6 +102,102 @@ Value create_value_tonset(void* set) {
     return val;
 }
 
+Value create_value_tondeque(void* deque) {
+    Value val;
+    val.type = VALUE_TONDEQUE;
+    val.data.tondeque_val = deque;
+    val.ref_count = 1;
+    return val;
+}
+
+Value create_value_tonpq(void* pq) {
+    Value val;
+    val.type = VALUE_TONPQ;
+    val.data.tonpq_val = pq;
+    val.ref_count = 1;
+    return val;
+}
+
+Value create_value_tonomap(void* map) {
+    Value val;
+    val.type = VALUE_TONOMAP;
+    val.data.tonomap_val = map;
+    val.ref_count = 1;
+    return val;
+}
+
+Value create_value_tonpvec(void* vec) {
+    Value val;
+    val.type = VALUE_TONPVEC;
+    val.data.tonpvec_val = vec;
+    val.ref_count = 1;
+    return val;
+}
+
+Value create_value_tonpmap(void* map) {
+    Value val;
+    val.type = VALUE_TONPMAP;
+    val.data.tonpmap_val = map;
+    val.ref_count = 1;
+    return val;
+}
+
+Value create_value_tonbloom(void* bloom) {
+    Value val;
+    val.type = VALUE_TONBLOOM;
+    val.data.tonbloom_val = bloom;
+    val.ref_count = 1;
+    return val;
+}
+
+Value create_value_tonhll(void* hll) {
+    Value val;
+    val.type = VALUE_TONHLL;
+    val.data.tonhll_val = hll;
+    val.ref_count = 1;
+    return val;
+}
+
+Value create_value_tonbitmap(void* bitmap) {
+    Value val;
+    val.type = VALUE_TONBITMAP;
+    val.data.tonbitmap_val = bitmap;
+    val.ref_count = 1;
+    return val;
+}
+
+Value create_value_tonart(void* art) {
+    Value val;
+    val.type = VALUE_TONART;
+    val.data.tonart_val = art;
+    val.ref_count = 1;
+    return val;
+}
+
+Value create_value_toncache(void* cache) {
+    Value val;
+    val.type = VALUE_TONCACHE;
+    val.data.toncache_val = cache;
+    val.ref_count = 1;
+    return val;
+}
+
+Value create_value_tonsoa(void* soa) {
+    Value val;
+    val.type = VALUE_TONSOA;
+    val.data.tonsoa_val = soa;
+    val.ref_count = 1;
+    return val;
+}
+
+Value create_value_tondigest(void* digest) {
+    Value val;
+    val.type = VALUE_TONDIGEST;
+    val.data.tondigest_val = digest;
+    val.ref_count = 1;
+    return val;
+}
+
 Value create_value_method(Value* object, char* method_name) {
     Value val;
     val.type = VALUE_METHOD;
@@ -137,7 +233,7 @@ Value create_value_error(const char* message)
 }
 
 void value_add_ref(Value* val) {
-    if (val->type == VALUE_STRING || val->type == VALUE_FN || val->type == VALUE_ARRAY || val->type == VALUE_TONLIST || val->type == VALUE_TONMAP || val->type == VALUE_TONSET || val->type == VALUE_METHOD) {
+    if (val->type == VALUE_STRING || val->type == VALUE_FN || val->type == VALUE_ARRAY || val->type == VALUE_TONLIST || val->type == VALUE_TONMAP || val->type == VALUE_TONSET || val->type == VALUE_TONDEQUE || val->type == VALUE_TONPQ || val->type == VALUE_TONOMAP || val->type == VALUE_TONPVEC || val->type == VALUE_TONPMAP || val->type == VALUE_TONBLOOM || val->type == VALUE_TONHLL || val->type == VALUE_TONBITMAP || val->type == VALUE_TONART || val->type == VALUE_TONCACHE || val->type == VALUE_TONSOA || val->type == VALUE_TONDIGEST || val->type == VALUE_METHOD) {
         val->ref_count++;
     }
 }
@@ -149,9 +245,14 @@ void value_add_ref(Value* val) {
 void value_release(Value* val) {
     if (!val) return;
     
-    // Only reference-counted types need special handling
+    // Only reference-counted types need special handling. Functions, collections
+    // and struct instances are owned by the garbage collector and never freed here.
     if (val->type == VALUE_STRING || val->type == VALUE_FN || val->type == VALUE_ARRAY || 
         val->type == VALUE_TONLIST || val->type == VALUE_TONMAP || val->type == VALUE_TONSET || 
+        val->type == VALUE_TONDEQUE || val->type == VALUE_TONPQ || val->type == VALUE_TONOMAP || 
+        val->type == VALUE_TONPVEC || val->type == VALUE_TONPMAP || 
+        val->type == VALUE_TONBLOOM || val->type == VALUE_TONHLL || val->type == VALUE_TONBITMAP || 
+        val->type == VALUE_TONART || val->type == VALUE_TONCACHE || val->type == VALUE_TONSOA || val->type == VALUE_TONDIGEST || 
         val->type == VALUE_METHOD || val->type == VALUE_ERROR || val->type == VALUE_STRUCT) {
         
         if (val->ref_count > 0) {
@@ -181,20 +282,6 @@ void value_release(Value* val) {
                     }
                     break;
                     
-                case VALUE_FN:
-                    if (val->data.function_value) {
-                        if (val->data.function_value->type == USER_DEFINED && 
-                            val->data.function_value->closure_env) {
-                            env_release(val->data.function_value->closure_env);
-                        }
-                        if (val->data.function_value->name) {
-                            ton_free(val->data.function_value->name);
-                        }
-                        ton_free(val->data.function_value);
-                        val->data.function_value = NULL;
-                    }
-                    break;
-                    
                 default:
                     // For other reference-counted types, just reset the pointer
                     break;
@@ -203,6 +290,32 @@ void value_release(Value* val) {
     }
 }
 
+/**
+ * Make an owned copy of a value for storing in a variable or container slot
+ * @param val Value to copy
+ * @return Copy whose string payload can be released independently of val
+ */
+Value value_copy(const Value* val) {
+    Value copy = *val;
+    switch (val->type) {
+        case VALUE_STRING:
+            copy.data.string_val = ton_strdup(val->data.string_val);
+            copy.ref_count = 1;
+            break;
+        case VALUE_METHOD:
+            copy.data.method_val.method_name = ton_strdup(val->data.method_val.method_name);
+            copy.ref_count = 1;
+            break;
+        case VALUE_ERROR:
+            copy.data.error_message = ton_strdup(val->data.error_message);
+            copy.ref_count = 0;
+            break;
+        default:
+            break;
+    }
+    return copy;
+}
+
 char* value_to_string(Value* val) {
     char* str = (char*)ton_malloc(256);
     if (!str) {
@@ -243,6 +356,42 @@ char* value_to_string(Value* val) {
         case VALUE_TONSET:
             strcpy(str, "[tonset]");
             break;
+        case VALUE_TONDEQUE:
+            strcpy(str, "[tondeque]");
+            break;
+        case VALUE_TONPQ:
+            strcpy(str, "[tonpq]");
+            break;
+        case VALUE_TONOMAP:
+            strcpy(str, "[tonomap]");
+            break;
+        case VALUE_TONPVEC:
+            strcpy(str, "[tonpvec]");
+            break;
+        case VALUE_TONPMAP:
+            strcpy(str, "[tonpmap]");
+            break;
+        case VALUE_TONBLOOM:
+            strcpy(str, "[tonbloom]");
+            break;
+        case VALUE_TONHLL:
+            strcpy(str, "[tonhll]");
+            break;
+        case VALUE_TONBITMAP:
+            strcpy(str, "[tonbitmap]");
+            break;
+        case VALUE_TONART:
+            strcpy(str, "[tonart]");
+            break;
+        case VALUE_TONCACHE:
+            strcpy(str, "[toncache]");
+            break;
+        case VALUE_TONSOA:
+            strcpy(str, "[tonsoa]");
+            break;
+        case VALUE_TONDIGEST:
+            strcpy(str, "[tondigest]");
+            break;
         case VALUE_MACRO:
             strcpy(str, "[macro]");
             break;
@@ -269,6 +418,18 @@ const char* value_type_to_string(ValueType type) {
         case VALUE_TONLIST: return "tonlist";
         case VALUE_TONMAP: return "tonmap";
         case VALUE_TONSET: return "tonset";
+        case VALUE_TONDEQUE: return "tondeque";
+        case VALUE_TONPQ: return "tonpq";
+        case VALUE_TONOMAP: return "tonomap";
+        case VALUE_TONPVEC: return "tonpvec";
+        case VALUE_TONPMAP: return "tonpmap";
+        case VALUE_TONBLOOM: return "tonbloom";
+        case VALUE_TONHLL: return "tonhll";
+        case VALUE_TONBITMAP: return "tonbitmap";
+        case VALUE_TONART: return "tonart";
+        case VALUE_TONCACHE: return "toncache";
+        case VALUE_TONSOA: return "tonsoa";
+        case VALUE_TONDIGEST: return "tondigest";
         case VALUE_METHOD: return "method";
         case VALUE_CHAR: return "char";
         case VALUE_STRUCT: return "struct";
@@ -315,6 +476,18 @@ VariableType value_type_to_variable_type(ValueType value_type) {
         case VALUE_TONLIST: return VAR_TYPE_ARRAY;
         case VALUE_TONMAP: return VAR_TYPE_ARRAY;
         case VALUE_TONSET: return VAR_TYPE_ARRAY;
+        case VALUE_TONDEQUE: return VAR_TYPE_ARRAY;
+        case VALUE_TONPQ: return VAR_TYPE_ARRAY;
+        case VALUE_TONOMAP: return VAR_TYPE_ARRAY;
+        case VALUE_TONPVEC: return VAR_TYPE_ARRAY;
+        case VALUE_TONPMAP: return VAR_TYPE_ARRAY;
+        case VALUE_TONBLOOM: return VAR_TYPE_ARRAY;
+        case VALUE_TONHLL: return VAR_TYPE_ARRAY;
+        case VALUE_TONBITMAP: return VAR_TYPE_ARRAY;
+        case VALUE_TONART: return VAR_TYPE_ARRAY;
+        case VALUE_TONCACHE: return VAR_TYPE_ARRAY;
+        case VALUE_TONSOA: return VAR_TYPE_ARRAY;
+        case VALUE_TONDIGEST: return VAR_TYPE_ARRAY;
         case VALUE_METHOD: return VAR_TYPE_FUNCTION;
         case VALUE_STRUCT: return VAR_TYPE_UNKNOWN;
         case VALUE_ERROR: return VAR_TYPE_UNKNOWN;
@@ -33,6 +33,18 @@ typedef enum {
     VALUE_TONLIST,
     VALUE_TONMAP,
     VALUE_TONSET,
+    VALUE_TONDEQUE,
+    VALUE_TONPQ,
+    VALUE_TONOMAP,
+    VALUE_TONPVEC,
+    VALUE_TONPMAP,
+    VALUE_TONBLOOM,
+    VALUE_TONHLL,
+    VALUE_TONBITMAP,
+    VALUE_TONART,
+    VALUE_TONCACHE,
+    VALUE_TONSOA,
+    VALUE_TONDIGEST,
     VALUE_METHOD,
     VALUE_CHAR,
     VALUE_STRUCT, // Add this line
@@ -54,6 +66,18 @@ typedef struct Value {
         void* tonlist_val;     // TonList pointer
         void* tonmap_val;      // TonMap pointer
         void* tonset_val;      // TonSet pointer
+        void* tondeque_val;    // TonDeque pointer
+        void* tonpq_val;       // TonPQ pointer
+        void* tonomap_val;     // TonOMap pointer
+        void* tonpvec_val;     // TonPVec pointer
+        void* tonpmap_val;     // TonPMap pointer
+        void* tonbloom_val;    // TonBloom pointer
+        void* tonhll_val;      // TonHLL pointer
+        void* tonbitmap_val;   // TonBitmap pointer
+        void* tonart_val;      // TonART pointer
+        void* toncache_val;    // TonCache pointer
+        void* tonsoa_val;      // TonSoA pointer
+        void* tondigest_val;   // TonDigest pointer
         MethodData method_val; // Method data for object method calls
         char char_val;
         void* struct_val; // Add this line
@@ -78,6 +102,18 @@ Value create_value_array(void* arr);
 Value create_value_tonlist(void* list);
 Value create_value_tonmap(void* map);
 Value create_value_tonset(void* set);
+Value create_value_tondeque(void* deque);
+Value create_value_tonpq(void* pq);
+Value create_value_tonomap(void* map);
+Value create_value_tonpvec(void* vec);
+Value create_value_tonpmap(void* map);
+Value create_value_tonbloom(void* bloom);
+Value create_value_tonhll(void* hll);
+Value create_value_tonbitmap(void* bitmap);
+Value create_value_tonart(void* art);
+Value create_value_toncache(void* cache);
+Value create_value_tonsoa(void* soa);
+Value create_value_tondigest(void* digest);
 Value create_value_method(Value* object, char* method_name);
 Value create_value_char(char c);
 Value create_value_struct(void* s); // Add this line
@@ -87,6 +123,7 @@ Value create_value_error(const char* message);
 // Memory management functions
 void value_add_ref(Value* val);
 void value_release(Value* value);
+Value value_copy(const Value* val);
 char* value_to_string(Value* val);
 const char* value_type_to_string(ValueType type);
 